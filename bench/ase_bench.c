@@ -0,0 +1,641 @@
+/*
+ase_bench.c - timing for paq_aseprite.h
+
+Build from the repo root:
+	cc -O2 -D_POSIX_C_SOURCE=200809L bench/ase_bench.c -o ase_bench -lm -lpthread
+	cl /O2 bench\ase_bench.c
+
+Run:
+	ase_bench [--warmup N] [--reps N] [--json out.json|-] [files or dirs...]
+
+With no files it times a set of generated sprites covering RGBA, grayscale
+and indexed depths, raw, linked and compressed cels, and sprites with lots of
+frames or lots of layers. Files and directories given on the command line are
+timed as well (directories are not searched recursively).
+
+Each sprite is loaded into memory first, so disk speed doesn't count. Phases:
+	decode   ASE_load_from_memory + ASE_free, the whole thing
+	headers  walking the file, frame and chunk headers only
+	inflate  stbi_zlib_decode_buffer over the sprite's compressed cels
+	alloc    replaying the malloc/realloc/free calls one decode makes
+
+MB/s is bytes of .ase file per second for decode, headers and alloc, and
+inflated bytes per second for inflate. "share" is the phase's time over the
+decode time, so you can see where a slow sprite spends it.
+*/
+#include "bench.h"
+
+#if !defined(_WIN32)
+#	include <dirent.h>
+#endif
+
+// every allocation the decoder makes goes through here so one decode can be
+// recorded and replayed on its own
+static void *BENCH_ase_malloc(size_t size);
+static void *BENCH_ase_realloc(void *p, size_t size);
+static void  BENCH_ase_free(void *p);
+
+#define ASE_MALLOC  BENCH_ase_malloc
+#define ASE_REALLOC BENCH_ase_realloc
+#define ASE_FREE    BENCH_ase_free
+#define ASE_IMPLEMENTATION
+#include "../paq_aseprite.h"
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// allocation recording
+//
+enum { ALLOC_MALLOC, ALLOC_REALLOC, ALLOC_FREE };
+
+typedef struct {
+	int    kind;
+	int    slot;  // -1 for null
+	int    to;    // slot of the result (malloc, realloc)
+	size_t size;
+} BENCH_AllocOp;
+
+typedef struct {
+	int             recording;
+	int             nops, cap;
+	BENCH_AllocOp * ops;
+	int             nslots;
+
+	// live pointer -> slot, open addressing
+	int    mask;
+	void **keys;
+	int  * vals;
+} BENCH_AllocLog;
+
+static BENCH_AllocLog BENCH_alloc_log;
+
+static uint32_t BENCH__ptr_hash(void *P)
+{
+	uint64_t X = (uint64_t)(uintptr_t)P;
+	X ^= X >> 33;
+	X *= 0xff51afd7ed558ccdull;
+	X ^= X >> 33;
+	return((uint32_t)X);
+}
+
+static void BENCH__log_put(void *P, int Slot);
+
+static void BENCH__log_grow(void)
+{
+	BENCH_AllocLog *L = &BENCH_alloc_log;
+	int    OldSize = L->mask ? L->mask + 1 : 0;
+	void **OldKeys = L->keys;
+	int  * OldVals = L->vals;
+	int    Size    = OldSize ? OldSize * 2 : 1024;
+
+	L->mask = Size - 1;
+	L->keys = (void **)calloc(Size, sizeof(void *));
+	L->vals = (int *)malloc(Size * sizeof(int));
+	for (int i=0; i < OldSize; ++i) {
+		if (OldKeys[i] && OldVals[i] >= 0) BENCH__log_put(OldKeys[i], OldVals[i]);
+	}
+	free(OldKeys);
+	free(OldVals);
+}
+
+// slot -1 marks a freed pointer, which keeps probe chains intact
+static void BENCH__log_put(void *P, int Slot)
+{
+	BENCH_AllocLog *L = &BENCH_alloc_log;
+	uint32_t i = BENCH__ptr_hash(P) & L->mask;
+	while (L->keys[i] && L->keys[i] != P) i = (i + 1) & L->mask;
+	L->keys[i] = P;
+	L->vals[i] = Slot;
+}
+
+// looks up a pointer that's about to be freed and forgets it
+static int BENCH__log_take(void *P)
+{
+	BENCH_AllocLog *L = &BENCH_alloc_log;
+	if (!P || !L->mask) return(-1);
+	uint32_t i = BENCH__ptr_hash(P) & L->mask;
+	while (L->keys[i]) {
+		if (L->keys[i] == P) {
+			int Slot = L->vals[i];
+			L->vals[i] = -1;
+			return(Slot);
+		}
+		i = (i + 1) & L->mask;
+	}
+	return(-1);
+}
+
+static void BENCH__log_op(int Kind, int Slot, void *New, size_t Size)
+{
+	BENCH_AllocLog *L = &BENCH_alloc_log;
+	if (L->nops == L->cap) {
+		L->cap = L->cap ? L->cap * 2 : 1024;
+		L->ops = (BENCH_AllocOp *)realloc(L->ops, L->cap * sizeof(BENCH_AllocOp));
+	}
+	// keep the table under half full, tombstones included
+	if (!L->mask || L->nslots * 2 >= L->mask) BENCH__log_grow();
+
+	BENCH_AllocOp *Op = L->ops + L->nops++;
+	Op->kind = Kind;
+	Op->size = Size;
+	Op->slot = Slot;
+	Op->to   = -1;
+	if (New) {
+		Op->to = L->nslots++;
+		BENCH__log_put(New, Op->to);
+	}
+}
+
+static void *BENCH_ase_malloc(size_t size)
+{
+	void *P = malloc(size);
+	if (BENCH_alloc_log.recording) BENCH__log_op(ALLOC_MALLOC, -1, P, size);
+	return(P);
+}
+
+static void *BENCH_ase_realloc(void *p, size_t size)
+{
+	int Slot = BENCH_alloc_log.recording ? BENCH__log_take(p) : -1;
+	void *P = realloc(p, size);
+	if (BENCH_alloc_log.recording) BENCH__log_op(ALLOC_REALLOC, Slot, P, size);
+	return(P);
+}
+
+static void BENCH_ase_free(void *p)
+{
+	if (BENCH_alloc_log.recording && p) BENCH__log_op(ALLOC_FREE, BENCH__log_take(p), 0, 0);
+	free(p);
+}
+
+static void BENCH_alloc_reset(void)
+{
+	BENCH_AllocLog *L = &BENCH_alloc_log;
+	free(L->keys);
+	free(L->vals);
+	L->keys = 0;
+	L->vals = 0;
+	L->mask = 0;
+	L->nops = 0;
+	L->nslots = 0;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// sprite generator
+//
+// writes the same layout Aseprite does: header, then per frame a palette,
+// layer and tag chunks (first frame only) followed by one cel per layer
+
+typedef struct {
+	uint8_t *data;
+	int      len, cap;
+} BENCH_Buf;
+
+static void BENCH__buf_put(BENCH_Buf *B, const void *Data, int Len)
+{
+	if (B->len + Len > B->cap) {
+		while (B->len + Len > B->cap) B->cap = B->cap ? B->cap * 2 : 4096;
+		B->data = (uint8_t *)realloc(B->data, B->cap);
+	}
+	if (Data) memcpy(B->data + B->len, Data, Len);
+	else      memset(B->data + B->len, 0, Len);
+	B->len += Len;
+}
+
+static void BENCH__buf_u8(BENCH_Buf *B, int V)   { uint8_t X = (uint8_t)V; BENCH__buf_put(B, &X, 1); }
+static void BENCH__buf_u16(BENCH_Buf *B, int V)  { BENCH__buf_u8(B, V); BENCH__buf_u8(B, V >> 8); }
+static void BENCH__buf_u32(BENCH_Buf *B, uint32_t V) { BENCH__buf_u16(B, V & 0xffff); BENCH__buf_u16(B, V >> 16); }
+static void BENCH__buf_zero(BENCH_Buf *B, int N) { BENCH__buf_put(B, 0, N); }
+static void BENCH__buf_str(BENCH_Buf *B, const char *S)
+{
+	BENCH__buf_u16(B, (int)strlen(S));
+	BENCH__buf_put(B, S, (int)strlen(S));
+}
+
+static void BENCH__patch_u32(BENCH_Buf *B, int At, uint32_t V)
+{
+	for (int i=0; i < 4; ++i) B->data[At + i] = (uint8_t)(V >> (8 * i));
+}
+
+// chunk header goes in with a zero size, patched when the chunk ends
+static int  BENCH__chunk_begin(BENCH_Buf *B, int Type) { int At = B->len; BENCH__buf_u32(B, 0); BENCH__buf_u16(B, Type); return(At); }
+static void BENCH__chunk_end(BENCH_Buf *B, int At) { BENCH__patch_u32(B, At, B->len - At); }
+
+enum { CELS_RAW = 1, CELS_COMPRESSED = 2, CELS_LINKED = 4 };
+
+typedef struct {
+	const char *name;
+	int w, h;
+	int depth;
+	int nlayers;
+	int nframes;
+	int ntags;
+	int cels;    // CELS_*
+	int level;   // zlib level for compressed cels
+} BENCH_SpriteSpec;
+
+static uint8_t *BENCH_make_sprite(const BENCH_SpriteSpec *S, uint32_t Seed, int *OutLen)
+{
+	BENCH_Buf B = {0};
+	int Bpp = S->depth / 8;
+	int MaxPixels = S->w * S->h * Bpp;
+	uint8_t *Pixels = (uint8_t *)malloc(MaxPixels);
+
+	// file header, 128 bytes
+	BENCH__buf_u32(&B, 0);
+	BENCH__buf_u16(&B, ASE_FILE_MAGIC);
+	BENCH__buf_u16(&B, S->nframes);
+	BENCH__buf_u16(&B, S->w);
+	BENCH__buf_u16(&B, S->h);
+	BENCH__buf_u16(&B, S->depth);
+	BENCH__buf_u32(&B, ASE_FILE_FLAG_LAYER_WITH_OPACITY);
+	BENCH__buf_u16(&B, 100);
+	BENCH__buf_u32(&B, 0);
+	BENCH__buf_u32(&B, 0);
+	BENCH__buf_u8(&B, 0);
+	BENCH__buf_zero(&B, 3);
+	BENCH__buf_u16(&B, 256);
+	BENCH__buf_u8(&B, 1);
+	BENCH__buf_u8(&B, 1);
+	BENCH__buf_zero(&B, 128 - B.len);
+
+	for (int f=0; f < S->nframes; ++f) {
+		int FrameAt = B.len, Chunks = 0;
+		BENCH__buf_u32(&B, 0);
+		BENCH__buf_u16(&B, ASE_FILE_FRAME_MAGIC);
+		BENCH__buf_u16(&B, 0); // chunk count, patched below
+		BENCH__buf_u16(&B, 50 + (f % 7) * 25);
+		BENCH__buf_zero(&B, 6);
+
+		if (f == 0) {
+			int At = BENCH__chunk_begin(&B, ASE_FILE_CHUNK_PALETTE);
+			BENCH__buf_u32(&B, 64);
+			BENCH__buf_u32(&B, 0);
+			BENCH__buf_u32(&B, 63);
+			BENCH__buf_zero(&B, 8);
+			for (int i=0; i < 64; ++i) {
+				BENCH__buf_u16(&B, 0);
+				BENCH__buf_u8(&B, i);
+				BENCH__buf_u8(&B, i * 3);
+				BENCH__buf_u8(&B, 255 - i);
+				BENCH__buf_u8(&B, 255);
+			}
+			BENCH__chunk_end(&B, At);
+			++Chunks;
+
+			for (int l=0; l < S->nlayers; ++l) {
+				char Name[32];
+				snprintf(Name, sizeof(Name), "layer %d", l);
+				At = BENCH__chunk_begin(&B, ASE_FILE_CHUNK_LAYER);
+				BENCH__buf_u16(&B, 3); // visible | editable
+				BENCH__buf_u16(&B, ASE_FILE_LAYER_IMAGE);
+				BENCH__buf_u16(&B, 0);
+				BENCH__buf_u16(&B, 0);
+				BENCH__buf_u16(&B, 0);
+				BENCH__buf_u16(&B, 0);
+				BENCH__buf_u8(&B, 255);
+				BENCH__buf_zero(&B, 3);
+				BENCH__buf_str(&B, Name);
+				BENCH__chunk_end(&B, At);
+				++Chunks;
+			}
+
+			if (S->ntags) {
+				At = BENCH__chunk_begin(&B, ASE_FILE_CHUNK_FRAME_TAGS);
+				BENCH__buf_u16(&B, S->ntags);
+				BENCH__buf_zero(&B, 8);
+				for (int t=0; t < S->ntags; ++t) {
+					char Name[32];
+					snprintf(Name, sizeof(Name), "tag %d", t);
+					BENCH__buf_u16(&B, (t * S->nframes) / S->ntags);
+					BENCH__buf_u16(&B, ((t + 1) * S->nframes) / S->ntags - 1);
+					BENCH__buf_u8(&B, t % 3);
+					BENCH__buf_zero(&B, 8);
+					BENCH__buf_zero(&B, 4);
+					BENCH__buf_str(&B, Name);
+				}
+				BENCH__chunk_end(&B, At);
+				++Chunks;
+			}
+		}
+
+		for (int l=0; l < S->nlayers; ++l) {
+			int Type = (S->cels & CELS_COMPRESSED) ? ASE_FILE_COMPRESSED_CEL : ASE_FILE_RAW_CEL;
+			if ((S->cels & CELS_RAW) && (S->cels & CELS_COMPRESSED) && ((f + l) & 1)) Type = ASE_FILE_RAW_CEL;
+			if ((S->cels & CELS_LINKED) && f > 0 && (f + l) % 3 == 0) Type = ASE_FILE_LINK_CEL;
+
+			int At = BENCH__chunk_begin(&B, ASE_FILE_CHUNK_CEL);
+			BENCH__buf_u16(&B, l);
+			BENCH__buf_u16(&B, BENCH_rand(&Seed) % 8);
+			BENCH__buf_u16(&B, BENCH_rand(&Seed) % 8);
+			BENCH__buf_u8(&B, 255);
+			BENCH__buf_u16(&B, Type);
+			BENCH__buf_zero(&B, 7);
+
+			if (Type == ASE_FILE_LINK_CEL) {
+				BENCH__buf_u16(&B, f - 1);
+			} else {
+				int W = S->w / 2 + BENCH_rand(&Seed) % (S->w / 2 + 1);
+				int H = S->h / 2 + BENCH_rand(&Seed) % (S->h / 2 + 1);
+				BENCH__buf_u16(&B, W);
+				BENCH__buf_u16(&B, H);
+				BENCH_fill_pixels(Pixels, W * H * Bpp, Bpp, &Seed);
+				if (Type == ASE_FILE_RAW_CEL) {
+					BENCH__buf_put(&B, Pixels, W * H * Bpp);
+				} else {
+					int ZLen = 0;
+					uint8_t *Z = BENCH_zlib_alloc(Pixels, W * H * Bpp, S->level, &ZLen);
+					BENCH__buf_put(&B, Z, ZLen);
+					free(Z);
+				}
+			}
+			BENCH__chunk_end(&B, At);
+			++Chunks;
+		}
+
+		BENCH__patch_u32(&B, FrameAt, B.len - FrameAt);
+		B.data[FrameAt + 6] = (uint8_t)Chunks;
+		B.data[FrameAt + 7] = (uint8_t)(Chunks >> 8);
+	}
+	BENCH__patch_u32(&B, 0, B.len);
+
+	free(Pixels);
+	*OutLen = B.len;
+	return(B.data);
+}
+
+static const BENCH_SpriteSpec BENCH_sprites[] = {
+	//  name                    w    h  depth layers frames tags  cels                          level
+	{ "rgba-compressed",      128, 128, 32,     4,    32,   4, CELS_COMPRESSED,                 6 },
+	{ "rgba-raw",             128, 128, 32,     4,    32,   4, CELS_RAW,                        0 },
+	{ "rgba-linked",          128, 128, 32,     4,    32,   4, CELS_COMPRESSED | CELS_LINKED,   6 },
+	{ "rgba-mixed-stored",    128, 128, 32,     4,    32,   4, CELS_RAW | CELS_COMPRESSED,      0 },
+	{ "grayscale-compressed", 128, 128, 16,     4,    32,   4, CELS_COMPRESSED,                 6 },
+	{ "grayscale-raw",        128, 128, 16,     4,    32,   4, CELS_RAW,                        0 },
+	{ "indexed-compressed",   128, 128,  8,     4,    32,   4, CELS_COMPRESSED,                 6 },
+	{ "indexed-raw",          128, 128,  8,     4,    32,   4, CELS_RAW,                        0 },
+	{ "many-frames",           32,  32, 32,     2,  2000,  64, CELS_COMPRESSED | CELS_LINKED,   6 },
+	{ "many-layers",           64,  64, 32,   200,     8,   2, CELS_COMPRESSED | CELS_LINKED,   6 },
+	{ "large-canvas",         512, 512, 32,     2,     4,   1, CELS_COMPRESSED,                 9 },
+};
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// what gets timed
+//
+typedef struct {
+	uint8_t *compressed;
+	int      len;
+	int      olen;
+} BENCH_Stream;
+
+typedef struct {
+	char          name[256];
+	uint8_t     * data;
+	int           len;
+
+	// filled by BENCH_scan
+	int           frames, chunks, cels;
+	int           nstreams;
+	BENCH_Stream *streams;
+	int           inflated;   // sum of olen
+	uint8_t     * out;        // big enough for the largest stream
+} BENCH_Case;
+
+// walks every header with the decoder's own readers; the same walk finds
+// the compressed cels when 'Collect' is set
+static int BENCH_scan(BENCH_Case *C, int Collect)
+{
+	ASE__ctx Ctx;
+	memset(&Ctx, 0, sizeof(Ctx));
+	ASE__start_mem(&Ctx, C->data, C->len);
+
+	ASE_DOC_Header Header;
+	if (!ASE_DOC_Header_read(&Ctx, &Header)) return(0);
+	int Bpp = Header.depth / 8, Cels = 0, Chunks = 0, MaxOut = 0;
+
+	for (int i=0; i < Header.frames; ++i) {
+		size_t FrameStart = Ctx.io.tell(Ctx.udata);
+		ASE_FrameHeader FrameHeader;
+		ASE_FrameHeader_read(&Ctx, &FrameHeader);
+
+		for (int j=0; j < FrameHeader.chunks; ++j) {
+			size_t ChunkStart = Ctx.io.tell(Ctx.udata);
+			ASE_DOC_ChunkHeader ChunkHeader;
+			ASE_DOC_ChunkHeader_read(&Ctx, &ChunkHeader);
+			++Chunks;
+
+			if (ChunkHeader.type == ASE_FILE_CHUNK_CEL) {
+				++Cels;
+				if (Collect) {
+					Ctx.io.skip(Ctx.udata, 7);
+					int Type = ASE__read16(&Ctx);
+					Ctx.io.skip(Ctx.udata, 7);
+					if (Type == ASE_FILE_COMPRESSED_CEL) {
+						int W = ASE__read16(&Ctx);
+						int H = ASE__read16(&Ctx);
+						int At = Ctx.io.tell(Ctx.udata);
+						int End = (int)(ChunkStart + ChunkHeader.size);
+						if (End > C->len) End = C->len;
+						if (End > At && W > 0 && H > 0) {
+							BENCH_Stream *S;
+							C->streams = (BENCH_Stream *)realloc(C->streams, (C->nstreams + 1) * sizeof(BENCH_Stream));
+							S = C->streams + C->nstreams++;
+							S->compressed = C->data + At;
+							S->len  = End - At;
+							S->olen = W * H * Bpp;
+							C->inflated += S->olen;
+							if (S->olen > MaxOut) MaxOut = S->olen;
+						}
+					}
+				}
+			}
+			Ctx.io.seek(Ctx.udata, (int)(ChunkStart + ChunkHeader.size));
+		}
+		Ctx.io.seek(Ctx.udata, (int)(FrameStart + FrameHeader.size));
+	}
+
+	if (Collect) {
+		C->frames = Header.frames;
+		C->chunks = Chunks;
+		C->cels   = Cels;
+		C->out    = (uint8_t *)malloc(MaxOut ? MaxOut : 1);
+	}
+	return(Chunks);
+}
+
+static volatile int BENCH_sink;
+
+static void BENCH_run_decode(void *User)
+{
+	BENCH_Case *C = (BENCH_Case *)User;
+	ASE_Sprite S = {0};
+	if (ASE_load_from_memory(C->data, C->len, &S)) {
+		BENCH_sink += S.nframes;
+		ASE_free(&S);
+	}
+}
+
+static void BENCH_run_headers(void *User)
+{
+	BENCH_sink += BENCH_scan((BENCH_Case *)User, 0);
+}
+
+static void BENCH_run_inflate(void *User)
+{
+	BENCH_Case *C = (BENCH_Case *)User;
+	for (int i=0; i < C->nstreams; ++i) {
+		BENCH_Stream *S = C->streams + i;
+		BENCH_sink += stbi_zlib_decode_buffer((char *)C->out, S->olen, (const char *)S->compressed, S->len);
+	}
+}
+
+static void BENCH_run_alloc(void *User)
+{
+	BENCH_AllocLog *L = &BENCH_alloc_log;
+	void **Slots = (void **)User;
+	for (int i=0; i < L->nops; ++i) {
+		BENCH_AllocOp *Op = L->ops + i;
+		void *Old = (Op->slot >= 0) ? Slots[Op->slot] : 0;
+		switch (Op->kind) {
+		case ALLOC_MALLOC:  Slots[Op->to] = malloc(Op->size); break;
+		case ALLOC_REALLOC: Slots[Op->to] = realloc(Old, Op->size); break;
+		case ALLOC_FREE:    free(Old); break;
+		}
+		if (Op->to >= 0 && Slots[Op->to]) *(volatile uint8_t *)Slots[Op->to] = 0; // touch it, as the decoder would
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// reporting
+//
+static void BENCH_report(BENCH_Json *J, BENCH_Case *C, const char *Phase,
+                         BENCH_Timing *T, double Bytes, double Units, const char *UnitName, BENCH_Timing *Decode)
+{
+	double MBps  = BENCH_rate(Bytes, T) / (1024.0 * 1024.0);
+	double Rate  = BENCH_rate(Units, T);
+	double Share = Decode->median_ns ? (double)T->median_ns / (double)Decode->median_ns : 0;
+
+	BENCH_log("  %-8s %10.3f ms %10.1f MB/s %14.0f %s/s %6.1f%%\n",
+	       Phase, T->median_ns / 1e6, MBps, Rate, UnitName, Share * 100.0);
+
+	BENCH_json_row(J);
+	BENCH_json_str(J, "sprite", C->name);
+	BENCH_json_str(J, "phase", Phase);
+	BENCH_json_num(J, "bytes", Bytes);
+	BENCH_json_num(J, "cels", C->cels);
+	BENCH_json_num(J, "median_ns", (double)T->median_ns);
+	BENCH_json_num(J, "min_ns", (double)T->min_ns);
+	BENCH_json_num(J, "median_cycles", (double)T->median_cycles);
+	BENCH_json_num(J, "mb_per_s", MBps);
+	BENCH_json_num(J, "cels_per_s", BENCH_rate(C->cels, T));
+	if (strcmp(UnitName, "cels")) BENCH_json_num(J, UnitName, Rate);
+	BENCH_json_num(J, "share", Share);
+}
+
+static void BENCH_case(BENCH_Json *J, BENCH_Case *C, BENCH_Args *A)
+{
+	ASE_Sprite Check = {0};
+	if (!ASE_load_from_memory(C->data, C->len, &Check)) {
+		BENCH_log("%s: does not load, skipped\n", C->name);
+		return;
+	}
+	ASE_free(&Check);
+	BENCH_scan(C, 1);
+
+	BENCH_log("%s: %d bytes, %d frames, %d chunks, %d cels, %d compressed (%d bytes inflated)\n",
+	       C->name, C->len, C->frames, C->chunks, C->cels, C->nstreams, C->inflated);
+
+	BENCH_Timing Decode  = BENCH_time(BENCH_run_decode, C, A->warmup, A->reps);
+	BENCH_Timing Headers = BENCH_time(BENCH_run_headers, C, A->warmup, A->reps);
+	BENCH_Timing Inflate = BENCH_time(BENCH_run_inflate, C, A->warmup, A->reps);
+
+	BENCH_alloc_reset();
+	BENCH_alloc_log.recording = 1;
+	BENCH_run_decode(C);
+	BENCH_alloc_log.recording = 0;
+	void **Slots = (void **)calloc(BENCH_alloc_log.nslots + 1, sizeof(void *));
+	BENCH_Timing Alloc = BENCH_time(BENCH_run_alloc, Slots, A->warmup, A->reps);
+	free(Slots);
+
+	BENCH_report(J, C, "decode",  &Decode,  C->len,      C->cels,              "cels",   &Decode);
+	BENCH_report(J, C, "headers", &Headers, C->len,      C->chunks,            "chunks", &Decode);
+	BENCH_report(J, C, "inflate", &Inflate, C->inflated, C->nstreams,          "cels",   &Decode);
+	BENCH_report(J, C, "alloc",   &Alloc,   C->len,      BENCH_alloc_log.nops, "ops",    &Decode);
+
+	free(C->streams);
+	free(C->out);
+	C->streams  = 0;
+	C->out      = 0;
+	C->nstreams = 0;
+	C->inflated = 0;
+}
+
+static void BENCH_file(BENCH_Json *J, const char *Path, BENCH_Args *A)
+{
+	BENCH_Case C;
+	memset(&C, 0, sizeof(C));
+	snprintf(C.name, sizeof(C.name), "%s", Path);
+	C.data = BENCH_read_file(Path, &C.len);
+	if (!C.data) {
+		BENCH_log("%s: could not read\n", Path);
+		return;
+	}
+	BENCH_case(J, &C, A);
+	free(C.data);
+}
+
+static void BENCH_path(BENCH_Json *J, const char *Path, BENCH_Args *A)
+{
+#if !defined(_WIN32)
+	DIR *D = opendir(Path);
+	if (D) {
+		struct dirent *E;
+		while ((E = readdir(D))) {
+			size_t N = strlen(E->d_name);
+			int Ase      = N > 4 && !strcmp(E->d_name + N - 4, ".ase");
+			int Aseprite = N > 9 && !strcmp(E->d_name + N - 9, ".aseprite");
+			if (!Ase && !Aseprite) continue;
+			char Full[1024];
+			snprintf(Full, sizeof(Full), "%s/%s", Path, E->d_name);
+			BENCH_file(J, Full, A);
+		}
+		closedir(D);
+		return;
+	}
+#endif
+	BENCH_file(J, Path, A);
+}
+
+int main(int argc, char **argv)
+{
+	BENCH_Args A;
+	BENCH_args(&A, argc, argv, 2, 9);
+
+	BENCH_Json J;
+	BENCH_json_begin(&J, BENCH_json_open(A.json), "ase_bench");
+	BENCH_log("warmup %d, reps %d, times are medians\n\n", A.warmup, A.reps);
+
+	if (!A.nfiles) {
+		for (int i=0; i < (int)(sizeof(BENCH_sprites) / sizeof(BENCH_sprites[0])); ++i) {
+			BENCH_Case C;
+			memset(&C, 0, sizeof(C));
+			snprintf(C.name, sizeof(C.name), "%s", BENCH_sprites[i].name);
+			C.data = BENCH_make_sprite(BENCH_sprites + i, 1234 + i, &C.len);
+			BENCH_case(&J, &C, &A);
+			free(C.data);
+			BENCH_log("\n");
+		}
+	}
+	for (int i=0; i < A.nfiles; ++i) BENCH_path(&J, A.files[i], &A);
+
+	BENCH_json_end(&J);
+	BENCH_alloc_reset();
+	free(BENCH_alloc_log.ops);
+	free(A.files);
+	return(0);
+}
@@ -0,0 +1,465 @@
+/*
+bench.h - shared bits for the paq benchmarks in this folder
+
+Not a library; each benchmark #includes it once. Provides:
+	- a nanosecond clock and a cycle counter
+	- warmup/repetition timing with min/median
+	- a small JSON writer
+	- a zlib encoder (stored and fixed-Huffman blocks) so the benchmarks can
+	  make compressed data without linking zlib
+	- a deterministic random number generator
+
+Build the benchmarks from the repo root, see the top of each .c file.
+*/
+#ifndef PAQ_BENCH_H
+#define PAQ_BENCH_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+// not every benchmark uses every helper
+#if defined(__GNUC__)
+#	pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#	include <x86intrin.h>
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// clocks
+//
+static uint64_t BENCH_now_ns(void)
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER Freq;
+	LARGE_INTEGER Now;
+	if (!Freq.QuadPart) QueryPerformanceFrequency(&Freq);
+	QueryPerformanceCounter(&Now);
+	return((uint64_t)((double)Now.QuadPart * 1e9 / (double)Freq.QuadPart));
+#else
+	struct timespec T;
+	clock_gettime(CLOCK_MONOTONIC, &T);
+	return((uint64_t)T.tv_sec * 1000000000ull + (uint64_t)T.tv_nsec);
+#endif
+}
+
+// 0 where there's no cheap cycle counter
+static uint64_t BENCH_cycles(void)
+{
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+	return((uint64_t)__rdtsc());
+#else
+	return(0);
+#endif
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// timing
+//
+typedef struct {
+	int      warmup;
+	int      reps;
+	uint64_t min_ns;
+	uint64_t median_ns;
+	uint64_t median_cycles;
+} BENCH_Timing;
+
+typedef void (*BENCH_Fn) (void *user);
+
+static int BENCH__cmp_u64(const void *A, const void *B)
+{
+	uint64_t X = *(const uint64_t *)A, Y = *(const uint64_t *)B;
+	return((X > Y) - (X < Y));
+}
+
+// runs fn 'warmup' times untimed, then 'reps' times timed. setup and
+// teardown (either may be 0) run around every call and aren't timed
+static BENCH_Timing BENCH_time_ex(BENCH_Fn setup, BENCH_Fn fn, BENCH_Fn teardown,
+                                  void *user, int warmup, int reps)
+{
+	BENCH_Timing R;
+	memset(&R, 0, sizeof(R));
+	R.warmup = warmup;
+	R.reps   = (reps < 1) ? 1 : reps;
+
+	uint64_t *Ns = (uint64_t *)malloc(R.reps * sizeof(uint64_t));
+	uint64_t *Cy = (uint64_t *)malloc(R.reps * sizeof(uint64_t));
+	for (int i=0; i < warmup + R.reps; ++i) {
+		if (setup) setup(user);
+		uint64_t C0 = BENCH_cycles();
+		uint64_t T0 = BENCH_now_ns();
+		fn(user);
+		uint64_t T1 = BENCH_now_ns();
+		uint64_t C1 = BENCH_cycles();
+		if (teardown) teardown(user);
+		if (i >= warmup) {
+			Ns[i - warmup] = T1 - T0;
+			Cy[i - warmup] = C1 - C0;
+		}
+	}
+	qsort(Ns, R.reps, sizeof(uint64_t), BENCH__cmp_u64);
+	qsort(Cy, R.reps, sizeof(uint64_t), BENCH__cmp_u64);
+	R.min_ns        = Ns[0];
+	R.median_ns     = Ns[R.reps / 2];
+	R.median_cycles = Cy[R.reps / 2];
+	free(Ns);
+	free(Cy);
+	return(R);
+}
+
+static BENCH_Timing BENCH_time(BENCH_Fn fn, void *user, int warmup, int reps)
+{
+	return(BENCH_time_ex(0, fn, 0, user, warmup, reps));
+}
+
+// units per second at the median
+static double BENCH_rate(double units, BENCH_Timing *T)
+{
+	return(T->median_ns ? units * 1e9 / (double)T->median_ns : 0.0);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// command line
+//
+// the human-readable table goes to stderr instead when the json goes to stdout
+static FILE *BENCH_log_file;
+
+static void BENCH_log(const char *Fmt, ...)
+{
+	va_list Args;
+	va_start(Args, Fmt);
+	vfprintf(BENCH_log_file ? BENCH_log_file : stdout, Fmt, Args);
+	va_end(Args);
+}
+
+typedef struct {
+	int          warmup;
+	int          reps;
+	const char * json;    // path, "-" for stdout, 0 for none
+	int          nfiles;  // everything that isn't an option
+	char      ** files;
+} BENCH_Args;
+
+static void BENCH_args(BENCH_Args *A, int argc, char **argv, int warmup, int reps)
+{
+	memset(A, 0, sizeof(BENCH_Args));
+	A->warmup = warmup;
+	A->reps   = reps;
+	A->files  = (char **)malloc((argc + 1) * sizeof(char *));
+	for (int i=1; i < argc; ++i) {
+		if      (!strcmp(argv[i], "--warmup") && i+1 < argc) A->warmup = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--reps")   && i+1 < argc) A->reps   = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--json")   && i+1 < argc) A->json   = argv[++i];
+		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
+			printf("usage: %s [--warmup N] [--reps N] [--json out.json|-] [files or dirs...]\n", argv[0]);
+			exit(0);
+		}
+		else A->files[A->nfiles++] = argv[i];
+	}
+	BENCH_log_file = (A->json && !strcmp(A->json, "-")) ? stderr : stdout;
+}
+
+static uint8_t *BENCH_read_file(const char *Path, int *Len)
+{
+	FILE *F = fopen(Path, "rb");
+	if (!F) return(0);
+	fseek(F, 0, SEEK_END);
+	long Size = ftell(F);
+	fseek(F, 0, SEEK_SET);
+	uint8_t *Data = (Size > 0 && Size < 0x7fffffff) ? (uint8_t *)malloc(Size) : 0;
+	if (Data && (long)fread(Data, 1, Size, F) != Size) {
+		free(Data);
+		Data = 0;
+	}
+	fclose(F);
+	*Len = Data ? (int)Size : 0;
+	return(Data);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// json
+//
+// just enough to write flat arrays of flat objects:
+//	BENCH_json_begin(F, "ase_bench");
+//	BENCH_json_row(F); BENCH_json_str(F, "name", x); BENCH_json_num(F, "mbps", y); ...
+//	BENCH_json_end(F);
+
+typedef struct {
+	FILE *f;
+	int   rows;
+	int   fields;
+} BENCH_Json;
+
+static void BENCH_json_begin(BENCH_Json *J, FILE *F, const char *Bench)
+{
+	J->f = F;
+	J->rows = 0;
+	J->fields = 0;
+	if (F) fprintf(F, "{\n\t\"benchmark\": \"%s\",\n\t\"results\": [", Bench);
+}
+
+static void BENCH_json_row(BENCH_Json *J)
+{
+	if (!J->f) return;
+	fprintf(J->f, "%s\n\t\t{", J->rows++ ? " }," : "");
+	J->fields = 0;
+}
+
+static void BENCH_json_str(BENCH_Json *J, const char *Key, const char *Value)
+{
+	if (!J->f) return;
+	fprintf(J->f, "%s \"%s\": \"", J->fields++ ? "," : "", Key);
+	for (; *Value; ++Value) {
+		if (*Value == '"' || *Value == '\\') fputc('\\', J->f);
+		if ((unsigned char)*Value >= 0x20) fputc(*Value, J->f);
+	}
+	fputc('"', J->f);
+}
+
+static void BENCH_json_num(BENCH_Json *J, const char *Key, double Value)
+{
+	if (!J->f) return;
+	fprintf(J->f, "%s \"%s\": %.6g", J->fields++ ? "," : "", Key, Value);
+}
+
+static void BENCH_json_end(BENCH_Json *J)
+{
+	if (!J->f) return;
+	fprintf(J->f, "%s\n\t]\n}\n", J->rows ? " }" : "");
+	if (J->f != stdout) fclose(J->f);
+	J->f = 0;
+}
+
+static FILE *BENCH_json_open(const char *Path)
+{
+	if (!Path) return(0);
+	if (!strcmp(Path, "-")) return(stdout);
+	FILE *F = fopen(Path, "w");
+	if (!F) fprintf(stderr, "could not write %s\n", Path);
+	return(F);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// random
+//
+static uint32_t BENCH_rand(uint32_t *State)
+{
+	uint32_t X = *State ? *State : 0x9e3779b9u; // xorshift32
+	X ^= X << 13;
+	X ^= X >> 17;
+	X ^= X << 5;
+	*State = X;
+	return(X);
+}
+
+// pixel-art-ish bytes: runs of a few values with some noise, so it
+// compresses about as well as real sprite data does
+static void BENCH_fill_pixels(uint8_t *Out, int Len, int Stride, uint32_t *Seed)
+{
+	uint8_t Run[8] = {0};
+	int Left = 0;
+	for (int i=0; i < Len; i += Stride) {
+		if (!Left) {
+			Left = 1 + BENCH_rand(Seed) % 24;
+			for (int k=0; k < Stride && k < 8; ++k)
+				Run[k] = (BENCH_rand(Seed) & 3) ? (uint8_t)(BENCH_rand(Seed) & 0xf0) : 0;
+		}
+		for (int k=0; k < Stride && i + k < Len; ++k)
+			Out[i + k] = (BENCH_rand(Seed) % 16) ? Run[k % 8] : (uint8_t)BENCH_rand(Seed);
+		--Left;
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// zlib encoder
+//
+// level 0 writes stored blocks; 1..9 write one fixed-Huffman block with
+// greedy LZ77 matches, searching more of the hash chain at higher levels.
+// good enough to give the inflater realistic work; not a real compressor.
+
+typedef struct {
+	uint8_t *out;
+	int      cap;
+	int      len;
+	uint32_t bits;
+	int      nbits;
+} BENCH__bitw;
+
+static void BENCH__put(BENCH__bitw *W, uint32_t Value, int N) // LSB first
+{
+	W->bits |= Value << W->nbits;
+	W->nbits += N;
+	while (W->nbits >= 8) {
+		if (W->len < W->cap) W->out[W->len] = (uint8_t)W->bits;
+		++W->len;
+		W->bits >>= 8;
+		W->nbits -= 8;
+	}
+}
+
+static void BENCH__put_code(BENCH__bitw *W, uint32_t Code, int N) // MSB first
+{
+	uint32_t R = 0;
+	for (int i=0; i < N; ++i) R |= ((Code >> i) & 1) << (N - 1 - i);
+	BENCH__put(W, R, N);
+}
+
+static void BENCH__flush(BENCH__bitw *W)
+{
+	if (W->nbits) BENCH__put(W, 0, 8 - W->nbits);
+}
+
+static void BENCH__fixed_lit(BENCH__bitw *W, int Sym)
+{
+	if      (Sym < 144) BENCH__put_code(W, 0x30 + Sym, 8);
+	else if (Sym < 256) BENCH__put_code(W, 0x190 + (Sym - 144), 9);
+	else if (Sym < 280) BENCH__put_code(W, Sym - 256, 7);
+	else                BENCH__put_code(W, 0xc0 + (Sym - 280), 8);
+}
+
+static const int BENCH__len_base[29]  = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+static const int BENCH__len_extra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+static const int BENCH__dist_base[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+static const int BENCH__dist_extra[30]= { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+static void BENCH__fixed_match(BENCH__bitw *W, int Len, int Dist)
+{
+	int l = 28;
+	while (BENCH__len_base[l] > Len) --l;
+	BENCH__fixed_lit(W, 257 + l);
+	BENCH__put(W, Len - BENCH__len_base[l], BENCH__len_extra[l]);
+
+	int d = 29;
+	while (BENCH__dist_base[d] > Dist) --d;
+	BENCH__put_code(W, d, 5);
+	BENCH__put(W, Dist - BENCH__dist_base[d], BENCH__dist_extra[d]);
+}
+
+static uint32_t BENCH_adler32(const uint8_t *Data, int Len)
+{
+	uint32_t A = 1, B = 0;
+	for (int i=0; i < Len; ++i) {
+		A = (A + Data[i]) % 65521;
+		B = (B + A) % 65521;
+	}
+	return((B << 16) | A);
+}
+
+// returns the compressed size; if it's more than 'cap' nothing useful was
+// written and you should try again with a bigger buffer
+static int BENCH_zlib_compress(const uint8_t *Src, int Len, uint8_t *Dst, int Cap, int Level)
+{
+	BENCH__bitw W = { Dst, Cap, 0, 0, 0 };
+	BENCH__put(&W, 0x78, 8);
+	BENCH__put(&W, 0x01, 8);
+
+	if (Level <= 0) {
+		int Pos = 0;
+		do {
+			int N = Len - Pos;
+			if (N > 65535) N = 65535;
+			BENCH__put(&W, (Pos + N == Len), 1); // BFINAL
+			BENCH__put(&W, 0, 2);                // stored
+			BENCH__flush(&W);
+			BENCH__put(&W, N, 16);
+			BENCH__put(&W, N ^ 0xffff, 16);
+			for (int i=0; i < N; ++i) BENCH__put(&W, Src[Pos + i], 8);
+			Pos += N;
+		} while (Pos < Len);
+	} else {
+		enum { HASH_BITS = 15, WINDOW = 32768 };
+		int  Chain = (Level >= 9) ? 256 : (Level >= 6) ? 32 : 4;
+		int *Head  = (int *)malloc((1 << HASH_BITS) * sizeof(int));
+		int *Prev  = (int *)malloc(WINDOW * sizeof(int));
+		for (int i=0; i < (1 << HASH_BITS); ++i) Head[i] = -1;
+
+		BENCH__put(&W, 1, 1); // BFINAL
+		BENCH__put(&W, 1, 2); // fixed Huffman
+		int Pos = 0;
+		while (Pos < Len) {
+			int BestLen = 0, BestDist = 0;
+			uint32_t H = 0;
+			if (Pos + 3 <= Len) {
+				H = ((Src[Pos] << 10) ^ (Src[Pos+1] << 5) ^ Src[Pos+2]) & ((1 << HASH_BITS) - 1);
+				int Cand = Head[H];
+				for (int c=0; c < Chain && Cand >= 0 && Pos - Cand <= WINDOW; ++c) {
+					int Max = Len - Pos;
+					if (Max > 258) Max = 258;
+					int L = 0;
+					while (L < Max && Src[Cand + L] == Src[Pos + L]) ++L;
+					if (L > BestLen) {
+						BestLen  = L;
+						BestDist = Pos - Cand;
+						if (L == Max) break;
+					}
+					Cand = Prev[Cand & (WINDOW - 1)];
+				}
+			}
+
+			int Step = (BestLen >= 3) ? BestLen : 1;
+			if (BestLen >= 3) BENCH__fixed_match(&W, BestLen, BestDist);
+			else              BENCH__fixed_lit(&W, Src[Pos]);
+
+			for (int i=0; i < Step; ++i, ++Pos) {
+				if (Pos + 3 > Len) continue;
+				uint32_t K = ((Src[Pos] << 10) ^ (Src[Pos+1] << 5) ^ Src[Pos+2]) & ((1 << HASH_BITS) - 1);
+				Prev[Pos & (WINDOW - 1)] = Head[K];
+				Head[K] = Pos;
+			}
+		}
+		BENCH__fixed_lit(&W, 256);
+		BENCH__flush(&W);
+		free(Head);
+		free(Prev);
+	}
+
+	uint32_t Adler = BENCH_adler32(Src, Len);
+	BENCH__put(&W, (Adler >> 24) & 0xff, 8);
+	BENCH__put(&W, (Adler >> 16) & 0xff, 8);
+	BENCH__put(&W, (Adler >>  8) & 0xff, 8);
+	BENCH__put(&W, Adler & 0xff, 8);
+	return(W.len);
+}
+
+// compresses into a new buffer
+static uint8_t *BENCH_zlib_alloc(const uint8_t *Src, int Len, int Level, int *OutLen)
+{
+	int Cap = Len + Len / 8 + 64;
+	uint8_t *Out = (uint8_t *)malloc(Cap);
+	int N = BENCH_zlib_compress(Src, Len, Out, Cap, Level);
+	if (N > Cap) {
+		Out = (uint8_t *)realloc(Out, N);
+		BENCH_zlib_compress(Src, Len, Out, N, Level);
+	}
+	*OutLen = N;
+	return(Out);
+}
+
+#endif // PAQ_BENCH_H
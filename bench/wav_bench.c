@@ -0,0 +1,428 @@
+/*
+wav_bench.c - timing for paq_wav.h loading and conversion
+
+Build from the repo root:
+	cc -O2 -D_POSIX_C_SOURCE=200809L bench/wav_bench.c -o wav_bench -lm -lpthread
+	cl /O2 bench\wav_bench.c
+
+Run:
+	wav_bench [--warmup N] [--reps N] [--json out.json|-] [files...]
+
+With no files it generates clips of 0.1, 1 and 10 seconds at 48kHz, mono,
+stereo and 5.1, as 8-bit, 16-bit, float, IMA ADPCM and MS ADPCM (the ADPCM
+clips are noise; decoding speed doesn't depend on what the nibbles say).
+.wav files given on the command line are timed the same way.
+
+For each clip it times:
+	load_memory     WAV_load_from_memory
+	load_callbacks  WAV_load_from_callbacks over the same memory
+	load_file       WAV_load on a copy written to the working directory
+	                (so it's the page cache, not the disk)
+	to_8bit, to_16bit, to_float
+	                every WAV_convert_to_* that changes the clip's format
+	memcpy          copying the same number of bytes, the roofline
+
+samples/s counts every channel. bytes/s is bytes of file for the loads and
+bytes of source samples for the conversions; "of_memcpy" is bytes/s over
+memcpy's bytes/s at the same size, so 1.0 means as fast as a copy.
+*/
+#include "bench.h"
+
+#include <math.h>
+
+// paq_wav.h prints its progress by default; that would be timed too
+#define WAV_DBG(...)
+#define WAV_ERR(...) fprintf(stderr, __VA_ARGS__)
+#define WAV_IMPLEMENTATION
+#include "../paq_wav.h"
+
+#define BENCH_TMP_FILE "wav_bench.tmp.wav"
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// clip generator
+//
+typedef struct {
+	int format;   // WAV_FORMAT_*
+	int bits;     // WAV_8BIT, WAV_16BIT, WAV_FLOAT, 4 for ADPCM
+	const char *name;
+} BENCH_Format;
+
+static const BENCH_Format BENCH_formats[] = {
+	{ WAV_FORMAT_PCM,       WAV_8BIT,  "pcm8"    },
+	{ WAV_FORMAT_PCM,       WAV_16BIT, "pcm16"   },
+	{ WAV_FORMAT_FLOAT,     WAV_FLOAT, "float"   },
+	{ WAV_FORMAT_IMA_ADPCM, WAV_4BIT,  "ima"     },
+	{ WAV_FORMAT_MS_ADPCM,  WAV_4BIT,  "msadpcm" },
+};
+
+static void BENCH__le16(uint8_t *P, int V)      { P[0] = (uint8_t)V; P[1] = (uint8_t)(V >> 8); }
+static void BENCH__le32(uint8_t *P, uint32_t V) { BENCH__le16(P, V & 0xffff); BENCH__le16(P + 2, V >> 16); }
+
+static uint8_t *BENCH_make_clip(const BENCH_Format *Fmt, int Channels, int Frames, uint32_t Seed, int *OutLen)
+{
+	int Rate = 48000, BlockAlign = 0, SamplesPerBlock = 0, FmtSize = 16;
+	uint32_t DataSize = 0;
+
+	switch (Fmt->format) {
+	case WAV_FORMAT_IMA_ADPCM:
+		BlockAlign      = 256 * Channels;
+		SamplesPerBlock = (BlockAlign - 4 * Channels) * 2 / Channels + 1;
+		FmtSize         = 20;
+		break;
+	case WAV_FORMAT_MS_ADPCM:
+		BlockAlign      = 256 * Channels;
+		SamplesPerBlock = (BlockAlign - 7 * Channels) * 2 / Channels + 2;
+		FmtSize         = 50; // cbSize 32: samples per block, 7 coefficient pairs
+		break;
+	default:
+		BlockAlign = Channels * Fmt->bits / 8;
+		FmtSize    = 18;
+		break;
+	}
+	if (SamplesPerBlock) {
+		Frames   = (Frames + SamplesPerBlock - 1) / SamplesPerBlock * SamplesPerBlock;
+		DataSize = Frames / SamplesPerBlock * BlockAlign;
+	} else {
+		DataSize = (uint32_t)Frames * BlockAlign;
+	}
+
+	int Len = 12 + 8 + FmtSize + 8 + DataSize;
+	uint8_t *W = (uint8_t *)calloc(Len, 1);
+	memcpy(W, "RIFF", 4);
+	BENCH__le32(W + 4, Len - 8);
+	memcpy(W + 8, "WAVE", 4);
+
+	uint8_t *F = W + 12;
+	memcpy(F, "fmt ", 4);
+	BENCH__le32(F + 4, FmtSize);
+	BENCH__le16(F + 8, Fmt->format);
+	BENCH__le16(F + 10, Channels);
+	BENCH__le32(F + 12, Rate);
+	BENCH__le32(F + 16, SamplesPerBlock ? (uint32_t)((uint64_t)Rate * BlockAlign / SamplesPerBlock) : (uint32_t)Rate * BlockAlign);
+	BENCH__le16(F + 20, BlockAlign);
+	BENCH__le16(F + 22, Fmt->bits);
+	if (FmtSize >= 18) BENCH__le16(F + 24, FmtSize - 18);
+	if (SamplesPerBlock) BENCH__le16(F + 26, SamplesPerBlock);
+	if (WAV_FORMAT_MS_ADPCM == Fmt->format) {
+		static const int16_t Coef[7][2] = {
+			{ 256,    0 }, { 512, -256 }, {   0,    0 }, { 192,   64 },
+			{ 240,    0 }, { 460, -208 }, { 392, -232 },
+		};
+		BENCH__le16(F + 28, 7);
+		for (int i=0; i < 7; ++i) {
+			BENCH__le16(F + 30 + i * 4, Coef[i][0]);
+			BENCH__le16(F + 32 + i * 4, Coef[i][1]);
+		}
+	}
+
+	uint8_t *D = F + 8 + FmtSize;
+	memcpy(D, "data", 4);
+	BENCH__le32(D + 4, DataSize);
+	D += 8;
+
+	if (SamplesPerBlock) {
+		// valid block headers, noise for the nibbles. MS ADPCM's step grows
+		// on big nibbles and shrinks on small ones, so keep most of them
+		// small or it runs away the way no encoder would let it
+		static const uint8_t Small[8] = { 0, 1, 2, 3, 13, 14, 15, 0 };
+		for (uint32_t b=0; b < DataSize; b += BlockAlign) {
+			uint8_t *B = D + b;
+			for (int i=0; i < BlockAlign; ++i) {
+				uint32_t R = BENCH_rand(&Seed);
+				if (WAV_FORMAT_MS_ADPCM == Fmt->format) {
+					int Hi = (R & 0xf00) ? Small[(R >> 4) & 7] : (int)((R >> 4) & 15);
+					int Lo = (R & 0xf000) ? Small[R & 7] : (int)(R & 15);
+					B[i] = (uint8_t)((Hi << 4) | Lo);
+				} else {
+					B[i] = (uint8_t)R;
+				}
+			}
+			for (int c=0; c < Channels; ++c) {
+				if (WAV_FORMAT_IMA_ADPCM == Fmt->format) {
+					B[4 * c + 2] = (uint8_t)(BENCH_rand(&Seed) % 89);
+					B[4 * c + 3] = 0;
+				} else {
+					B[c] = (uint8_t)(BENCH_rand(&Seed) % 7);                     // predictor
+					BENCH__le16(B + Channels + 2 * c, 16 + BENCH_rand(&Seed) % 512); // delta
+				}
+			}
+		}
+	} else {
+		// a couple of tones with a little noise
+		int N = Frames * Channels;
+		for (int i=0; i < N; ++i) {
+			int   Frame = i / Channels, C = i % Channels;
+			float X = 0.5f * sinf((float)Frame * (0.01f + 0.003f * C)) +
+			          0.2f * sinf((float)Frame * 0.173f) +
+			          0.05f * ((int)(BENCH_rand(&Seed) & 0xffff) - 32768) / 32768.0f;
+			switch (Fmt->bits) {
+			case WAV_8BIT:  D[i] = (uint8_t)(int8_t)(X * 127.0f); break;
+			case WAV_16BIT: BENCH__le16(D + 2 * i, (int16_t)(X * 32767.0f)); break;
+			case WAV_FLOAT: memcpy(D + 4 * i, &X, 4); break;
+			}
+		}
+	}
+
+	*OutLen = Len;
+	return(W);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// what gets timed
+//
+typedef struct {
+	char      name[256];
+	int8_t  * file;
+	int       len;
+	WAV_Data  info;      // loaded once, for the conversions
+
+	// per run
+	WAV_Data  work;
+	int       target;    // WAV_8BIT, WAV_16BIT, WAV_FLOAT
+	int       pos;       // callback read position
+	uint8_t * copy;      // memcpy destination
+	int       copy_len;
+} BENCH_Clip;
+
+static volatile uint32_t BENCH_sink;
+
+static void BENCH_run_load_memory(void *User)
+{
+	BENCH_Clip *C = (BENCH_Clip *)User;
+	WAV_Data D = {0};
+	if (WAV_load_from_memory(C->file, C->len, &D)) BENCH_sink += D.dwSamples;
+	WAV_free(&D);
+}
+
+static int BENCH__cb_read(void *User, char *Out, int Size)
+{
+	BENCH_Clip *C = (BENCH_Clip *)User;
+	int N = C->len - C->pos;
+	if (N > Size) N = Size;
+	if (N < 0) N = 0;
+	memcpy(Out, C->file + C->pos, N);
+	C->pos += N;
+	return(N);
+}
+static void BENCH__cb_skip(void *User, int N) { BENCH_Clip *C = (BENCH_Clip *)User; C->pos += N; if (C->pos > C->len) C->pos = C->len; }
+static int  BENCH__cb_eof(void *User)         { BENCH_Clip *C = (BENCH_Clip *)User; return(C->pos >= C->len); }
+static int  BENCH__cb_tell(void *User)        { return(((BENCH_Clip *)User)->pos); }
+static void BENCH__cb_seek(void *User, int P) { ((BENCH_Clip *)User)->pos = P; }
+
+static const WAV_Callbacks BENCH_callbacks = {
+	BENCH__cb_read, BENCH__cb_skip, BENCH__cb_eof, BENCH__cb_tell, BENCH__cb_seek
+};
+
+static void BENCH_run_load_callbacks(void *User)
+{
+	BENCH_Clip *C = (BENCH_Clip *)User;
+	WAV_Data D = {0};
+	C->pos = 0;
+	if (WAV_load_from_callbacks(&BENCH_callbacks, C, &D)) BENCH_sink += D.dwSamples;
+	WAV_free(&D);
+}
+
+static void BENCH_run_load_file(void *User)
+{
+	WAV_Data D = {0};
+	(void)User;
+	if (WAV_load(BENCH_TMP_FILE, &D)) BENCH_sink += D.dwSamples;
+	WAV_free(&D);
+}
+
+// conversions consume their input, so every run gets a fresh copy
+static void BENCH_setup_convert(void *User)
+{
+	BENCH_Clip *C = (BENCH_Clip *)User;
+	C->work = C->info;
+	C->work.data = (int8_t *)WAV_MALLOC((size_t)C->info.qwDataSize);
+	memcpy(C->work.data, C->info.data, (size_t)C->info.qwDataSize);
+	C->work.loops = 0;
+	C->work.cues  = 0;
+	C->work.nloops = C->work.ncues = 0;
+}
+
+static void BENCH_run_convert(void *User)
+{
+	BENCH_Clip *C = (BENCH_Clip *)User;
+	switch (C->target) {
+	case WAV_8BIT:  WAV_convert_to_8bit(&C->work);  break;
+	case WAV_16BIT: WAV_convert_to_16bit(&C->work); break;
+	case WAV_FLOAT: WAV_convert_to_float(&C->work); break;
+	}
+	BENCH_sink += (uint32_t)C->work.qwDataSize;
+}
+
+static void BENCH_teardown_convert(void *User)
+{
+	WAV_free(&((BENCH_Clip *)User)->work);
+}
+
+static void BENCH_run_memcpy(void *User)
+{
+	BENCH_Clip *C = (BENCH_Clip *)User;
+	memcpy(C->copy, C->file, C->copy_len);
+	BENCH_sink += C->copy[C->copy_len / 2];
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// reporting
+//
+static const char *BENCH_format_name(const WAV_Data *D)
+{
+	if (WAV_FORMAT_IMA_ADPCM == D->wFormatTag) return("ima");
+	if (WAV_FORMAT_MS_ADPCM  == D->wFormatTag) return("msadpcm");
+	if (WAV_FLOAT == D->wBitsPerSample) return("float");
+	if (WAV_16BIT == D->wBitsPerSample) return("pcm16");
+	return("pcm8");
+}
+
+// memcpy bytes/s at a given size; sizes repeat a lot, so keep the answers
+static double BENCH_roofline(BENCH_Clip *C, int Bytes, BENCH_Args *A, BENCH_Timing *Out)
+{
+	static struct { int bytes; double rate; BENCH_Timing t; } Cache[64];
+	static int NCache;
+	for (int i=0; i < NCache; ++i) {
+		if (Cache[i].bytes == Bytes) {
+			*Out = Cache[i].t;
+			return(Cache[i].rate);
+		}
+	}
+
+	C->copy_len = Bytes < C->len ? Bytes : C->len;
+	C->copy = (uint8_t *)malloc(C->copy_len ? C->copy_len : 1);
+	memset(C->copy, 1, C->copy_len); // fault the pages in before timing
+	BENCH_Timing T = BENCH_time(BENCH_run_memcpy, C, A->warmup, A->reps);
+	free(C->copy);
+	C->copy = 0;
+
+	double Rate = BENCH_rate(C->copy_len, &T);
+	if (NCache < 64) {
+		Cache[NCache].bytes = Bytes;
+		Cache[NCache].rate  = Rate;
+		Cache[NCache].t     = T;
+		++NCache;
+	}
+	*Out = T;
+	return(Rate);
+}
+
+static void BENCH_report(BENCH_Json *J, BENCH_Clip *C, const char *Op, BENCH_Timing *T,
+                         double Bytes, double Samples, double Memcpy)
+{
+	double Bps = BENCH_rate(Bytes, T);
+	double Sps = BENCH_rate(Samples, T);
+	double Of  = Memcpy > 0 ? Bps / Memcpy : 0;
+
+	BENCH_log("  %-15s %10.3f ms %10.1f MB/s %10.1f Msamples/s %6.2fx memcpy\n",
+	          Op, T->median_ns / 1e6, Bps / (1024.0 * 1024.0), Sps / 1e6, Of);
+
+	BENCH_json_row(J);
+	BENCH_json_str(J, "clip", C->name);
+	BENCH_json_str(J, "format", BENCH_format_name(&C->info));
+	BENCH_json_num(J, "channels", C->info.wChannels);
+	BENCH_json_num(J, "frames", C->info.dwSamples);
+	BENCH_json_str(J, "op", Op);
+	BENCH_json_num(J, "bytes", Bytes);
+	BENCH_json_num(J, "samples", Samples);
+	BENCH_json_num(J, "median_ns", (double)T->median_ns);
+	BENCH_json_num(J, "min_ns", (double)T->min_ns);
+	BENCH_json_num(J, "median_cycles", (double)T->median_cycles);
+	BENCH_json_num(J, "samples_per_s", Sps);
+	BENCH_json_num(J, "bytes_per_s", Bps);
+	BENCH_json_num(J, "memcpy_bytes_per_s", Memcpy);
+	BENCH_json_num(J, "of_memcpy", Of);
+}
+
+static void BENCH_clip(BENCH_Json *J, BENCH_Clip *C, BENCH_Args *A)
+{
+	memset(&C->info, 0, sizeof(WAV_Data));
+	if (!WAV_load_from_memory(C->file, C->len, &C->info)) {
+		BENCH_log("%s: does not load, skipped\n", C->name);
+		return;
+	}
+
+	FILE *F = fopen(BENCH_TMP_FILE, "wb");
+	int Written = F && (int)fwrite(C->file, 1, C->len, F) == C->len;
+	if (F) fclose(F);
+
+	double Samples = (double)C->info.dwSamples * C->info.wChannels;
+	BENCH_log("%s: %s, %d channels, %u frames, %d bytes\n",
+	          C->name, BENCH_format_name(&C->info), (int)C->info.wChannels, (unsigned)C->info.dwSamples, C->len);
+
+	BENCH_Timing M, T;
+	double Memcpy = BENCH_roofline(C, C->len, A, &M);
+
+	T = BENCH_time(BENCH_run_load_memory, C, A->warmup, A->reps);
+	BENCH_report(J, C, "load_memory", &T, C->len, Samples, Memcpy);
+	T = BENCH_time(BENCH_run_load_callbacks, C, A->warmup, A->reps);
+	BENCH_report(J, C, "load_callbacks", &T, C->len, Samples, Memcpy);
+	if (Written) {
+		T = BENCH_time(BENCH_run_load_file, C, A->warmup, A->reps);
+		BENCH_report(J, C, "load_file", &T, C->len, Samples, Memcpy);
+	}
+	BENCH_report(J, C, "memcpy", &M, C->len, Samples, Memcpy);
+
+	static const struct { int bits; const char *name; } Targets[] = {
+		{ WAV_8BIT, "to_8bit" }, { WAV_16BIT, "to_16bit" }, { WAV_FLOAT, "to_float" },
+	};
+	double SrcBytes = (double)C->info.qwDataSize;
+	double Copy = BENCH_roofline(C, (int)SrcBytes, A, &M);
+	for (int i=0; i < 3; ++i) {
+		if (Targets[i].bits == (int)C->info.wBitsPerSample) continue;
+		C->target = Targets[i].bits;
+		T = BENCH_time_ex(BENCH_setup_convert, BENCH_run_convert, BENCH_teardown_convert, C, A->warmup, A->reps);
+		BENCH_report(J, C, Targets[i].name, &T, SrcBytes, Samples, Copy);
+	}
+
+	WAV_free(&C->info);
+	remove(BENCH_TMP_FILE);
+}
+
+int main(int argc, char **argv)
+{
+	BENCH_Args A;
+	BENCH_args(&A, argc, argv, 1, 7);
+
+	BENCH_Json J;
+	BENCH_json_begin(&J, BENCH_json_open(A.json), "wav_bench");
+	BENCH_log("warmup %d, reps %d, times are medians\n\n", A.warmup, A.reps);
+
+	if (!A.nfiles) {
+		static const int Channels[] = { 1, 2, 6 };
+		static const int Frames[]   = { 4800, 48000, 480000 };
+		for (int f=0; f < (int)(sizeof(BENCH_formats) / sizeof(BENCH_formats[0])); ++f)
+		for (int c=0; c < 3; ++c)
+		for (int n=0; n < 3; ++n) {
+			BENCH_Clip C;
+			memset(&C, 0, sizeof(C));
+			snprintf(C.name, sizeof(C.name), "%s-%dch-%dms", BENCH_formats[f].name, Channels[c], Frames[n] / 48);
+			C.file = (int8_t *)BENCH_make_clip(BENCH_formats + f, Channels[c], Frames[n], 77 + f * 9 + c * 3 + n, &C.len);
+			BENCH_clip(&J, &C, &A);
+			free(C.file);
+			BENCH_log("\n");
+		}
+	}
+	for (int i=0; i < A.nfiles; ++i) {
+		BENCH_Clip C;
+		memset(&C, 0, sizeof(C));
+		snprintf(C.name, sizeof(C.name), "%s", A.files[i]);
+		C.file = (int8_t *)BENCH_read_file(A.files[i], &C.len);
+		if (!C.file) {
+			BENCH_log("%s: could not read\n", A.files[i]);
+			continue;
+		}
+		BENCH_clip(&J, &C, &A);
+		free(C.file);
+	}
+
+	BENCH_json_end(&J);
+	free(A.files);
+	return(0);
+}
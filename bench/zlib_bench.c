@@ -0,0 +1,381 @@
+/*
+zlib_bench.c - timing for the inflater inside paq_aseprite.h
+
+Build from the repo root:
+	cc -O2 -D_POSIX_C_SOURCE=200809L bench/zlib_bench.c -o zlib_bench -lm -lpthread
+	cl /O2 bench\zlib_bench.c
+
+With the system zlib, for dynamic-Huffman streams and a second opinion on
+every output:
+	cc -O2 -D_POSIX_C_SOURCE=200809L -DBENCH_ZLIB bench/zlib_bench.c -o zlib_bench -lm -lpthread -lz
+
+Run:
+	zlib_bench [--warmup N] [--reps N] [--json out.json|-] [files...]
+
+Corpora:
+	cels     pixel data shaped like sprite cels at 8, 16 and 32 bits per
+	         pixel, plus the compressed cels of any .ase/.aseprite files
+	         given, exactly as they were written
+	text     word salad, the usual stand-in for text
+	records  fixed-size binary records with slowly changing fields
+	zeros    one long run
+	random   incompressible noise
+	files    anything else given on the command line
+
+Everything generated is compressed as stored blocks (level 0) and with
+fixed Huffman codes (levels 1, 6 and 9, from bench.h's encoder). With
+BENCH_ZLIB it's also compressed with zlib's compress2 at levels 1, 6 and 9
+("zlib" rows), which picks its own block types the way Aseprite's writer
+does: dynamic Huffman mostly, stored where nothing compresses.
+
+Each stream is inflated with stbi_zlib_decode_buffer and checked against the
+original bytes, and against zlib's uncompress when BENCH_ZLIB is on. The exit
+code is the number of streams that didn't match.
+
+MB/s is inflated bytes per second; cycles/byte is per inflated byte too.
+*/
+#include "bench.h"
+
+#define ASE_IMPLEMENTATION
+#include "../paq_aseprite.h"
+
+#ifdef BENCH_ZLIB
+#	include <zlib.h>
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// corpus
+//
+typedef struct {
+	char      name[256];
+	char      corpus[16];
+	char      block[16];  // stored, fixed, zlib, or as-is
+	int       level;      // -1 if we didn't compress it
+	uint8_t * compressed;
+	int       len;
+	uint8_t * expect;     // 0 if we don't know what it inflates to
+	int       olen;
+} BENCH_Stream;
+
+typedef struct {
+	int            count, cap;
+	BENCH_Stream * items;
+} BENCH_Corpus;
+
+static BENCH_Stream *BENCH_add(BENCH_Corpus *C)
+{
+	if (C->count == C->cap) {
+		C->cap = C->cap ? C->cap * 2 : 64;
+		C->items = (BENCH_Stream *)realloc(C->items, C->cap * sizeof(BENCH_Stream));
+	}
+	BENCH_Stream *S = C->items + C->count++;
+	memset(S, 0, sizeof(BENCH_Stream));
+	S->level = -1;
+	return(S);
+}
+
+// adds 'Data' compressed every way we know how; takes ownership of Data
+static void BENCH_add_levels(BENCH_Corpus *C, const char *Corpus, const char *Name, uint8_t *Data, int Len)
+{
+	static const int Levels[] = { 0, 1, 6, 9 };
+	for (int i=0; i < 4; ++i) {
+		BENCH_Stream *S = BENCH_add(C);
+		snprintf(S->name, sizeof(S->name), "%s", Name);
+		snprintf(S->corpus, sizeof(S->corpus), "%s", Corpus);
+		snprintf(S->block, sizeof(S->block), "%s", Levels[i] ? "fixed" : "stored");
+		S->level      = Levels[i];
+		S->compressed = BENCH_zlib_alloc(Data, Len, Levels[i], &S->len);
+		S->expect     = Data;
+		S->olen       = Len;
+	}
+#ifdef BENCH_ZLIB
+	for (int i=1; i < 4; ++i) {
+		uLongf ZLen = compressBound(Len);
+		uint8_t *Z = (uint8_t *)malloc(ZLen);
+		if (Z && Z_OK == compress2(Z, &ZLen, Data, Len, Levels[i])) {
+			BENCH_Stream *S = BENCH_add(C);
+			snprintf(S->name, sizeof(S->name), "%s", Name);
+			snprintf(S->corpus, sizeof(S->corpus), "%s", Corpus);
+			snprintf(S->block, sizeof(S->block), "zlib");
+			S->level      = Levels[i];
+			S->compressed = Z;
+			S->len        = (int)ZLen;
+			S->expect     = Data;
+			S->olen       = Len;
+		} else {
+			free(Z);
+		}
+	}
+#endif
+}
+
+static uint8_t *BENCH_gen_cels(int Bpp, int *Len)
+{
+	// a sheet's worth of cels back to back, like one sprite's pixels
+	uint32_t Seed = 1000 + Bpp;
+	int N = 0;
+	uint8_t *Data = (uint8_t *)malloc(24 * 96 * 96 * 4);
+	for (int i=0; i < 24; ++i) {
+		int W = 32 + BENCH_rand(&Seed) % 64, H = 32 + BENCH_rand(&Seed) % 64;
+		BENCH_fill_pixels(Data + N, W * H * Bpp, Bpp, &Seed);
+		N += W * H * Bpp;
+	}
+	*Len = N;
+	return(Data);
+}
+
+static uint8_t *BENCH_gen_text(int N)
+{
+	static const char *Words[] = {
+		"the", "of", "and", "sprite", "frame", "layer", "to", "a", "in", "is",
+		"that", "cel", "for", "it", "animation", "with", "as", "was", "on", "tag",
+		"palette", "be", "at", "by", "this", "pixel", "from", "or", "had", "not",
+	};
+	uint32_t Seed = 7;
+	uint8_t *Data = (uint8_t *)malloc(N);
+	int i = 0;
+	while (i < N) {
+		const char *W = Words[BENCH_rand(&Seed) % 30];
+		while (*W && i < N) Data[i++] = (uint8_t)*W++;
+		if (i < N) Data[i++] = (BENCH_rand(&Seed) % 12) ? ' ' : (BENCH_rand(&Seed) & 1) ? '.' : '\n';
+	}
+	return(Data);
+}
+
+static uint8_t *BENCH_gen_records(int N)
+{
+	uint32_t Seed = 11, Id = 1000, Time = 0;
+	uint8_t *Data = (uint8_t *)calloc(N, 1);
+	for (int i=0; i + 32 <= N; i += 32) {
+		Time += 16 + BENCH_rand(&Seed) % 3;
+		memcpy(Data + i, &Id, 4);
+		memcpy(Data + i + 4, &Time, 4);
+		Data[i + 8]  = (uint8_t)(BENCH_rand(&Seed) % 4);
+		Data[i + 12] = (uint8_t)(i >> 10);
+		memcpy(Data + i + 16, "entity\0\0", 8);
+		if (BENCH_rand(&Seed) % 8 == 0) ++Id;
+	}
+	return(Data);
+}
+
+static uint8_t *BENCH_gen_random(int N)
+{
+	uint32_t Seed = 13;
+	uint8_t *Data = (uint8_t *)malloc(N);
+	for (int i=0; i < N; ++i) Data[i] = (uint8_t)BENCH_rand(&Seed);
+	return(Data);
+}
+
+static uint32_t BENCH__le(const uint8_t *P, int N)
+{
+	uint32_t V = 0;
+	for (int i=N-1; i >= 0; --i) V = (V << 8) | P[i];
+	return(V);
+}
+
+// pulls out every compressed cel, as written. keeps a pointer into Data
+static int BENCH_add_ase(BENCH_Corpus *C, const char *Path, uint8_t *Data, int Len)
+{
+	if (Len < 128 || BENCH__le(Data + 4, 2) != ASE_FILE_MAGIC) return(0);
+	int Frames = BENCH__le(Data + 6, 2), Bpp = BENCH__le(Data + 12, 2) / 8, Found = 0;
+	int Pos = 128;
+	for (int f=0; f < Frames && Pos + 16 <= Len; ++f) {
+		int FrameSize = BENCH__le(Data + Pos, 4);
+		int Chunks    = BENCH__le(Data + Pos + 6, 2);
+		int At = Pos + 16;
+		for (int c=0; c < Chunks && At + 6 <= Len; ++c) {
+			int Size = BENCH__le(Data + At, 4);
+			int Type = BENCH__le(Data + At + 4, 2);
+			if (Size < 6 || At + Size > Len) break;
+			if (Type == ASE_FILE_CHUNK_CEL && Size >= 26 &&
+			    BENCH__le(Data + At + 13, 2) == ASE_FILE_COMPRESSED_CEL)
+			{
+				BENCH_Stream *S = BENCH_add(C);
+				snprintf(S->name, sizeof(S->name), "%s#%d.%d", Path, f, c);
+				snprintf(S->corpus, sizeof(S->corpus), "cels");
+				snprintf(S->block, sizeof(S->block), "as-is");
+				S->compressed = Data + At + 26;
+				S->len  = Size - 26;
+				S->olen = BENCH__le(Data + At + 22, 2) * BENCH__le(Data + At + 24, 2) * Bpp;
+				++Found;
+			}
+			At += Size;
+		}
+		if (FrameSize < 16) break;
+		Pos += FrameSize;
+	}
+	return(Found);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// timing and checking
+//
+typedef struct {
+	BENCH_Stream *streams;
+	int           count;
+	uint8_t     * out;
+} BENCH_Group;
+
+static volatile int BENCH_sink;
+
+static void BENCH_run_inflate(void *User)
+{
+	BENCH_Group *G = (BENCH_Group *)User;
+	for (int i=0; i < G->count; ++i) {
+		BENCH_Stream *S = G->streams + i;
+		if (S->olen < 0) continue; // failed its check
+		BENCH_sink += stbi_zlib_decode_buffer((char *)G->out, S->olen, (const char *)S->compressed, S->len);
+	}
+}
+
+// returns nonzero if the stream doesn't inflate to what it should
+static int BENCH_check(BENCH_Stream *S, uint8_t *Out)
+{
+	int Got = stbi_zlib_decode_buffer((char *)Out, S->olen, (const char *)S->compressed, S->len);
+	if (Got != S->olen) {
+		BENCH_log("MISMATCH %s (%s level %d): inflated %d bytes, expected %d\n", S->name, S->block, S->level, Got, S->olen);
+		return(1);
+	}
+	if (S->expect && memcmp(Out, S->expect, S->olen)) {
+		BENCH_log("MISMATCH %s (%s level %d): wrong bytes\n", S->name, S->block, S->level);
+		return(1);
+	}
+#ifdef BENCH_ZLIB
+	{
+		uLongf ZLen = S->olen;
+		uint8_t *Z = (uint8_t *)malloc(S->olen ? S->olen : 1);
+		int Bad = Z_OK != uncompress(Z, &ZLen, S->compressed, S->len) ||
+		          (int)ZLen != S->olen || memcmp(Z, Out, S->olen);
+		free(Z);
+		if (Bad) {
+			BENCH_log("MISMATCH %s (%s level %d): zlib disagrees\n", S->name, S->block, S->level);
+			return(1);
+		}
+	}
+#endif
+	return(0);
+}
+
+// streams are timed in groups: one per generated input and compression, and
+// one per .ase file for the cels pulled out of it ("path#frame.chunk")
+static int BENCH__same_group(BENCH_Stream *A, BENCH_Stream *B)
+{
+	if (strcmp(A->corpus, B->corpus) || strcmp(A->block, B->block) || A->level != B->level) return(0);
+	size_t N = strcspn(A->name, "#");
+	return(N == strcspn(B->name, "#") && !strncmp(A->name, B->name, N));
+}
+
+int main(int argc, char **argv)
+{
+	BENCH_Args A;
+	BENCH_args(&A, argc, argv, 2, 9);
+
+	BENCH_Json J;
+	BENCH_json_begin(&J, BENCH_json_open(A.json), "zlib_bench");
+	BENCH_log("warmup %d, reps %d, times are medians", A.warmup, A.reps);
+#ifdef BENCH_ZLIB
+	BENCH_log(", checked against zlib %s\n\n", zlibVersion());
+#else
+	BENCH_log(", no system zlib (build with -DBENCH_ZLIB -lz to cross-check)\n\n");
+#endif
+
+	BENCH_Corpus C = {0};
+	int Len;
+	uint8_t *D;
+	D = BENCH_gen_cels(1, &Len); BENCH_add_levels(&C, "cels", "indexed", D, Len);
+	D = BENCH_gen_cels(2, &Len); BENCH_add_levels(&C, "cels", "grayscale", D, Len);
+	D = BENCH_gen_cels(4, &Len); BENCH_add_levels(&C, "cels", "rgba", D, Len);
+	BENCH_add_levels(&C, "text",    "text",    BENCH_gen_text(1 << 20),    1 << 20);
+	BENCH_add_levels(&C, "records", "records", BENCH_gen_records(1 << 20), 1 << 20);
+	BENCH_add_levels(&C, "zeros",   "zeros",   (uint8_t *)calloc(1 << 20, 1), 1 << 20);
+	BENCH_add_levels(&C, "random",  "random",  BENCH_gen_random(1 << 20),  1 << 20);
+
+	uint8_t **Files = (uint8_t **)calloc(A.nfiles + 1, sizeof(uint8_t *));
+	for (int i=0; i < A.nfiles; ++i) {
+		Files[i] = BENCH_read_file(A.files[i], &Len);
+		if (!Files[i]) {
+			BENCH_log("%s: could not read\n", A.files[i]);
+			continue;
+		}
+		if (!BENCH_add_ase(&C, A.files[i], Files[i], Len)) {
+			uint8_t *Copy = (uint8_t *)malloc(Len);
+			memcpy(Copy, Files[i], Len);
+			BENCH_add_levels(&C, "files", A.files[i], Copy, Len);
+		}
+	}
+
+	// check everything first
+	int MaxOut = 1, Bad = 0;
+	for (int i=0; i < C.count; ++i) if (C.items[i].olen > MaxOut) MaxOut = C.items[i].olen;
+	uint8_t *Out = (uint8_t *)malloc(MaxOut);
+	for (int i=0; i < C.count; ++i) {
+		if (BENCH_check(C.items + i, Out)) {
+			C.items[i].olen = -1; // leave it out of the timings
+			++Bad;
+		}
+	}
+
+	BENCH_log("%-9s %-24s %-8s %5s %10s %10s %7s %10s %10s\n",
+	          "corpus", "name", "block", "level", "in", "out", "ratio", "MB/s", "cycles/B");
+
+	// time runs of streams that belong together; .ase cels are timed per file
+	for (int i=0; i < C.count; ) {
+		int n = i + 1;
+		while (n < C.count && BENCH__same_group(C.items + i, C.items + n)) ++n;
+
+		BENCH_Group G = { C.items + i, n - i, Out };
+		double In = 0, Total = 0;
+		for (int k=i; k < n; ++k) {
+			if (C.items[k].olen < 0) continue;
+			In    += C.items[k].len;
+			Total += C.items[k].olen;
+		}
+
+		if (Total > 0) {
+			BENCH_Timing T = BENCH_time(BENCH_run_inflate, &G, A.warmup, A.reps);
+			double MBps = BENCH_rate(Total, &T) / (1024.0 * 1024.0);
+			double Cpb  = (double)T.median_cycles / Total;
+
+			char Name[256];
+			snprintf(Name, sizeof(Name), "%.*s", (int)strcspn(C.items[i].name, "#"), C.items[i].name);
+
+			BENCH_log("%-9s %-24.24s %-8s %5d %10.0f %10.0f %7.3f %10.1f %10.2f\n",
+			          C.items[i].corpus, Name, C.items[i].block, C.items[i].level,
+			          In, Total, In / Total, MBps, Cpb);
+
+			BENCH_json_row(&J);
+			BENCH_json_str(&J, "corpus", C.items[i].corpus);
+			BENCH_json_str(&J, "name", Name);
+			BENCH_json_str(&J, "block", C.items[i].block);
+			BENCH_json_num(&J, "level", C.items[i].level);
+			BENCH_json_num(&J, "streams", n - i);
+			BENCH_json_num(&J, "in_bytes", In);
+			BENCH_json_num(&J, "out_bytes", Total);
+			BENCH_json_num(&J, "median_ns", (double)T.median_ns);
+			BENCH_json_num(&J, "min_ns", (double)T.min_ns);
+			BENCH_json_num(&J, "mb_per_s", MBps);
+			BENCH_json_num(&J, "cycles_per_byte", Cpb);
+		}
+		i = n;
+	}
+
+	BENCH_json_end(&J);
+	BENCH_log("\n%d streams, %d mismatches\n", C.count, Bad);
+
+	// generated data is shared by its levels; free each buffer once
+	for (int i=0; i < C.count; ++i) {
+		if (strcmp(C.items[i].block, "as-is")) free(C.items[i].compressed);
+		if (C.items[i].expect && (i + 1 == C.count || C.items[i + 1].expect != C.items[i].expect))
+			free(C.items[i].expect);
+	}
+	for (int i=0; i < A.nfiles; ++i) free(Files[i]);
+	free(Files);
+	free(C.items);
+	free(Out);
+	free(A.files);
+	return(Bad);
+}
@@ -1,5 +1,5 @@
 /*
-paq_aseprite.h - v1.01 - public domain Aseprite file loader
+paq_aseprite.h - v1.02 - public domain Aseprite file loader
 https://github.com/pennie-quinn/paq
 
 	*** no warranty implied; use at your own risk ***
@@ -29,6 +29,30 @@ https://github.com/pennie-quinn/paq
 
 	- You can #define ASE_NO_STDIO if you don't want to load from files.
 
+	- You can #define ASE_NO_THREADS to make ASE_load_batch load on the
+	  calling thread only, and ASE_load_async load before it returns
+	  (ASE_async_init turns executors down, as nothing could wait on them).
+
+	- You can #define ASE_IO_URING on Linux 5.6+ to get ASE_load_batch_uring.
+	  ASE_URING_DEPTH, ASE_URING_CHUNK and ASE_URING_WINDOW tune it.
+
+	- You can #define ASE_WATCH on Linux to get hot reloading of the files
+	  ASE_load reads (see: ASE_watch_start).
+
+	- You can #define ASE_STATS to get per-load counters and timings (see:
+	  ASE_Stats). Without it none of the counting is compiled in. With it,
+	  ASE_MALLOC/ASE_REALLOC/ASE_FREE are wrapped for the rest of the
+	  implementation file so allocations can be counted.
+
+	- You can #define ASE_TRACE to get begin/end hooks around the decode
+	  work, and a writer for Chrome's trace format (see: ASE_trace_hooks).
+
+	- You can #define ASE_ALLOCATOR to send every allocation through an
+	  ASE_Allocator you pick at runtime, which gets a user pointer, the call
+	  site, and the size on free and realloc (see: ASE_set_allocator). It
+	  comes with a tracking one (see: ASE_Tracker). ASE_MALLOC and friends
+	  are still where the memory comes from by default.
+
 	- You can #define ASE_UserData_Cel my_typename if you want to extend
 	  ASE_Cel without editing the source code. This is useful for adding a
 	  texture handle, atlas offset, etc. to loaded Cels.
@@ -46,11 +70,32 @@ NOTES:
 
 	- Decode from a filepath, FILE*, or memory block.
 	- Decode with arbitrary I/O callbacks (see: ASE_Callbacks)
+	- Reuse one decoder and its buffers across loads (see: ASE_Decoder)
+	- Decode one frame at a time in constant memory (see: ASE_Stream)
+	- Decode any single frame of a file through a saved or scanned frame
+	  index (see: ASE_Index)
+	- Decode many files at once on a worker pool (see: ASE_load_batch),
+	  optionally reading them with io_uring (see: ASE_load_batch_uring)
+	- Decode in the background, with cancellation (see: ASE_load_async)
+	- Reload sprites as their files change, re-decoding only the frames
+	  that did (see: ASE_watch_start)
+	- Optional counters and timings for every load (see: ASE_Stats)
+	- Optional trace events for chrome://tracing (see: ASE_trace_hooks)
+	- Optional allocator interface with a tracking allocator
+	  (see: ASE_Allocator, ASE_Tracker)
 
 	Full docs under "DOCUMENTATION" below.
 
 
 CHANGELOG:
+	- 1.02  (2026-10-16) batch and async loading on worker threads,
+	                    io_uring batch reads, hashed name lookups,
+	                    cel links and frame x layer table resolved at load,
+	                    time-based animation player (see: ASE_Anim),
+	                    per-tag timelines, load statistics,
+	                    trace events, allocator interface,
+	                    reusable decoders, frame streaming,
+	                    random access frame index, hot reload
 	- 1.01  (2018-01-19) added userdata support, more usage code,
 	                    fixed some errors in the documentation.
 	- 1.00  (2018-01-13) first release
@@ -147,6 +192,18 @@ NOTE (ASE_get_next_frame):
 	...
 	...
 
+Or let ASE_Anim keep the clock, which handles every loop direction and the
+per-frame durations for you:
+
+	ASE_Anim anim;
+	ASE_anim_init(&anim, &sprite, ASE_find_tag(&sprite, "walk"));
+	...
+	frame_p = sprite.frames + ASE_anim_update(&anim, &sprite, elapsed_ms);
+	...
+
+For crowds, keep the tag/time/frame of every instance in arrays and call
+ASE_anim_update_batch once per sprite per tick.
+
 See "primary API" below for full interface.
 
 
@@ -394,6 +451,7 @@ typedef struct {
 
 	int       is_linked;
 	int       frame;
+	int       link;     // linked cels: frames[frame].cels[link], -1 if missing
 
 #ifdef ASE_UserData_Cel
 	ASE_UserData_Cel user;
@@ -412,8 +470,25 @@ typedef struct {
 	int16_t to;
 	int16_t dir;
 	char  * name;
+
+	// one trip through the loop, worked out at load (see: ASE_tag_frame_at)
+	int        nsteps;
+	int      * steps;    // frame index of each step, direction applied
+	uint32_t * step_end; // ms from the start of the trip to the end of each
+	                     // step; shares the allocation with steps
+	uint32_t   cycle;    // ms for the whole trip
 } ASE_Tag;
 
+typedef struct {
+	uint32_t hash;
+	int      item; // index + 1, 0 = empty
+} ASE_NameSlot;
+
+typedef struct {
+	int            mask; // slots - 1, a power of two; 0 = not built
+	ASE_NameSlot * slots;
+} ASE_NameIndex;
+
 typedef struct {
     uint16_t width;
     uint16_t height;
@@ -430,6 +505,16 @@ typedef struct {
 	int            ntags;
 	ASE_Tag * tags;
 
+	// [frame * nlayers + layer] -> index into that frame's cels, -1 if none
+	int       * cel_table;
+
+	// frame i shows from frame_start[i] to frame_start[i+1] ms (nframes + 1)
+	uint32_t  * frame_start;
+
+	// name lookups, built at load (see: ASE_find_layer, ASE_find_tag)
+	ASE_NameIndex layer_index;
+	ASE_NameIndex tag_index;
+
 #ifdef ASE_UserData_Sprite
 	ASE_UserData_Sprite user;
 #endif
@@ -481,15 +566,433 @@ ASE_DECL void     ASE_free(ASE_Sprite *Sprite);
 
 
 
+//////////////////////////////////////////////////////////////////////////////
+// primary API - reusable decoders
+//
+#ifndef ASE_DECODER_IOBUF
+#	define ASE_DECODER_IOBUF (64 << 10) // stdio buffer for files it opens
+#endif
+
+typedef struct ASE_Decoder ASE_Decoder;
+
+ASE_DECL ASE_Decoder *ASE_decoder_new (void);
+// keeps its buffers warm between loads: the compressed cel scratch, and the
+// stdio buffer of the files it opens. not thread-safe; one per thread.
+ASE_DECL void         ASE_decoder_free (ASE_Decoder *D);
+ASE_DECL void         ASE_decoder_trim (ASE_Decoder *D);
+// gives the buffers back; they come back as needed.
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_BOOL ASE_decoder_load (ASE_Decoder *D, const char *filename, ASE_Sprite *out);
+ASE_DECL ASE_BOOL ASE_decoder_load_from_file (ASE_Decoder *D, FILE *f, ASE_Sprite *out);
+#endif
+ASE_DECL ASE_BOOL ASE_decoder_load_from_memory (ASE_Decoder *D, const uint8_t *buffer, int len, ASE_Sprite *out);
+ASE_DECL ASE_BOOL ASE_decoder_load_from_callbacks (ASE_Decoder *D, const ASE_Callbacks *io, void *user, ASE_Sprite *out);
+// same as ASE_load and friends. the sprite is yours, as usual.
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - streaming
+//
+typedef struct ASE_Stream ASE_Stream;
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_Stream *ASE_open (const char *filename);
+
+ASE_DECL ASE_Stream *ASE_open_file (FILE *f);
+// f must stay open until ASE_close.
+#endif
+
+ASE_DECL ASE_Stream *ASE_open_memory (const uint8_t *buffer, int len);
+// buffer must stay around until ASE_close.
+
+ASE_DECL ASE_Stream *ASE_open_callbacks (const ASE_Callbacks *io, void *user);
+
+ASE_DECL ASE_Sprite  ASE_stream_info (ASE_Stream *S);
+// the header, and the palette, layers and tags read so far (they usually
+// all come in frame 0). 'nframes' is how many the file has; 'frames' and
+// the lookup tables are always null. everything in it belongs to the stream.
+
+ASE_DECL ASE_Frame  *ASE_next_frame (ASE_Stream *S);
+// decodes the next frame, or returns null at the end. the frame and its
+// cels are valid until the next call; only one frame of pixels is held,
+// plus the last one each layer showed (for links).
+
+ASE_DECL int         ASE_stream_tell (ASE_Stream *S);
+// index of the frame the next ASE_next_frame will decode.
+
+ASE_DECL ASE_Cel    *ASE_stream_linked_cel (ASE_Stream *S, ASE_Cel *cel);
+// like ASE_get_linked_cel, for a cel of the current frame. only links to the
+// last frame that gave the layer pixels resolve; older ones return null.
+
+ASE_DECL void        ASE_close (ASE_Stream *S);
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - random access
+//
+typedef struct ASE_Index ASE_Index;
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_Index *ASE_index_open (const char *filename);
+
+ASE_DECL ASE_Index *ASE_index_open_file (FILE *f);
+// f must stay open until ASE_index_close.
+#endif
+
+ASE_DECL ASE_Index *ASE_index_open_memory (const uint8_t *buffer, int len);
+// buffer must stay around until ASE_index_close.
+
+ASE_DECL ASE_Index *ASE_index_open_callbacks (const ASE_Callbacks *io, void *user);
+// scans the file once, skipping the cels, for where every frame starts.
+// one thread at a time per index.
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_BOOL   ASE_index_save (ASE_Index *X, const char *index_filename);
+// writes the frame offsets out, so the next open can skip the scan.
+
+ASE_DECL ASE_Index *ASE_index_open_saved (const char *filename, const char *index_filename);
+// opens with a saved index, only reading the frames with palette, layer or
+// tag chunks. scans instead if it's missing, or the file's size or frame
+// count changed since (save it again then).
+#endif
+
+ASE_DECL ASE_Sprite ASE_index_info (ASE_Index *X);
+// everything but the cels: palette, layers, tags and their timelines, and
+// every frame with its duration and no cels. belongs to the index.
+
+ASE_DECL int        ASE_index_offset (ASE_Index *X, int frame);
+// where frame's header starts in the file, or -1.
+
+ASE_DECL ASE_BOOL   ASE_decode_frame (ASE_Index *X, int frame, ASE_Frame *out);
+// seeks to frame and decodes only its cels. free it with ASE_free_frame.
+
+ASE_DECL void       ASE_free_frame (ASE_Frame *frame);
+
+ASE_DECL ASE_Cel   *ASE_index_linked_cel (ASE_Index *X, ASE_Cel *cel);
+// like ASE_get_linked_cel: decodes the cel it links to from its frame, the
+// first time it's asked for. valid until the next call for another frame of
+// the same layer, or ASE_index_close.
+
+ASE_DECL void       ASE_index_close (ASE_Index *X);
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - batch loading
+//
+typedef void (*ASE_TaskFn) (void *task, int index, int worker);
+
+typedef void (*ASE_Dispatch) (void *user, ASE_TaskFn fn, void *task, int count);
+// your job system: call fn(task, i, worker) for every i in [0, count) and
+// return once all of them have finished. 'worker' identifies the thread;
+// it must be below the 'workers' you passed in, and no two calls running at
+// the same time may share one.
+
+#ifndef ASE_NO_STDIO
+ASE_DECL int ASE_load_batch (const char **filenames, ASE_Sprite *out,
+                             ASE_BOOL *ok, int count, int threads);
+// loads filenames[i] into out[i] on 'threads' threads (0 = one per core),
+// including the calling one. ok[i] says which loaded, if you want it.
+// returns the number loaded.
+
+ASE_DECL int ASE_load_batch_dispatch (const char **filenames, ASE_Sprite *out,
+                                      ASE_BOOL *ok, int count,
+                                      ASE_Dispatch dispatch, void *user, int workers);
+// same, but runs on your own threads.
+#endif
+
+#if defined(ASE_IO_URING) && defined(__linux__) && !defined(ASE_NO_STDIO)
+ASE_DECL int ASE_load_batch_uring (const char **filenames, ASE_Sprite *out,
+                                   ASE_BOOL *ok, int count, int threads);
+// same as ASE_load_batch, but the calling thread reads the files through
+// io_uring, many chunks in flight at once into registered buffers, while
+// the other threads decode them from memory. falls back to ASE_load_batch
+// if the kernel won't give us a ring.
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - async loading
+//
+typedef struct ASE_Request ASE_Request;
+
+enum {
+	ASE_REQUEST_PENDING   = 0,
+	ASE_REQUEST_RUNNING   = 1,
+	ASE_REQUEST_DONE      = 2,
+	ASE_REQUEST_FAILED    = 3,
+	ASE_REQUEST_CANCELLED = 4,
+};
+
+typedef void (*ASE_Done) (ASE_Request *request, ASE_Sprite *sprite, int status, void *user);
+// called on the loading thread when a request finishes, before
+// ASE_request_wait returns. 'sprite' is only filled in if status is
+// ASE_REQUEST_DONE; copy it out and zero it to keep it, or leave it for
+// ASE_request_take.
+
+typedef void (*ASE_Submit) (void *user, void (*job)(void *arg), void *arg);
+// your executor: run job(arg) once, on some other thread, some time soon.
+
+ASE_DECL ASE_BOOL     ASE_async_init (int threads, ASE_Submit submit, void *user);
+// starts the background executor: 'threads' loader threads (0 = one per
+// core), or your 'submit' if it isn't null. optional; the first async
+// load starts one with defaults. call it from one thread.
+
+ASE_DECL void         ASE_async_shutdown (void);
+// cancels whatever is still queued and stops the loader threads.
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_Request *ASE_load_async (const char *filename, ASE_Done done, void *user);
+#endif
+ASE_DECL ASE_Request *ASE_load_from_memory_async (const uint8_t *buffer, int len, ASE_Done done, void *user);
+// returns right away. 'buffer' must stay alive until the request finishes.
+
+ASE_DECL int          ASE_request_status (ASE_Request *R);
+ASE_DECL int          ASE_request_wait (ASE_Request *R);
+// blocks until the request finishes, returns its status.
+
+ASE_DECL void         ASE_request_cancel (ASE_Request *R);
+// checked between frames. the request then finishes as CANCELLED.
+
+ASE_DECL ASE_BOOL     ASE_request_take (ASE_Request *R, ASE_Sprite *out);
+// moves the loaded sprite into 'out'. only once, only when DONE.
+
+ASE_DECL void         ASE_request_free (ASE_Request *R);
+// cancels the request if it's still going and forgets about it; it never
+// blocks. a sprite that wasn't taken is freed.
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - hot reload
+//
+#if defined(ASE_WATCH) && defined(__linux__) && !defined(ASE_NO_STDIO) && !defined(ASE_NO_THREADS)
+#define ASE__WATCHING
+
+ASE_DECL ASE_BOOL ASE_watch_start (void);
+// from now on, every sprite ASE_load fills is watched with inotify. when its
+// file is written, a thread of ours decodes it again, skipping the frames
+// whose bytes didn't change; their cels are kept from the sprite you have.
+
+ASE_DECL int      ASE_watch_poll (void);
+// swaps the reloaded sprites in, each into the same ASE_Sprite ASE_load
+// filled, and frees what they held. call it where nothing is using them (once
+// a frame, say). returns how many changed.
+
+ASE_DECL void     ASE_unwatch (ASE_Sprite *sprite);
+// stops watching sprite's file. ASE_free does it for you; a sprite that's
+// watched must not move.
+
+ASE_DECL void     ASE_watch_stop (void);
+// stops the thread and forgets every file, dropping unswapped reloads.
+#endif
+
+
+
 //////////////////////////////////////////////////////////////////////////////
 // primary API - conveniences
 //
 ASE_DECL ASE_Layer *ASE_get_layer_by_name (ASE_Sprite *sprite, const char *name);
 ASE_DECL ASE_Tag   *ASE_get_tag_by_name (ASE_Sprite *sprite, const char *name);
+ASE_DECL int        ASE_find_layer (ASE_Sprite *sprite, const char *name);
+ASE_DECL int        ASE_find_tag (ASE_Sprite *sprite, const char *name);
+// index of the first layer/tag with that name, or -1. names are hashed at
+// load, so these are O(1); look a name up once and keep the int around.
 ASE_DECL int        ASE_get_next_frame (ASE_Tag *tag, int frame);
 ASE_DECL ASE_Cel   *ASE_get_linked_cel (ASE_Sprite *sprite, ASE_Cel *cel);
+ASE_DECL ASE_Cel   *ASE_get_cel (ASE_Sprite *sprite, int frame, int layer);
+// links and the frame x layer table are resolved at load; neither searches.
 ASE_DECL int        ASE_check_cel_visible (ASE_Sprite *sprite, ASE_Cel *cel);
 
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - animation
+//
+typedef struct {
+	int      tag;   // index into sprite->tags, -1 = all frames, forward
+	uint32_t time;  // ms into the loop
+	int      frame; // sprite->frames index to draw
+} ASE_Anim;
+
+ASE_DECL void     ASE_anim_init (ASE_Anim *anim, ASE_Sprite *sprite, int tag);
+ASE_DECL int      ASE_anim_update (ASE_Anim *anim, ASE_Sprite *sprite, uint32_t elapsed_ms);
+// advances the clock and returns anim->frame. every loop direction gives a
+// plain frame index; ping-pong doesn't repeat the end frames.
+
+ASE_DECL int      ASE_frame_at (ASE_Sprite *sprite, int tag, uint32_t ms);
+ASE_DECL uint32_t ASE_tag_duration (ASE_Sprite *sprite, int tag);
+// one trip through the loop, in ms
+
+ASE_DECL int      ASE_tag_frame_at (ASE_Tag *tag, uint32_t ms);
+// same as ASE_frame_at, straight from the tag's timeline. -1 if it has none
+
+typedef struct {
+	int        count;
+	int16_t  * tag;   // as ASE_Anim, one array per field
+	uint32_t * time;
+	int32_t  * frame;
+} ASE_AnimBatch;
+
+ASE_DECL void     ASE_anim_update_batch (ASE_Sprite *sprite, ASE_AnimBatch *batch, uint32_t elapsed_ms);
+// ASE_anim_update for every instance of one sprite. the arrays are yours.
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - statistics
+//
+#ifdef ASE_STATS
+
+#ifndef ASE_STATS_CHUNK_TYPES
+#	define ASE_STATS_CHUNK_TYPES 16
+#endif
+
+enum {
+	ASE_STATS_TOTAL,   // all of ASE__decode_main
+	ASE_STATS_HEADER,  // file header
+	ASE_STATS_FRAMES,  // the frame and chunk loop, including the next two
+	ASE_STATS_RAW,     // reading raw cels
+	ASE_STATS_INFLATE, // inflating compressed cels
+	ASE_STATS_INDEX,   // timelines, cel table and name lookups after the loop
+	ASE_STATS_PHASES
+};
+
+typedef struct {
+	uint16_t type;     // ASE_FILE_CHUNK_*, 0 = unused slot
+	uint32_t count;
+	uint64_t bytes;    // including chunk headers
+} ASE_StatsChunk;
+
+typedef struct {
+	uint32_t loads;
+	uint64_t bytes_read;
+	uint64_t io_calls;         // every callback: read, skip, eof, tell, seek
+	uint64_t reads;
+	uint64_t seeks;            // seek and skip
+	uint64_t allocs;           // ASE_MALLOC and ASE_REALLOC
+	uint64_t frees;
+	uint64_t bytes_allocated;  // sizes asked for, not what's live
+	uint64_t compressed_bytes; // compressed cel data read
+	uint64_t inflated_bytes;   // and what it inflated to
+	uint32_t cels[4];          // raw, linked, compressed, other
+	ASE_StatsChunk chunks[ASE_STATS_CHUNK_TYPES]; // first come; the rest
+	                                              // land in the last slot
+	uint64_t ns[ASE_STATS_PHASES];
+} ASE_Stats;
+
+ASE_DECL ASE_Stats *ASE_stats_attach (ASE_Stats *stats);
+// loads on the calling thread add to 'stats' from now on, until you attach
+// something else or 0. returns what was attached before. zero it yourself
+// to start over. batch and async loads run on other threads: attach from
+// your ASE_Dispatch or ASE_Submit if you want those counted.
+
+#endif // ASE_STATS
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - tracing
+//
+#ifdef ASE_TRACE
+
+typedef void (*ASE_TraceBegin) (void *user, const char *name, int64_t arg);
+typedef void (*ASE_TraceEnd)   (void *user, const char *name);
+// 'name' is a string literal, the same one for both ends:
+//     "load"    a whole sprite, arg 0
+//     "frame"   arg is the frame number
+//     "cel", "layer", "palette", "tags" or "chunk"
+//               one chunk of a frame, arg is its ASE_FILE_CHUNK_* type
+//     "inflate" a compressed cel, arg is the compressed size
+//     "index"   timelines, cel table and name lookups after the frames
+
+ASE_DECL void     ASE_trace_hooks (ASE_TraceBegin begin, ASE_TraceEnd end, void *user);
+// called around each piece of work, on whichever thread does it, so they
+// must be thread-safe. set them while nothing is loading; 0 to stop.
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_BOOL ASE_trace_json_open (const char *filename);
+// installs hooks that write every event to 'filename' as Chrome trace
+// JSON (chrome://tracing, ui.perfetto.dev), one track per thread.
+ASE_DECL void     ASE_trace_json_close (void);
+// removes them and finishes the file. stop loading first.
+#endif
+
+#endif // ASE_TRACE
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - allocators
+//
+#ifdef ASE_ALLOCATOR
+
+#define ASE_ALLOC_HEADER 32 // bytes in front of every block, see below
+
+typedef struct {
+	void *(*alloc)   (void *user, size_t size, const char *site);
+	void *(*realloc) (void *user, void *ptr, size_t old_size, size_t size, const char *site);
+	void  (*free)    (void *user, void *ptr, size_t size, const char *site);
+	void  *user;
+} ASE_Allocator;
+// 'site' is the "file:line" in this header that asked; free gets the site
+// that made (or last resized) the block. every block starts with
+// ASE_ALLOC_HEADER bytes where we keep its size, site and allocator, and the
+// sizes you see include them.
+
+ASE_DECL const ASE_Allocator *ASE_set_allocator (const ASE_Allocator *allocator);
+// allocations from now on, on every thread, go to 'allocator' (0 = back to
+// ASE_MALLOC and friends). returns the one before. blocks are freed by the
+// allocator that made them, so it has to outlive them. call it while
+// nothing is loading.
+
+// tracking -- counts everything on its way to another allocator
+#ifndef ASE_TRACKER_SITES
+#	define ASE_TRACKER_SITES 64
+#endif
+
+typedef struct {
+	const char *site;       // 0 = unused; the last slot takes the overflow
+	uint64_t    allocs;
+	uint64_t    frees;
+	uint64_t    reallocs;
+	uint64_t    live;       // blocks not freed yet
+	uint64_t    live_bytes;
+	uint64_t    peak_bytes;
+} ASE_TrackerSite;
+
+typedef struct {
+	ASE_Allocator        allocator; // pass &tracker.allocator to ASE_set_allocator
+	const ASE_Allocator *parent;    // where the memory comes from, 0 = ASE_MALLOC
+	void                *lock;
+
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t reallocs;
+	uint64_t realloc_moves;  // reallocs that came back somewhere else
+	uint64_t realloc_copied; // and the bytes they had to copy
+	uint64_t live;
+	uint64_t live_bytes;
+	uint64_t peak_live;
+	uint64_t peak_bytes;
+	ASE_TrackerSite sites[ASE_TRACKER_SITES];
+} ASE_Tracker;
+
+ASE_DECL ASE_BOOL ASE_tracker_init (ASE_Tracker *T, const ASE_Allocator *parent);
+ASE_DECL void     ASE_tracker_free (ASE_Tracker *T);
+// uninstall it first. blocks it still tracks go back to 'parent' as usual.
+
+#ifndef ASE_NO_STDIO
+ASE_DECL void     ASE_tracker_report (ASE_Tracker *T, FILE *f);
+// totals, then every site by peak bytes.
+#endif
+
+#endif // ASE_ALLOCATOR
+
 #define PAQ_ASE_H
 #endif
 
@@ -519,1786 +1022,4762 @@ ASE_streq(const char *a, const char *b)
 
 
 //////////////////////////////////////////////////////////////////////////////
-// context struct and functions
+// threads
 //
+#if !defined(ASE_NO_THREADS) && defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+	typedef HANDLE ASE__thread;
+	typedef LPTHREAD_START_ROUTINE ASE__thread_fn;
+#	define ASE__THREAD_PROC(name, arg) static DWORD WINAPI name(LPVOID arg)
+#elif !defined(ASE_NO_THREADS)
+#	include <pthread.h>
+#	include <sched.h>
+#	include <unistd.h>
+	typedef pthread_t ASE__thread;
+	typedef void *(*ASE__thread_fn)(void *);
+#	define ASE__THREAD_PROC(name, arg) static void *name(void *arg)
+#else
+	typedef int ASE__thread;
+	typedef void *(*ASE__thread_fn)(void *);
+#	define ASE__THREAD_PROC(name, arg) static void *name(void *arg)
+#endif
 
-// we want to load from different sources without a lot of code duplication
-
-typedef struct {
-	ASE_Callbacks io;
-	void *udata;
-
-	int read_callbacks;
-	int buflen;
-
-	uint8_t *buf;
-	uint8_t *buf_end;
-	uint8_t *buf_orig;
-	uint8_t *buf_orig_end;
-} ASE__ctx;
-
-
-// init decode from callbacks
-static void ASE__start_callbacks(ASE__ctx *ctx, ASE_Callbacks *cb, void *user)
+static int ASE__cpu_count(void)
 {
-	ctx->io = *cb;
-	ctx->udata = user;
-	ctx->read_callbacks = 1;
+#if defined(ASE_NO_THREADS)
+	return(1);
+#elif defined(_WIN32)
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	return((int)Info.dwNumberOfProcessors);
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long N = sysconf(_SC_NPROCESSORS_ONLN);
+	return((N > 0) ? (int)N : 1);
+#else
+	return(1);
+#endif
 }
 
-
-
-// memory interface
-static int ASE__mem_read(void *user, char *data, int size)
+static ASE_BOOL ASE__thread_start(ASE__thread *T, ASE__thread_fn Fn, void *Arg)
 {
-	ASE__ctx *C = (ASE__ctx *)user;
-	int count = 0;
-	for(; count < size; ++count) {
-		if (C->buf >= C->buf_end) break;
-		*(data++) = *(C->buf++);
-	}
-	return(count);
+#if defined(ASE_NO_THREADS)
+	(void)T; (void)Fn; (void)Arg;
+	return(0);
+#elif defined(_WIN32)
+	*T = CreateThread(0, 0, Fn, Arg, 0, 0);
+	return(0 != *T);
+#else
+	return(0 == pthread_create(T, 0, Fn, Arg));
+#endif
 }
 
-static void ASE__mem_skip(void *user, int bytes)
+static void ASE__thread_join(ASE__thread T)
 {
-	ASE__ctx *C = (ASE__ctx *)user;
-	for(; bytes; --bytes, ++C->buf) {
-		if (C->buf >= C->buf_end) break;
-	}
+#if defined(ASE_NO_THREADS)
+	(void)T;
+#elif defined(_WIN32)
+	WaitForSingleObject(T, INFINITE);
+	CloseHandle(T);
+#else
+	pthread_join(T, 0);
+#endif
 }
 
-static int ASE__mem_eof(void *user)
+// gives up the rest of the time slice
+static void ASE__thread_yield(void)
 {
-	ASE__ctx *C = (ASE__ctx *)user;
-	return(C->buf >= C->buf_end);
+#if defined(ASE_NO_THREADS)
+#elif defined(_WIN32)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
 }
 
-static int ASE__mem_tell(void *user)
+// returns the value from before the add
+static long ASE__atomic_inc(volatile long *p)
 {
-	ASE__ctx *C = (ASE__ctx *)user;
-	return((int)(C->buf - C->buf_orig));
+#if defined(_MSC_VER)
+	return(_InterlockedIncrement(p) - 1);
+#else
+	return(__sync_fetch_and_add(p, 1));
+#endif
 }
 
-static void ASE__mem_seek(void *user, int pos)
+// reads a flag another thread may be setting
+static long ASE__atomic_get(volatile long *p)
 {
-	ASE__ctx *C = (ASE__ctx *)user;
-	C->buf = C->buf_orig + pos;
+#if defined(_MSC_VER)
+	return(_InterlockedOr(p, 0));
+#else
+	return(__sync_fetch_and_add(p, 0));
+#endif
 }
 
-static ASE_Callbacks ASE__mem_callbacks = {
-	ASE__mem_read,
-	ASE__mem_skip,
-	ASE__mem_eof,
-	ASE__mem_tell,
-	ASE__mem_seek
-};
-
-static void ASE__start_mem(ASE__ctx *ctx, uint8_t *buf, int len)
+// stores New if *p is Old; returns what *p was
+static long ASE__atomic_cas(volatile long *p, long Old, long New)
 {
-	ASE__start_callbacks(ctx, &ASE__mem_callbacks, (void *)ctx);
-	ctx->buf = ctx->buf_orig = buf;
-	ctx->buf_end = ctx->buf_orig_end = buf + len;
+#if defined(_MSC_VER)
+	return(_InterlockedCompareExchange(p, New, Old));
+#else
+	return(__sync_val_compare_and_swap(p, Old, New));
+#endif
 }
 
+#if !defined(ASE_NO_THREADS) && defined(_WIN32)
+	typedef CRITICAL_SECTION   ASE__mutex;
+	typedef CONDITION_VARIABLE ASE__cond;
+#elif !defined(ASE_NO_THREADS)
+	typedef pthread_mutex_t    ASE__mutex;
+	typedef pthread_cond_t     ASE__cond;
+#else
+	typedef int                ASE__mutex;
+	typedef int                ASE__cond;
+#endif
 
-// file interface
-#ifndef ASE_NO_STDIO
-
-static int ASE__file_read(void *user, char *data, int size)
+static void ASE__mutex_init(ASE__mutex *M)
 {
-	return((int)fread(data, 1, size, (FILE *)user));
+#if defined(ASE_NO_THREADS)
+	(void)M;
+#elif defined(_WIN32)
+	InitializeCriticalSection(M);
+#else
+	pthread_mutex_init(M, 0);
+#endif
 }
 
-static void ASE__file_skip(void *user, int bytes)
+static void ASE__mutex_lock(ASE__mutex *M)
 {
-	fseek((FILE *)user, bytes, SEEK_CUR);
+#if defined(ASE_NO_THREADS)
+	(void)M;
+#elif defined(_WIN32)
+	EnterCriticalSection(M);
+#else
+	pthread_mutex_lock(M);
+#endif
 }
 
-static int ASE__file_eof(void *user)
+static void ASE__mutex_unlock(ASE__mutex *M)
 {
-	return(feof((FILE *)user));
+#if defined(ASE_NO_THREADS)
+	(void)M;
+#elif defined(_WIN32)
+	LeaveCriticalSection(M);
+#else
+	pthread_mutex_unlock(M);
+#endif
 }
 
-static int ASE__file_tell(void *user)
+static void ASE__cond_init(ASE__cond *C)
 {
-	return((int)ftell((FILE *)user));
+#if defined(ASE_NO_THREADS)
+	(void)C;
+#elif defined(_WIN32)
+	InitializeConditionVariable(C);
+#else
+	pthread_cond_init(C, 0);
+#endif
 }
 
-static void ASE__file_seek(void *user, int pos)
+static void ASE__cond_wait(ASE__cond *C, ASE__mutex *M)
 {
-	fseek((FILE *)user, pos, SEEK_SET);
-}
-
-static ASE_Callbacks ASE__file_callbacks = {
-	ASE__file_read,
-	ASE__file_skip,
-	ASE__file_eof,
-	ASE__file_tell,
-	ASE__file_seek
-};
+#if defined(ASE_NO_THREADS)
+	(void)C; (void)M;
+#elif defined(_WIN32)
+	SleepConditionVariableCS(C, M, INFINITE);
+#else
+	pthread_cond_wait(C, M);
+#endif
+}
 
-// init decode from FILE
-static void ASE__start_file(ASE__ctx *ctx, FILE *f)
+static void ASE__cond_broadcast(ASE__cond *C)
 {
-	ASE__start_callbacks(ctx, &ASE__file_callbacks, (void *)f);
+#if defined(ASE_NO_THREADS)
+	(void)C;
+#elif defined(_WIN32)
+	WakeAllConditionVariable(C);
+#else
+	pthread_cond_broadcast(C);
+#endif
 }
 
-#endif // !ASE_NO_STDIO
-
 
 
 //////////////////////////////////////////////////////////////////////////////
-// generic reads
+// statistics
 //
-ASE__read8(ASE__ctx *c)
+#if defined(ASE_STATS) || defined(ASE_TRACE)
+
+#if defined(ASE_NO_THREADS)
+#	define ASE__THREAD_LOCAL
+#elif defined(_MSC_VER)
+#	define ASE__THREAD_LOCAL __declspec(thread)
+#else
+#	define ASE__THREAD_LOCAL __thread
+#endif
+
+// stats, and the json trace writer; the trace hook alone doesn't need it
+#if defined(ASE_STATS) || (defined(ASE_TRACE) && !defined(ASE_NO_STDIO))
+#if defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+static uint64_t ASE__now_ns(void)
 {
-	uint8_t v;
-	if (1 == c->io.read(c->udata, &v, 1)) return(v);
-	return(0);
+#if defined(_WIN32)
+	LARGE_INTEGER Freq, Now;
+	QueryPerformanceFrequency(&Freq);
+	QueryPerformanceCounter(&Now);
+	return((uint64_t)((double)Now.QuadPart * 1e9 / (double)Freq.QuadPart));
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec T;
+	clock_gettime(CLOCK_MONOTONIC, &T);
+	return((uint64_t)T.tv_sec * 1000000000ull + (uint64_t)T.tv_nsec);
+#else
+	return((uint64_t)clock() * (1000000000ull / CLOCKS_PER_SEC));
+#endif
 }
+#endif
 
-ASE__read16(ASE__ctx *c)
+#endif // ASE_STATS || ASE_TRACE
+
+#ifdef ASE_STATS
+
+static ASE__THREAD_LOCAL ASE_Stats *ASE__stats;
+
+#	define ASE__STAT(expr)          do { ASE_Stats *S_ = ASE__stats; if (S_) S_->expr; } while(0)
+#	define ASE__STAT_BEGIN(t)       uint64_t t = ASE__stats ? ASE__now_ns() : 0
+#	define ASE__STAT_END(t, phase)  do { if (ASE__stats) ASE__stats->ns[phase] += ASE__now_ns() - t; } while(0)
+#	define ASE__STAT_CHUNK(type, n) ASE__stats_chunk(type, n)
+
+static void ASE__stats_chunk(uint16_t Type, uint32_t Size)
 {
-	uint8_t v[2];
-	if (2 == c->io.read(c->udata, v, 2))
-		return((v[1] << 8) | v[0]); // little-endian
-	else return(0);
+	ASE_Stats *S = ASE__stats;
+	if (!S) return;
+	int i = 0;
+	while (i < ASE_STATS_CHUNK_TYPES - 1 && S->chunks[i].type && S->chunks[i].type != Type) ++i;
+	if (!S->chunks[i].type) S->chunks[i].type = Type;
+	S->chunks[i].count += 1;
+	S->chunks[i].bytes += Size;
 }
 
-ASE__read32(ASE__ctx *c)
+#ifndef ASE_ALLOCATOR
+// the allocator, counted. these are compiled before the macros below
+// point at them, so they call whatever ASE_MALLOC was. with ASE_ALLOCATOR
+// the allocator shim counts instead.
+static void *ASE__stats_malloc(size_t Size)
 {
-	uint8_t v[4];
-	if (4 == c->io.read(c->udata, v, 4))
-		return((v[3] << 24) | (v[2] << 16) | (v[1] << 8) | v[0]); // little-endian
-	else return(0);
+	ASE__STAT(allocs += 1);
+	ASE__STAT(bytes_allocated += Size);
+	return(ASE_MALLOC(Size));
 }
 
+static void *ASE__stats_realloc(void *P, size_t Size)
+{
+	ASE__STAT(allocs += 1);
+	ASE__STAT(bytes_allocated += Size);
+	return(ASE_REALLOC(P, Size));
+}
 
-
-//////////////////////////////////////////////////////////////////////////////
-// pixels
-//
-ASE_DECL ASE_Pixel32
-ASE_Pixel32_make(int r, int g, int b, int a)
+static void ASE__stats_free(void *P)
 {
-	ASE_Pixel32 R = {0};
-	R.r = r;
-	R.g = g;
-	R.b = b;
-	R.a = a;
-	return(R);
+	if (P) ASE__STAT(frees += 1);
+	ASE_FREE(P);
 }
 
-ASE_DECL ASE_Pixel16
-ASE_Pixel16_make(int k, int a)
+#undef  ASE_MALLOC
+#undef  ASE_REALLOC
+#undef  ASE_FREE
+#define ASE_MALLOC  ASE__stats_malloc
+#define ASE_REALLOC ASE__stats_realloc
+#define ASE_FREE    ASE__stats_free
+#endif // !ASE_ALLOCATOR
+
+ASE_DECL ASE_Stats *
+ASE_stats_attach (ASE_Stats *stats)
 {
-	ASE_Pixel16 R = {0};
-	R.k = k;
-	R.a = a;
-	return(R);
+	ASE_Stats *Prev = ASE__stats;
+	ASE__stats = stats;
+	return(Prev);
 }
 
+#else
+#	define ASE__STAT(expr)          do {} while(0)
+#	define ASE__STAT_BEGIN(t)
+#	define ASE__STAT_END(t, phase)
+#	define ASE__STAT_CHUNK(type, n)
+#endif // ASE_STATS
+
 
 
 //////////////////////////////////////////////////////////////////////////////
-// document types
+// allocators
 //
-typedef struct {
-	uint32_t size;
-    uint16_t magic;
-    uint16_t frames;
-    uint16_t width;
-    uint16_t height;
-    uint16_t depth;       // 32, 16, or 8
-    uint32_t flags;
-    uint16_t speed;       // DEPRECATED: use "duration" of FrameHeader
-    uint32_t next;
-    uint32_t frit;
-    uint8_t  transparent_index;
-    uint8_t  _ignore[3];
-    uint16_t ncolors;
-    uint8_t  pixel_w;
-    uint8_t  pixel_h;
-} ASE_DOC_Header;
+#ifdef ASE_ALLOCATOR
 
 typedef struct {
-	uint32_t size;
-    uint16_t magic;
-    uint16_t chunks;
-    uint16_t duration;
-} ASE_FrameHeader;
+	size_t               size; // what was asked for, without the header
+	const ASE_Allocator *allocator;
+	const char          *site;
+} ASE__alloc_header;
 
-typedef struct {
-	uint32_t  size;
-	uint16_t  type;
-	size_t    start;
-} ASE_DOC_ChunkHeader;
+typedef char ASE__alloc_header_fits[(sizeof(ASE__alloc_header) <= ASE_ALLOC_HEADER) ? 1 : -1];
 
-typedef struct {
-	uint16_t flags;
-	uint16_t type;
-	uint16_t child_level;
-	uint16_t default_w;
-	uint16_t default_h;
-	uint16_t blendmode;
-	uint8_t  opacity;
-	uint8_t  _ignore[3];
-	char *   name;
-} ASE_LayerHeader;
+#define ASE__STR2(x) #x
+#define ASE__STR(x)  ASE__STR2(x)
+#define ASE__SITE    __FILE__ ":" ASE__STR(__LINE__)
 
+// the default, ASE_MALLOC and friends as they were before this section
+static void *ASE__default_alloc(void *user, size_t size, const char *site)
+{
+	(void)user; (void)site;
+	return(ASE_MALLOC(size));
+}
 
+static void *ASE__default_realloc(void *user, void *ptr, size_t old_size, size_t size, const char *site)
+{
+	(void)user; (void)old_size; (void)site;
+	return(ASE_REALLOC(ptr, size));
+}
 
-//////////////////////////////////////////////////////////////////////////////
-// document funcs
-//
-ASE_DECL char *
-ASE_DOC_read_string(ASE__ctx *F)
+static void ASE__default_free(void *user, void *ptr, size_t size, const char *site)
 {
-	char *S = 0;
-	uint16_t Length = ASE__read16(F);
+	(void)user; (void)size; (void)site;
+	ASE_FREE(ptr);
+}
 
-	if (Length != EOF) {
-		S = (char *)ASE_MALLOC(Length + 1);
-		S[Length] = '\0';
-		for (int i=0; i<Length; ++i) S[i] = ASE__read8(F);
+static const ASE_Allocator ASE__default_allocator = {
+	ASE__default_alloc,
+	ASE__default_realloc,
+	ASE__default_free,
+	0
+};
+
+static const ASE_Allocator *ASE__allocator = &ASE__default_allocator;
+
+ASE_DECL const ASE_Allocator *
+ASE_set_allocator (const ASE_Allocator *allocator)
+{
+	const ASE_Allocator *Prev = ASE__allocator;
+	ASE__allocator = allocator ? allocator : &ASE__default_allocator;
+	return((Prev == &ASE__default_allocator) ? 0 : Prev);
+}
+
+static void *ASE__alloc_malloc(size_t Size, const char *Site)
+{
+	const ASE_Allocator *A = ASE__allocator;
+	ASE__alloc_header *H = (ASE__alloc_header *)A->alloc(A->user, Size + ASE_ALLOC_HEADER, Site);
+	if (!H) return(0);
+	H->size      = Size;
+	H->allocator = A;
+	H->site      = Site;
+	ASE__STAT(allocs += 1);
+	ASE__STAT(bytes_allocated += Size);
+	return((char *)H + ASE_ALLOC_HEADER);
+}
+
+static void ASE__alloc_free(void *P)
+{
+	if (!P) return;
+	ASE__alloc_header *H = (ASE__alloc_header *)((char *)P - ASE_ALLOC_HEADER);
+	const ASE_Allocator *A = H->allocator;
+	ASE__STAT(frees += 1);
+	A->free(A->user, H, H->size + ASE_ALLOC_HEADER, H->site);
+}
+
+static void *ASE__alloc_realloc(void *P, size_t Size, const char *Site)
+{
+	if (!P) return(ASE__alloc_malloc(Size, Site));
+	if (!Size) {
+		ASE__alloc_free(P);
+		return(0);
 	}
+	ASE__alloc_header *H = (ASE__alloc_header *)((char *)P - ASE_ALLOC_HEADER);
+	const ASE_Allocator *A = H->allocator;
+	H = (ASE__alloc_header *)A->realloc(A->user, H,
+		H->size + ASE_ALLOC_HEADER, Size + ASE_ALLOC_HEADER, Site);
+	if (!H) return(0);
+	H->size = Size;
+	H->site = Site;
+	ASE__STAT(allocs += 1);
+	ASE__STAT(bytes_allocated += Size);
+	return((char *)H + ASE_ALLOC_HEADER);
+}
 
-	return(S);
+
+// tracking
+static ASE_TrackerSite *ASE__tracker_site(ASE_Tracker *T, const char *Site)
+{
+	int i = 0;
+	while (i < ASE_TRACKER_SITES - 1 && T->sites[i].site && T->sites[i].site != Site) ++i;
+	if (!T->sites[i].site) T->sites[i].site = Site;
+	return(T->sites + i);
 }
 
-ASE_DECL ASE_BOOL
-ASE_DOC_Header_read(ASE__ctx *F, ASE_DOC_Header *O)
+static void ASE__tracker_add(ASE_Tracker *T, const char *Site, size_t Size)
 {
-	size_t Pos = F->io.tell(F->udata);
+	ASE_TrackerSite *S = ASE__tracker_site(T, Site);
+	S->live       += 1;
+	S->live_bytes += Size;
+	if (S->live_bytes > S->peak_bytes) S->peak_bytes = S->live_bytes;
+
+	T->live       += 1;
+	T->live_bytes += Size;
+	if (T->live > T->peak_live) T->peak_live = T->live;
+	if (T->live_bytes > T->peak_bytes) T->peak_bytes = T->live_bytes;
+}
 
-	O->size = ASE__read32(F);
-	O->magic = ASE__read16(F);
-	O->frames = ASE__read16(F);
-	O->width = ASE__read16(F);
-	O->height = ASE__read16(F);
-	O->depth = ASE__read16(F);
-	O->flags = ASE__read32(F);
-	O->speed = ASE__read16(F);
-	O->next = ASE__read32(F);
-	O->frit = ASE__read32(F);
-	O->transparent_index = ASE__read8(F);
+static void ASE__tracker_remove(ASE_Tracker *T, const char *Site, size_t Size)
+{
+	ASE_TrackerSite *S = ASE__tracker_site(T, Site);
+	S->live       -= 1;
+	S->live_bytes -= Size;
+	T->live       -= 1;
+	T->live_bytes -= Size;
+}
 
-	F->io.skip(F->udata, 3);
+static const ASE_Allocator *ASE__tracker_parent(ASE_Tracker *T)
+{
+	return(T->parent ? T->parent : &ASE__default_allocator);
+}
 
-	O->ncolors = ASE__read16(F);
-	O->pixel_h = ASE__read8(F);
-	O->pixel_w = ASE__read8(F);
+static void *ASE__tracker_alloc(void *user, size_t size, const char *site)
+{
+	ASE_Tracker *T = (ASE_Tracker *)user;
+	const ASE_Allocator *A = ASE__tracker_parent(T);
+	void *P = A->alloc(A->user, size, site);
+	if (!P) return(0);
+
+	ASE__mutex_lock((ASE__mutex *)T->lock);
+	T->allocs += 1;
+	ASE__tracker_site(T, site)->allocs += 1;
+	ASE__tracker_add(T, site, size);
+	ASE__mutex_unlock((ASE__mutex *)T->lock);
+	return(P);
+}
 
-	if (O->magic != ASE_FILE_MAGIC) {
-		ASE_ERR("invalid magic: 0x%04x -- is this an Aseprite file?\n", (int)O->magic);
-		return(0);
-	}
-	if (O->depth != ASE_DEPTH_RGBA &&
-	    O->depth != ASE_DEPTH_GRAYSCALE &&
-	    O->depth != ASE_DEPTH_INDEXED)
-	{
-		ASE_ERR("invalid depth given: %i\n", O->depth);
-		return(0);
-	}
-	if (0 == O->ncolors) { // older file quirk
-		O->ncolors = 256;
-	}
-	if (!O->pixel_w || !O->pixel_h) {
-		O->pixel_w = O->pixel_h = 1;
+static void *ASE__tracker_realloc(void *user, void *ptr, size_t old_size, size_t size, const char *site)
+{
+	ASE_Tracker *T = (ASE_Tracker *)user;
+	const ASE_Allocator *A = ASE__tracker_parent(T);
+	const char *OldSite = ((ASE__alloc_header *)ptr)->site;
+	void *P = A->realloc(A->user, ptr, old_size, size, site);
+	if (!P) return(0);
+
+	ASE__mutex_lock((ASE__mutex *)T->lock);
+	T->reallocs += 1;
+	if (P != ptr) {
+		T->realloc_moves  += 1;
+		T->realloc_copied += (old_size < size) ? old_size : size;
 	}
+	ASE__tracker_site(T, site)->reallocs += 1;
+	ASE__tracker_remove(T, OldSite, old_size);
+	ASE__tracker_add(T, site, size);
+	ASE__mutex_unlock((ASE__mutex *)T->lock);
+	return(P);
+}
 
-	F->io.seek(F->udata, Pos + 128);
+static void ASE__tracker_free(void *user, void *ptr, size_t size, const char *site)
+{
+	ASE_Tracker *T = (ASE_Tracker *)user;
+	const ASE_Allocator *A = ASE__tracker_parent(T);
+
+	ASE__mutex_lock((ASE__mutex *)T->lock);
+	T->frees += 1;
+	ASE__tracker_site(T, site)->frees += 1;
+	ASE__tracker_remove(T, site, size);
+	ASE__mutex_unlock((ASE__mutex *)T->lock);
+
+	A->free(A->user, ptr, size, site);
+}
+
+ASE_DECL ASE_BOOL
+ASE_tracker_init (ASE_Tracker *T, const ASE_Allocator *parent)
+{
+	memset(T, 0, sizeof(ASE_Tracker));
+	T->lock = ASE_MALLOC(sizeof(ASE__mutex));
+	if (!T->lock) return(0);
+	ASE__mutex_init((ASE__mutex *)T->lock);
+
+	T->parent            = parent;
+	T->allocator.alloc   = ASE__tracker_alloc;
+	T->allocator.realloc = ASE__tracker_realloc;
+	T->allocator.free    = ASE__tracker_free;
+	T->allocator.user    = T;
 	return(1);
 }
 
 ASE_DECL void
-ASE_FrameHeader_read(ASE__ctx *F, ASE_FrameHeader *O)
+ASE_tracker_free (ASE_Tracker *T)
 {
-	size_t Pos = F->io.tell(F->udata);
+	ASE_FREE(T->lock);
+	T->lock = 0;
+}
 
-	O->size     = ASE__read32(F);
-	O->magic    = ASE__read16(F);
-	O->chunks   = ASE__read16(F);
-	O->duration = ASE__read16(F);
+#ifndef ASE_NO_STDIO
+ASE_DECL void
+ASE_tracker_report (ASE_Tracker *T, FILE *f)
+{
+	ASE__mutex_lock((ASE__mutex *)T->lock);
+	ASE_Tracker C = *T;
+	ASE__mutex_unlock((ASE__mutex *)T->lock);
+
+	fprintf(f, "ase allocations: %llu allocs, %llu frees, %llu reallocs "
+		"(%llu moved, %llu bytes copied)\n",
+		(unsigned long long)C.allocs, (unsigned long long)C.frees,
+		(unsigned long long)C.reallocs, (unsigned long long)C.realloc_moves,
+		(unsigned long long)C.realloc_copied);
+	fprintf(f, "  live: %llu blocks, %llu bytes; peak: %llu blocks, %llu bytes\n",
+		(unsigned long long)C.live, (unsigned long long)C.live_bytes,
+		(unsigned long long)C.peak_live, (unsigned long long)C.peak_bytes);
+
+	// biggest peak first
+	int Order[ASE_TRACKER_SITES];
+	int N = 0;
+	for (int i=0; i < ASE_TRACKER_SITES && C.sites[i].site; ++i) {
+		int j = N++;
+		for (; j > 0 && C.sites[Order[j-1]].peak_bytes < C.sites[i].peak_bytes; --j) Order[j] = Order[j-1];
+		Order[j] = i;
+	}
 
-	F->io.skip(F->udata, 6);
+	fprintf(f, "  %-28s %10s %10s %10s %8s %12s %12s\n",
+		"site", "allocs", "frees", "reallocs", "live", "live bytes", "peak bytes");
+	for (int i=0; i < N; ++i) {
+		ASE_TrackerSite *S = C.sites + Order[i];
+		const char *Name = S->site;
+		for (const char *c = S->site; *c; ++c) if ('/' == *c || '\\' == *c) Name = c + 1;
+		fprintf(f, "  %-28s %10llu %10llu %10llu %8llu %12llu %12llu\n", Name,
+			(unsigned long long)S->allocs, (unsigned long long)S->frees,
+			(unsigned long long)S->reallocs, (unsigned long long)S->live,
+			(unsigned long long)S->live_bytes, (unsigned long long)S->peak_bytes);
+	}
 }
+#endif // !ASE_NO_STDIO
+
+// everything below goes through the shim
+#undef  ASE_MALLOC
+#undef  ASE_REALLOC
+#undef  ASE_FREE
+#define ASE_MALLOC(size)     ASE__alloc_malloc(size, ASE__SITE)
+#define ASE_REALLOC(p, size) ASE__alloc_realloc(p, size, ASE__SITE)
+#define ASE_FREE(p)          ASE__alloc_free(p)
+
+#endif // ASE_ALLOCATOR
 
 
 
 //////////////////////////////////////////////////////////////////////////////
-// chunk reading
+// tracing
 //
+#ifdef ASE_TRACE
+
+static struct {
+	ASE_TraceBegin begin;
+	ASE_TraceEnd   end;
+	void *         user;
+} ASE__trace;
+
+#	define ASE__TRACE_BEGIN(name, arg) do { if (ASE__trace.begin) ASE__trace.begin(ASE__trace.user, name, arg); } while(0)
+#	define ASE__TRACE_END(name)        do { if (ASE__trace.end) ASE__trace.end(ASE__trace.user, name); } while(0)
+
 ASE_DECL void
-ASE_DOC_ChunkHeader_read(ASE__ctx *F, ASE_DOC_ChunkHeader *O)
+ASE_trace_hooks (ASE_TraceBegin begin, ASE_TraceEnd end, void *user)
 {
-	size_t Pos = F->io.tell(F->udata);
-	O->size = ASE__read32(F);
-	O->type = ASE__read16(F);
-	O->start = Pos + 6;
+	ASE__trace.begin = begin;
+	ASE__trace.end   = end;
+	ASE__trace.user  = user;
 }
 
-ASE_DECL ASE_Palette
-ASE_Palette_read(ASE__ctx *F, ASE_Palette *Prev)
+// cel, layer and so on get their own names on the timeline
+static const char *ASE__trace_chunk(uint16_t Type)
 {
-	ASE_Palette R = {0};
-	memcpy(&R, Prev, sizeof(R));
+	switch (Type) {
+		case ASE_FILE_CHUNK_CEL:        return("cel");
+		case ASE_FILE_CHUNK_LAYER:      return("layer");
+		case ASE_FILE_CHUNK_PALETTE:    return("palette");
+		case ASE_FILE_CHUNK_FRAME_TAGS: return("tags");
+		default:                        return("chunk");
+	}
+}
 
-	int NewSize = ASE__read32(F); // ignore
-	int From    = ASE__read32(F);
-	int To      = ASE__read32(F);
-	F->io.skip(F->udata, 8);
+#ifndef ASE_NO_STDIO
 
-	// since we have a static palette, we don't need to resize or anything.
-	// newsize is irrelevant for us lol
+// Chrome's JSON array format, a B and an E event for every span. threads
+// are numbered in the order they first show up.
+static struct {
+	FILE *        file;
+	ASE__mutex    lock;
+	uint64_t      start;
+	long          events;
+	volatile long threads;
+} ASE__trace_json;
 
-	ASE_DBG("\t\t--- palette chunk ---\n");
-	ASE_DBG("\t\tfrom:  %i\n", (int)From);
-	ASE_DBG("\t\tto:    %i\n", (int)To);
-	ASE_DBG("\t\t   i  | r | g | b | a \n"
-			"\t\t  --------------------\n");
+static ASE__THREAD_LOCAL long ASE__trace_tid;
 
-	for (int i=From; i <= To; ++i) {
-		int Flags = ASE__read16(F);
-		R.colors[R.ncolors++].rgba = ASE__read32(F);
+static void ASE__trace_json_event(char Phase, const char *Name, int64_t Arg)
+{
+	uint64_t Now = ASE__now_ns();
+	if (!ASE__trace_tid) ASE__trace_tid = ASE__atomic_inc(&ASE__trace_json.threads) + 1;
+
+	ASE__mutex_lock(&ASE__trace_json.lock);
+	FILE *f = ASE__trace_json.file;
+	if (f) {
+		fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"ase\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%ld",
+			ASE__trace_json.events++ ? ",\n" : "", Name, Phase,
+			(double)(Now - ASE__trace_json.start) / 1000.0, ASE__trace_tid);
+		if ('B' == Phase) fprintf(f, ",\"args\":{\"arg\":%lld}", (long long)Arg);
+		fputs("}", f);
+	}
+	ASE__mutex_unlock(&ASE__trace_json.lock);
+}
 
-		// windows balogna: byte order (sigh)
-		{
-			uint8_t tmp = R.colors[R.ncolors-1].r;
-			R.colors[R.ncolors-1].r = R.colors[R.ncolors-1].b;
-			R.colors[R.ncolors-1].b = tmp;
-		}
+static void ASE__trace_json_begin(void *user, const char *name, int64_t arg)
+{
+	(void)user;
+	ASE__trace_json_event('B', name, arg);
+}
 
-		ASE_DBG("\t\t  %03i: %3i %3i %3i %3i\n", i,
-			(int)R.colors[R.ncolors-1].r,
-			(int)R.colors[R.ncolors-1].g,
-			(int)R.colors[R.ncolors-1].b,
-			(int)R.colors[R.ncolors-1].a);
+static void ASE__trace_json_end(void *user, const char *name)
+{
+	(void)user;
+	ASE__trace_json_event('E', name, 0);
+}
 
-		// skip name
-		if (Flags & ASE_PALETTE_FLAG_HAS_NAME) {
-			char *Name = ASE_DOC_read_string(F);
-			ASE_DBG("\t\tname: %s\n", Name);
-			ASE_FREE(Name);
-		}
+ASE_DECL ASE_BOOL
+ASE_trace_json_open (const char *filename)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		ASE_ERR("could not open file: %s\n", filename);
+		return(0);
 	}
+	fputs("[\n", f);
 
-	return(R);
+	ASE__mutex_init(&ASE__trace_json.lock);
+	ASE__trace_json.file   = f;
+	ASE__trace_json.start  = ASE__now_ns();
+	ASE__trace_json.events = 0;
+	ASE_trace_hooks(ASE__trace_json_begin, ASE__trace_json_end, 0);
+	return(1);
 }
 
-
-//////////////////////////////////////////////////////////////////////////////
-// layers
-//
-ASE_DECL ASE_Layer *
-ASE_DOC_AddLayer(ASE_Sprite *S)
+ASE_DECL void
+ASE_trace_json_close (void)
 {
-	S->layers = (ASE_Layer *)ASE_REALLOC(S->layers, ++S->nlayers * sizeof(ASE_Layer));
-	ASE_Layer *L = S->layers + (S->nlayers - 1);
-	memset(L, 0, sizeof(ASE_Layer));
-
-	ASE_DBG("\t\tlayer index: %i\n", (int)S->nlayers-1);
-
-	return(L);
+	if (!ASE__trace_json.file) return;
+	ASE_trace_hooks(0, 0, 0);
+
+	ASE__mutex_lock(&ASE__trace_json.lock);
+	fputs("\n]\n", ASE__trace_json.file);
+	fclose(ASE__trace_json.file);
+	ASE__trace_json.file = 0;
+	ASE__mutex_unlock(&ASE__trace_json.lock);
 }
 
-ASE_DECL ASE_Layer *
-ASE_Layer_read(ASE__ctx *F,
-	               ASE_DOC_Header *Header,
-				   ASE_Sprite *Sprite,
-				   ASE_Layer **PrevLayer,
-				   int *CurrentLevel)
-{
-	// LAYER HEADER
-	ASE_LayerHeader H = {0};
-	H.flags = ASE__read16(F);
-	H.type  = ASE__read16(F);
-	H.child_level = ASE__read16(F);
-	H.default_w = ASE__read16(F);
-	H.default_h = ASE__read16(F);
-	H.blendmode = ASE__read16(F);
-	H.opacity = ASE__read8(F);
-	F->io.skip(F->udata, 3);
-	H.name = ASE_DOC_read_string(F);
+#endif // !ASE_NO_STDIO
 
-	ASE_DBG("\t\t--- layer chunk ---\n");
-	ASE_DBG("\t\tname:      %s\n", H.name);
-	ASE_DBG("\t\ttype:      0x%04x\n", (int)H.type);
-	ASE_DBG("\t\tclevel:    %i\n", (int)H.child_level);
-	ASE_DBG("\t\tdefault_w: %i\n", (int)H.default_w);
-	ASE_DBG("\t\tdefault_h: %i\n", (int)H.default_h);
-	ASE_DBG("\t\tblendmode: %i\n", (int)H.blendmode);
-	ASE_DBG("\t\topacity:   %i\n", (int)H.opacity);
+#else
+#	define ASE__TRACE_BEGIN(name, arg)
+#	define ASE__TRACE_END(name)
+#endif // ASE_TRACE
 
-	// LAYER DATA
-	ASE_Layer *Layer = 0;
 
-	// TYPE
-	switch (H.type) {
-	case ASE_FILE_LAYER_IMAGE:
-		{
-			Layer = ASE_DOC_AddLayer(Sprite);
 
-			// only transparent layers have blendmode, opacity
-			if (!(H.flags & ASE_LAYER_BACKGROUND)) {
-				Layer->blendmode = H.blendmode;
-				Layer->opacity   = H.opacity;
-			}
+//////////////////////////////////////////////////////////////////////////////
+// context struct and functions
+//
 
-			ASE_DBG("\t\t--- image layer ---\n");
-		} break;
+// we want to load from different sources without a lot of code duplication
 
-	case ASE_FILE_LAYER_GROUP:
-		{
-			Layer = ASE_DOC_AddLayer(Sprite);
-			ASE_DBG("\t\t--- layer group ---\n");
-		} break;
+typedef struct {
+	ASE_Callbacks io;
+	void *udata;
 
-		// ? No default case ?
-	}
+	int read_callbacks;
+	int buflen;
 
-	// DECODE
-	if (Layer) {
-		Layer->name = H.name;
-		Layer->flags = H.flags;
-		Layer->type = H.type;
-		Layer->child_level = H.child_level;
+	uint8_t *buf;
+	uint8_t *buf_end;
+	uint8_t *buf_orig;
+	uint8_t *buf_orig_end;
 
-		Layer->visible = (H.flags & ASE_LAYER_VISIBLE);
+	// compressed cel bytes; an ASE_Decoder keeps it between files
+	uint8_t *scratch;
+	int      scratch_cap;
 
-		// parent (groups)
-		if (0 == H.child_level) {
-			Layer->parent = -1; // root
-		} else if (*CurrentLevel == H.child_level) {
-			Layer->parent = (*PrevLayer)->parent;
-		} else if (H.child_level > *CurrentLevel) {
-			// PREVIOUS LAYER IS GROUP, ADD THIS LAYER
-			Layer->parent = Sprite->nlayers - 2;
-		} else if (H.child_level < *CurrentLevel) {
-			// WALK BACK UP LAYER CHAIN UNTIL LEVEL REACHED
-			int Parent = (*PrevLayer)->parent;
-			if (Parent >= 0) {
-				int Levels = *CurrentLevel - H.child_level;
-				int ThisLayer = Sprite->nlayers - 1;
-				while (Levels--) {
-					ASE_Layer *PL = Sprite->layers + Parent;
-					if (PL->parent == -1) break;
-					Parent = PL->parent;
-				}
-			}
-		}
+	// set by ASE_request_cancel, checked between frames
+	volatile long *cancel;
 
-		*PrevLayer = Layer;
-		*CurrentLevel = H.child_level;
+	// room in the sprite's arrays; cels_cap is for the frame being read
+	int frames_cap;
+	int cels_cap;
+	int layers_cap;
+	int tags_cap;
 
-		ASE_DBG("\t\tparent:        %s\n", (Layer->parent <= -1)? "root" : Sprite->layers[Layer->parent].name);
-		ASE_DBG("\t\tlevel:         %i\n", (int)Layer->child_level);
-		ASE_DBG("\t\tcurrent_level: %i\n", (int)*CurrentLevel);
+#ifdef ASE_STATS
+	// the real callbacks while counting ones stand in for them
+	ASE_Callbacks stats_io;
+	void *        stats_udata;
+#endif
+} ASE__ctx;
+
+// resizes an array to hold exactly 'Want' items
+static ASE_BOOL ASE__reserve(void **Items, int *Cap, int Want, int Size)
+{
+	void *P = 0;
+	if (Want) {
+		P = ASE_REALLOC(*Items, (size_t)Want * Size);
+		if (!P) return(0);
 	} else {
-		ASE_FREE(H.name);
+		ASE_FREE(*Items);
 	}
+	*Items = P;
+	*Cap   = Want;
+	return(1);
+}
 
-	return(Layer);
+// makes room for at least 'Want' items, doubling as it goes
+static ASE_BOOL ASE__grow(void **Items, int *Cap, int Want, int Size)
+{
+	if (Want <= *Cap) return(1);
+	int NewCap = (*Cap > 4) ? *Cap : 4;
+	while (NewCap < Want) NewCap *= 2;
+	return(ASE__reserve(Items, Cap, NewCap, Size));
 }
 
+static uint8_t *ASE__scratch(ASE__ctx *F, int size)
+{
+	if (size > F->scratch_cap) {
+		uint8_t *P = (uint8_t *)ASE_REALLOC(F->scratch, size);
+		if (!P) return(0);
+		F->scratch = P;
+		F->scratch_cap = size;
+	}
+	return(F->scratch);
+}
 
 
-//////////////////////////////////////////////////////////////////////////////
-// frames
-//
-ASE_DECL ASE_Frame *
-ASE_DOC_AddFrame(ASE_Sprite *S)
+// init decode from callbacks
+static void ASE__start_callbacks(ASE__ctx *ctx, ASE_Callbacks *cb, void *user)
 {
-	S->frames = (ASE_Frame *)ASE_REALLOC(S->frames, ++S->nframes * sizeof(ASE_Frame));
-	ASE_Frame *A = S->frames + (S->nframes - 1);
-	memset(A, 0, sizeof(ASE_Frame));
-	ASE_DBG("\t\tframe index: %i\n", (int)S->nframes-1);
-	return(A);
+	ctx->io = *cb;
+	ctx->udata = user;
+	ctx->read_callbacks = 1;
 }
 
 
 
-//////////////////////////////////////////////////////////////////////////////
-// cels
-//
-ASE_DECL ASE_Cel *
-ASE_DOC_AddCel(ASE_Frame *S)
+// memory interface
+static int ASE__mem_read(void *user, char *data, int size)
 {
-	S->cels = (ASE_Cel *)ASE_REALLOC(S->cels, ++S->ncels * sizeof(ASE_Cel));
-	ASE_Cel *L = S->cels + (S->ncels - 1);
-	memset(L, 0, sizeof(ASE_Cel));
-	ASE_DBG("\t\tcel index: %i\n", (int)S->ncels-1);
-	return(L);
+	ASE__ctx *C = (ASE__ctx *)user;
+	int count = (int)(C->buf_end - C->buf);
+	if (count > size) count = size;
+	if (count < 0) count = 0;
+	memcpy(data, C->buf, count);
+	C->buf += count;
+	return(count);
 }
 
-
-ASE_DECL void
-ASE_DOC_read_raw_image_rgba      (ASE__ctx *F, ASE_Cel *Cel)
+static void ASE__mem_skip(void *user, int bytes)
 {
-	Cel->data = (uint8_t *)ASE_MALLOC(Cel->w * Cel->h * 4);
-	uint8_t *P = (uint8_t *)Cel->data;
-	for (int i=0; i < Cel->w * Cel->h; ++i) {
-		*(P++) = ASE__read8(F);
-		*(P++) = ASE__read8(F);
-		*(P++) = ASE__read8(F);
-		*(P++) = ASE__read8(F);
+	ASE__ctx *C = (ASE__ctx *)user;
+	for(; bytes; --bytes, ++C->buf) {
+		if (C->buf >= C->buf_end) break;
 	}
-	ASE_DBG("\t\t--- (LOADED) ---\n");
 }
 
-ASE_DECL void
-ASE_DOC_read_raw_image_grayscale (ASE__ctx *F, ASE_Cel *Cel)
+static int ASE__mem_eof(void *user)
 {
-	Cel->data = (uint8_t *)ASE_MALLOC(Cel->w * Cel->h * 2);
-	uint8_t *P = Cel->data;
-	for (int i=0; i < Cel->w * Cel->h; ++i) {
-		*(P++) = ASE__read8(F);
-		*(P++) = ASE__read8(F);
-	}
-	ASE_DBG("\t\t--- (LOADED) ---\n");
+	ASE__ctx *C = (ASE__ctx *)user;
+	return(C->buf >= C->buf_end);
 }
 
-ASE_DECL void
-ASE_DOC_read_raw_image_indexed   (ASE__ctx *F, ASE_Cel *Cel)
+static int ASE__mem_tell(void *user)
 {
-	Cel->data = (uint8_t *)ASE_MALLOC(Cel->w * Cel->h);
-	uint8_t *P = Cel->data;
-	for (int i=0; i < Cel->w * Cel->h; ++i) *(P++) = ASE__read8(F);
-	ASE_DBG("\t\t--- (LOADED) ---\n");
+	ASE__ctx *C = (ASE__ctx *)user;
+	return((int)(C->buf - C->buf_orig));
 }
 
+static void ASE__mem_seek(void *user, int pos)
+{
+	ASE__ctx *C = (ASE__ctx *)user;
+	C->buf = C->buf_orig + pos;
+}
 
+static ASE_Callbacks ASE__mem_callbacks = {
+	ASE__mem_read,
+	ASE__mem_skip,
+	ASE__mem_eof,
+	ASE__mem_tell,
+	ASE__mem_seek
+};
 
-//////////////////////////////////////////////////////////////////////////////
-// ZLIB
-//
-#if !defined(STBI_INCLUDE_STB_IMAGE_H) || defined(STBI_NO_ZLIB) || (defined(STBI_NO_PNG) && !defined(STBI_SUPPORT_ZLIB))
-
-// public domain zlib decode    v0.2  Sean Barrett 2006-11-18
-//    simple implementation
-//      - all input must be provided in an upfront buffer
-//      - all output is written to a single output buffer (can malloc/realloc)
-//    performance
-//      - fast huffman
-
+static void ASE__start_mem(ASE__ctx *ctx, uint8_t *buf, int len)
+{
+	ASE__start_callbacks(ctx, &ASE__mem_callbacks, (void *)ctx);
+	ctx->buf = ctx->buf_orig = buf;
+	ctx->buf_end = ctx->buf_orig_end = buf + len;
+}
 
-// header /////////////////////////////////////////////////////////////////////
-#ifdef STB_IMAGE_STATIC
-#define STBIDEF static
-#else
-#define STBIDEF extern
-#endif
 
-STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
-STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, int len, int initial_size, int *outlen, int parse_header);
-STBIDEF char *stbi_zlib_decode_malloc(const char *buffer, int len, int *outlen);
-STBIDEF int   stbi_zlib_decode_buffer(char *obuffer, int olen, const char *ibuffer, int ilen);
+// file interface
+#ifndef ASE_NO_STDIO
 
-STBIDEF char *stbi_zlib_decode_noheader_malloc(const char *buffer, int len, int *outlen);
-STBIDEF int   stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char *ibuffer, int ilen);
+static int ASE__file_read(void *user, char *data, int size)
+{
+	return((int)fread(data, 1, size, (FILE *)user));
+}
 
+static void ASE__file_skip(void *user, int bytes)
+{
+	fseek((FILE *)user, bytes, SEEK_CUR);
+}
 
-// implementation /////////////////////////////////////////////////////////////
-#include <stdarg.h>
-#include <stddef.h> // ptrdiff_t on osx
-#include <stdlib.h>
-#include <string.h>
+static int ASE__file_eof(void *user)
+{
+	return(feof((FILE *)user));
+}
 
-typedef unsigned char stbi_uc;
+static int ASE__file_tell(void *user)
+{
+	return((int)ftell((FILE *)user));
+}
+
+static void ASE__file_seek(void *user, int pos)
+{
+	fseek((FILE *)user, pos, SEEK_SET);
+}
+
+static ASE_Callbacks ASE__file_callbacks = {
+	ASE__file_read,
+	ASE__file_skip,
+	ASE__file_eof,
+	ASE__file_tell,
+	ASE__file_seek
+};
+
+// init decode from FILE
+static void ASE__start_file(ASE__ctx *ctx, FILE *f)
+{
+	ASE__start_callbacks(ctx, &ASE__file_callbacks, (void *)f);
+}
+
+#endif // !ASE_NO_STDIO
+
+
+// counting interface, in front of any of the others
+#ifdef ASE_STATS
+
+static int ASE__stats_read(void *user, char *data, int size)
+{
+	ASE__ctx *C = (ASE__ctx *)user;
+	int Count = C->stats_io.read(C->stats_udata, data, size);
+	ASE__STAT(io_calls += 1);
+	ASE__STAT(reads += 1);
+	if (Count > 0) ASE__STAT(bytes_read += Count);
+	return(Count);
+}
+
+static void ASE__stats_skip(void *user, int bytes)
+{
+	ASE__ctx *C = (ASE__ctx *)user;
+	ASE__STAT(io_calls += 1);
+	ASE__STAT(seeks += 1);
+	C->stats_io.skip(C->stats_udata, bytes);
+}
+
+static int ASE__stats_eof(void *user)
+{
+	ASE__ctx *C = (ASE__ctx *)user;
+	ASE__STAT(io_calls += 1);
+	return(C->stats_io.eof(C->stats_udata));
+}
+
+static int ASE__stats_tell(void *user)
+{
+	ASE__ctx *C = (ASE__ctx *)user;
+	ASE__STAT(io_calls += 1);
+	return(C->stats_io.tell(C->stats_udata));
+}
+
+static void ASE__stats_seek(void *user, int pos)
+{
+	ASE__ctx *C = (ASE__ctx *)user;
+	ASE__STAT(io_calls += 1);
+	ASE__STAT(seeks += 1);
+	C->stats_io.seek(C->stats_udata, pos);
+}
+
+static ASE_Callbacks ASE__stats_callbacks = {
+	ASE__stats_read,
+	ASE__stats_skip,
+	ASE__stats_eof,
+	ASE__stats_tell,
+	ASE__stats_seek
+};
+
+#endif // ASE_STATS
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// generic reads
+//
+ASE__read8(ASE__ctx *c)
+{
+	uint8_t v;
+	if (1 == c->io.read(c->udata, &v, 1)) return(v);
+	return(0);
+}
+
+ASE__read16(ASE__ctx *c)
+{
+	uint8_t v[2];
+	if (2 == c->io.read(c->udata, v, 2))
+		return((v[1] << 8) | v[0]); // little-endian
+	else return(0);
+}
+
+ASE__read32(ASE__ctx *c)
+{
+	uint8_t v[4];
+	if (4 == c->io.read(c->udata, v, 4))
+		return((v[3] << 24) | (v[2] << 16) | (v[1] << 8) | v[0]); // little-endian
+	else return(0);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// pixels
+//
+ASE_DECL ASE_Pixel32
+ASE_Pixel32_make(int r, int g, int b, int a)
+{
+	ASE_Pixel32 R = {0};
+	R.r = r;
+	R.g = g;
+	R.b = b;
+	R.a = a;
+	return(R);
+}
+
+ASE_DECL ASE_Pixel16
+ASE_Pixel16_make(int k, int a)
+{
+	ASE_Pixel16 R = {0};
+	R.k = k;
+	R.a = a;
+	return(R);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// document types
+//
+typedef struct {
+	uint32_t size;
+    uint16_t magic;
+    uint16_t frames;
+    uint16_t width;
+    uint16_t height;
+    uint16_t depth;       // 32, 16, or 8
+    uint32_t flags;
+    uint16_t speed;       // DEPRECATED: use "duration" of FrameHeader
+    uint32_t next;
+    uint32_t frit;
+    uint8_t  transparent_index;
+    uint8_t  _ignore[3];
+    uint16_t ncolors;
+    uint8_t  pixel_w;
+    uint8_t  pixel_h;
+} ASE_DOC_Header;
+
+typedef struct {
+	uint32_t size;
+    uint16_t magic;
+    uint16_t chunks;
+    uint16_t duration;
+} ASE_FrameHeader;
+
+typedef struct {
+	uint32_t  size;
+	uint16_t  type;
+	size_t    start;
+} ASE_DOC_ChunkHeader;
+
+typedef struct {
+	uint16_t flags;
+	uint16_t type;
+	uint16_t child_level;
+	uint16_t default_w;
+	uint16_t default_h;
+	uint16_t blendmode;
+	uint8_t  opacity;
+	uint8_t  _ignore[3];
+	char *   name;
+} ASE_LayerHeader;
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// document funcs
+//
+ASE_DECL char *
+ASE_DOC_read_string(ASE__ctx *F)
+{
+	char *S = 0;
+	uint16_t Length = ASE__read16(F);
+
+	if (Length != EOF) {
+		S = (char *)ASE_MALLOC(Length + 1);
+		S[Length] = '\0';
+		for (int i=0; i<Length; ++i) S[i] = ASE__read8(F);
+	}
+
+	return(S);
+}
+
+ASE_DECL ASE_BOOL
+ASE_DOC_Header_read(ASE__ctx *F, ASE_DOC_Header *O)
+{
+	size_t Pos = F->io.tell(F->udata);
+
+	O->size = ASE__read32(F);
+	O->magic = ASE__read16(F);
+	O->frames = ASE__read16(F);
+	O->width = ASE__read16(F);
+	O->height = ASE__read16(F);
+	O->depth = ASE__read16(F);
+	O->flags = ASE__read32(F);
+	O->speed = ASE__read16(F);
+	O->next = ASE__read32(F);
+	O->frit = ASE__read32(F);
+	O->transparent_index = ASE__read8(F);
+
+	F->io.skip(F->udata, 3);
+
+	O->ncolors = ASE__read16(F);
+	O->pixel_h = ASE__read8(F);
+	O->pixel_w = ASE__read8(F);
+
+	if (O->magic != ASE_FILE_MAGIC) {
+		ASE_ERR("invalid magic: 0x%04x -- is this an Aseprite file?\n", (int)O->magic);
+		return(0);
+	}
+	if (O->depth != ASE_DEPTH_RGBA &&
+	    O->depth != ASE_DEPTH_GRAYSCALE &&
+	    O->depth != ASE_DEPTH_INDEXED)
+	{
+		ASE_ERR("invalid depth given: %i\n", O->depth);
+		return(0);
+	}
+	if (0 == O->ncolors) { // older file quirk
+		O->ncolors = 256;
+	}
+	if (!O->pixel_w || !O->pixel_h) {
+		O->pixel_w = O->pixel_h = 1;
+	}
+
+	F->io.seek(F->udata, Pos + 128);
+	return(1);
+}
+
+ASE_DECL void
+ASE_FrameHeader_read(ASE__ctx *F, ASE_FrameHeader *O)
+{
+	size_t Pos = F->io.tell(F->udata);
+
+	O->size     = ASE__read32(F);
+	O->magic    = ASE__read16(F);
+	O->chunks   = ASE__read16(F);
+	O->duration = ASE__read16(F);
+
+	F->io.skip(F->udata, 6);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// chunk reading
+//
+ASE_DECL void
+ASE_DOC_ChunkHeader_read(ASE__ctx *F, ASE_DOC_ChunkHeader *O)
+{
+	size_t Pos = F->io.tell(F->udata);
+	O->size = ASE__read32(F);
+	O->type = ASE__read16(F);
+	O->start = Pos + 6;
+}
+
+ASE_DECL ASE_Palette
+ASE_Palette_read(ASE__ctx *F, ASE_Palette *Prev)
+{
+	ASE_Palette R = {0};
+	memcpy(&R, Prev, sizeof(R));
+
+	int NewSize = ASE__read32(F); // ignore
+	int From    = ASE__read32(F);
+	int To      = ASE__read32(F);
+	F->io.skip(F->udata, 8);
+
+	// since we have a static palette, we don't need to resize or anything.
+	// newsize is irrelevant for us lol
+
+	ASE_DBG("\t\t--- palette chunk ---\n");
+	ASE_DBG("\t\tfrom:  %i\n", (int)From);
+	ASE_DBG("\t\tto:    %i\n", (int)To);
+	ASE_DBG("\t\t   i  | r | g | b | a \n"
+			"\t\t  --------------------\n");
+
+	for (int i=From; i <= To; ++i) {
+		int Flags = ASE__read16(F);
+		R.colors[R.ncolors++].rgba = ASE__read32(F);
+
+		// windows balogna: byte order (sigh)
+		{
+			uint8_t tmp = R.colors[R.ncolors-1].r;
+			R.colors[R.ncolors-1].r = R.colors[R.ncolors-1].b;
+			R.colors[R.ncolors-1].b = tmp;
+		}
+
+		ASE_DBG("\t\t  %03i: %3i %3i %3i %3i\n", i,
+			(int)R.colors[R.ncolors-1].r,
+			(int)R.colors[R.ncolors-1].g,
+			(int)R.colors[R.ncolors-1].b,
+			(int)R.colors[R.ncolors-1].a);
+
+		// skip name
+		if (Flags & ASE_PALETTE_FLAG_HAS_NAME) {
+			char *Name = ASE_DOC_read_string(F);
+			ASE_DBG("\t\tname: %s\n", Name);
+			ASE_FREE(Name);
+		}
+	}
+
+	return(R);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// layers
+//
+ASE_DECL ASE_Layer *
+ASE_DOC_AddLayer(ASE__ctx *F, ASE_Sprite *S)
+{
+	if (!ASE__grow((void **)&S->layers, &F->layers_cap, S->nlayers + 1, sizeof(ASE_Layer))) return(0);
+	ASE_Layer *L = S->layers + S->nlayers++;
+	memset(L, 0, sizeof(ASE_Layer));
+
+	ASE_DBG("\t\tlayer index: %i\n", (int)S->nlayers-1);
+
+	return(L);
+}
+
+ASE_DECL ASE_Layer *
+ASE_Layer_read(ASE__ctx *F,
+	               ASE_DOC_Header *Header,
+				   ASE_Sprite *Sprite,
+				   ASE_Layer **PrevLayer,
+				   int *CurrentLevel)
+{
+	// LAYER HEADER
+	ASE_LayerHeader H = {0};
+	H.flags = ASE__read16(F);
+	H.type  = ASE__read16(F);
+	H.child_level = ASE__read16(F);
+	H.default_w = ASE__read16(F);
+	H.default_h = ASE__read16(F);
+	H.blendmode = ASE__read16(F);
+	H.opacity = ASE__read8(F);
+	F->io.skip(F->udata, 3);
+	H.name = ASE_DOC_read_string(F);
+
+	ASE_DBG("\t\t--- layer chunk ---\n");
+	ASE_DBG("\t\tname:      %s\n", H.name);
+	ASE_DBG("\t\ttype:      0x%04x\n", (int)H.type);
+	ASE_DBG("\t\tclevel:    %i\n", (int)H.child_level);
+	ASE_DBG("\t\tdefault_w: %i\n", (int)H.default_w);
+	ASE_DBG("\t\tdefault_h: %i\n", (int)H.default_h);
+	ASE_DBG("\t\tblendmode: %i\n", (int)H.blendmode);
+	ASE_DBG("\t\topacity:   %i\n", (int)H.opacity);
+
+	// LAYER DATA
+	ASE_Layer *Layer = 0;
+
+	// TYPE
+	switch (H.type) {
+	case ASE_FILE_LAYER_IMAGE:
+		{
+			Layer = ASE_DOC_AddLayer(F, Sprite);
+
+			// only transparent layers have blendmode, opacity
+			if (!(H.flags & ASE_LAYER_BACKGROUND)) {
+				Layer->blendmode = H.blendmode;
+				Layer->opacity   = H.opacity;
+			}
+
+			ASE_DBG("\t\t--- image layer ---\n");
+		} break;
+
+	case ASE_FILE_LAYER_GROUP:
+		{
+			Layer = ASE_DOC_AddLayer(F, Sprite);
+			ASE_DBG("\t\t--- layer group ---\n");
+		} break;
+
+		// ? No default case ?
+	}
+
+	// DECODE
+	if (Layer) {
+		Layer->name = H.name;
+		Layer->flags = H.flags;
+		Layer->type = H.type;
+		Layer->child_level = H.child_level;
+
+		Layer->visible = (H.flags & ASE_LAYER_VISIBLE);
+
+		// parent (groups)
+		if (0 == H.child_level) {
+			Layer->parent = -1; // root
+		} else if (*CurrentLevel == H.child_level) {
+			Layer->parent = (*PrevLayer)->parent;
+		} else if (H.child_level > *CurrentLevel) {
+			// PREVIOUS LAYER IS GROUP, ADD THIS LAYER
+			Layer->parent = Sprite->nlayers - 2;
+		} else if (H.child_level < *CurrentLevel) {
+			// WALK BACK UP LAYER CHAIN UNTIL LEVEL REACHED
+			int Parent = (*PrevLayer)->parent;
+			if (Parent >= 0) {
+				int Levels = *CurrentLevel - H.child_level;
+				int ThisLayer = Sprite->nlayers - 1;
+				while (Levels--) {
+					ASE_Layer *PL = Sprite->layers + Parent;
+					if (PL->parent == -1) break;
+					Parent = PL->parent;
+				}
+			}
+		}
+
+		*PrevLayer = Layer;
+		*CurrentLevel = H.child_level;
+
+		ASE_DBG("\t\tparent:        %s\n", (Layer->parent <= -1)? "root" : Sprite->layers[Layer->parent].name);
+		ASE_DBG("\t\tlevel:         %i\n", (int)Layer->child_level);
+		ASE_DBG("\t\tcurrent_level: %i\n", (int)*CurrentLevel);
+	} else {
+		ASE_FREE(H.name);
+	}
+
+	return(Layer);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// frames
+//
+ASE_DECL ASE_Frame *
+ASE_DOC_AddFrame(ASE__ctx *F, ASE_Sprite *S)
+{
+	if (!ASE__grow((void **)&S->frames, &F->frames_cap, S->nframes + 1, sizeof(ASE_Frame))) return(0);
+	ASE_Frame *A = S->frames + S->nframes++;
+	memset(A, 0, sizeof(ASE_Frame));
+	ASE_DBG("\t\tframe index: %i\n", (int)S->nframes-1);
+	return(A);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// cels
+//
+ASE_DECL ASE_Cel *
+ASE_DOC_AddCel(ASE__ctx *F, ASE_Frame *S)
+{
+	if (!ASE__grow((void **)&S->cels, &F->cels_cap, S->ncels + 1, sizeof(ASE_Cel))) return(0);
+	ASE_Cel *L = S->cels + S->ncels++;
+	memset(L, 0, sizeof(ASE_Cel));
+	L->link = -1;
+	ASE_DBG("\t\tcel index: %i\n", (int)S->ncels-1);
+	return(L);
+}
+
+
+ASE_DECL void
+ASE_DOC_read_raw_image_rgba      (ASE__ctx *F, ASE_Cel *Cel)
+{
+	Cel->data = (uint8_t *)ASE_MALLOC(Cel->w * Cel->h * 4);
+	uint8_t *P = (uint8_t *)Cel->data;
+	for (int i=0; i < Cel->w * Cel->h; ++i) {
+		*(P++) = ASE__read8(F);
+		*(P++) = ASE__read8(F);
+		*(P++) = ASE__read8(F);
+		*(P++) = ASE__read8(F);
+	}
+	ASE_DBG("\t\t--- (LOADED) ---\n");
+}
+
+ASE_DECL void
+ASE_DOC_read_raw_image_grayscale (ASE__ctx *F, ASE_Cel *Cel)
+{
+	Cel->data = (uint8_t *)ASE_MALLOC(Cel->w * Cel->h * 2);
+	uint8_t *P = Cel->data;
+	for (int i=0; i < Cel->w * Cel->h; ++i) {
+		*(P++) = ASE__read8(F);
+		*(P++) = ASE__read8(F);
+	}
+	ASE_DBG("\t\t--- (LOADED) ---\n");
+}
+
+ASE_DECL void
+ASE_DOC_read_raw_image_indexed   (ASE__ctx *F, ASE_Cel *Cel)
+{
+	Cel->data = (uint8_t *)ASE_MALLOC(Cel->w * Cel->h);
+	uint8_t *P = Cel->data;
+	for (int i=0; i < Cel->w * Cel->h; ++i) *(P++) = ASE__read8(F);
+	ASE_DBG("\t\t--- (LOADED) ---\n");
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// ZLIB
+//
+#if !defined(STBI_INCLUDE_STB_IMAGE_H) || defined(STBI_NO_ZLIB) || (defined(STBI_NO_PNG) && !defined(STBI_SUPPORT_ZLIB))
+
+// public domain zlib decode    v0.2  Sean Barrett 2006-11-18
+//    simple implementation
+//      - all input must be provided in an upfront buffer
+//      - all output is written to a single output buffer (can malloc/realloc)
+//    performance
+//      - fast huffman
+
+
+// header /////////////////////////////////////////////////////////////////////
+#ifdef STB_IMAGE_STATIC
+#define STBIDEF static
+#else
+#define STBIDEF extern
+#endif
+
+STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
+STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, int len, int initial_size, int *outlen, int parse_header);
+STBIDEF char *stbi_zlib_decode_malloc(const char *buffer, int len, int *outlen);
+STBIDEF int   stbi_zlib_decode_buffer(char *obuffer, int olen, const char *ibuffer, int ilen);
+
+STBIDEF char *stbi_zlib_decode_noheader_malloc(const char *buffer, int len, int *outlen);
+STBIDEF int   stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char *ibuffer, int ilen);
+
+
+// implementation /////////////////////////////////////////////////////////////
+#include <stdarg.h>
+#include <stddef.h> // ptrdiff_t on osx
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned char stbi_uc;
 
 #if !defined(STBI_NO_LINEAR) || !defined(STBI_NO_HDR)
 #include <math.h>  // ldexp
 #endif
 
-#ifndef ASE_NO_STDIO
-#include <stdio.h>
-#endif
+#ifndef ASE_NO_STDIO
+#include <stdio.h>
+#endif
+
+#ifndef STBI_ASSERT
+#include <assert.h>
+#define STBI_ASSERT(x) assert(x)
+#endif
+
+#ifndef _MSC_VER
+   #ifdef __cplusplus
+   #define stbi_inline inline
+   #else
+   #define stbi_inline
+   #endif
+#else
+   #define stbi_inline __forceinline
+#endif
+
+#ifdef _MSC_VER
+typedef unsigned short stbi__uint16;
+typedef   signed short stbi__int16;
+typedef unsigned int   stbi__uint32;
+typedef   signed int   stbi__int32;
+#else
+#include <stdint.h>
+typedef uint16_t stbi__uint16;
+typedef int16_t  stbi__int16;
+typedef uint32_t stbi__uint32;
+typedef int32_t  stbi__int32;
+#endif
+
+// should produce compiler error if size is wrong
+typedef unsigned char validate_uint32[sizeof(stbi__uint32)==4 ? 1 : -1];
+
+#ifdef _MSC_VER
+#define STBI_NOTUSED(v)  (void)(v)
+#else
+#define STBI_NOTUSED(v)  (void)sizeof(v)
+#endif
+
+#ifdef _MSC_VER
+#define STBI_HAS_LROTL
+#endif
+
+#ifdef STBI_HAS_LROTL
+   #define stbi_lrot(x,y)  _lrotl(x,y)
+#else
+   #define stbi_lrot(x,y)  (((x) << (y)) | ((x) >> (32 - (y))))
+#endif
+
+#if defined(STBI_MALLOC) && defined(STBI_FREE) && (defined(STBI_REALLOC) || defined(STBI_REALLOC_SIZED))
+// ok
+#elif !defined(STBI_MALLOC) && !defined(STBI_FREE) && !defined(STBI_REALLOC) && !defined(STBI_REALLOC_SIZED)
+// ok
+#else
+#error "Must define all or none of STBI_MALLOC, STBI_FREE, and STBI_REALLOC (or STBI_REALLOC_SIZED)."
+#endif
+
+#ifndef STBI_MALLOC
+#define STBI_MALLOC(sz)           ASE_MALLOC(sz)
+#define STBI_REALLOC(p,newsz)     ASE_REALLOC(p,newsz)
+#define STBI_FREE(p)              ASE_FREE(p)
+#endif
+
+#ifndef STBI_REALLOC_SIZED
+#define STBI_REALLOC_SIZED(p,oldsz,newsz) STBI_REALLOC(p,newsz)
+#endif
+
+// this is not threadsafe
+static const char *stbi__g_failure_reason;
+
+STBIDEF const char *stbi_failure_reason(void)
+{
+   return stbi__g_failure_reason;
+}
+
+static int stbi__err(const char *str)
+{
+   stbi__g_failure_reason = str;
+   return 0;
+}
+
+static void *stbi__malloc(size_t size)
+{
+    return STBI_MALLOC(size);
+}
+
+// stbi__err - error
+// stbi__errpf - error returning pointer to float
+// stbi__errpuc - error returning pointer to unsigned char
+
+#ifdef STBI_NO_FAILURE_STRINGS
+   #define stbi__err(x,y)  0
+#elif defined(STBI_FAILURE_USERMSG)
+   #define stbi__err(x,y)  stbi__err(y)
+#else
+   #define stbi__err(x,y)  stbi__err(x)
+#endif
+
+#define stbi__errpf(x,y)   ((float *)(size_t) (stbi__err(x,y)?NULL:NULL))
+#define stbi__errpuc(x,y)  ((unsigned char *)(size_t) (stbi__err(x,y)?NULL:NULL))
+
+
+// x86/x64 detection
+#if defined(__x86_64__) || defined(_M_X64)
+#define STBI__X64_TARGET
+#elif defined(__i386) || defined(_M_IX86)
+#define STBI__X86_TARGET
+#endif
+
+#if defined(__GNUC__) && (defined(STBI__X86_TARGET) || defined(STBI__X64_TARGET)) && !defined(__SSE2__) && !defined(STBI_NO_SIMD)
+// NOTE: not clear do we actually need this for the 64-bit path?
+// gcc doesn't support sse2 intrinsics unless you compile with -msse2,
+// (but compiling with -msse2 allows the compiler to use SSE2 everywhere;
+// this is just broken and gcc are jerks for not fixing it properly
+// http://www.virtualdub.org/blog/pivot/entry.php?id=363 )
+#define STBI_NO_SIMD
+#endif
+
+#if defined(__MINGW32__) && defined(STBI__X86_TARGET) && !defined(STBI_MINGW_ENABLE_SSE2) && !defined(STBI_NO_SIMD)
+// Note that __MINGW32__ doesn't actually mean 32-bit, so we have to avoid STBI__X64_TARGET
+//
+// 32-bit MinGW wants ESP to be 16-byte aligned, but this is not in the
+// Windows ABI and VC++ as well as Windows DLLs don't maintain that invariant.
+// As a result, enabling SSE2 on 32-bit MinGW is dangerous when not
+// simultaneously enabling "-mstackrealign".
+//
+// See https://github.com/nothings/stb/issues/81 for more information.
+//
+// So default to no SSE2 on 32-bit MinGW. If you've read this far and added
+// -mstackrealign to your build settings, feel free to #define STBI_MINGW_ENABLE_SSE2.
+#define STBI_NO_SIMD
+#endif
+
+#if !defined(STBI_NO_SIMD) && (defined(STBI__X86_TARGET) || defined(STBI__X64_TARGET))
+#define STBI_SSE2
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+
+#if _MSC_VER >= 1400  // not VC6
+#include <intrin.h> // __cpuid
+static int stbi__cpuid3(void)
+{
+   int info[4];
+   __cpuid(info,1);
+   return info[3];
+}
+#else
+static int stbi__cpuid3(void)
+{
+   int res;
+   __asm {
+      mov  eax,1
+      cpuid
+      mov  res,edx
+   }
+   return res;
+}
+#endif
+
+#define STBI_SIMD_ALIGN(type, name) __declspec(align(16)) type name
+
+static int stbi__sse2_available()
+{
+   int info3 = stbi__cpuid3();
+   return ((info3 >> 26) & 1) != 0;
+}
+#else // assume GCC-style if not VC++
+#define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
+
+static int stbi__sse2_available()
+{
+#if defined(__GNUC__) && (__GNUC__ * 100 + __GNUC_MINOR__) >= 408 // GCC 4.8 or later
+   // GCC 4.8+ has a nice way to do this
+   return __builtin_cpu_supports("sse2");
+#else
+   // portable way to do this, preferably without using GCC inline ASM?
+   // just bail for now.
+   return 0;
+#endif
+}
+#endif
+#endif
+
+// ARM NEON
+#if defined(STBI_NO_SIMD) && defined(STBI_NEON)
+#undef STBI_NEON
+#endif
+
+#ifdef STBI_NEON
+#include <arm_neon.h>
+// assume GCC or Clang on ARM targets
+#define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
+#endif
+
+#ifndef STBI_SIMD_ALIGN
+#define STBI_SIMD_ALIGN(type, name) type name
+#endif
+
+
+// fast-way is faster to check than jpeg huffman, but slow way is slower
+#define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
+#define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
+
+// zlib-style huffman encoding
+// (jpegs packs from left, zlib from right, so can't share code)
+typedef struct
+{
+   stbi__uint16 fast[1 << STBI__ZFAST_BITS];
+   stbi__uint16 firstcode[16];
+   int maxcode[17];
+   stbi__uint16 firstsymbol[16];
+   stbi_uc  size[288];
+   stbi__uint16 value[288];
+} stbi__zhuffman;
+
+stbi_inline static int stbi__bitreverse16(int n)
+{
+  n = ((n & 0xAAAA) >>  1) | ((n & 0x5555) << 1);
+  n = ((n & 0xCCCC) >>  2) | ((n & 0x3333) << 2);
+  n = ((n & 0xF0F0) >>  4) | ((n & 0x0F0F) << 4);
+  n = ((n & 0xFF00) >>  8) | ((n & 0x00FF) << 8);
+  return n;
+}
+
+stbi_inline static int stbi__bit_reverse(int v, int bits)
+{
+   STBI_ASSERT(bits <= 16);
+   // to bit reverse n bits, reverse 16 and shift
+   // e.g. 11 bits, bit reverse and shift away 5
+   return stbi__bitreverse16(v) >> (16-bits);
+}
+
+static int stbi__zbuild_huffman(stbi__zhuffman *z, stbi_uc *sizelist, int num)
+{
+   int i,k=0;
+   int code, next_code[16], sizes[17];
+
+   // DEFLATE spec for generating codes
+   memset(sizes, 0, sizeof(sizes));
+   memset(z->fast, 0, sizeof(z->fast));
+   for (i=0; i < num; ++i)
+      ++sizes[sizelist[i]];
+   sizes[0] = 0;
+   for (i=1; i < 16; ++i)
+      if (sizes[i] > (1 << i))
+         return stbi__err("bad sizes", "Corrupt PNG");
+   code = 0;
+   for (i=1; i < 16; ++i) {
+      next_code[i] = code;
+      z->firstcode[i] = (stbi__uint16) code;
+      z->firstsymbol[i] = (stbi__uint16) k;
+      code = (code + sizes[i]);
+      if (sizes[i])
+         if (code-1 >= (1 << i)) return stbi__err("bad codelengths","Corrupt PNG");
+      z->maxcode[i] = code << (16-i); // preshift for inner loop
+      code <<= 1;
+      k += sizes[i];
+   }
+   z->maxcode[16] = 0x10000; // sentinel
+   for (i=0; i < num; ++i) {
+      int s = sizelist[i];
+      if (s) {
+         int c = next_code[s] - z->firstcode[s] + z->firstsymbol[s];
+         stbi__uint16 fastv = (stbi__uint16) ((s << 9) | i);
+         z->size [c] = (stbi_uc     ) s;
+         z->value[c] = (stbi__uint16) i;
+         if (s <= STBI__ZFAST_BITS) {
+            int j = stbi__bit_reverse(next_code[s],s);
+            while (j < (1 << STBI__ZFAST_BITS)) {
+               z->fast[j] = fastv;
+               j += (1 << s);
+            }
+         }
+         ++next_code[s];
+      }
+   }
+   return 1;
+}
+
+// zlib-from-memory implementation for PNG reading
+//    because PNG allows splitting the zlib stream arbitrarily,
+//    and it's annoying structurally to have PNG call ZLIB call PNG,
+//    we require PNG read all the IDATs and combine them into a single
+//    memory buffer
+
+typedef struct
+{
+   stbi_uc *zbuffer, *zbuffer_end;
+   int num_bits;
+   stbi__uint32 code_buffer;
+
+   char *zout;
+   char *zout_start;
+   char *zout_end;
+   int   z_expandable;
+
+   stbi__zhuffman z_length, z_distance;
+} stbi__zbuf;
+
+stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
+{
+   if (z->zbuffer >= z->zbuffer_end) return 0;
+   return *z->zbuffer++;
+}
+
+static void stbi__fill_bits(stbi__zbuf *z)
+{
+   do {
+      STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
+      z->code_buffer |= (unsigned int) stbi__zget8(z) << z->num_bits;
+      z->num_bits += 8;
+   } while (z->num_bits <= 24);
+}
+
+stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
+{
+   unsigned int k;
+   if (z->num_bits < n) stbi__fill_bits(z);
+   k = z->code_buffer & ((1 << n) - 1);
+   z->code_buffer >>= n;
+   z->num_bits -= n;
+   return k;
+}
+
+static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+{
+   int b,s,k;
+   // not resolved by fast table, so compute it the slow way
+   // use jpeg approach, which requires MSbits at top
+   k = stbi__bit_reverse(a->code_buffer, 16);
+   for (s=STBI__ZFAST_BITS+1; ; ++s)
+      if (k < z->maxcode[s])
+         break;
+   if (s == 16) return -1; // invalid code!
+   // code size is s, so:
+   b = (k >> (16-s)) - z->firstcode[s] + z->firstsymbol[s];
+   STBI_ASSERT(z->size[b] == s);
+   a->code_buffer >>= s;
+   a->num_bits -= s;
+   return z->value[b];
+}
+
+stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
+{
+   int b,s;
+   if (a->num_bits < 16) stbi__fill_bits(a);
+   b = z->fast[a->code_buffer & STBI__ZFAST_MASK];
+   if (b) {
+      s = b >> 9;
+      a->code_buffer >>= s;
+      a->num_bits -= s;
+      return b & 511;
+   }
+   return stbi__zhuffman_decode_slowpath(a, z);
+}
+
+static int stbi__zexpand(stbi__zbuf *z, char *zout, int n)  // need to make room for n bytes
+{
+   char *q;
+   int cur, limit, old_limit;
+   z->zout = zout;
+   if (!z->z_expandable) return stbi__err("output buffer limit","Corrupt PNG");
+   cur   = (int) (z->zout     - z->zout_start);
+   limit = old_limit = (int) (z->zout_end - z->zout_start);
+   while (cur + n > limit)
+      limit *= 2;
+   q = (char *) STBI_REALLOC_SIZED(z->zout_start, old_limit, limit);
+   STBI_NOTUSED(old_limit);
+   if (q == NULL) return stbi__err("outofmem", "Out of memory");
+   z->zout_start = q;
+   z->zout       = q + cur;
+   z->zout_end   = q + limit;
+   return 1;
+}
+
+static int stbi__zlength_base[31] = {
+   3,4,5,6,7,8,9,10,11,13,
+   15,17,19,23,27,31,35,43,51,59,
+   67,83,99,115,131,163,195,227,258,0,0 };
+
+static int stbi__zlength_extra[31]=
+{ 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0,0,0 };
+
+static int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,
+257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,0,0};
+
+static int stbi__zdist_extra[32] =
+{ 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+static int stbi__parse_huffman_block(stbi__zbuf *a)
+{
+   char *zout = a->zout;
+   for(;;) {
+      int z = stbi__zhuffman_decode(a, &a->z_length);
+      if (z < 256) {
+         if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
+         if (zout >= a->zout_end) {
+            if (!stbi__zexpand(a, zout, 1)) return 0;
+            zout = a->zout;
+         }
+         *zout++ = (char) z;
+      } else {
+         stbi_uc *p;
+         int len,dist;
+         if (z == 256) {
+            a->zout = zout;
+            return 1;
+         }
+         z -= 257;
+         len = stbi__zlength_base[z];
+         if (stbi__zlength_extra[z]) len += stbi__zreceive(a, stbi__zlength_extra[z]);
+         z = stbi__zhuffman_decode(a, &a->z_distance);
+         if (z < 0) return stbi__err("bad huffman code","Corrupt PNG");
+         dist = stbi__zdist_base[z];
+         if (stbi__zdist_extra[z]) dist += stbi__zreceive(a, stbi__zdist_extra[z]);
+         if (zout - a->zout_start < dist) return stbi__err("bad dist","Corrupt PNG");
+         if (zout + len > a->zout_end) {
+            if (!stbi__zexpand(a, zout, len)) return 0;
+            zout = a->zout;
+         }
+         p = (stbi_uc *) (zout - dist);
+         if (dist == 1) { // run of one byte; common in images.
+            stbi_uc v = *p;
+            if (len) { do *zout++ = v; while (--len); }
+         } else {
+            if (len) { do *zout++ = *p++; while (--len); }
+         }
+      }
+   }
+}
+
+static int stbi__compute_huffman_codes(stbi__zbuf *a)
+{
+   static stbi_uc length_dezigzag[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+   stbi__zhuffman z_codelength;
+   stbi_uc lencodes[286+32+137];//padding for maximum single op
+   stbi_uc codelength_sizes[19];
+   int i,n;
+
+   int hlit  = stbi__zreceive(a,5) + 257;
+   int hdist = stbi__zreceive(a,5) + 1;
+   int hclen = stbi__zreceive(a,4) + 4;
+
+   memset(codelength_sizes, 0, sizeof(codelength_sizes));
+   for (i=0; i < hclen; ++i) {
+      int s = stbi__zreceive(a,3);
+      codelength_sizes[length_dezigzag[i]] = (stbi_uc) s;
+   }
+   if (!stbi__zbuild_huffman(&z_codelength, codelength_sizes, 19)) return 0;
+
+   n = 0;
+   while (n < hlit + hdist) {
+      int c = stbi__zhuffman_decode(a, &z_codelength);
+      if (c < 0 || c >= 19) return stbi__err("bad codelengths", "Corrupt PNG");
+      if (c < 16)
+         lencodes[n++] = (stbi_uc) c;
+      else if (c == 16) {
+         c = stbi__zreceive(a,2)+3;
+         memset(lencodes+n, lencodes[n-1], c);
+         n += c;
+      } else if (c == 17) {
+         c = stbi__zreceive(a,3)+3;
+         memset(lencodes+n, 0, c);
+         n += c;
+      } else {
+         STBI_ASSERT(c == 18);
+         c = stbi__zreceive(a,7)+11;
+         memset(lencodes+n, 0, c);
+         n += c;
+      }
+   }
+   if (n != hlit+hdist) return stbi__err("bad codelengths","Corrupt PNG");
+   if (!stbi__zbuild_huffman(&a->z_length, lencodes, hlit)) return 0;
+   if (!stbi__zbuild_huffman(&a->z_distance, lencodes+hlit, hdist)) return 0;
+   return 1;
+}
+
+static int stbi__parse_uncompressed_block(stbi__zbuf *a)
+{
+   stbi_uc header[4];
+   int len,nlen,k;
+   if (a->num_bits & 7)
+      stbi__zreceive(a, a->num_bits & 7); // discard
+   // drain the bit-packed data into header
+   k = 0;
+   while (a->num_bits > 0) {
+      header[k++] = (stbi_uc) (a->code_buffer & 255); // suppress MSVC run-time check
+      a->code_buffer >>= 8;
+      a->num_bits -= 8;
+   }
+   STBI_ASSERT(a->num_bits == 0);
+   // now fill header the normal way
+   while (k < 4)
+      header[k++] = stbi__zget8(a);
+   len  = header[1] * 256 + header[0];
+   nlen = header[3] * 256 + header[2];
+   if (nlen != (len ^ 0xffff)) return stbi__err("zlib corrupt","Corrupt PNG");
+   if (a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer","Corrupt PNG");
+   if (a->zout + len > a->zout_end)
+      if (!stbi__zexpand(a, a->zout, len)) return 0;
+   memcpy(a->zout, a->zbuffer, len);
+   a->zbuffer += len;
+   a->zout += len;
+   return 1;
+}
+
+static int stbi__parse_zlib_header(stbi__zbuf *a)
+{
+   int cmf   = stbi__zget8(a);
+   int cm    = cmf & 15;
+   /* int cinfo = cmf >> 4; */
+   int flg   = stbi__zget8(a);
+   if ((cmf*256+flg) % 31 != 0) return stbi__err("bad zlib header","Corrupt PNG"); // zlib spec
+   if (flg & 32) return stbi__err("no preset dict","Corrupt PNG"); // preset dictionary not allowed in png
+   if (cm != 8) return stbi__err("bad compression","Corrupt PNG"); // DEFLATE required for png
+   // window = 1 << (8 + cinfo)... but who cares, we fully buffer output
+   return 1;
+}
+
+// @TODO: should statically initialize these for optimal thread safety
+static stbi_uc stbi__zdefault_length[288], stbi__zdefault_distance[32];
+static void stbi__init_zdefaults(void)
+{
+   int i;   // use <= to match clearly with spec
+   for (i=0; i <= 143; ++i)     stbi__zdefault_length[i]   = 8;
+   for (   ; i <= 255; ++i)     stbi__zdefault_length[i]   = 9;
+   for (   ; i <= 279; ++i)     stbi__zdefault_length[i]   = 7;
+   for (   ; i <= 287; ++i)     stbi__zdefault_length[i]   = 8;
+
+   for (i=0; i <=  31; ++i)     stbi__zdefault_distance[i] = 5;
+}
+
+static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
+{
+   int final, type;
+   if (parse_header)
+      if (!stbi__parse_zlib_header(a)) return 0;
+   a->num_bits = 0;
+   a->code_buffer = 0;
+   do {
+      final = stbi__zreceive(a,1);
+      type = stbi__zreceive(a,2);
+      if (type == 0) {
+         if (!stbi__parse_uncompressed_block(a)) return 0;
+      } else if (type == 3) {
+         return 0;
+      } else {
+         if (type == 1) {
+            // use fixed code lengths
+            if (!stbi__zdefault_distance[31]) stbi__init_zdefaults();
+            if (!stbi__zbuild_huffman(&a->z_length  , stbi__zdefault_length  , 288)) return 0;
+            if (!stbi__zbuild_huffman(&a->z_distance, stbi__zdefault_distance,  32)) return 0;
+         } else {
+            if (!stbi__compute_huffman_codes(a)) return 0;
+         }
+         if (!stbi__parse_huffman_block(a)) return 0;
+      }
+   } while (!final);
+   return 1;
+}
+
+static int stbi__do_zlib(stbi__zbuf *a, char *obuf, int olen, int exp, int parse_header)
+{
+   a->zout_start = obuf;
+   a->zout       = obuf;
+   a->zout_end   = obuf + olen;
+   a->z_expandable = exp;
+
+   return stbi__parse_zlib(a, parse_header);
+}
+
+STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen)
+{
+   stbi__zbuf a;
+   char *p = (char *) stbi__malloc(initial_size);
+   if (p == NULL) return NULL;
+   a.zbuffer = (stbi_uc *) buffer;
+   a.zbuffer_end = (stbi_uc *) buffer + len;
+   if (stbi__do_zlib(&a, p, initial_size, 1, 1)) {
+      if (outlen) *outlen = (int) (a.zout - a.zout_start);
+      return a.zout_start;
+   } else {
+      STBI_FREE(a.zout_start);
+      return NULL;
+   }
+}
+
+STBIDEF char *stbi_zlib_decode_malloc(char const *buffer, int len, int *outlen)
+{
+   return stbi_zlib_decode_malloc_guesssize(buffer, len, 16384, outlen);
+}
+
+STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, int len, int initial_size, int *outlen, int parse_header)
+{
+   stbi__zbuf a;
+   char *p = (char *) stbi__malloc(initial_size);
+   if (p == NULL) return NULL;
+   a.zbuffer = (stbi_uc *) buffer;
+   a.zbuffer_end = (stbi_uc *) buffer + len;
+   if (stbi__do_zlib(&a, p, initial_size, 1, parse_header)) {
+      if (outlen) *outlen = (int) (a.zout - a.zout_start);
+      return a.zout_start;
+   } else {
+      STBI_FREE(a.zout_start);
+      return NULL;
+   }
+}
+
+STBIDEF int stbi_zlib_decode_buffer(char *obuffer, int olen, char const *ibuffer, int ilen)
+{
+   stbi__zbuf a;
+   a.zbuffer = (stbi_uc *) ibuffer;
+   a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
+   if (stbi__do_zlib(&a, obuffer, olen, 0, 1))
+      return (int) (a.zout - a.zout_start);
+   else
+      return -1;
+}
+
+STBIDEF char *stbi_zlib_decode_noheader_malloc(char const *buffer, int len, int *outlen)
+{
+   stbi__zbuf a;
+   char *p = (char *) stbi__malloc(16384);
+   if (p == NULL) return NULL;
+   a.zbuffer = (stbi_uc *) buffer;
+   a.zbuffer_end = (stbi_uc *) buffer+len;
+   if (stbi__do_zlib(&a, p, 16384, 1, 0)) {
+      if (outlen) *outlen = (int) (a.zout - a.zout_start);
+      return a.zout_start;
+   } else {
+      STBI_FREE(a.zout_start);
+      return NULL;
+   }
+}
+
+STBIDEF int stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char *ibuffer, int ilen)
+{
+   stbi__zbuf a;
+   a.zbuffer = (stbi_uc *) ibuffer;
+   a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
+   if (stbi__do_zlib(&a, obuffer, olen, 0, 0))
+      return (int) (a.zout - a.zout_start);
+   else
+      return -1;
+}
+
+#endif // !STBI_INCLUDE_STB_IMAGE_H
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// cels (compressed)
+//
+static void
+ASE__read_compressed(ASE__ctx *F, ASE_Cel *Cel, size_t EndPos, int Bpp)
+{
+	// read compressed data
+	int isize = EndPos - F->io.tell(F->udata);
+	uint8_t *ibuffer = ASE__scratch(F, isize + 16);
+	if (isize <= 0 || !ibuffer) return;
+	if (isize != F->io.read(F->udata, (char *)ibuffer, isize)) {
+		ASE_ERR("ase: compressed cel is cut short!\n");
+		return;
+	}
+	{
+		// alloc uncompressed data
+		int osize = Cel->w * Cel->h * Bpp;
+		uint8_t *obuffer = ASE_MALLOC(osize);
+
+		// decode
+		ASE__STAT_BEGIN(InflateStart);
+		ASE__TRACE_BEGIN("inflate", isize);
+		int Result = stbi_zlib_decode_buffer(
+			(char *)obuffer, osize, (char *)ibuffer, isize);
+		ASE__TRACE_END("inflate");
+		ASE__STAT_END(InflateStart, ASE_STATS_INFLATE);
+		ASE__STAT(compressed_bytes += isize);
+		if (Result > 0) ASE__STAT(inflated_bytes += Result);
+		if (-1 == Result) {
+			// failure!
+			ASE_FREE(obuffer);
+			ASE_ERR("ase: failed to load compressed cel!\n");
+		} else {
+			Cel->data = obuffer;
+			ASE_DBG("\t\t--- (LOADED) ---\n");
+		}
+	}
+}
+
+ASE_DECL void
+ASE_DOC_read_compressed_rgba(ASE__ctx *F,
+	                         ASE_Cel *Cel,
+							 size_t EndPos)
+{
+	ASE__read_compressed(F, Cel, EndPos, 4);
+}
+
+ASE_DECL void
+ASE_DOC_read_compressed_grayscale(ASE__ctx *F,
+	                              ASE_Cel *Cel,
+							      size_t EndPos)
+{
+	ASE__read_compressed(F, Cel, EndPos, 2);
+}
+
+ASE_DECL void
+ASE_DOC_read_compressed_indexed(ASE__ctx *F,
+	                            ASE_Cel *Cel,
+							    size_t EndPos)
+{
+	ASE__read_compressed(F, Cel, EndPos, 1);
+}
+
+
+
+ASE_DECL ASE_Cel *
+ASE_Cel_read(ASE__ctx *F,
+	             ASE_Sprite *S,
+				 int frame_index,
+			     ASE_Frame *Frame,
+			     size_t EndPos)
+{
+	ASE_DBG("\t\t--- CEL ---\n");
+
+	// HEADER
+	int layer   = ASE__read16(F);
+	int x       = (int16_t)ASE__read16(F);
+	int y       = (int16_t)ASE__read16(F);
+	int opacity = ASE__read8(F);
+	int type    = ASE__read16(F);
+	F->io.skip(F->udata, 7);
+
+	ASE_DBG("\t\tlayer:   %i  (%s)\n", layer, S->layers[layer].name);
+	ASE_DBG("\t\tx:       %i\n", x);
+	ASE_DBG("\t\ty:       %i\n", y);
+	ASE_DBG("\t\topacity: %i\n", opacity);
+	ASE_DBG("\t\ttype:    %i\n", type);
+
+	ASE_Layer *L = 0;
+	if (layer >= 0 && layer < S->nlayers) L = S->layers + layer;
+	if (!L) {
+		ASE_ERR("ase: frame %i missing layer %i\n", (int)frame_index, (int)layer);
+		return(0);
+	}
+	if (L->type != ASE_FILE_LAYER_IMAGE) {
+		ASE_ERR("ase: invalid .ase file (frame %i in layer %i which does not contain images)\n", (int)frame_index, (int)layer);
+		return(0);
+	}
+
+	// create new frame
+	ASE_Cel *Cel = ASE_DOC_AddCel(F, Frame);
+	assert(Cel);
+	Cel->layer = layer;
+	Cel->x = x;
+	Cel->y = y;
+	Cel->opacity = opacity;
+	ASE__STAT(cels[(type >= 0 && type <= ASE_FILE_COMPRESSED_CEL) ? type : 3] += 1);
+
+	switch (type) {
+	case ASE_FILE_RAW_CEL:
+		{
+			ASE_DBG("\t\t--- RAW ---\n");
+
+			int w = ASE__read16(F);
+			int h = ASE__read16(F);
+
+			Cel->w = w;
+			Cel->h = h;
+
+			ASE_DBG("\t\tw: %i\n", w);
+			ASE_DBG("\t\th: %i\n", h);
+
+			if (w > 0 && h > 0) {
+				ASE__STAT_BEGIN(RawStart);
+				switch (S->depth) {
+					case ASE_DEPTH_RGBA:      // RGBA
+					{
+						ASE_DOC_read_raw_image_rgba(F, Cel);
+					} break;
+					case ASE_DEPTH_GRAYSCALE: // Grayscale
+					{
+						ASE_DOC_read_raw_image_grayscale(F, Cel);
+					} break;
+					case ASE_DEPTH_INDEXED:   // Indexed
+					{
+						ASE_DOC_read_raw_image_indexed(F, Cel);
+					} break;
+				}
+				ASE__STAT_END(RawStart, ASE_STATS_RAW);
+			} else {
+				ASE_DBG("\t\t(cel has no area...?)\n");
+			}
+		} break;
+
+	case ASE_FILE_LINK_CEL:
+		{
+			ASE_DBG("\t\t--- LINKED ---\n");
+
+			/*
+			NOTE:
+				We are ignoring the edge case of the beta version
+				with silly link attributes :)
+				We are also assuming that a link is found.
+			*/
+
+			int frame = ASE__read16(F);
+
+			Cel->is_linked = 1;
+			Cel->frame = frame;
+
+			ASE_DBG("\t\tframe: %i\n", frame);
+		} break;
+
+	case ASE_FILE_COMPRESSED_CEL:
+		{
+			ASE_DBG("\t\t--- COMPRESSED ---\n");
+
+			// WORD      Width in pixels
+		  	// WORD      Height in pixels
+		  	// BYTE[]    "Raw Cel" data compressed with ZLIB method
+
+			int w = ASE__read16(F);
+			int h = ASE__read16(F);
+
+			Cel->w = w;
+			Cel->h = h;
+
+			ASE_DBG("\t\tw: %i\n", w);
+			ASE_DBG("\t\th: %i\n", h);
+
+			// he uses C++ exceptions in his decoder... hoo boy.
+			// i think we'll be fine. things are set up such that
+			// you will just get an empty cel if loading fails.
+
+			if (w > 0 && h > 0) {
+				switch (S->depth) {
+					case ASE_DEPTH_RGBA:      // RGBA
+					{
+						ASE_DOC_read_compressed_rgba(F, Cel, EndPos);
+					} break;
+					case ASE_DEPTH_GRAYSCALE: // Grayscale
+					{
+						ASE_DOC_read_compressed_grayscale(F, Cel, EndPos);
+					} break;
+					case ASE_DEPTH_INDEXED:   // Indexed
+					{
+						ASE_DOC_read_compressed_indexed(F, Cel, EndPos);
+					} break;
+				}
+			} else {
+				ASE_DBG("\t\t(cel has no area...?)\n");
+			}
+		} break;
+	}
+
+	if (!Cel) return(0);
+
+	return(Cel);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// frame tags
+//
+ASE_DECL ASE_Tag *
+ASE_DOC_AddTag(ASE__ctx *F, ASE_Sprite *S)
+{
+	if (!ASE__grow((void **)&S->tags, &F->tags_cap, S->ntags + 1, sizeof(ASE_Tag))) return(0);
+	ASE_Tag *L = S->tags + S->ntags++;
+	memset(L, 0, sizeof(ASE_Tag));
+	ASE_DBG("\t\ttag index: %i\n", (int)S->ntags-1);
+	return(L);
+}
+
+ASE_DECL void
+ASE_Tags_read(ASE__ctx *F, ASE_Sprite *S)
+{
+	ASE_DBG("\t--- FRAME TAGS ---\n");
+
+	size_t count = ASE__read16(F);
+
+	ASE__read32(F); // 8 reserved bytes
+	ASE__read32(F);
+
+	ASE__grow((void **)&S->tags, &F->tags_cap, S->ntags + (int)count, sizeof(ASE_Tag));
+
+	for (size_t i=0; i<count; ++i) {
+		ASE_DBG("\t\t--- TAG (%i) ---\n", i);
+
+		int From = ASE__read16(F);
+		int To   = ASE__read16(F);
+		int AnimDirection = ASE__read8(F);
+
+		if (ASE_LOOP_FORWARD != AnimDirection &&
+		    ASE_LOOP_REVERSE != AnimDirection &&
+			ASE_LOOP_PINGPONG != AnimDirection)
+		{
+			AnimDirection = ASE_LOOP_FORWARD;
+		}
+
+		ASE__read32(F); // 8 reserved bytes
+		ASE__read32(F);
+
+		F->io.skip(F->udata, 4); // skip tag color
+
+		char *Name = ASE_DOC_read_string(F);
+
+		ASE_DBG("\t\tfrom: %i\n", From);
+		ASE_DBG("\t\tto:   %i\n", To);
+		ASE_DBG("\t\tdir:  %i\n", AnimDirection);
+		ASE_DBG("\t\tname: %s\n", Name);
+
+		// allocate the tag
+		ASE_Tag *Tag = ASE_DOC_AddTag(F, S);
+		Tag->from = From;
+		Tag->to   = To;
+		Tag->dir  = AnimDirection;
+		Tag->name = Name;
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// name index
+//
+// open addressing, linear probing, at most half full. each slot keeps the
+// full hash so a probe only compares strings when the hashes match.
+
+static uint32_t ASE__name_hash(const char *s)
+{
+	uint32_t H = 2166136261u; // FNV-1a
+	for (; *s; ++s) H = (H ^ (uint8_t)*s) * 16777619u;
+	return(H ? H : 1);
+}
+
+// 'Names' is the name of each item, 'Stride' bytes apart
+static void ASE__index_names(ASE_NameIndex *Index, char **Names, int Count, int Stride)
+{
+	ASE_FREE(Index->slots);
+	memset(Index, 0, sizeof(ASE_NameIndex));
+	if (Count <= 0) return;
+
+	int Size = 8;
+	while (Size < Count * 2) Size *= 2;
+	Index->slots = (ASE_NameSlot *)ASE_MALLOC(Size * sizeof(ASE_NameSlot));
+	if (!Index->slots) return;
+	memset(Index->slots, 0, Size * sizeof(ASE_NameSlot));
+	Index->mask = Size - 1;
+
+	for (int i=0; i < Count; ++i) {
+		const char *Name = *(char **)((char *)Names + (size_t)i * Stride);
+		if (!Name) continue;
+		uint32_t H = ASE__name_hash(Name);
+		int s = (int)(H & Index->mask);
+		for (; Index->slots[s].item; s = (s + 1) & Index->mask) {
+			// keep the first of a repeated name, like the linear search did
+			const char *Other = *(char **)((char *)Names + (size_t)(Index->slots[s].item - 1) * Stride);
+			if (Index->slots[s].hash == H && ASE_streq(Name, Other)) break;
+		}
+		if (Index->slots[s].item) continue;
+		Index->slots[s].hash = H;
+		Index->slots[s].item = i + 1;
+	}
+}
+
+// returns the index, or -1
+static int ASE__find_name(ASE_NameIndex *Index, char **Names, int Count, int Stride, const char *Name)
+{
+	if (!Index->slots) { // not built; search
+		for (int i=0; i < Count; ++i) {
+			const char *Other = *(char **)((char *)Names + (size_t)i * Stride);
+			if (Other && ASE_streq(Name, Other)) return(i);
+		}
+		return(-1);
+	}
+
+	uint32_t H = ASE__name_hash(Name);
+	for (int s = (int)(H & Index->mask); Index->slots[s].item; s = (s + 1) & Index->mask) {
+		if (Index->slots[s].hash != H) continue;
+		int i = Index->slots[s].item - 1;
+		if (ASE_streq(Name, *(char **)((char *)Names + (size_t)i * Stride))) return(i);
+	}
+	return(-1);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// cel table
+//
+static void ASE__index_cels(ASE_Sprite *S)
+{
+	ASE_FREE(S->cel_table);
+	S->cel_table = 0;
+	size_t Size = (size_t)S->nframes * S->nlayers;
+	if (!Size) return;
+
+	int *Table = (int *)ASE_MALLOC(Size * sizeof(int));
+	if (!Table) return;
+	memset(Table, 0xff, Size * sizeof(int)); // -1
+
+	for (int f=0; f < S->nframes; ++f) {
+		ASE_Frame *Frame = S->frames + f;
+		for (int c=0; c < Frame->ncels; ++c) {
+			int Layer = Frame->cels[c].layer;
+			if (Layer < S->nlayers && Table[f * S->nlayers + Layer] < 0)
+				Table[f * S->nlayers + Layer] = c;
+		}
+	}
+
+	// point links straight at the cel with the pixels. aseprite links to
+	// the original, but follow chains anyway, a few steps at most
+	for (int f=0; f < S->nframes; ++f) {
+		ASE_Frame *Frame = S->frames + f;
+		for (int c=0; c < Frame->ncels; ++c) {
+			ASE_Cel *Cel = Frame->cels + c;
+			if (!Cel->is_linked) continue;
+
+			int Target = Cel->frame;
+			Cel->link  = -1;
+			for (int Hops=0; Hops < 8; ++Hops) {
+				if (Target < 0 || Target >= S->nframes || Cel->layer >= S->nlayers) break;
+				int i = Table[Target * S->nlayers + Cel->layer];
+				if (i < 0) break;
+				ASE_Cel *Next = S->frames[Target].cels + i;
+				if (!Next->is_linked) {
+					Cel->frame = Target;
+					Cel->link  = i;
+					break;
+				}
+				Target = Next->frame;
+			}
+		}
+	}
+
+	S->cel_table = Table;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// frame times
+//
+static void ASE__index_times(ASE_Sprite *S)
+{
+	ASE_FREE(S->frame_start);
+	S->frame_start = (uint32_t *)ASE_MALLOC((S->nframes + 1) * sizeof(uint32_t));
+	if (!S->frame_start) return;
+
+	uint32_t T = 0;
+	for (int i=0; i < S->nframes; ++i) {
+		S->frame_start[i] = T;
+		T += S->frames[i].duration;
+	}
+	S->frame_start[S->nframes] = T;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// tag timelines
+//
+static void ASE__index_tags(ASE_Sprite *S)
+{
+	for (int i=0; i < S->ntags; ++i) {
+		ASE_Tag *T = S->tags + i;
+		ASE_FREE(T->steps);
+		T->steps    = 0;
+		T->step_end = 0;
+		T->nsteps   = 0;
+		T->cycle    = 0;
+
+		int From = T->from, To = T->to;
+		if (From < 0 || To >= S->nframes || To < From) continue;
+
+		int N = To - From + 1;
+		if (ASE_LOOP_PINGPONG == T->dir && N > 2) N += N - 2; // ends aren't repeated
+		T->steps = (int *)ASE_MALLOC(N * (sizeof(int) + sizeof(uint32_t)));
+		if (!T->steps) continue;
+		T->step_end = (uint32_t *)(T->steps + N);
+
+		int k = 0;
+		if (ASE_LOOP_REVERSE == T->dir) {
+			for (int f=To; f >= From; --f) T->steps[k++] = f;
+		} else {
+			for (int f=From; f <= To; ++f) T->steps[k++] = f;
+			if (ASE_LOOP_PINGPONG == T->dir)
+				for (int f=To-1; f > From; --f) T->steps[k++] = f;
+		}
+
+		uint32_t End = 0;
+		for (k=0; k < N; ++k) {
+			End += S->frames[T->steps[k]].duration;
+			T->step_end[k] = End;
+		}
+		T->nsteps = N;
+		T->cycle  = End;
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// decoder main
+//
+#define ASE__ALL_CELS -1
+#define ASE__NO_CELS  -2
+
+// what the chunks of one frame leave behind for the next
+typedef struct {
+	ASE_DOC_Header header;
+	ASE_Layer *    last_layer;
+	void *         last_with_user_data;
+	void *         last_cel;
+	int            current_level;
+	ASE_BOOL       ignore_old_color_chunks;
+
+	// what to decode: the palette, layer and tag chunks, unless skip_meta,
+	// and the cels of cel_layer, which can be ASE__ALL_CELS or ASE__NO_CELS
+	ASE_BOOL       skip_meta;
+	int            cel_layer;
+	int            meta_chunks; // palette, layer and tag chunks in the last frame
+} ASE__frame_state;
+
+// reads the file header into S and readies St for the first frame
+static ASE_BOOL
+ASE__decode_header(ASE__ctx *F, ASE_Sprite *S, ASE__frame_state *St)
+{
+	// LOAD FILE HEADER
+	ASE__STAT_BEGIN(HeaderStart);
+	memset(St, 0, sizeof(ASE__frame_state));
+	ASE_BOOL Ok = ASE_DOC_Header_read(F, &St->header);
+	assert(Ok && "couldn't read the header!");
+	ASE__STAT_END(HeaderStart, ASE_STATS_HEADER);
+
+	ASE_DOC_Header *Header = &St->header;
+	St->current_level = -1; // root
+	St->cel_layer     = ASE__ALL_CELS;
+
+	// COPY TO SPRITE
+	S->width = Header->width;
+	S->height = Header->height;
+	S->depth = Header->depth;
+
+	ASE_DBG("--- aseprite document ---\n");
+	ASE_DBG("frames:  %i\n", (int)Header->frames);
+	ASE_DBG("width:   %i\n", (int)Header->width);
+	ASE_DBG("height:  %i\n", (int)Header->height);
+	ASE_DBG("depth:   %i\n", (int)Header->depth);
+	ASE_DBG("ncolors: %i\n", (int)Header->ncolors);
+	ASE_DBG("tcolor:  %i\n", (int)Header->transparent_index);
+
+	F->frames_cap = F->cels_cap = F->layers_cap = F->tags_cap = 0;
+	return(Ok);
+}
+
+// reads frame i into Frame, and the palette, layers and tags it carries
+// into S; leaves the stream at the next frame header
+static void
+ASE__decode_frame(ASE__ctx *F, ASE_Sprite *S, ASE__frame_state *St, ASE_Frame *Frame, int i)
+{
+	ASE__TRACE_BEGIN("frame", i);
+
+	size_t FrameHeaderStart = F->io.tell(F->udata);
+
+	// LOAD FRAME HEADER
+	ASE_FrameHeader FrameHeader = {0};
+	ASE_FrameHeader_read(F, &FrameHeader);
+	assert(FrameHeader.magic == ASE_FILE_FRAME_MAGIC);
+
+	ASE_DBG("--- frame header (%i) ---\n", i);
+	ASE_DBG("size:      %i\n", (int)FrameHeader.size);
+	ASE_DBG("chunks:    %i\n", (int)FrameHeader.chunks);
+	ASE_DBG("duration:  %i\n", (int)FrameHeader.duration);
+
+
+	// FRAME
+	Frame->duration = FrameHeader.duration;
+
+	// at most one cel per chunk, and a chunk is at least 6 bytes
+	int MaxCels = FrameHeader.chunks;
+	if (MaxCels > (int)(FrameHeader.size / 6)) MaxCels = (int)(FrameHeader.size / 6);
+	F->cels_cap = 0;
+	if (ASE__ALL_CELS == St->cel_layer)
+		ASE__reserve((void **)&Frame->cels, &F->cels_cap, MaxCels, sizeof(ASE_Cel));
+	St->meta_chunks = 0;
+
+
+	// LOAD CHUNKS
+	for (int j=0; j<FrameHeader.chunks; ++j) {
+		size_t ChunkHeaderStart = F->io.tell(F->udata);
+
+		// LOAD CHUNK HEADER
+		ASE_DOC_ChunkHeader ChunkHeader = {0};
+		ASE_DOC_ChunkHeader_read(F, &ChunkHeader);
+		ASE__STAT_CHUNK(ChunkHeader.type, ChunkHeader.size);
+		ASE__TRACE_BEGIN(ASE__trace_chunk(ChunkHeader.type), ChunkHeader.type);
+
+		ASE_DBG("\t--- chunk header (%i) ---\n", j);
+		ASE_DBG("\tsize:  %i\n", (int)ChunkHeader.size);
+		ASE_DBG("\ttype:  0x%04x\n", (int)ChunkHeader.type);
+		ASE_DBG("\tstart: %i\n", (int)ChunkHeader.start);
+
+
+		// CHUNK TYPE
+		switch (ChunkHeader.type) {
+		case ASE_FILE_CHUNK_FLI_COLOR:  // FALLTHROUGH
+		case ASE_FILE_CHUNK_FLI_COLOR2:
+			{
+				if (!St->ignore_old_color_chunks) {
+					// OLD COLOR CHUNKS -- SAFELY IGNORE?
+				}
+			} break;
+
+		case ASE_FILE_CHUNK_PALETTE:
+			{
+				St->meta_chunks += 1;
+				if (St->skip_meta) break;
+				S->palette = ASE_Palette_read(F, &S->palette);
+				St->ignore_old_color_chunks = 1;
+			} break;
+
+		case ASE_FILE_CHUNK_LAYER:
+			{
+				St->meta_chunks += 1;
+				if (St->skip_meta) break;
+				ASE_Layer *Layer = 0;
+				Layer = ASE_Layer_read(F,
+					&St->header, S, &St->last_layer, &St->current_level);
+				if (Layer) {
+					St->last_with_user_data = Layer;
+				}
+			} break;
+
+		case ASE_FILE_CHUNK_CEL:
+			{
+				if (ASE__NO_CELS == St->cel_layer) break;
+				if (St->cel_layer >= 0) {
+					size_t CelStart = F->io.tell(F->udata);
+					int    CelLayer = ASE__read16(F);
+					F->io.seek(F->udata, CelStart);
+					if (CelLayer != St->cel_layer) break;
+				}
+				ASE_Cel *Cel = ASE_Cel_read(F,
+					S, i, Frame,
+					ChunkHeaderStart + ChunkHeader.size);
+				if (Cel) {
+					St->last_cel = Cel;
+					St->last_with_user_data = Cel->data;
+				}
+			} break;
+
+		case ASE_FILE_CHUNK_CEL_EXTRA: break; // IGNORE
+		case ASE_FILE_CHUNK_MASK:      break; // DEPRECATED
+		case ASE_FILE_CHUNK_PATH:      break; // UNUSED
+
+		case ASE_FILE_CHUNK_FRAME_TAGS:
+			{
+				St->meta_chunks += 1;
+				if (St->skip_meta) break;
+				ASE_Tags_read(F, S);
+			} break;
+
+		case ASE_FILE_CHUNK_SLICES:    break; // IGNORE
+		case ASE_FILE_CHUNK_SLICE:     break; // IGNORE
+		case ASE_FILE_CHUNK_USER_DATA: break; // IGNORE
+		}
+
+		// GOTO NEXT CHUNK HEADER
+		F->io.seek(F->udata, ChunkHeaderStart + ChunkHeader.size);
+		ASE__TRACE_END(ASE__trace_chunk(ChunkHeader.type));
+	}
+
+	// give back what the other chunk types didn't use
+	if (Frame->ncels < F->cels_cap)
+		ASE__reserve((void **)&Frame->cels, &F->cels_cap, Frame->ncels, sizeof(ASE_Cel));
+
+	// GOTO NEXT FRAME HEADER
+	F->io.seek(F->udata, FrameHeaderStart + FrameHeader.size);
+	ASE__TRACE_END("frame");
+}
+
+static ASE_BOOL
+ASE__decode_sprite(ASE__ctx *F, ASE_Sprite *S)
+{
+	ASE_BOOL R = 1;
+
+	ASE__frame_state State;
+	ASE__decode_header(F, S, &State);
+
+	// the header knows how many frames there are, so size for them once.
+	// layers and tags are scattered through the chunks and just grow
+	ASE__reserve((void **)&S->frames, &F->frames_cap, State.header.frames, sizeof(ASE_Frame));
+
+
+	// LOOP OVER FRAMES
+	ASE__STAT_BEGIN(FramesStart);
+	for (int i=0; i < State.header.frames; ++i) {
+		if (F->cancel && ASE__atomic_get(F->cancel)) return(0);
+
+		ASE_Frame *Frame = ASE_DOC_AddFrame(F, S);
+		assert(Frame);
+		ASE__decode_frame(F, S, &State, Frame, i);
+	}
+	ASE__STAT_END(FramesStart, ASE_STATS_FRAMES);
+
+	// FRAME TIMES, TAG TIMELINES, LINKED CELS, NAME LOOKUPS
+	ASE__STAT_BEGIN(IndexStart);
+	ASE__TRACE_BEGIN("index", 0);
+	ASE__index_times(S);
+	ASE__index_tags(S);
+	ASE__index_cels(S);
+	if (S->nlayers) ASE__index_names(&S->layer_index, &S->layers->name, S->nlayers, sizeof(ASE_Layer));
+	if (S->ntags)   ASE__index_names(&S->tag_index, &S->tags->name, S->ntags, sizeof(ASE_Tag));
+	ASE__TRACE_END("index");
+	ASE__STAT_END(IndexStart, ASE_STATS_INDEX);
+
+	return(R);
+}
+
+ASE_DECL ASE_BOOL
+ASE__decode_main(ASE__ctx *F, ASE_Sprite *S)
+{
+	ASE__TRACE_BEGIN("load", 0);
+#ifdef ASE_STATS
+	ASE_Stats *Stats = ASE__stats;
+	uint64_t   Start = Stats ? ASE__now_ns() : 0;
+	if (Stats) {
+		// count every callback by standing in front of them
+		F->stats_io    = F->io;
+		F->stats_udata = F->udata;
+		F->io          = ASE__stats_callbacks;
+		F->udata       = F;
+	}
+#endif
+
+	ASE_BOOL R = ASE__decode_sprite(F, S);
+
+#ifdef ASE_STATS
+	if (Stats) {
+		F->io    = F->stats_io;
+		F->udata = F->stats_udata;
+		Stats->loads += 1;
+		Stats->ns[ASE_STATS_TOTAL] += ASE__now_ns() - Start;
+	}
+#endif
+	ASE__TRACE_END("load");
+	return(R);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - loading
+//
+#ifdef ASE__WATCHING
+// see: hot reload
+typedef struct ASE__watched ASE__watched;
+
+static struct {
+	int            started;
+	volatile long  quit;
+	int            fd;      // inotify
+	int            wake[2]; // a pipe to get the thread out of poll()
+	ASE__mutex     lock;
+	ASE__thread    thread;
+	ASE__watched * head;
+} ASE__watch;
+
+static ASE_BOOL ASE__watch_load(const char *filename, ASE_Sprite *out);
+static void     ASE__watch_drop(ASE_Sprite *sprite);
+#endif
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_BOOL
+ASE_load (const char *filename, ASE_Sprite *out)
+{
+#ifdef ASE__WATCHING
+	if (ASE__watch.started) return(ASE__watch_load(filename, out));
+#endif
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		ASE_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	ASE__ctx Context = {0};
+	ASE__start_file(&Context, F);
+	int R = ASE__decode_main(&Context, out);
+	ASE_FREE(Context.scratch);
+	fclose(F);
+	return(R);
+}
+
+ASE_DECL ASE_BOOL
+ASE_load_from_file (FILE *f, ASE_Sprite *out)
+{
+	ASE__ctx Context = {0};
+	ASE__start_file(&Context, f);
+	int R = ASE__decode_main(&Context, out);
+	ASE_FREE(Context.scratch);
+	return(R);
+}
+#endif
+
+ASE_DECL ASE_BOOL
+ASE_load_from_memory (const uint8_t *buffer, int len, ASE_Sprite *out)
+{
+	ASE__ctx Context = {0};
+	ASE__start_mem(&Context, (uint8_t *)buffer, len);
+	int R = ASE__decode_main(&Context, out);
+	ASE_FREE(Context.scratch);
+	return(R);
+}
 
-#ifndef STBI_ASSERT
-#include <assert.h>
-#define STBI_ASSERT(x) assert(x)
-#endif
+ASE_DECL ASE_BOOL
+ASE_load_from_callbacks (const ASE_Callbacks *io, void *user, ASE_Sprite *out)
+{
+	ASE__ctx Context = {0};
+	ASE__start_callbacks(&Context, (ASE_Callbacks *)io, user);
+	int R = ASE__decode_main(&Context, out);
+	ASE_FREE(Context.scratch);
+	return(R);
+}
 
-#ifndef _MSC_VER
-   #ifdef __cplusplus
-   #define stbi_inline inline
-   #else
-   #define stbi_inline
-   #endif
-#else
-   #define stbi_inline __forceinline
+ASE_DECL void
+ASE_free(ASE_Sprite *Sprite)
+{
+	if (!Sprite) return;
+#ifdef ASE__WATCHING
+	ASE__watch_drop(Sprite);
 #endif
 
-#ifdef _MSC_VER
-typedef unsigned short stbi__uint16;
-typedef   signed short stbi__int16;
-typedef unsigned int   stbi__uint32;
-typedef   signed int   stbi__int32;
-#else
-#include <stdint.h>
-typedef uint16_t stbi__uint16;
-typedef int16_t  stbi__int16;
-typedef uint32_t stbi__uint32;
-typedef int32_t  stbi__int32;
-#endif
+	for (int i=0; i < Sprite->nlayers; ++i) {
+		ASE_Layer *I = Sprite->layers + i;
+		ASE_FREE(I->name);
+	}
+	ASE_FREE(Sprite->layers);
 
-// should produce compiler error if size is wrong
-typedef unsigned char validate_uint32[sizeof(stbi__uint32)==4 ? 1 : -1];
+	for (int i=0; i < Sprite->nframes; ++i) {
+		ASE_Frame *I = Sprite->frames + i;
+		for (int j=0; j < I->ncels; ++j) {
+			ASE_Cel *J = I->cels + j;
+			ASE_FREE(J->data);
+		}
+		ASE_FREE(I->cels);
+	}
+	ASE_FREE(Sprite->frames);
 
-#ifdef _MSC_VER
-#define STBI_NOTUSED(v)  (void)(v)
-#else
-#define STBI_NOTUSED(v)  (void)sizeof(v)
-#endif
+	for (int i=0; i < Sprite->ntags; ++i) {
+		ASE_Tag *I = Sprite->tags + i;
+		ASE_FREE(I->name);
+		ASE_FREE(I->steps);
+	}
+	ASE_FREE(Sprite->tags);
 
-#ifdef _MSC_VER
-#define STBI_HAS_LROTL
-#endif
+	ASE_FREE(Sprite->cel_table);
+	ASE_FREE(Sprite->frame_start);
+	ASE_FREE(Sprite->layer_index.slots);
+	ASE_FREE(Sprite->tag_index.slots);
 
-#ifdef STBI_HAS_LROTL
-   #define stbi_lrot(x,y)  _lrotl(x,y)
-#else
-   #define stbi_lrot(x,y)  (((x) << (y)) | ((x) >> (32 - (y))))
-#endif
+	memset(Sprite, 0, sizeof(ASE_Sprite));
+}
 
-#if defined(STBI_MALLOC) && defined(STBI_FREE) && (defined(STBI_REALLOC) || defined(STBI_REALLOC_SIZED))
-// ok
-#elif !defined(STBI_MALLOC) && !defined(STBI_FREE) && !defined(STBI_REALLOC) && !defined(STBI_REALLOC_SIZED)
-// ok
-#else
-#error "Must define all or none of STBI_MALLOC, STBI_FREE, and STBI_REALLOC (or STBI_REALLOC_SIZED)."
-#endif
 
-#ifndef STBI_MALLOC
-#define STBI_MALLOC(sz)           ASE_MALLOC(sz)
-#define STBI_REALLOC(p,newsz)     ASE_REALLOC(p,newsz)
-#define STBI_FREE(p)              ASE_FREE(p)
-#endif
 
-#ifndef STBI_REALLOC_SIZED
-#define STBI_REALLOC_SIZED(p,oldsz,newsz) STBI_REALLOC(p,newsz)
-#endif
+//////////////////////////////////////////////////////////////////////////////
+// primary API - reusable decoders
+//
+struct ASE_Decoder {
+	ASE__ctx ctx;   // only the scratch buffer survives between loads
+	char    *iobuf; // ASE_DECODER_IOBUF bytes, once a file has been opened
+};
 
-// this is not threadsafe
-static const char *stbi__g_failure_reason;
+// the fixed-code zlib tables are built lazily, once for everyone; get it
+// done before threads race for it
+static void ASE__zlib_warm(void)
+{
+	static const char Empty[] = { 0x78, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	char Out[1];
+	stbi_zlib_decode_buffer(Out, sizeof(Out), Empty, sizeof(Empty));
+}
 
-STBIDEF const char *stbi_failure_reason(void)
+// a fresh context that keeps what the last load grew
+static ASE__ctx *ASE__decoder_ctx(ASE_Decoder *D)
 {
-   return stbi__g_failure_reason;
+	uint8_t *Scratch = D->ctx.scratch;
+	int      Cap     = D->ctx.scratch_cap;
+	memset(&D->ctx, 0, sizeof(ASE__ctx));
+	D->ctx.scratch     = Scratch;
+	D->ctx.scratch_cap = Cap;
+	return(&D->ctx);
 }
 
-static int stbi__err(const char *str)
+ASE_DECL ASE_Decoder *
+ASE_decoder_new (void)
 {
-   stbi__g_failure_reason = str;
-   return 0;
+	ASE_Decoder *D = (ASE_Decoder *)ASE_MALLOC(sizeof(ASE_Decoder));
+	if (!D) return(0);
+	memset(D, 0, sizeof(ASE_Decoder));
+	ASE__zlib_warm();
+	return(D);
 }
 
-static void *stbi__malloc(size_t size)
+ASE_DECL void
+ASE_decoder_trim (ASE_Decoder *D)
 {
-    return STBI_MALLOC(size);
+	ASE_FREE(D->ctx.scratch);
+	ASE_FREE(D->iobuf);
+	D->ctx.scratch     = 0;
+	D->ctx.scratch_cap = 0;
+	D->iobuf           = 0;
 }
 
-// stbi__err - error
-// stbi__errpf - error returning pointer to float
-// stbi__errpuc - error returning pointer to unsigned char
+ASE_DECL void
+ASE_decoder_free (ASE_Decoder *D)
+{
+	if (!D) return;
+	ASE_decoder_trim(D);
+	ASE_FREE(D);
+}
 
-#ifdef STBI_NO_FAILURE_STRINGS
-   #define stbi__err(x,y)  0
-#elif defined(STBI_FAILURE_USERMSG)
-   #define stbi__err(x,y)  stbi__err(y)
-#else
-   #define stbi__err(x,y)  stbi__err(x)
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_BOOL
+ASE_decoder_load (ASE_Decoder *D, const char *filename, ASE_Sprite *out)
+{
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		ASE_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	if (!D->iobuf) D->iobuf = (char *)ASE_MALLOC(ASE_DECODER_IOBUF);
+	if (D->iobuf) setvbuf(F, D->iobuf, _IOFBF, ASE_DECODER_IOBUF);
+
+	ASE__ctx *Context = ASE__decoder_ctx(D);
+	ASE__start_file(Context, F);
+	int R = ASE__decode_main(Context, out);
+	fclose(F);
+	return(R);
+}
+
+ASE_DECL ASE_BOOL
+ASE_decoder_load_from_file (ASE_Decoder *D, FILE *f, ASE_Sprite *out)
+{
+	ASE__ctx *Context = ASE__decoder_ctx(D);
+	ASE__start_file(Context, f);
+	return(ASE__decode_main(Context, out));
+}
 #endif
 
-#define stbi__errpf(x,y)   ((float *)(size_t) (stbi__err(x,y)?NULL:NULL))
-#define stbi__errpuc(x,y)  ((unsigned char *)(size_t) (stbi__err(x,y)?NULL:NULL))
+ASE_DECL ASE_BOOL
+ASE_decoder_load_from_memory (ASE_Decoder *D, const uint8_t *buffer, int len, ASE_Sprite *out)
+{
+	ASE__ctx *Context = ASE__decoder_ctx(D);
+	ASE__start_mem(Context, (uint8_t *)buffer, len);
+	return(ASE__decode_main(Context, out));
+}
 
+ASE_DECL ASE_BOOL
+ASE_decoder_load_from_callbacks (ASE_Decoder *D, const ASE_Callbacks *io, void *user, ASE_Sprite *out)
+{
+	ASE__ctx *Context = ASE__decoder_ctx(D);
+	ASE__start_callbacks(Context, (ASE_Callbacks *)io, user);
+	return(ASE__decode_main(Context, out));
+}
 
-// x86/x64 detection
-#if defined(__x86_64__) || defined(_M_X64)
-#define STBI__X64_TARGET
-#elif defined(__i386) || defined(_M_IX86)
-#define STBI__X86_TARGET
-#endif
 
-#if defined(__GNUC__) && (defined(STBI__X86_TARGET) || defined(STBI__X64_TARGET)) && !defined(__SSE2__) && !defined(STBI_NO_SIMD)
-// NOTE: not clear do we actually need this for the 64-bit path?
-// gcc doesn't support sse2 intrinsics unless you compile with -msse2,
-// (but compiling with -msse2 allows the compiler to use SSE2 everywhere;
-// this is just broken and gcc are jerks for not fixing it properly
-// http://www.virtualdub.org/blog/pivot/entry.php?id=363 )
-#define STBI_NO_SIMD
-#endif
 
-#if defined(__MINGW32__) && defined(STBI__X86_TARGET) && !defined(STBI_MINGW_ENABLE_SSE2) && !defined(STBI_NO_SIMD)
-// Note that __MINGW32__ doesn't actually mean 32-bit, so we have to avoid STBI__X64_TARGET
-//
-// 32-bit MinGW wants ESP to be 16-byte aligned, but this is not in the
-// Windows ABI and VC++ as well as Windows DLLs don't maintain that invariant.
-// As a result, enabling SSE2 on 32-bit MinGW is dangerous when not
-// simultaneously enabling "-mstackrealign".
-//
-// See https://github.com/nothings/stb/issues/81 for more information.
+//////////////////////////////////////////////////////////////////////////////
+// primary API - streaming
 //
-// So default to no SSE2 on 32-bit MinGW. If you've read this far and added
-// -mstackrealign to your build settings, feel free to #define STBI_MINGW_ENABLE_SSE2.
-#define STBI_NO_SIMD
+struct ASE_Stream {
+	ASE__ctx         ctx;
+	ASE__frame_state state;
+	ASE_Sprite       sprite; // palette, layers and tags; never any frames
+#ifndef ASE_NO_STDIO
+	FILE           * owned;  // opened by ASE_open
 #endif
 
-#if !defined(STBI_NO_SIMD) && (defined(STBI__X86_TARGET) || defined(STBI__X64_TARGET))
-#define STBI_SSE2
-#include <emmintrin.h>
+	int              next;   // frame the next ASE_next_frame decodes
+	ASE_Frame        frame;  // the one handed out last
 
-#ifdef _MSC_VER
+	// per layer, the last cel that had pixels, with 'frame' set to where it
+	// came from; data is null until the layer shows something
+	int              nheld;
+	int              held_cap;
+	ASE_Cel        * held;
+};
 
-#if _MSC_VER >= 1400  // not VC6
-#include <intrin.h> // __cpuid
-static int stbi__cpuid3(void)
+static ASE_Stream *ASE__stream_alloc(void)
 {
-   int info[4];
-   __cpuid(info,1);
-   return info[3];
+	ASE_Stream *S = (ASE_Stream *)ASE_MALLOC(sizeof(ASE_Stream));
+	if (S) memset(S, 0, sizeof(ASE_Stream));
+	return(S);
 }
-#else
-static int stbi__cpuid3(void)
+
+static ASE_Stream *ASE__stream_begin(ASE_Stream *S)
 {
-   int res;
-   __asm {
-      mov  eax,1
-      cpuid
-      mov  res,edx
-   }
-   return res;
+	if (!ASE__decode_header(&S->ctx, &S->sprite, &S->state)) {
+		ASE_close(S);
+		return(0);
+	}
+	return(S);
+}
+
+// done with the current frame: its pixels move over to the held cels, so the
+// next frame can link to them, and the frame keeps its cel array for reuse
+static void ASE__stream_release(ASE_Stream *S)
+{
+	ASE_Frame *Frame = &S->frame;
+	for (int c=0; c < Frame->ncels; ++c) {
+		ASE_Cel *C = Frame->cels + c;
+		if (C->is_linked || !C->data) continue;
+
+		int L = C->layer;
+		if (L >= S->nheld) {
+			if (!ASE__grow((void **)&S->held, &S->held_cap, L + 1, sizeof(ASE_Cel))) {
+				ASE_FREE(C->data);
+				continue;
+			}
+			memset(S->held + S->nheld, 0, (L + 1 - S->nheld) * sizeof(ASE_Cel));
+			S->nheld = L + 1;
+		}
+		ASE_FREE(S->held[L].data);
+		S->held[L]       = *C;
+		S->held[L].frame = S->next - 1;
+	}
+	Frame->ncels = 0;
+}
+
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_Stream *
+ASE_open (const char *filename)
+{
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		ASE_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	ASE_Stream *S = ASE__stream_alloc();
+	if (!S) {
+		fclose(F);
+		return(0);
+	}
+	S->owned = F;
+	ASE__start_file(&S->ctx, F);
+	return(ASE__stream_begin(S));
+}
+
+ASE_DECL ASE_Stream *
+ASE_open_file (FILE *f)
+{
+	ASE_Stream *S = ASE__stream_alloc();
+	if (!S) return(0);
+	ASE__start_file(&S->ctx, f);
+	return(ASE__stream_begin(S));
 }
 #endif
 
-#define STBI_SIMD_ALIGN(type, name) __declspec(align(16)) type name
+ASE_DECL ASE_Stream *
+ASE_open_memory (const uint8_t *buffer, int len)
+{
+	ASE_Stream *S = ASE__stream_alloc();
+	if (!S) return(0);
+	ASE__start_mem(&S->ctx, (uint8_t *)buffer, len);
+	return(ASE__stream_begin(S));
+}
 
-static int stbi__sse2_available()
+ASE_DECL ASE_Stream *
+ASE_open_callbacks (const ASE_Callbacks *io, void *user)
 {
-   int info3 = stbi__cpuid3();
-   return ((info3 >> 26) & 1) != 0;
+	ASE_Stream *S = ASE__stream_alloc();
+	if (!S) return(0);
+	ASE__start_callbacks(&S->ctx, (ASE_Callbacks *)io, user);
+	return(ASE__stream_begin(S));
 }
-#else // assume GCC-style if not VC++
-#define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
 
-static int stbi__sse2_available()
+ASE_DECL ASE_Sprite
+ASE_stream_info (ASE_Stream *S)
 {
-#if defined(__GNUC__) && (__GNUC__ * 100 + __GNUC_MINOR__) >= 408 // GCC 4.8 or later
-   // GCC 4.8+ has a nice way to do this
-   return __builtin_cpu_supports("sse2");
-#else
-   // portable way to do this, preferably without using GCC inline ASM?
-   // just bail for now.
-   return 0;
+	ASE_Sprite Info = S->sprite;
+	Info.nframes = S->state.header.frames;
+	return(Info);
+}
+
+ASE_DECL ASE_Frame *
+ASE_next_frame (ASE_Stream *S)
+{
+	ASE__stream_release(S);
+	if (S->next >= S->state.header.frames) return(0);
+
+	ASE__decode_frame(&S->ctx, &S->sprite, &S->state, &S->frame, S->next);
+	S->next += 1;
+	return(&S->frame);
+}
+
+ASE_DECL int
+ASE_stream_tell (ASE_Stream *S)
+{
+	return(S->next);
+}
+
+ASE_DECL ASE_Cel *
+ASE_stream_linked_cel (ASE_Stream *S, ASE_Cel *cel)
+{
+	if (!cel->is_linked || cel->layer >= S->nheld) return(0);
+	ASE_Cel *H = S->held + cel->layer;
+	if (!H->data || H->frame != cel->frame) return(0);
+	return(H);
+}
+
+ASE_DECL void
+ASE_close (ASE_Stream *S)
+{
+	if (!S) return;
+
+	for (int c=0; c < S->frame.ncels; ++c)
+		ASE_FREE(S->frame.cels[c].data);
+	ASE_FREE(S->frame.cels);
+
+	for (int l=0; l < S->nheld; ++l)
+		ASE_FREE(S->held[l].data);
+	ASE_FREE(S->held);
+
+	ASE_free(&S->sprite);
+	ASE_FREE(S->ctx.scratch);
+#ifndef ASE_NO_STDIO
+	if (S->owned) fclose(S->owned);
 #endif
+	ASE_FREE(S);
 }
-#endif
-#endif
 
-// ARM NEON
-#if defined(STBI_NO_SIMD) && defined(STBI_NEON)
-#undef STBI_NEON
-#endif
 
-#ifdef STBI_NEON
-#include <arm_neon.h>
-// assume GCC or Clang on ARM targets
-#define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
-#endif
 
-#ifndef STBI_SIMD_ALIGN
-#define STBI_SIMD_ALIGN(type, name) type name
+//////////////////////////////////////////////////////////////////////////////
+// primary API - random access
+//
+// saved index: "ASEI", version, frames (16 bits), the file size from its
+// header (32 bits), then per frame its offset (32 bits), duration (16) and
+// whether it has palette, layer or tag chunks (16). all little-endian.
+#define ASE__INDEX_MAGIC   0x49455341 // "ASEI"
+#define ASE__INDEX_VERSION 1
+
+struct ASE_Index {
+	ASE__ctx         ctx;
+	ASE__frame_state state;   // the file header, for decoding cels
+	ASE_Sprite       sprite;  // everything but the cels
+#ifndef ASE_NO_STDIO
+	FILE           * owned;   // opened by ASE_index_open
 #endif
 
+	uint32_t       * offsets; // per frame, where its header starts
+	uint16_t       * meta;    // per frame, nonzero if it has palette, layer or tag chunks
 
-// fast-way is faster to check than jpeg huffman, but slow way is slower
-#define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
-#define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
-
-// zlib-style huffman encoding
-// (jpegs packs from left, zlib from right, so can't share code)
-typedef struct
-{
-   stbi__uint16 fast[1 << STBI__ZFAST_BITS];
-   stbi__uint16 firstcode[16];
-   int maxcode[17];
-   stbi__uint16 firstsymbol[16];
-   stbi_uc  size[288];
-   stbi__uint16 value[288];
-} stbi__zhuffman;
+	// per layer, the last cel a link was chased to ('frame' is -1 if none)
+	int              nheld;
+	int              held_cap;
+	ASE_Cel        * held;
+};
 
-stbi_inline static int stbi__bitreverse16(int n)
+static ASE_Index *ASE__index_alloc(void)
 {
-  n = ((n & 0xAAAA) >>  1) | ((n & 0x5555) << 1);
-  n = ((n & 0xCCCC) >>  2) | ((n & 0x3333) << 2);
-  n = ((n & 0xF0F0) >>  4) | ((n & 0x0F0F) << 4);
-  n = ((n & 0xFF00) >>  8) | ((n & 0x00FF) << 8);
-  return n;
+	ASE_Index *X = (ASE_Index *)ASE_MALLOC(sizeof(ASE_Index));
+	if (X) memset(X, 0, sizeof(ASE_Index));
+	return(X);
 }
 
-stbi_inline static int stbi__bit_reverse(int v, int bits)
+// room for N frames, with no cels
+static ASE_BOOL ASE__index_frames(ASE_Index *X, int N)
 {
-   STBI_ASSERT(bits <= 16);
-   // to bit reverse n bits, reverse 16 and shift
-   // e.g. 11 bits, bit reverse and shift away 5
-   return stbi__bitreverse16(v) >> (16-bits);
+	ASE__ctx   *F = &X->ctx;
+	ASE_Sprite *S = &X->sprite;
+	if (!N) return(1);
+
+	X->offsets = (uint32_t *)ASE_MALLOC(N * sizeof(uint32_t));
+	X->meta    = (uint16_t *)ASE_MALLOC(N * sizeof(uint16_t));
+	if (!X->offsets || !X->meta) return(0);
+	if (!ASE__reserve((void **)&S->frames, &F->frames_cap, N, sizeof(ASE_Frame))) return(0);
+	for (int i=0; i < N; ++i) {
+		if (!ASE_DOC_AddFrame(F, S)) return(0);
+	}
+	return(1);
 }
 
-static int stbi__zbuild_huffman(stbi__zhuffman *z, stbi_uc *sizelist, int num)
+// frame times, tag timelines and name lookups; there are no cels to link
+static void ASE__index_sprite(ASE_Sprite *S)
 {
-   int i,k=0;
-   int code, next_code[16], sizes[17];
-
-   // DEFLATE spec for generating codes
-   memset(sizes, 0, sizeof(sizes));
-   memset(z->fast, 0, sizeof(z->fast));
-   for (i=0; i < num; ++i)
-      ++sizes[sizelist[i]];
-   sizes[0] = 0;
-   for (i=1; i < 16; ++i)
-      if (sizes[i] > (1 << i))
-         return stbi__err("bad sizes", "Corrupt PNG");
-   code = 0;
-   for (i=1; i < 16; ++i) {
-      next_code[i] = code;
-      z->firstcode[i] = (stbi__uint16) code;
-      z->firstsymbol[i] = (stbi__uint16) k;
-      code = (code + sizes[i]);
-      if (sizes[i])
-         if (code-1 >= (1 << i)) return stbi__err("bad codelengths","Corrupt PNG");
-      z->maxcode[i] = code << (16-i); // preshift for inner loop
-      code <<= 1;
-      k += sizes[i];
-   }
-   z->maxcode[16] = 0x10000; // sentinel
-   for (i=0; i < num; ++i) {
-      int s = sizelist[i];
-      if (s) {
-         int c = next_code[s] - z->firstcode[s] + z->firstsymbol[s];
-         stbi__uint16 fastv = (stbi__uint16) ((s << 9) | i);
-         z->size [c] = (stbi_uc     ) s;
-         z->value[c] = (stbi__uint16) i;
-         if (s <= STBI__ZFAST_BITS) {
-            int j = stbi__bit_reverse(next_code[s],s);
-            while (j < (1 << STBI__ZFAST_BITS)) {
-               z->fast[j] = fastv;
-               j += (1 << s);
-            }
-         }
-         ++next_code[s];
-      }
-   }
-   return 1;
+	ASE__index_times(S);
+	ASE__index_tags(S);
+	if (S->nlayers) ASE__index_names(&S->layer_index, &S->layers->name, S->nlayers, sizeof(ASE_Layer));
+	if (S->ntags)   ASE__index_names(&S->tag_index, &S->tags->name, S->ntags, sizeof(ASE_Tag));
 }
 
-// zlib-from-memory implementation for PNG reading
-//    because PNG allows splitting the zlib stream arbitrarily,
-//    and it's annoying structurally to have PNG call ZLIB call PNG,
-//    we require PNG read all the IDATs and combine them into a single
-//    memory buffer
-
-typedef struct
+// seeks to frame i, making sure one starts there
+static ASE_BOOL ASE__index_seek(ASE_Index *X, int i)
 {
-   stbi_uc *zbuffer, *zbuffer_end;
-   int num_bits;
-   stbi__uint32 code_buffer;
-
-   char *zout;
-   char *zout_start;
-   char *zout_end;
-   int   z_expandable;
+	ASE__ctx *F = &X->ctx;
+	F->io.seek(F->udata, X->offsets[i]);
 
-   stbi__zhuffman z_length, z_distance;
-} stbi__zbuf;
+	ASE_FrameHeader FrameHeader = {0};
+	ASE_FrameHeader_read(F, &FrameHeader);
+	F->io.seek(F->udata, X->offsets[i]);
 
-stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
-{
-   if (z->zbuffer >= z->zbuffer_end) return 0;
-   return *z->zbuffer++;
+	if (FrameHeader.magic != ASE_FILE_FRAME_MAGIC) {
+		ASE_ERR("ase: no frame %i at %u -- stale index?\n", i, (unsigned)X->offsets[i]);
+		return(0);
+	}
+	return(1);
 }
 
-static void stbi__fill_bits(stbi__zbuf *z)
+// reads every chunk but the cels, noting where the frames start
+static ASE_Index *ASE__index_scan(ASE_Index *X)
 {
-   do {
-      STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
-      z->code_buffer |= (unsigned int) stbi__zget8(z) << z->num_bits;
-      z->num_bits += 8;
-   } while (z->num_bits <= 24);
+	ASE__ctx   *F = &X->ctx;
+	ASE_Sprite *S = &X->sprite;
+
+	if (!ASE__decode_header(F, S, &X->state) ||
+	    !ASE__index_frames(X, X->state.header.frames))
+	{
+		ASE_index_close(X);
+		return(0);
+	}
+
+	X->state.cel_layer = ASE__NO_CELS;
+	for (int i=0; i < S->nframes; ++i) {
+		X->offsets[i] = (uint32_t)F->io.tell(F->udata);
+		ASE__decode_frame(F, S, &X->state, S->frames + i, i);
+		X->meta[i] = (uint16_t)(X->state.meta_chunks > 0);
+	}
+	ASE__index_sprite(S);
+	return(X);
 }
 
-stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_Index *
+ASE_index_open (const char *filename)
 {
-   unsigned int k;
-   if (z->num_bits < n) stbi__fill_bits(z);
-   k = z->code_buffer & ((1 << n) - 1);
-   z->code_buffer >>= n;
-   z->num_bits -= n;
-   return k;
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		ASE_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	ASE_Index *X = ASE__index_alloc();
+	if (!X) {
+		fclose(F);
+		return(0);
+	}
+	X->owned = F;
+	ASE__start_file(&X->ctx, F);
+	return(ASE__index_scan(X));
 }
 
-static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+ASE_DECL ASE_Index *
+ASE_index_open_file (FILE *f)
 {
-   int b,s,k;
-   // not resolved by fast table, so compute it the slow way
-   // use jpeg approach, which requires MSbits at top
-   k = stbi__bit_reverse(a->code_buffer, 16);
-   for (s=STBI__ZFAST_BITS+1; ; ++s)
-      if (k < z->maxcode[s])
-         break;
-   if (s == 16) return -1; // invalid code!
-   // code size is s, so:
-   b = (k >> (16-s)) - z->firstcode[s] + z->firstsymbol[s];
-   STBI_ASSERT(z->size[b] == s);
-   a->code_buffer >>= s;
-   a->num_bits -= s;
-   return z->value[b];
+	ASE_Index *X = ASE__index_alloc();
+	if (!X) return(0);
+	ASE__start_file(&X->ctx, f);
+	return(ASE__index_scan(X));
 }
 
-stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
+static void ASE__put(FILE *f, uint32_t v, int bytes)
 {
-   int b,s;
-   if (a->num_bits < 16) stbi__fill_bits(a);
-   b = z->fast[a->code_buffer & STBI__ZFAST_MASK];
-   if (b) {
-      s = b >> 9;
-      a->code_buffer >>= s;
-      a->num_bits -= s;
-      return b & 511;
-   }
-   return stbi__zhuffman_decode_slowpath(a, z);
+	for (int i=0; i < bytes; ++i) fputc((v >> (8 * i)) & 0xff, f);
 }
 
-static int stbi__zexpand(stbi__zbuf *z, char *zout, int n)  // need to make room for n bytes
+ASE_DECL ASE_BOOL
+ASE_index_save (ASE_Index *X, const char *index_filename)
 {
-   char *q;
-   int cur, limit, old_limit;
-   z->zout = zout;
-   if (!z->z_expandable) return stbi__err("output buffer limit","Corrupt PNG");
-   cur   = (int) (z->zout     - z->zout_start);
-   limit = old_limit = (int) (z->zout_end - z->zout_start);
-   while (cur + n > limit)
-      limit *= 2;
-   q = (char *) STBI_REALLOC_SIZED(z->zout_start, old_limit, limit);
-   STBI_NOTUSED(old_limit);
-   if (q == NULL) return stbi__err("outofmem", "Out of memory");
-   z->zout_start = q;
-   z->zout       = q + cur;
-   z->zout_end   = q + limit;
-   return 1;
-}
+	FILE *f = fopen(index_filename, "wb");
+	if (!f) {
+		ASE_ERR("could not open file: %s\n", index_filename);
+		return(0);
+	}
 
-static int stbi__zlength_base[31] = {
-   3,4,5,6,7,8,9,10,11,13,
-   15,17,19,23,27,31,35,43,51,59,
-   67,83,99,115,131,163,195,227,258,0,0 };
+	ASE__put(f, ASE__INDEX_MAGIC, 4);
+	ASE__put(f, ASE__INDEX_VERSION, 2);
+	ASE__put(f, X->sprite.nframes, 2);
+	ASE__put(f, X->state.header.size, 4);
+	for (int i=0; i < X->sprite.nframes; ++i) {
+		ASE__put(f, X->offsets[i], 4);
+		ASE__put(f, X->sprite.frames[i].duration, 2);
+		ASE__put(f, X->meta[i], 2);
+	}
 
-static int stbi__zlength_extra[31]=
-{ 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0,0,0 };
+	ASE_BOOL R = !ferror(f);
+	if (fclose(f)) R = 0;
+	return(R);
+}
 
-static int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,
-257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,0,0};
+// takes the frame offsets from a saved index if it matches the file, and
+// reads only the frames with palette, layer or tag chunks
+static ASE_BOOL ASE__index_load(ASE_Index *X, FILE *Saved)
+{
+	ASE__ctx   *F = &X->ctx;
+	ASE_Sprite *S = &X->sprite;
+
+	ASE__ctx I = {0};
+	ASE__start_file(&I, Saved);
+	if ((uint32_t)ASE__read32(&I) != ASE__INDEX_MAGIC) return(0);
+	if (ASE__read16(&I) != ASE__INDEX_VERSION) return(0);
+	int      N    = ASE__read16(&I);
+	uint32_t Size = (uint32_t)ASE__read32(&I);
+
+	if (!ASE__decode_header(F, S, &X->state)) return(0);
+	if (N != X->state.header.frames || Size != X->state.header.size) return(0);
+	if (!ASE__index_frames(X, N)) return(0);
+
+	for (int i=0; i < N; ++i) {
+		X->offsets[i]         = (uint32_t)ASE__read32(&I);
+		S->frames[i].duration = (uint16_t)ASE__read16(&I);
+		X->meta[i]            = (uint16_t)ASE__read16(&I);
+	}
+	if (feof(Saved)) return(0);
 
-static int stbi__zdist_extra[32] =
-{ 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+	X->state.cel_layer = ASE__NO_CELS;
+	for (int i=0; i < N; ++i) {
+		if (!X->meta[i]) continue;
+		if (!ASE__index_seek(X, i)) return(0);
+		ASE__decode_frame(F, S, &X->state, S->frames + i, i);
+	}
+	ASE__index_sprite(S);
+	return(1);
+}
 
-static int stbi__parse_huffman_block(stbi__zbuf *a)
+ASE_DECL ASE_Index *
+ASE_index_open_saved (const char *filename, const char *index_filename)
 {
-   char *zout = a->zout;
-   for(;;) {
-      int z = stbi__zhuffman_decode(a, &a->z_length);
-      if (z < 256) {
-         if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
-         if (zout >= a->zout_end) {
-            if (!stbi__zexpand(a, zout, 1)) return 0;
-            zout = a->zout;
-         }
-         *zout++ = (char) z;
-      } else {
-         stbi_uc *p;
-         int len,dist;
-         if (z == 256) {
-            a->zout = zout;
-            return 1;
-         }
-         z -= 257;
-         len = stbi__zlength_base[z];
-         if (stbi__zlength_extra[z]) len += stbi__zreceive(a, stbi__zlength_extra[z]);
-         z = stbi__zhuffman_decode(a, &a->z_distance);
-         if (z < 0) return stbi__err("bad huffman code","Corrupt PNG");
-         dist = stbi__zdist_base[z];
-         if (stbi__zdist_extra[z]) dist += stbi__zreceive(a, stbi__zdist_extra[z]);
-         if (zout - a->zout_start < dist) return stbi__err("bad dist","Corrupt PNG");
-         if (zout + len > a->zout_end) {
-            if (!stbi__zexpand(a, zout, len)) return 0;
-            zout = a->zout;
-         }
-         p = (stbi_uc *) (zout - dist);
-         if (dist == 1) { // run of one byte; common in images.
-            stbi_uc v = *p;
-            if (len) { do *zout++ = v; while (--len); }
-         } else {
-            if (len) { do *zout++ = *p++; while (--len); }
-         }
-      }
-   }
+	FILE *Saved = fopen(index_filename, "rb");
+	if (!Saved) return(ASE_index_open(filename));
+
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		ASE_ERR("could not open file: %s\n", filename);
+		fclose(Saved);
+		return(0);
+	}
+	ASE_Index *X = ASE__index_alloc();
+	if (!X) {
+		fclose(Saved);
+		fclose(F);
+		return(0);
+	}
+	X->owned = F;
+	ASE__start_file(&X->ctx, F);
+
+	ASE_BOOL Ok = ASE__index_load(X, Saved);
+	fclose(Saved);
+	if (Ok) return(X);
+
+	// out of date; start over from the top
+	ASE_free(&X->sprite);
+	ASE_FREE(X->offsets);
+	ASE_FREE(X->meta);
+	X->offsets = 0;
+	X->meta    = 0;
+	X->ctx.io.seek(X->ctx.udata, 0);
+	return(ASE__index_scan(X));
 }
+#endif
 
-static int stbi__compute_huffman_codes(stbi__zbuf *a)
+ASE_DECL ASE_Index *
+ASE_index_open_memory (const uint8_t *buffer, int len)
 {
-   static stbi_uc length_dezigzag[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
-   stbi__zhuffman z_codelength;
-   stbi_uc lencodes[286+32+137];//padding for maximum single op
-   stbi_uc codelength_sizes[19];
-   int i,n;
+	ASE_Index *X = ASE__index_alloc();
+	if (!X) return(0);
+	ASE__start_mem(&X->ctx, (uint8_t *)buffer, len);
+	return(ASE__index_scan(X));
+}
 
-   int hlit  = stbi__zreceive(a,5) + 257;
-   int hdist = stbi__zreceive(a,5) + 1;
-   int hclen = stbi__zreceive(a,4) + 4;
+ASE_DECL ASE_Index *
+ASE_index_open_callbacks (const ASE_Callbacks *io, void *user)
+{
+	ASE_Index *X = ASE__index_alloc();
+	if (!X) return(0);
+	ASE__start_callbacks(&X->ctx, (ASE_Callbacks *)io, user);
+	return(ASE__index_scan(X));
+}
 
-   memset(codelength_sizes, 0, sizeof(codelength_sizes));
-   for (i=0; i < hclen; ++i) {
-      int s = stbi__zreceive(a,3);
-      codelength_sizes[length_dezigzag[i]] = (stbi_uc) s;
-   }
-   if (!stbi__zbuild_huffman(&z_codelength, codelength_sizes, 19)) return 0;
+ASE_DECL ASE_Sprite
+ASE_index_info (ASE_Index *X)
+{
+	return(X->sprite);
+}
 
-   n = 0;
-   while (n < hlit + hdist) {
-      int c = stbi__zhuffman_decode(a, &z_codelength);
-      if (c < 0 || c >= 19) return stbi__err("bad codelengths", "Corrupt PNG");
-      if (c < 16)
-         lencodes[n++] = (stbi_uc) c;
-      else if (c == 16) {
-         c = stbi__zreceive(a,2)+3;
-         memset(lencodes+n, lencodes[n-1], c);
-         n += c;
-      } else if (c == 17) {
-         c = stbi__zreceive(a,3)+3;
-         memset(lencodes+n, 0, c);
-         n += c;
-      } else {
-         STBI_ASSERT(c == 18);
-         c = stbi__zreceive(a,7)+11;
-         memset(lencodes+n, 0, c);
-         n += c;
-      }
-   }
-   if (n != hlit+hdist) return stbi__err("bad codelengths","Corrupt PNG");
-   if (!stbi__zbuild_huffman(&a->z_length, lencodes, hlit)) return 0;
-   if (!stbi__zbuild_huffman(&a->z_distance, lencodes+hlit, hdist)) return 0;
-   return 1;
+ASE_DECL int
+ASE_index_offset (ASE_Index *X, int frame)
+{
+	if (frame < 0 || frame >= X->sprite.nframes) return(-1);
+	return((int)X->offsets[frame]);
 }
 
-static int stbi__parse_uncompressed_block(stbi__zbuf *a)
+ASE_DECL ASE_BOOL
+ASE_decode_frame (ASE_Index *X, int frame, ASE_Frame *out)
 {
-   stbi_uc header[4];
-   int len,nlen,k;
-   if (a->num_bits & 7)
-      stbi__zreceive(a, a->num_bits & 7); // discard
-   // drain the bit-packed data into header
-   k = 0;
-   while (a->num_bits > 0) {
-      header[k++] = (stbi_uc) (a->code_buffer & 255); // suppress MSVC run-time check
-      a->code_buffer >>= 8;
-      a->num_bits -= 8;
-   }
-   STBI_ASSERT(a->num_bits == 0);
-   // now fill header the normal way
-   while (k < 4)
-      header[k++] = stbi__zget8(a);
-   len  = header[1] * 256 + header[0];
-   nlen = header[3] * 256 + header[2];
-   if (nlen != (len ^ 0xffff)) return stbi__err("zlib corrupt","Corrupt PNG");
-   if (a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer","Corrupt PNG");
-   if (a->zout + len > a->zout_end)
-      if (!stbi__zexpand(a, a->zout, len)) return 0;
-   memcpy(a->zout, a->zbuffer, len);
-   a->zbuffer += len;
-   a->zout += len;
-   return 1;
+	memset(out, 0, sizeof(ASE_Frame));
+	if (frame < 0 || frame >= X->sprite.nframes) return(0);
+	if (!ASE__index_seek(X, frame)) return(0);
+
+	ASE__frame_state State = X->state;
+	State.skip_meta = 1;
+	State.cel_layer = ASE__ALL_CELS;
+	ASE__decode_frame(&X->ctx, &X->sprite, &State, out, frame);
+	return(1);
 }
 
-static int stbi__parse_zlib_header(stbi__zbuf *a)
+ASE_DECL void
+ASE_free_frame (ASE_Frame *frame)
 {
-   int cmf   = stbi__zget8(a);
-   int cm    = cmf & 15;
-   /* int cinfo = cmf >> 4; */
-   int flg   = stbi__zget8(a);
-   if ((cmf*256+flg) % 31 != 0) return stbi__err("bad zlib header","Corrupt PNG"); // zlib spec
-   if (flg & 32) return stbi__err("no preset dict","Corrupt PNG"); // preset dictionary not allowed in png
-   if (cm != 8) return stbi__err("bad compression","Corrupt PNG"); // DEFLATE required for png
-   // window = 1 << (8 + cinfo)... but who cares, we fully buffer output
-   return 1;
+	for (int c=0; c < frame->ncels; ++c)
+		ASE_FREE(frame->cels[c].data);
+	ASE_FREE(frame->cels);
+	memset(frame, 0, sizeof(ASE_Frame));
 }
 
-// @TODO: should statically initialize these for optimal thread safety
-static stbi_uc stbi__zdefault_length[288], stbi__zdefault_distance[32];
-static void stbi__init_zdefaults(void)
+ASE_DECL ASE_Cel *
+ASE_index_linked_cel (ASE_Index *X, ASE_Cel *cel)
 {
-   int i;   // use <= to match clearly with spec
-   for (i=0; i <= 143; ++i)     stbi__zdefault_length[i]   = 8;
-   for (   ; i <= 255; ++i)     stbi__zdefault_length[i]   = 9;
-   for (   ; i <= 279; ++i)     stbi__zdefault_length[i]   = 7;
-   for (   ; i <= 287; ++i)     stbi__zdefault_length[i]   = 8;
+	if (!cel->is_linked || cel->frame < 0 || cel->frame >= X->sprite.nframes) return(0);
 
-   for (i=0; i <=  31; ++i)     stbi__zdefault_distance[i] = 5;
+	int L = cel->layer;
+	if (L >= X->nheld) {
+		if (!ASE__grow((void **)&X->held, &X->held_cap, L + 1, sizeof(ASE_Cel))) return(0);
+		memset(X->held + X->nheld, 0, (L + 1 - X->nheld) * sizeof(ASE_Cel));
+		for (; X->nheld <= L; ++X->nheld) X->held[X->nheld].frame = -1;
+	}
+
+	ASE_Cel *H = X->held + L;
+	if (H->frame == cel->frame) return(H);
+
+	// decode just this layer's cel out of the frame it links to
+	ASE_Frame Source = {0};
+	if (!ASE__index_seek(X, cel->frame)) return(0);
+	ASE__frame_state State = X->state;
+	State.skip_meta = 1;
+	State.cel_layer = L;
+	ASE__decode_frame(&X->ctx, &X->sprite, &State, &Source, cel->frame);
+
+	ASE_FREE(H->data);
+	memset(H, 0, sizeof(ASE_Cel));
+	H->frame = -1;
+	if (Source.ncels && !Source.cels->is_linked) {
+		*H = *Source.cels;
+		H->frame = cel->frame;
+		Source.cels->data = 0;
+	}
+	ASE_free_frame(&Source);
+	return((H->frame == cel->frame) ? H : 0);
 }
 
-static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
+ASE_DECL void
+ASE_index_close (ASE_Index *X)
 {
-   int final, type;
-   if (parse_header)
-      if (!stbi__parse_zlib_header(a)) return 0;
-   a->num_bits = 0;
-   a->code_buffer = 0;
-   do {
-      final = stbi__zreceive(a,1);
-      type = stbi__zreceive(a,2);
-      if (type == 0) {
-         if (!stbi__parse_uncompressed_block(a)) return 0;
-      } else if (type == 3) {
-         return 0;
-      } else {
-         if (type == 1) {
-            // use fixed code lengths
-            if (!stbi__zdefault_distance[31]) stbi__init_zdefaults();
-            if (!stbi__zbuild_huffman(&a->z_length  , stbi__zdefault_length  , 288)) return 0;
-            if (!stbi__zbuild_huffman(&a->z_distance, stbi__zdefault_distance,  32)) return 0;
-         } else {
-            if (!stbi__compute_huffman_codes(a)) return 0;
-         }
-         if (!stbi__parse_huffman_block(a)) return 0;
-      }
-   } while (!final);
-   return 1;
+	if (!X) return;
+
+	for (int l=0; l < X->nheld; ++l)
+		ASE_FREE(X->held[l].data);
+	ASE_FREE(X->held);
+	ASE_FREE(X->offsets);
+	ASE_FREE(X->meta);
+
+	ASE_free(&X->sprite);
+	ASE_FREE(X->ctx.scratch);
+#ifndef ASE_NO_STDIO
+	if (X->owned) fclose(X->owned);
+#endif
+	ASE_FREE(X);
 }
 
-static int stbi__do_zlib(stbi__zbuf *a, char *obuf, int olen, int exp, int parse_header)
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - batch loading
+//
+#ifndef ASE_NO_STDIO
+
+#define ASE_BATCH_MAX_THREADS 64
+
+typedef struct {
+	const char  ** filenames;
+	ASE_Sprite   * out;
+	ASE_BOOL     * ok;
+	int            count;
+	volatile long  next;    // next file to hand out (our own threads only)
+	volatile long  loaded;
+	ASE_Decoder  * workers; // one per worker
+} ASE__batch;
+
+static void ASE__batch_task(void *task, int index, int worker)
 {
-   a->zout_start = obuf;
-   a->zout       = obuf;
-   a->zout_end   = obuf + olen;
-   a->z_expandable = exp;
+	ASE__batch *B = (ASE__batch *)task;
+	ASE_Sprite *S = B->out + index;
 
-   return stbi__parse_zlib(a, parse_header);
+	memset(S, 0, sizeof(ASE_Sprite));
+	ASE_BOOL R = ASE_decoder_load(B->workers + worker, B->filenames[index], S);
+
+	if (B->ok) B->ok[index] = R;
+	if (R) ASE__atomic_inc(&B->loaded);
 }
 
-STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen)
+static ASE_BOOL ASE__batch_begin(ASE__batch *B, const char **filenames, ASE_Sprite *out,
+                                 ASE_BOOL *ok, int count, int workers)
 {
-   stbi__zbuf a;
-   char *p = (char *) stbi__malloc(initial_size);
-   if (p == NULL) return NULL;
-   a.zbuffer = (stbi_uc *) buffer;
-   a.zbuffer_end = (stbi_uc *) buffer + len;
-   if (stbi__do_zlib(&a, p, initial_size, 1, 1)) {
-      if (outlen) *outlen = (int) (a.zout - a.zout_start);
-      return a.zout_start;
-   } else {
-      STBI_FREE(a.zout_start);
-      return NULL;
-   }
+	memset(B, 0, sizeof(ASE__batch));
+	B->filenames = filenames;
+	B->out       = out;
+	B->ok        = ok;
+	B->count     = count;
+	B->workers   = (ASE_Decoder *)ASE_MALLOC(workers * sizeof(ASE_Decoder));
+	if (!B->workers) return(0);
+	memset(B->workers, 0, workers * sizeof(ASE_Decoder));
+	ASE__zlib_warm();
+	return(1);
 }
 
-STBIDEF char *stbi_zlib_decode_malloc(char const *buffer, int len, int *outlen)
+static int ASE__batch_end(ASE__batch *B, int workers)
 {
-   return stbi_zlib_decode_malloc_guesssize(buffer, len, 16384, outlen);
+	for (int i=0; i < workers; ++i) ASE_decoder_trim(B->workers + i);
+	ASE_FREE(B->workers);
+	return((int)B->loaded);
 }
 
-STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, int len, int initial_size, int *outlen, int parse_header)
+typedef struct {
+	ASE__batch *batch;
+	int         worker;
+} ASE__batch_worker;
+
+ASE__THREAD_PROC(ASE__batch_thread, Arg)
 {
-   stbi__zbuf a;
-   char *p = (char *) stbi__malloc(initial_size);
-   if (p == NULL) return NULL;
-   a.zbuffer = (stbi_uc *) buffer;
-   a.zbuffer_end = (stbi_uc *) buffer + len;
-   if (stbi__do_zlib(&a, p, initial_size, 1, parse_header)) {
-      if (outlen) *outlen = (int) (a.zout - a.zout_start);
-      return a.zout_start;
-   } else {
-      STBI_FREE(a.zout_start);
-      return NULL;
-   }
+	ASE__batch_worker *W = (ASE__batch_worker *)Arg;
+	long i;
+	while ((i = ASE__atomic_inc(&W->batch->next)) < W->batch->count)
+		ASE__batch_task(W->batch, (int)i, W->worker);
+	return(0);
 }
 
-STBIDEF int stbi_zlib_decode_buffer(char *obuffer, int olen, char const *ibuffer, int ilen)
+ASE_DECL int
+ASE_load_batch (const char **filenames, ASE_Sprite *out, ASE_BOOL *ok, int count, int threads)
 {
-   stbi__zbuf a;
-   a.zbuffer = (stbi_uc *) ibuffer;
-   a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
-   if (stbi__do_zlib(&a, obuffer, olen, 0, 1))
-      return (int) (a.zout - a.zout_start);
-   else
-      return -1;
+	ASE_ASSERT(filenames && out, "invalid arg");
+	if (count <= 0) return(0);
+	if (threads <= 0) threads = ASE__cpu_count();
+	if (threads > count) threads = count;
+	if (threads > ASE_BATCH_MAX_THREADS) threads = ASE_BATCH_MAX_THREADS;
+
+	ASE__batch B;
+	if (!ASE__batch_begin(&B, filenames, out, ok, count, threads)) return(0);
+
+	ASE__batch_worker W[ASE_BATCH_MAX_THREADS];
+	ASE__thread       T[ASE_BATCH_MAX_THREADS];
+	int Started = 1;
+	for (int i=0; i < threads; ++i) {
+		W[i].batch  = &B;
+		W[i].worker = i;
+	}
+	for (; Started < threads; ++Started) {
+		if (!ASE__thread_start(T + Started, ASE__batch_thread, W + Started)) break;
+	}
+
+	ASE__batch_thread(W); // this thread is worker 0
+	for (int i=1; i < Started; ++i) ASE__thread_join(T[i]);
+
+	return(ASE__batch_end(&B, threads));
 }
 
-STBIDEF char *stbi_zlib_decode_noheader_malloc(char const *buffer, int len, int *outlen)
+ASE_DECL int
+ASE_load_batch_dispatch (const char **filenames, ASE_Sprite *out, ASE_BOOL *ok, int count,
+                         ASE_Dispatch dispatch, void *user, int workers)
 {
-   stbi__zbuf a;
-   char *p = (char *) stbi__malloc(16384);
-   if (p == NULL) return NULL;
-   a.zbuffer = (stbi_uc *) buffer;
-   a.zbuffer_end = (stbi_uc *) buffer+len;
-   if (stbi__do_zlib(&a, p, 16384, 1, 0)) {
-      if (outlen) *outlen = (int) (a.zout - a.zout_start);
-      return a.zout_start;
-   } else {
-      STBI_FREE(a.zout_start);
-      return NULL;
-   }
+	ASE_ASSERT(filenames && out && dispatch && workers > 0, "invalid arg");
+	if (count <= 0) return(0);
+
+	ASE__batch B;
+	if (!ASE__batch_begin(&B, filenames, out, ok, count, workers)) return(0);
+	dispatch(user, ASE__batch_task, &B, count);
+	return(ASE__batch_end(&B, workers));
 }
 
-STBIDEF int stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char *ibuffer, int ilen)
+#endif // !ASE_NO_STDIO
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - batch loading with io_uring
+//
+#if defined(ASE_IO_URING) && defined(__linux__) && !defined(ASE_NO_STDIO)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// strict -std=c99 hides these
+#if defined(__GLIBC__) && !defined(__USE_MISC)
+extern long syscall(long number, ...);
+#endif
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+#ifndef ASE_URING_DEPTH
+#define ASE_URING_DEPTH     64                 // reads in flight
+#endif
+#ifndef ASE_URING_CHUNK
+#define ASE_URING_CHUNK     (256 * 1024)       // bytes per read
+#endif
+#ifndef ASE_URING_WINDOW
+#define ASE_URING_WINDOW    (32 * 1024 * 1024) // bytes read ahead of the decoders (x2)
+#endif
+#define ASE_URING_MAX_FILES 256                // open files per window
+
+// the raw ring, no liburing
+typedef struct {
+	int                   fd;
+	unsigned            * sq_head;
+	unsigned            * sq_tail;
+	unsigned            * sq_mask;
+	unsigned            * sq_array;
+	unsigned            * cq_head;
+	unsigned            * cq_tail;
+	unsigned            * cq_mask;
+	struct io_uring_sqe * sqes;
+	struct io_uring_cqe * cqes;
+	unsigned              queued; // not handed to the kernel yet
+
+	void                * sq_map;
+	void                * cq_map;
+	size_t                sq_map_size;
+	size_t                cq_map_size;
+	size_t                sqes_size;
+} ASE__uring;
+
+static void ASE__uring_free(ASE__uring *R)
 {
-   stbi__zbuf a;
-   a.zbuffer = (stbi_uc *) ibuffer;
-   a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
-   if (stbi__do_zlib(&a, obuffer, olen, 0, 0))
-      return (int) (a.zout - a.zout_start);
-   else
-      return -1;
+	if (R->sqes   && (void *)R->sqes != MAP_FAILED) munmap(R->sqes, R->sqes_size);
+	if (R->cq_map && R->cq_map != MAP_FAILED)       munmap(R->cq_map, R->cq_map_size);
+	if (R->sq_map && R->sq_map != MAP_FAILED)       munmap(R->sq_map, R->sq_map_size);
+	if (R->fd >= 0) close(R->fd);
+	memset(R, 0, sizeof(ASE__uring));
+	R->fd = -1;
+}
+
+static ASE_BOOL ASE__uring_init(ASE__uring *R, unsigned Entries)
+{
+	struct io_uring_params Params;
+	memset(R, 0, sizeof(ASE__uring));
+	memset(&Params, 0, sizeof(Params));
+
+	R->fd = (int)syscall(__NR_io_uring_setup, Entries, &Params);
+	if (R->fd < 0) return(0);
+
+	R->sq_map_size = Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+	R->cq_map_size = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+	R->sqes_size   = Params.sq_entries * sizeof(struct io_uring_sqe);
+
+	R->sq_map = mmap(0, R->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                 R->fd, IORING_OFF_SQ_RING);
+	R->cq_map = mmap(0, R->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                 R->fd, IORING_OFF_CQ_RING);
+	R->sqes   = (struct io_uring_sqe *)mmap(0, R->sqes_size, PROT_READ | PROT_WRITE,
+	                 MAP_SHARED | MAP_POPULATE, R->fd, IORING_OFF_SQES);
+	if (R->sq_map == MAP_FAILED || R->cq_map == MAP_FAILED || (void *)R->sqes == MAP_FAILED) {
+		ASE__uring_free(R);
+		return(0);
+	}
+
+	uint8_t *Sq = (uint8_t *)R->sq_map;
+	uint8_t *Cq = (uint8_t *)R->cq_map;
+	R->sq_head  = (unsigned *)(Sq + Params.sq_off.head);
+	R->sq_tail  = (unsigned *)(Sq + Params.sq_off.tail);
+	R->sq_mask  = (unsigned *)(Sq + Params.sq_off.ring_mask);
+	R->sq_array = (unsigned *)(Sq + Params.sq_off.array);
+	R->cq_head  = (unsigned *)(Cq + Params.cq_off.head);
+	R->cq_tail  = (unsigned *)(Cq + Params.cq_off.tail);
+	R->cq_mask  = (unsigned *)(Cq + Params.cq_off.ring_mask);
+	R->cqes     = (struct io_uring_cqe *)(Cq + Params.cq_off.cqes);
+	return(1);
+}
+
+// next submission entry, zeroed; 0 if the ring is full. there's no SQPOLL
+// thread, so the kernel won't look at it before ASE__uring_enter
+static struct io_uring_sqe *ASE__uring_sqe(ASE__uring *R)
+{
+	unsigned Head = __atomic_load_n(R->sq_head, __ATOMIC_ACQUIRE);
+	unsigned Tail = *R->sq_tail;
+	if (Tail - Head > *R->sq_mask) return(0);
+
+	unsigned Index = Tail & *R->sq_mask;
+	struct io_uring_sqe *E = R->sqes + Index;
+	memset(E, 0, sizeof(struct io_uring_sqe));
+	R->sq_array[Index] = Index;
+	__atomic_store_n(R->sq_tail, Tail + 1, __ATOMIC_RELEASE);
+	++R->queued;
+	return(E);
+}
+
+// submits what's queued and waits for at least 'Wait' completions
+static ASE_BOOL ASE__uring_enter(ASE__uring *R, unsigned Wait)
+{
+	for (;;) {
+		long N = syscall(__NR_io_uring_enter, R->fd, R->queued, Wait,
+		                 Wait ? IORING_ENTER_GETEVENTS : 0, (void *)0, (size_t)0);
+		if (N >= 0) {
+			R->queued -= (unsigned)N;
+			return(1);
+		}
+		if (errno != EINTR) return(0);
+	}
+}
+
+static struct io_uring_cqe *ASE__uring_cqe(ASE__uring *R)
+{
+	unsigned Head = *R->cq_head;
+	if (Head == __atomic_load_n(R->cq_tail, __ATOMIC_ACQUIRE)) return(0);
+	return(R->cqes + (Head & *R->cq_mask));
+}
+
+static void ASE__uring_cqe_seen(ASE__uring *R)
+{
+	__atomic_store_n(R->cq_head, *R->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// a batch task for a file that's already in memory
+static void ASE__batch_mem_task(ASE__batch *B, int index, int worker, uint8_t *data, int len)
+{
+	ASE_Sprite *S = B->out + index;
+
+	memset(S, 0, sizeof(ASE_Sprite));
+	ASE_BOOL R = ASE_decoder_load_from_memory(B->workers + worker, data, len, S);
+
+	if (B->ok) B->ok[index] = R;
+	if (R) ASE__atomic_inc(&B->loaded);
 }
 
-#endif // !STBI_INCLUDE_STB_IMAGE_H
+typedef struct {
+	int             fd;
+	int             size;
+	int             issued; // bytes asked for
+	int             done;   // bytes that arrived
+	int             window;
+	ASE_BOOL        failed; // not read here; the decoder loads it the usual way
+	uint8_t       * data;   // in its window
+} ASE__uring_file;
 
+typedef struct {
+	int file;
+	int offset;
+	int len;
+} ASE__uring_read;
 
+typedef struct {
+	ASE__batch        batch;
+	ASE__uring        ring;
+	ASE__uring_file * files;
+	uint8_t         * window[2];
+	int               window_cap;
+	ASE_BOOL          fixed;   // the windows are registered buffers
+
+	ASE__uring_read   reads[ASE_URING_DEPTH];
+	int               free_reads[ASE_URING_DEPTH];
+	int               nfree;
+
+	// files are handed to the decoders in order, a window at a time
+	ASE__mutex        lock;
+	ASE__cond         cond;
+	int               ready;   // files below this can be decoded
+	int               next;    // next one to decode
+	int               busy[2]; // files left to decode, per window
+} ASE__uring_batch;
 
-//////////////////////////////////////////////////////////////////////////////
-// cels (compressed)
-//
-ASE_DECL void
-ASE_DOC_read_compressed_rgba(ASE__ctx *F,
-	                         ASE_Cel *Cel,
-							 size_t EndPos)
+typedef struct {
+	ASE__uring_batch * batch;
+	int                worker;
+} ASE__uring_worker;
+
+static void ASE__uring_queue(ASE__uring_batch *U, int Slot)
 {
-	// read compressed data
-	int isize = EndPos - F->io.tell(F->udata);
-	uint8_t *ibuffer = ASE_MALLOC(isize + 16);
-	uint8_t *P = ibuffer;
-	for (int i=0; i < isize; ++i) {
-		*(P++) = ASE__read8(F);
-	}
-	{
-		// alloc uncompressed data
-		int osize = Cel->w * Cel->h * 4;
-		uint8_t *obuffer = ASE_MALLOC(osize);
+	ASE__uring_read *Rd = U->reads + Slot;
+	ASE__uring_file *F  = U->files + Rd->file;
+	struct io_uring_sqe *E = ASE__uring_sqe(&U->ring);
+	ASE_ASSERT(E, "io_uring submission queue overflow");
+
+	E->opcode    = U->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	E->fd        = F->fd;
+	E->off       = (uint64_t)Rd->offset;
+	E->addr      = (uint64_t)(uintptr_t)(F->data + Rd->offset);
+	E->len       = (unsigned)Rd->len;
+	E->buf_index = (uint16_t)F->window;
+	E->user_data = (uint64_t)Slot;
+}
 
-		// decode
-		int Result = stbi_zlib_decode_buffer(
-			(char *)obuffer, osize, (char *)ibuffer, isize);
-		if (-1 == Result) {
-			// failure!
-			ASE_FREE(obuffer);
-			ASE_ERR("ase: failed to load compressed cel!\n");
-		} else {
-			Cel->data = obuffer;
-			ASE_DBG("\t\t--- (LOADED) ---\n");
+// opens the files that fit in window W, starting at First; returns the end
+static int ASE__uring_fill(ASE__uring_batch *U, int First, int W)
+{
+	int Used = 0;
+	int i = First;
+	for (; i < U->batch.count && i - First < ASE_URING_MAX_FILES; ++i) {
+		ASE__uring_file *F = U->files + i;
+		struct stat St;
+		F->window = W;
+		F->fd = open(U->batch.filenames[i], O_RDONLY | O_CLOEXEC);
+		if (F->fd < 0 || fstat(F->fd, &St) || St.st_size > U->window_cap) {
+			if (F->fd >= 0) close(F->fd);
+			F->fd = -1;
+			F->failed = 1;
+			continue;
 		}
+		if (Used + St.st_size > U->window_cap) {
+			close(F->fd);
+			F->fd = -1;
+			break;
+		}
+		F->size = (int)St.st_size;
+		F->data = U->window[W] + Used;
+		Used += F->size;
 	}
-	ASE_FREE(ibuffer);
+	return(i);
 }
 
-ASE_DECL void
-ASE_DOC_read_compressed_grayscale(ASE__ctx *F,
-	                              ASE_Cel *Cel,
-							      size_t EndPos)
+// reads files [First, Last) in chunks, up to ASE_URING_DEPTH at a time
+static ASE_BOOL ASE__uring_read_window(ASE__uring_batch *U, int First, int Last)
 {
-	// read compressed data
-	int isize = EndPos - F->io.tell(F->udata);
-	uint8_t *ibuffer = ASE_MALLOC(isize + 16);
-	uint8_t *P = ibuffer;
-	for (int i=0; i < isize; ++i) {
-		*(P++) = ASE__read8(F);
+	int File = First;
+	int Inflight = 0;
+	for (;;) {
+		while (U->nfree) {
+			while (File < Last && (U->files[File].failed || U->files[File].issued == U->files[File].size))
+				++File;
+			if (File == Last) break;
+
+			ASE__uring_file *F = U->files + File;
+			int Len  = F->size - F->issued;
+			if (Len > ASE_URING_CHUNK) Len = ASE_URING_CHUNK;
+			int Slot = U->free_reads[--U->nfree];
+			U->reads[Slot].file   = File;
+			U->reads[Slot].offset = F->issued;
+			U->reads[Slot].len    = Len;
+			F->issued += Len;
+			ASE__uring_queue(U, Slot);
+			++Inflight;
+		}
+		if (!Inflight) return(1);
+		if (!ASE__uring_enter(&U->ring, 1)) return(0);
+
+		struct io_uring_cqe *E;
+		while ((E = ASE__uring_cqe(&U->ring))) {
+			int Slot = (int)E->user_data;
+			int Res  = E->res;
+			ASE__uring_cqe_seen(&U->ring);
+
+			ASE__uring_read *Rd = U->reads + Slot;
+			ASE__uring_file *F  = U->files + Rd->file;
+			if (Res == -EAGAIN || Res == -EINTR) {
+				ASE__uring_queue(U, Slot);
+				continue;
+			}
+			if (Res > 0) {
+				F->done += Res;
+				if (Res < Rd->len) { // short read, ask for the rest
+					Rd->offset += Res;
+					Rd->len    -= Res;
+					ASE__uring_queue(U, Slot);
+					continue;
+				}
+			} else {
+				F->failed = 1; // error, or the file got shorter
+			}
+			U->free_reads[U->nfree++] = Slot;
+			--Inflight;
+		}
 	}
-	{
-		// alloc uncompressed data
-		int osize = Cel->w * Cel->h * 2;
-		uint8_t *obuffer = ASE_MALLOC(osize);
+}
 
-		// decode
-		int Result = stbi_zlib_decode_buffer(
-			(char *)obuffer, osize, (char *)ibuffer, isize);
-		if (-1 == Result) {
-			// failure!
-			ASE_FREE(obuffer);
-			ASE_ERR("ase: failed to load compressed cel!\n");
-		} else {
-			Cel->data = obuffer;
-			ASE_DBG("\t\t--- (LOADED) ---\n");
+// decodes files as they're read. without 'Wait' it only takes what's ready
+static void ASE__uring_decode(ASE__uring_batch *U, int Worker, ASE_BOOL Wait)
+{
+	for (;;) {
+		ASE__mutex_lock(&U->lock);
+		while (Wait && U->next >= U->ready && U->ready < U->batch.count)
+			ASE__cond_wait(&U->cond, &U->lock);
+		if (U->next >= U->ready) {
+			ASE__mutex_unlock(&U->lock);
+			return;
 		}
+		int i = U->next++;
+		ASE__mutex_unlock(&U->lock);
+
+		ASE__uring_file *F = U->files + i;
+		if (F->failed || F->done != F->size)
+			ASE__batch_task(&U->batch, i, Worker);
+		else
+			ASE__batch_mem_task(&U->batch, i, Worker, F->data, F->size);
+
+		ASE__mutex_lock(&U->lock);
+		--U->busy[F->window];
+		ASE__cond_broadcast(&U->cond);
+		ASE__mutex_unlock(&U->lock);
 	}
-	ASE_FREE(ibuffer);
 }
 
-ASE_DECL void
-ASE_DOC_read_compressed_indexed(ASE__ctx *F,
-	                            ASE_Cel *Cel,
-							    size_t EndPos)
+ASE__THREAD_PROC(ASE__uring_thread, Arg)
 {
-	// read compressed data
-	int isize = EndPos - F->io.tell(F->udata);
-	uint8_t *ibuffer = ASE_MALLOC(isize + 16);
-	uint8_t *P = ibuffer;
-	for (int i=0; i < isize; ++i) {
-		*(P++) = ASE__read8(F);
+	ASE__uring_worker *W = (ASE__uring_worker *)Arg;
+	ASE__uring_decode(W->batch, W->worker, 1);
+	return(0);
+}
+
+ASE_DECL int
+ASE_load_batch_uring (const char **filenames, ASE_Sprite *out, ASE_BOOL *ok, int count, int threads)
+{
+	ASE_ASSERT(filenames && out, "invalid arg");
+	if (count <= 0) return(0);
+	if (threads <= 0) threads = ASE__cpu_count();
+	if (threads > count) threads = count;
+	if (threads > ASE_BATCH_MAX_THREADS) threads = ASE_BATCH_MAX_THREADS;
+
+	ASE__uring_batch *U = (ASE__uring_batch *)ASE_MALLOC(sizeof(ASE__uring_batch));
+	if (!U) return(0);
+	memset(U, 0, sizeof(ASE__uring_batch));
+	if (!ASE__uring_init(&U->ring, ASE_URING_DEPTH)) {
+		ASE_FREE(U);
+		return(ASE_load_batch(filenames, out, ok, count, threads));
 	}
-	{
-		// alloc uncompressed data
-		int osize = Cel->w * Cel->h;
-		uint8_t *obuffer = ASE_MALLOC(osize);
 
-		// decode
-		int Result = stbi_zlib_decode_buffer(
-			(char *)obuffer, osize, (char *)ibuffer, isize);
-		if (-1 == Result) { // failure
-			ASE_FREE(obuffer);
-			ASE_ERR("ase: failed to load compressed cel!\n");
-		} else {
-			Cel->data = obuffer;
-			ASE_DBG("\t\t--- (LOADED) ---\n");
-		}
+	// size the windows to the batch, so small batches don't pin 64MB
+	int64_t Total = 0;
+	for (int i=0; i < count && Total < ASE_URING_WINDOW; ++i) {
+		struct stat St;
+		if (!stat(filenames[i], &St) && St.st_size <= ASE_URING_WINDOW) Total += St.st_size;
+	}
+	U->window_cap = (Total < ASE_URING_WINDOW) ? (int)Total : ASE_URING_WINDOW;
+	if (U->window_cap < 4096) U->window_cap = 4096;
+
+	U->files     = (ASE__uring_file *)ASE_MALLOC(count * sizeof(ASE__uring_file));
+	U->window[0] = (uint8_t *)ASE_MALLOC(U->window_cap);
+	U->window[1] = (uint8_t *)ASE_MALLOC(U->window_cap);
+	if (!U->files || !U->window[0] || !U->window[1] || !ASE__batch_begin(&U->batch, filenames, out, ok, count, threads)) {
+		ASE__uring_free(&U->ring);
+		ASE_FREE(U->files);
+		ASE_FREE(U->window[0]);
+		ASE_FREE(U->window[1]);
+		ASE_FREE(U);
+		return(ASE_load_batch(filenames, out, ok, count, threads));
+	}
+	memset(U->files, 0, count * sizeof(ASE__uring_file));
+
+	// registering pins the windows so the kernel can skip mapping them on
+	// every read. it counts against RLIMIT_MEMLOCK; plain reads work too
+	struct iovec Io[2];
+	Io[0].iov_base = U->window[0];
+	Io[0].iov_len  = U->window_cap;
+	Io[1].iov_base = U->window[1];
+	Io[1].iov_len  = U->window_cap;
+	U->fixed = (0 == syscall(__NR_io_uring_register, U->ring.fd, IORING_REGISTER_BUFFERS, Io, 2));
+
+	U->nfree = ASE_URING_DEPTH;
+	for (int i=0; i < ASE_URING_DEPTH; ++i) U->free_reads[i] = i;
+	ASE__mutex_init(&U->lock);
+	ASE__cond_init(&U->cond);
+
+	ASE__uring_worker W[ASE_BATCH_MAX_THREADS];
+	ASE__thread       T[ASE_BATCH_MAX_THREADS];
+	int Started = 1;
+	for (int i=0; i < threads; ++i) {
+		W[i].batch  = U;
+		W[i].worker = i;
+	}
+	for (; Started < threads; ++Started) {
+		if (!ASE__thread_start(T + Started, ASE__uring_thread, W + Started)) break;
 	}
-	ASE_FREE(ibuffer);
-}
 
+	// this thread reads one window while the decoders work on the other
+	ASE_BOOL Broken = 0;
+	int Win = 0;
+	for (int First = 0; First < count; Win ^= 1) {
+		ASE__mutex_lock(&U->lock);
+		while (U->busy[Win]) ASE__cond_wait(&U->cond, &U->lock);
+		ASE__mutex_unlock(&U->lock);
+
+		int Last = ASE__uring_fill(U, First, Win);
+		if (!Broken) Broken = !ASE__uring_read_window(U, First, Last);
+		for (int i=First; i < Last; ++i) {
+			ASE__uring_file *F = U->files + i;
+			if (Broken && F->done != F->size) F->failed = 1;
+			if (F->fd >= 0) close(F->fd);
+			F->fd = -1;
+		}
 
+		ASE__mutex_lock(&U->lock);
+		U->busy[Win] = Last - First;
+		U->ready     = Last;
+		ASE__cond_broadcast(&U->cond);
+		ASE__mutex_unlock(&U->lock);
 
-ASE_DECL ASE_Cel *
-ASE_Cel_read(ASE__ctx *F,
-	             ASE_Sprite *S,
-				 int frame_index,
-			     ASE_Frame *Frame,
-			     size_t EndPos)
-{
-	ASE_DBG("\t\t--- CEL ---\n");
+		if (1 == Started) ASE__uring_decode(U, 0, 0);
+		First = Last;
+	}
 
-	// HEADER
-	int layer   = ASE__read16(F);
-	int x       = (int16_t)ASE__read16(F);
-	int y       = (int16_t)ASE__read16(F);
-	int opacity = ASE__read8(F);
-	int type    = ASE__read16(F);
-	F->io.skip(F->udata, 7);
+	ASE__uring_decode(U, 0, 1); // this thread is worker 0
+	for (int i=1; i < Started; ++i) ASE__thread_join(T[i]);
 
-	ASE_DBG("\t\tlayer:   %i  (%s)\n", layer, S->layers[layer].name);
-	ASE_DBG("\t\tx:       %i\n", x);
-	ASE_DBG("\t\ty:       %i\n", y);
-	ASE_DBG("\t\topacity: %i\n", opacity);
-	ASE_DBG("\t\ttype:    %i\n", type);
+	ASE__uring_free(&U->ring);
+	int Loaded = ASE__batch_end(&U->batch, threads);
+	ASE_FREE(U->files);
+	ASE_FREE(U->window[0]);
+	ASE_FREE(U->window[1]);
+	ASE_FREE(U);
+	return(Loaded);
+}
 
-	ASE_Layer *L = 0;
-	if (layer >= 0 && layer < S->nlayers) L = S->layers + layer;
-	if (!L) {
-		ASE_ERR("ase: frame %i missing layer %i\n", (int)frame_index, (int)layer);
-		return(0);
-	}
-	if (L->type != ASE_FILE_LAYER_IMAGE) {
-		ASE_ERR("ase: invalid .ase file (frame %i in layer %i which does not contain images)\n", (int)frame_index, (int)layer);
-		return(0);
-	}
+#endif // ASE_IO_URING
 
-	// create new frame
-	ASE_Cel *Cel = ASE_DOC_AddCel(Frame);
-	assert(Cel);
-	Cel->layer = layer;
-	Cel->x = x;
-	Cel->y = y;
-	Cel->opacity = opacity;
 
-	switch (type) {
-	case ASE_FILE_RAW_CEL:
-		{
-			ASE_DBG("\t\t--- RAW ---\n");
 
-			int w = ASE__read16(F);
-			int h = ASE__read16(F);
+//////////////////////////////////////////////////////////////////////////////
+// primary API - async loading
+//
+#define ASE_ASYNC_MAX_THREADS 64
+
+struct ASE_Request {
+	volatile long   cancel;
+	int             status;
+	int             refs;     // the caller and the loader
+	int             taken;
+	ASE_Request   * next;     // queue
+
+	char          * filename; // or
+	const uint8_t * buffer;
+	int             len;
+
+	ASE_Done        done;
+	void          * user;
+	ASE_Sprite      result;
+};
 
-			Cel->w = w;
-			Cel->h = h;
+static struct {
+	volatile long   state;    // 0 stopped, 1 starting, 2 running
+	int             quit;
+	ASE__mutex      lock;
+	ASE__cond       wake;     // work for the loader threads
+	ASE__cond       finished; // a request finished
+	ASE_Request   * head;
+	ASE_Request   * tail;
+	int             nthreads;
+	ASE__thread     threads[ASE_ASYNC_MAX_THREADS];
+	ASE_Submit      submit;
+	void          * submit_user;
+} ASE__async;
+
+// drops a reference; call with the lock held
+static void ASE__request_release(ASE_Request *R)
+{
+	if (--R->refs) return;
+	ASE_free(&R->result);
+	ASE_FREE(R->filename);
+	ASE_FREE(R);
+}
 
-			ASE_DBG("\t\tw: %i\n", w);
-			ASE_DBG("\t\th: %i\n", h);
+static void ASE__async_run(void *Job)
+{
+	ASE_Request *R = (ASE_Request *)Job;
 
-			if (w > 0 && h > 0) {
-				switch (S->depth) {
-					case ASE_DEPTH_RGBA:      // RGBA
-					{
-						ASE_DOC_read_raw_image_rgba(F, Cel);
-					} break;
-					case ASE_DEPTH_GRAYSCALE: // Grayscale
-					{
-						ASE_DOC_read_raw_image_grayscale(F, Cel);
-					} break;
-					case ASE_DEPTH_INDEXED:   // Indexed
-					{
-						ASE_DOC_read_raw_image_indexed(F, Cel);
-					} break;
-				}
-			} else {
-				ASE_DBG("\t\t(cel has no area...?)\n");
-			}
-		} break;
+	ASE__mutex_lock(&ASE__async.lock);
+	int Status = ASE__atomic_get(&R->cancel) ? ASE_REQUEST_CANCELLED : ASE_REQUEST_RUNNING;
+	R->status = Status;
+	ASE__mutex_unlock(&ASE__async.lock);
 
-	case ASE_FILE_LINK_CEL:
+	if (ASE_REQUEST_RUNNING == Status) {
+		ASE__ctx Context = {0};
+		ASE_BOOL Ok = 0;
+#ifndef ASE_NO_STDIO
+		if (R->filename) {
+			FILE *F = fopen(R->filename, "rb");
+			if (F) {
+				ASE__start_file(&Context, F);
+				Context.cancel = &R->cancel;
+				Ok = ASE__decode_main(&Context, &R->result);
+				fclose(F);
+			}
+		} else
+#endif
 		{
-			ASE_DBG("\t\t--- LINKED ---\n");
+			ASE__start_mem(&Context, (uint8_t *)R->buffer, R->len);
+			Context.cancel = &R->cancel;
+			Ok = ASE__decode_main(&Context, &R->result);
+		}
+		ASE_FREE(Context.scratch);
+		if (ASE__atomic_get(&R->cancel)) Status = ASE_REQUEST_CANCELLED;
+		else if (Ok)                   Status = ASE_REQUEST_DONE;
+		else                           Status = ASE_REQUEST_FAILED;
+		if (ASE_REQUEST_DONE != Status) ASE_free(&R->result);
+	}
 
-			/*
-			NOTE:
-				We are ignoring the edge case of the beta version
-				with silly link attributes :)
-				We are also assuming that a link is found.
-			*/
+	if (R->done) R->done(R, &R->result, Status, R->user);
 
-			int frame = ASE__read16(F);
+	ASE__mutex_lock(&ASE__async.lock);
+	R->status = Status;
+	ASE__cond_broadcast(&ASE__async.finished);
+	ASE__request_release(R);
+	ASE__mutex_unlock(&ASE__async.lock);
+}
 
-			Cel->is_linked = 1;
-			Cel->frame = frame;
+ASE__THREAD_PROC(ASE__async_thread, Arg)
+{
+	(void)Arg;
+	for (;;) {
+		ASE__mutex_lock(&ASE__async.lock);
+		while (!ASE__async.head && !ASE__async.quit)
+			ASE__cond_wait(&ASE__async.wake, &ASE__async.lock);
+		ASE_Request *R = ASE__async.head;
+		if (R) {
+			ASE__async.head = R->next;
+			if (!ASE__async.head) ASE__async.tail = 0;
+		}
+		ASE__mutex_unlock(&ASE__async.lock);
 
-			ASE_DBG("\t\tframe: %i\n", frame);
-		} break;
+		if (!R) break; // quit, and the queue is empty
+		ASE__async_run(R);
+	}
+	return(0);
+}
 
-	case ASE_FILE_COMPRESSED_CEL:
-		{
-			ASE_DBG("\t\t--- COMPRESSED ---\n");
+ASE_DECL ASE_BOOL
+ASE_async_init (int threads, ASE_Submit submit, void *user)
+{
+#ifdef ASE_NO_THREADS
+	// the lock and wake-ups are no-ops, so a request finishing on another
+	// thread couldn't tell a ASE_request_wait
+	if (submit) {
+		ASE_ERR("ASE_NO_THREADS can't take an executor\n");
+		return(0);
+	}
+#endif
+	// the first caller starts it, anyone racing it waits until it has
+	if (ASE__atomic_cas(&ASE__async.state, 0, 1)) {
+		while (2 != ASE__atomic_get(&ASE__async.state)) ASE__thread_yield();
+		return(1);
+	}
+	ASE__zlib_warm(); // so the loaders never race to build the tables
+	ASE__mutex_init(&ASE__async.lock);
+	ASE__cond_init(&ASE__async.wake);
+	ASE__cond_init(&ASE__async.finished);
+	ASE__async.quit        = 0;
+	ASE__async.head        = ASE__async.tail = 0;
+	ASE__async.submit      = submit;
+	ASE__async.submit_user = user;
+	ASE__async.nthreads    = 0;
+
+	if (!submit) {
+		if (threads <= 0) threads = ASE__cpu_count();
+		if (threads > ASE_ASYNC_MAX_THREADS) threads = ASE_ASYNC_MAX_THREADS;
+		for (int i=0; i < threads; ++i) {
+			if (!ASE__thread_start(ASE__async.threads + i, ASE__async_thread, 0)) break;
+			++ASE__async.nthreads;
+		}
+	}
+	ASE__atomic_inc(&ASE__async.state); // running
+	return(1);
+}
 
-			// WORD      Width in pixels
-		  	// WORD      Height in pixels
-		  	// BYTE[]    "Raw Cel" data compressed with ZLIB method
+ASE_DECL void
+ASE_async_shutdown (void)
+{
+	if (2 != ASE__atomic_get(&ASE__async.state)) return;
 
-			int w = ASE__read16(F);
-			int h = ASE__read16(F);
+	ASE__mutex_lock(&ASE__async.lock);
+	for (ASE_Request *R = ASE__async.head; R; R = R->next) ASE__atomic_inc(&R->cancel);
+	ASE__async.quit = 1;
+	ASE__cond_broadcast(&ASE__async.wake);
+	ASE__mutex_unlock(&ASE__async.lock);
 
-			Cel->w = w;
-			Cel->h = h;
+	for (int i=0; i < ASE__async.nthreads; ++i) ASE__thread_join(ASE__async.threads[i]);
+	ASE__async.nthreads = 0;
+	ASE__atomic_cas(&ASE__async.state, 2, 0);
+}
 
-			ASE_DBG("\t\tw: %i\n", w);
-			ASE_DBG("\t\th: %i\n", h);
+static ASE_Request *ASE__request_submit(ASE_Request *R)
+{
+	if (2 != ASE__atomic_get(&ASE__async.state)) ASE_async_init(0, 0, 0);
+
+	R->refs   = 2;
+	R->status = ASE_REQUEST_PENDING;
+	if (ASE__async.submit) {
+		ASE__async.submit(ASE__async.submit_user, ASE__async_run, R);
+	} else if (!ASE__async.nthreads) {
+		ASE__async_run(R); // no threads to be had: load it now
+	} else {
+		ASE__mutex_lock(&ASE__async.lock);
+		if (ASE__async.tail) ASE__async.tail->next = R;
+		else               ASE__async.head = R;
+		ASE__async.tail = R;
+		ASE__cond_broadcast(&ASE__async.wake);
+		ASE__mutex_unlock(&ASE__async.lock);
+	}
+	return(R);
+}
 
-			// he uses C++ exceptions in his decoder... hoo boy.
-			// i think we'll be fine. things are set up such that
-			// you will just get an empty cel if loading fails.
+static ASE_Request *ASE__request_alloc(ASE_Done done, void *user)
+{
+	ASE_Request *R = (ASE_Request *)ASE_MALLOC(sizeof(ASE_Request));
+	if (!R) return(0);
+	memset(R, 0, sizeof(ASE_Request));
+	R->done = done;
+	R->user = user;
+	return(R);
+}
 
-			if (w > 0 && h > 0) {
-				switch (S->depth) {
-					case ASE_DEPTH_RGBA:      // RGBA
-					{
-						ASE_DOC_read_compressed_rgba(F, Cel, EndPos);
-					} break;
-					case ASE_DEPTH_GRAYSCALE: // Grayscale
-					{
-						ASE_DOC_read_compressed_grayscale(F, Cel, EndPos);
-					} break;
-					case ASE_DEPTH_INDEXED:   // Indexed
-					{
-						ASE_DOC_read_compressed_indexed(F, Cel, EndPos);
-					} break;
-				}
-			} else {
-				ASE_DBG("\t\t(cel has no area...?)\n");
-			}
-		} break;
+#ifndef ASE_NO_STDIO
+ASE_DECL ASE_Request *
+ASE_load_async (const char *filename, ASE_Done done, void *user)
+{
+	ASE_ASSERT(filename, "invalid arg");
+	ASE_Request *R = ASE__request_alloc(done, user);
+	if (!R) return(0);
+
+	size_t Len = strlen(filename);
+	R->filename = (char *)ASE_MALLOC(Len + 1);
+	if (!R->filename) {
+		ASE_FREE(R);
+		return(0);
 	}
+	memcpy(R->filename, filename, Len + 1);
+	return(ASE__request_submit(R));
+}
+#endif
 
-	if (!Cel) return(0);
+ASE_DECL ASE_Request *
+ASE_load_from_memory_async (const uint8_t *buffer, int len, ASE_Done done, void *user)
+{
+	ASE_ASSERT(buffer, "invalid arg");
+	ASE_Request *R = ASE__request_alloc(done, user);
+	if (!R) return(0);
+	R->buffer = buffer;
+	R->len    = len;
+	return(ASE__request_submit(R));
+}
 
-	return(Cel);
+ASE_DECL int
+ASE_request_status (ASE_Request *R)
+{
+	ASE__mutex_lock(&ASE__async.lock);
+	int Status = R->status;
+	ASE__mutex_unlock(&ASE__async.lock);
+	return(Status);
 }
 
+ASE_DECL int
+ASE_request_wait (ASE_Request *R)
+{
+	ASE__mutex_lock(&ASE__async.lock);
+	while (R->status < ASE_REQUEST_DONE)
+		ASE__cond_wait(&ASE__async.finished, &ASE__async.lock);
+	int Status = R->status;
+	ASE__mutex_unlock(&ASE__async.lock);
+	return(Status);
+}
 
+ASE_DECL void
+ASE_request_cancel (ASE_Request *R)
+{
+	ASE__atomic_inc(&R->cancel);
+}
 
-//////////////////////////////////////////////////////////////////////////////
-// frame tags
-//
-ASE_DECL ASE_Tag *
-ASE_DOC_AddTag(ASE_Sprite *S)
+ASE_DECL ASE_BOOL
+ASE_request_take (ASE_Request *R, ASE_Sprite *out)
 {
-	S->tags = ASE_REALLOC(S->tags, ++S->ntags * sizeof(ASE_Tag));
-	ASE_Tag *L = S->tags + (S->ntags - 1);
-	memset(L, 0, sizeof(ASE_Tag));
-	ASE_DBG("\t\ttag index: %i\n", (int)S->ntags-1);
-	return(L);
+	ASE_BOOL Ok = 0;
+	ASE__mutex_lock(&ASE__async.lock);
+	if (ASE_REQUEST_DONE == R->status && !R->taken) {
+		*out = R->result;
+		memset(&R->result, 0, sizeof(ASE_Sprite));
+		R->taken = 1;
+		Ok = 1;
+	}
+	ASE__mutex_unlock(&ASE__async.lock);
+	return(Ok);
 }
 
 ASE_DECL void
-ASE_Tags_read(ASE__ctx *F, ASE_Sprite *S)
+ASE_request_free (ASE_Request *R)
 {
-	ASE_DBG("\t--- FRAME TAGS ---\n");
+	if (!R) return;
+	ASE__atomic_inc(&R->cancel);
+	ASE__mutex_lock(&ASE__async.lock);
+	ASE__request_release(R);
+	ASE__mutex_unlock(&ASE__async.lock);
+}
 
-	size_t count = ASE__read16(F);
 
-	ASE__read32(F); // 8 reserved bytes
-	ASE__read32(F);
 
-	for (size_t i=0; i<count; ++i) {
-		ASE_DBG("\t\t--- TAG (%i) ---\n", i);
+//////////////////////////////////////////////////////////////////////////////
+// primary API - hot reload
+//
+#ifdef ASE__WATCHING
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+struct ASE__watched {
+	ASE__watched * next;
+	ASE_Sprite   * sprite;  // what ASE_load filled
+	char         * path;
+	const char   * name;    // the part of path after the directory
+	int            wd;      // the directory's inotify watch
+	int            dirty;   // written since the thread last looked
+	int            busy;    // being decoded on the thread
+	int            dropped; // unwatched while busy; the thread frees it
+	int            swaps;   // times ASE_watch_poll swapped it
+
+	// hashes of the header and every frame of what 'sprite' holds
+	int            nprint;
+	uint64_t     * print;
+
+	// a finished reload, for ASE_watch_poll
+	int            ready;
+	ASE_Sprite     next_sprite;
+	int          * next_reuse; // per frame: take the cels from 'sprite'
+	int            next_nprint;
+	uint64_t     * next_print;
+};
 
-		int From = ASE__read16(F);
-		int To   = ASE__read16(F);
-		int AnimDirection = ASE__read8(F);
+static uint64_t ASE__hash_bytes(const uint8_t *P, size_t N)
+{
+	uint64_t H = 0xcbf29ce484222325ull ^ N;
+	for (; N >= 8; P += 8, N -= 8) {
+		uint64_t V;
+		memcpy(&V, P, 8);
+		H  = (H ^ V) * 0x100000001b3ull;
+		H ^= H >> 29;
+	}
+	for (; N; ++P, --N) H = (H ^ *P) * 0x100000001b3ull;
+	return(H);
+}
 
-		if (ASE_LOOP_FORWARD != AnimDirection &&
-		    ASE_LOOP_REVERSE != AnimDirection &&
-			ASE_LOOP_PINGPONG != AnimDirection)
-		{
-			AnimDirection = ASE_LOOP_FORWARD;
+// hashes the header, leaving out the file size and frame count, then every
+// frame by the size in its header. returns how many, or 0 if it doesn't
+// look like an .ase file
+static int ASE__watch_print(const uint8_t *Buf, size_t Len, uint64_t **Out)
+{
+	*Out = 0;
+	if (Len < 128 || ((Buf[5] << 8) | Buf[4]) != ASE_FILE_MAGIC) return(0);
+
+	int       N = (Buf[7] << 8) | Buf[6];
+	uint64_t *P = (uint64_t *)ASE_MALLOC((N + 1) * sizeof(uint64_t));
+	if (!P) return(0);
+	P[0] = ASE__hash_bytes(Buf + 8, 120);
+
+	size_t Pos = 128;
+	for (int i=0; i < N; ++i) {
+		const uint8_t *H = Buf + Pos;
+		uint32_t Size  = (Len - Pos >= 16) ? (H[0] | (H[1] << 8) | (H[2] << 16) | ((uint32_t)H[3] << 24)) : 0;
+		int      Magic = (Len - Pos >= 16) ? (H[4] | (H[5] << 8)) : 0;
+		if (Magic != ASE_FILE_FRAME_MAGIC || Size < 16 || Size > Len - Pos) {
+			ASE_FREE(P);
+			return(0);
 		}
+		P[i + 1] = ASE__hash_bytes(H, Size);
+		Pos += Size;
+	}
+	*Out = P;
+	return(N + 1);
+}
 
-		ASE__read32(F); // 8 reserved bytes
-		ASE__read32(F);
+static uint8_t *ASE__watch_read(const char *Path, size_t *Len)
+{
+	FILE *F = fopen(Path, "rb");
+	if (!F) return(0);
+
+	uint8_t *Buf = 0;
+	long     N   = (0 == fseek(F, 0, SEEK_END)) ? ftell(F) : -1;
+	if (N > 0 && 0 == fseek(F, 0, SEEK_SET)) Buf = (uint8_t *)ASE_MALLOC(N);
+	if (Buf && fread(Buf, 1, N, F) != (size_t)N) {
+		ASE_FREE(Buf);
+		Buf = 0;
+	}
+	fclose(F);
+	*Len = (N > 0) ? (size_t)N : 0;
+	return(Buf);
+}
 
-		F->io.skip(F->udata, 4); // skip tag color
+static void ASE__watched_free(ASE__watched *W)
+{
+	ASE_free(&W->next_sprite);
+	ASE_FREE(W->next_reuse);
+	ASE_FREE(W->next_print);
+	ASE_FREE(W->print);
+	ASE_FREE(W->path);
+	ASE_FREE(W);
+}
 
-		char *Name = ASE_DOC_read_string(F);
+// removes the directory's watch once no watched file uses it; call with the
+// lock held. inotify gives each directory one wd, so files in it share it
+static void ASE__watch_release(int wd)
+{
+	for (ASE__watched *W = ASE__watch.head; W; W = W->next)
+		if (W->wd == wd) return;
+	inotify_rm_watch(ASE__watch.fd, wd);
+}
 
-		ASE_DBG("\t\tfrom: %i\n", From);
-		ASE_DBG("\t\tto:   %i\n", To);
-		ASE_DBG("\t\tdir:  %i\n", AnimDirection);
-		ASE_DBG("\t\tname: %s\n", Name);
+static void ASE__watch_drop(ASE_Sprite *S)
+{
+	if (!ASE__watch.started) return;
+
+	ASE__watched *Gone = 0;
+	ASE__mutex_lock(&ASE__watch.lock);
+	for (ASE__watched **P = &ASE__watch.head; *P; ) {
+		ASE__watched *W = *P;
+		if (W->sprite != S) {
+			P = &W->next;
+			continue;
+		}
+		*P = W->next;
+		ASE__watch_release(W->wd);
+		if (W->busy) {
+			W->dropped = 1;
+		} else {
+			W->next = Gone;
+			Gone    = W;
+		}
+	}
+	ASE__mutex_unlock(&ASE__watch.lock);
 
-		// allocate the tag
-		ASE_Tag *Tag = ASE_DOC_AddTag(S);
-		Tag->from = From;
-		Tag->to   = To;
-		Tag->dir  = AnimDirection;
-		Tag->name = Name;
+	// freeing sprites takes the lock again
+	while (Gone) {
+		ASE__watched *Next = Gone->next;
+		ASE__watched_free(Gone);
+		Gone = Next;
 	}
 }
 
-
-
-//////////////////////////////////////////////////////////////////////////////
-// decoder main
-//
-ASE_DECL ASE_BOOL
-ASE__decode_main(ASE__ctx *F, ASE_Sprite *S)
+static void ASE__watch_add(const char *Path, ASE_Sprite *S, const uint8_t *Buf, size_t Len)
 {
-	ASE_BOOL R = 1;
-
-	// LOAD FILE HEADER
-	ASE_DOC_Header Header = {0};
-	ASE_BOOL Ok = ASE_DOC_Header_read(F, &Header);
-	assert(Ok && "couldn't read the header!");
+	ASE__watch_drop(S);
 
-	// COPY TO SPRITE
-	S->width = Header.width;
-	S->height = Header.height;
-	S->depth = Header.depth;
+	ASE__watched *W = (ASE__watched *)ASE_MALLOC(sizeof(ASE__watched));
+	if (!W) return;
+	memset(W, 0, sizeof(ASE__watched));
 
-	ASE_DBG("--- aseprite document ---\n");
-	ASE_DBG("frames:  %i\n", (int)Header.frames);
-	ASE_DBG("width:   %i\n", (int)Header.width);
-	ASE_DBG("height:  %i\n", (int)Header.height);
-	ASE_DBG("depth:   %i\n", (int)Header.depth);
-	ASE_DBG("ncolors: %i\n", (int)Header.ncolors);
-	ASE_DBG("tcolor:  %i\n", (int)Header.transparent_index);
+	size_t N = strlen(Path);
+	W->path = (char *)ASE_MALLOC(N + 1);
+	if (!W->path) {
+		ASE__watched_free(W);
+		return;
+	}
+	memcpy(W->path, Path, N + 1);
+	W->sprite = S;
+	W->nprint = ASE__watch_print(Buf, Len, &W->print);
+
+	// editors save by renaming over the file, so watch the directory. the
+	// lock keeps a drop from removing a shared watch before W is listed
+	ASE__mutex_lock(&ASE__watch.lock);
+	char *Slash = strrchr(W->path, '/');
+	if (Slash) {
+		*Slash  = 0;
+		W->wd   = inotify_add_watch(ASE__watch.fd, (Slash == W->path) ? "/" : W->path, IN_CLOSE_WRITE | IN_MOVED_TO);
+		*Slash  = '/';
+		W->name = Slash + 1;
+	} else {
+		W->wd   = inotify_add_watch(ASE__watch.fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO);
+		W->name = W->path;
+	}
+	if (W->wd >= 0) {
+		W->next = ASE__watch.head;
+		ASE__watch.head = W;
+	}
+	ASE__mutex_unlock(&ASE__watch.lock);
 
+	if (W->wd < 0) {
+		ASE_ERR("ase: can't watch %s\n", Path);
+		ASE__watched_free(W);
+	}
+}
 
-	ASE_Layer * LastLayer = 0;
-	void * LastWithUserData = 0;
-	void * LastCel = 0;
-	int   CurrentLevel = -1; // root
+// the file and the hashes come from the same read, so a save in between
+// can't slip past
+static ASE_BOOL ASE__watch_load(const char *filename, ASE_Sprite *out)
+{
+	size_t   Len = 0;
+	uint8_t *Buf = ASE__watch_read(filename, &Len);
+	if (!Buf) {
+		ASE_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	ASE_BOOL R = ASE_load_from_memory(Buf, (int)Len, out);
+	if (R) ASE__watch_add(filename, out, Buf, Len);
+	ASE_FREE(Buf);
+	return(R);
+}
 
-	ASE_BOOL IgnoreOldColorChunks = 0;
+// decodes the frames whose hashes differ from Old; Reuse marks the others,
+// which keep the cels of the sprite Old was taken from
+static ASE_BOOL ASE__watch_decode(const uint8_t *Buf, size_t Len,
+                                  const uint64_t *Old, int NOld,
+                                  const uint64_t *New, ASE_Sprite *S, int **Reuse)
+{
+	ASE_Index *X = ASE_index_open_memory(Buf, (int)Len);
+	if (!X) return(0);
 
+	int N = X->sprite.nframes;
+	*Reuse = (int *)ASE_MALLOC((N ? N : 1) * sizeof(int));
+	if (!*Reuse) {
+		ASE_index_close(X);
+		return(0);
+	}
 
-	// LOOP OVER FRAMES
-	for (int i=0; i < Header.frames; ++i) {
-		size_t FrameHeaderStart = F->io.tell(F->udata);
+	ASE_BOOL SameHeader = (NOld && Old[0] == New[0]);
+	for (int i=0; i < N; ++i) {
+		(*Reuse)[i] = SameHeader && i + 1 < NOld && Old[i + 1] == New[i + 1];
+		if (!(*Reuse)[i]) ASE_decode_frame(X, i, X->sprite.frames + i);
+	}
 
-		// LOAD FRAME HEADER
-		ASE_FrameHeader FrameHeader = {0};
-		ASE_FrameHeader_read(F, &FrameHeader);
-		assert(FrameHeader.magic == ASE_FILE_FRAME_MAGIC);
+	*S = X->sprite;
+	memset(&X->sprite, 0, sizeof(ASE_Sprite));
+	ASE_index_close(X);
+	return(1);
+}
 
-		ASE_DBG("--- frame header (%i) ---\n", i);
-		ASE_DBG("size:      %i\n", (int)FrameHeader.size);
-		ASE_DBG("chunks:    %i\n", (int)FrameHeader.chunks);
-		ASE_DBG("duration:  %i\n", (int)FrameHeader.duration);
+// reloads every file that's been written, one at a time
+static void ASE__watch_reload(void)
+{
+	while (!ASE__atomic_get(&ASE__watch.quit)) {
+		ASE__mutex_lock(&ASE__watch.lock);
+		ASE__watched *W = ASE__watch.head;
+		while (W && !W->dirty) W = W->next;
+		if (!W) {
+			ASE__mutex_unlock(&ASE__watch.lock);
+			return;
+		}
+		W->dirty = 0;
+		W->busy  = 1;
+		int       Swaps = W->swaps;
+		int       NOld  = W->nprint;
+		uint64_t *Old   = NOld ? (uint64_t *)ASE_MALLOC(NOld * sizeof(uint64_t)) : 0;
+		if (Old) memcpy(Old, W->print, NOld * sizeof(uint64_t));
+		else     NOld = 0;
+		ASE__mutex_unlock(&ASE__watch.lock);
+
+		size_t     Len   = 0;
+		uint8_t  * Buf   = ASE__watch_read(W->path, &Len);
+		uint64_t * New   = 0;
+		int        NNew  = Buf ? ASE__watch_print(Buf, Len, &New) : 0;
+		ASE_Sprite S     = {0};
+		int      * Reuse = 0;
+		ASE_BOOL   Ok    = 0;
+		ASE_BOOL   Same  = 0;
+
+		if (!NNew) {
+			ASE_ERR("ase: can't reload %s\n", W->path);
+		} else if (NNew == NOld && !memcmp(New, Old, NNew * sizeof(uint64_t))) {
+			Same = 1; // touched, or changed back
+		} else {
+			Ok = ASE__watch_decode(Buf, Len, Old, NOld, New, &S, &Reuse);
+		}
+		ASE_FREE(Buf);
+		ASE_FREE(Old);
+
+		ASE_Sprite Stale      = {0};
+		int      * StaleReuse = 0;
+		uint64_t * StalePrint = 0;
+
+		ASE__mutex_lock(&ASE__watch.lock);
+		W->busy = 0;
+		ASE__watched *Gone = W->dropped ? W : 0;
+		if (!Gone && Ok && Swaps != W->swaps) {
+			// the sprite changed under us; the frames to keep are wrong
+			W->dirty = 1;
+			Ok = 0;
+		}
+		if (!Gone && (Ok || (Same && Swaps == W->swaps))) {
+			Stale      = W->next_sprite;
+			StaleReuse = W->next_reuse;
+			StalePrint = W->next_print;
+			memset(&W->next_sprite, 0, sizeof(ASE_Sprite));
+			W->next_reuse  = 0;
+			W->next_print  = 0;
+			W->next_nprint = 0;
+			W->ready       = 0;
+		}
+		if (!Gone && Ok) {
+			W->ready       = 1;
+			W->next_sprite = S;
+			W->next_reuse  = Reuse;
+			W->next_print  = New;
+			W->next_nprint = NNew;
+		}
+		ASE__mutex_unlock(&ASE__watch.lock);
 
+		if (Gone) ASE__watched_free(Gone);
+		if (!Ok || Gone) {
+			ASE_free(&S);
+			ASE_FREE(Reuse);
+			ASE_FREE(New);
+		}
+		ASE_free(&Stale);
+		ASE_FREE(StaleReuse);
+		ASE_FREE(StalePrint);
+	}
+}
 
-		// FRAME
-		ASE_Frame *Frame = ASE_DOC_AddFrame(S);
-		assert(Frame);
-		Frame->duration = FrameHeader.duration;
-
-
-		// LOAD CHUNKS
-		for (int j=0; j<FrameHeader.chunks; ++j) {
-			size_t ChunkHeaderStart = F->io.tell(F->udata);
-
-			// LOAD CHUNK HEADER
-			ASE_DOC_ChunkHeader ChunkHeader = {0};
-			ASE_DOC_ChunkHeader_read(F, &ChunkHeader);
-
-			ASE_DBG("\t--- chunk header (%i) ---\n", j);
-			ASE_DBG("\tsize:  %i\n", (int)ChunkHeader.size);
-			ASE_DBG("\ttype:  0x%04x\n", (int)ChunkHeader.type);
-			ASE_DBG("\tstart: %i\n", (int)ChunkHeader.start);
-
-
-			// CHUNK TYPE
-			switch (ChunkHeader.type) {
-			case ASE_FILE_CHUNK_FLI_COLOR:  // FALLTHROUGH
-			case ASE_FILE_CHUNK_FLI_COLOR2:
-				{
-					if (!IgnoreOldColorChunks) {
-						// OLD COLOR CHUNKS -- SAFELY IGNORE?
-					}
-				} break;
-
-			case ASE_FILE_CHUNK_PALETTE:
-				{
-					S->palette = ASE_Palette_read(F, &S->palette);
-					IgnoreOldColorChunks = 1;
-				} break;
-
-			case ASE_FILE_CHUNK_LAYER:
-				{
-					ASE_Layer *Layer = 0;
-					Layer = ASE_Layer_read(F,
-						&Header, S, &LastLayer, &CurrentLevel);
-					if (Layer) {
-						LastWithUserData = Layer;
-					}
-				} break;
-
-			case ASE_FILE_CHUNK_CEL:
-				{
-					ASE_Cel *Cel = ASE_Cel_read(F,
-						S, i, Frame,
-						ChunkHeaderStart + ChunkHeader.size);
-					if (Cel) {
-						LastCel = Cel;
-						LastWithUserData = Cel->data;
-					}
-				} break;
-
-			case ASE_FILE_CHUNK_CEL_EXTRA: break; // IGNORE
-			case ASE_FILE_CHUNK_MASK:      break; // DEPRECATED
-			case ASE_FILE_CHUNK_PATH:      break; // UNUSED
-
-			case ASE_FILE_CHUNK_FRAME_TAGS:
-				{
-					ASE_Tags_read(F, S);
-				} break;
-
-			case ASE_FILE_CHUNK_SLICES:    break; // IGNORE
-			case ASE_FILE_CHUNK_SLICE:     break; // IGNORE
-			case ASE_FILE_CHUNK_USER_DATA: break; // IGNORE
+ASE__THREAD_PROC(ASE__watch_thread, Arg)
+{
+	(void)Arg;
+	union {
+		struct inotify_event event;
+		char                 bytes[4096];
+	} Events;
+
+	while (!ASE__atomic_get(&ASE__watch.quit)) {
+		struct pollfd P[2] = {
+			{ ASE__watch.fd,      POLLIN, 0 },
+			{ ASE__watch.wake[0], POLLIN, 0 },
+		};
+		if (poll(P, 2, -1) <= 0) continue;
+		if (P[1].revents) break;
+
+		ssize_t N = read(ASE__watch.fd, Events.bytes, sizeof(Events));
+		if (N <= 0) continue;
+
+		ASE__mutex_lock(&ASE__watch.lock);
+		for (char *E = Events.bytes; E < Events.bytes + N; ) {
+			struct inotify_event *Event = (struct inotify_event *)E;
+			for (ASE__watched *W = ASE__watch.head; Event->len && W; W = W->next) {
+				if (W->wd == Event->wd && !strcmp(W->name, Event->name)) W->dirty = 1;
 			}
-
-			// GOTO NEXT CHUNK HEADER
-			F->io.seek(F->udata, ChunkHeaderStart + ChunkHeader.size);
+			E += sizeof(struct inotify_event) + Event->len;
 		}
+		ASE__mutex_unlock(&ASE__watch.lock);
 
-		// GOTO NEXT FRAME HEADER
-		F->io.seek(F->udata, FrameHeaderStart + FrameHeader.size);
+		ASE__watch_reload();
 	}
-
-	return(R);
+	return(0);
 }
 
-
-
-//////////////////////////////////////////////////////////////////////////////
-// primary API - loading
-//
-#ifndef ASE_NO_STDIO
 ASE_DECL ASE_BOOL
-ASE_load (const char *filename, ASE_Sprite *out)
+ASE_watch_start (void)
 {
-	FILE *F = fopen(filename, "rb");
-	if (!F) {
-		ASE_ERR("could not open file: %s\n", filename);
+	if (ASE__watch.started) return(1);
+
+	ASE__watch.fd = inotify_init1(IN_CLOEXEC);
+	if (ASE__watch.fd < 0) {
+		ASE_ERR("ase: no inotify\n");
 		return(0);
 	}
-	ASE__ctx Context = {0};
-	ASE__start_file(&Context, F);
-	int R = ASE__decode_main(&Context, out);
-	fclose(F);
-	return(R);
+	if (pipe(ASE__watch.wake)) {
+		close(ASE__watch.fd);
+		return(0);
+	}
+	ASE__mutex_init(&ASE__watch.lock);
+	ASE__watch.quit = 0;
+	ASE__watch.head = 0;
+	if (!ASE__thread_start(&ASE__watch.thread, ASE__watch_thread, 0)) {
+		close(ASE__watch.wake[0]);
+		close(ASE__watch.wake[1]);
+		close(ASE__watch.fd);
+		return(0);
+	}
+	ASE__watch.started = 1;
+	return(1);
 }
 
-ASE_DECL ASE_BOOL
-ASE_load_from_file (FILE *f, ASE_Sprite *out)
+ASE_DECL int
+ASE_watch_poll (void)
 {
-	ASE__ctx Context = {0};
-	ASE__start_file(&Context, f);
-	return (ASE__decode_main(&Context, out));
-}
-#endif
+	if (!ASE__watch.started) return(0);
+
+	int Swapped = 0;
+	for (;;) {
+		ASE__mutex_lock(&ASE__watch.lock);
+		ASE__watched *W = ASE__watch.head;
+		while (W && !W->ready) W = W->next;
+		if (!W) {
+			ASE__mutex_unlock(&ASE__watch.lock);
+			break;
+		}
 
-ASE_DECL ASE_BOOL
-ASE_load_from_memory (const uint8_t *buffer, int len, ASE_Sprite *out)
-{
-	ASE__ctx Context = {0};
-	ASE__start_mem(&Context, (uint8_t *)buffer, len);
-	return(ASE__decode_main(&Context, out));
+		// carry the unchanged frames' cels over, then link them all up
+		ASE_Sprite *T = W->sprite;
+		ASE_Sprite  S = W->next_sprite;
+		for (int i=0; i < S.nframes && i < T->nframes; ++i) {
+			if (!W->next_reuse[i]) continue;
+			S.frames[i].cels   = T->frames[i].cels;
+			S.frames[i].ncels  = T->frames[i].ncels;
+			T->frames[i].cels  = 0;
+			T->frames[i].ncels = 0;
+		}
+		ASE__index_cels(&S);
+
+		ASE_Sprite Old = *T;
+		*T = S;
+		memset(&W->next_sprite, 0, sizeof(ASE_Sprite));
+		ASE_FREE(W->next_reuse);
+		ASE_FREE(W->print);
+		W->print       = W->next_print;
+		W->nprint      = W->next_nprint;
+		W->next_reuse  = 0;
+		W->next_print  = 0;
+		W->next_nprint = 0;
+		W->ready       = 0;
+		W->swaps      += 1;
+		ASE__mutex_unlock(&ASE__watch.lock);
+
+		ASE_free(&Old);
+		Swapped += 1;
+	}
+	return(Swapped);
 }
 
-ASE_DECL ASE_BOOL
-ASE_load_from_callbacks (const ASE_Callbacks *io, void *user, ASE_Sprite *out)
+ASE_DECL void
+ASE_unwatch (ASE_Sprite *sprite)
 {
-	ASE__ctx Context = {0};
-	ASE__start_callbacks(&Context, (ASE_Callbacks *)io, user);
-	return(ASE__decode_main(&Context, out));
+	ASE__watch_drop(sprite);
 }
 
 ASE_DECL void
-ASE_free(ASE_Sprite *Sprite)
+ASE_watch_stop (void)
 {
-	if (!Sprite) return;
-
-	for (int i=0; i < Sprite->nlayers; ++i) {
-		ASE_Layer *I = Sprite->layers + i;
-		ASE_FREE(I->name);
-	}
-	ASE_FREE(Sprite->layers);
+	if (!ASE__watch.started) return;
 
-	for (int i=0; i < Sprite->nframes; ++i) {
-		ASE_Frame *I = Sprite->frames + i;
-		for (int j=0; j < I->ncels; ++j) {
-			ASE_Cel *J = I->cels + j;
-			ASE_FREE(J->data);
-		}
-		ASE_FREE(I->cels);
+	ASE__atomic_inc(&ASE__watch.quit);
+	if (write(ASE__watch.wake[1], "q", 1) < 0) {
+		ASE_ERR("ase: can't wake the watcher\n");
 	}
-	ASE_FREE(Sprite->frames);
-
-	for (int i=0; i < Sprite->ntags; ++i) {
-		ASE_Tag *I = Sprite->tags + i;
-		ASE_FREE(I->name);
+	ASE__thread_join(ASE__watch.thread);
+	close(ASE__watch.wake[0]);
+	close(ASE__watch.wake[1]);
+	close(ASE__watch.fd);
+
+	// nothing else takes the lock now
+	ASE__watched *W = ASE__watch.head;
+	ASE__watch.head    = 0;
+	ASE__watch.started = 0;
+	while (W) {
+		ASE__watched *Next = W->next;
+		ASE__watched_free(W);
+		W = Next;
 	}
-	ASE_FREE(Sprite->tags);
-
-	memset(Sprite, 0, sizeof(ASE_Sprite));
 }
 
+#endif // ASE__WATCHING
+
 
 
 //////////////////////////////////////////////////////////////////////////////
 // primary API - conveniences
 //
+ASE_DECL int
+ASE_find_layer (ASE_Sprite *sprite, const char *name)
+{
+	if (!sprite->nlayers) return(-1);
+	return(ASE__find_name(&sprite->layer_index, &sprite->layers->name, sprite->nlayers,
+	                      sizeof(ASE_Layer), name));
+}
+
+ASE_DECL int
+ASE_find_tag (ASE_Sprite *sprite, const char *name)
+{
+	if (!sprite->ntags) return(-1);
+	return(ASE__find_name(&sprite->tag_index, &sprite->tags->name, sprite->ntags,
+	                      sizeof(ASE_Tag), name));
+}
+
 ASE_DECL ASE_Layer *
 ASE_get_layer_by_name (ASE_Sprite *sprite, const char *name)
 {
-	ASE_Layer *A = sprite->layers;
-	for (int i=0; i < sprite->nlayers; ++i, ++A) {
-		if (ASE_streq(name, A->name)) return(A);
-	}
-	return(0);
+	int i = ASE_find_layer(sprite, name);
+	return((i < 0) ? 0 : sprite->layers + i);
 }
 
 ASE_DECL ASE_Tag *
 ASE_get_tag_by_name (ASE_Sprite *sprite, const char *name)
 {
-	ASE_Tag *A = sprite->tags;
-	for (int i=0; i < sprite->ntags; ++i, ++A) {
-		if (ASE_streq(name, A->name)) return(A);
-	}
-	return(0);
+	int i = ASE_find_tag(sprite, name);
+	return((i < 0) ? 0 : sprite->tags + i);
 }
 
 ASE_DECL int
@@ -2332,6 +5811,11 @@ ASE_get_next_frame (ASE_Tag *tag, int frame)
 ASE_DECL ASE_Cel *
 ASE_get_linked_cel (ASE_Sprite *sprite, ASE_Cel *cel)
 {
+	if (sprite->cel_table) {
+		if (cel->link < 0) return(0);
+		return(sprite->frames[cel->frame].cels + cel->link);
+	}
+
 	ASE_Frame *lf = sprite->frames + cel->frame;
 	for (int ic=0; ic < lf->ncels; ++ic) {
 		ASE_Cel *cel2 = lf->cels + ic;
@@ -2340,6 +5824,23 @@ ASE_get_linked_cel (ASE_Sprite *sprite, ASE_Cel *cel)
 	return(0);
 }
 
+ASE_DECL ASE_Cel *
+ASE_get_cel (ASE_Sprite *sprite, int frame, int layer)
+{
+	if (frame < 0 || frame >= sprite->nframes) return(0);
+	if (layer < 0 || layer >= sprite->nlayers) return(0);
+
+	ASE_Frame *F = sprite->frames + frame;
+	if (sprite->cel_table) {
+		int i = sprite->cel_table[frame * sprite->nlayers + layer];
+		return((i < 0) ? 0 : F->cels + i);
+	}
+	for (int i=0; i < F->ncels; ++i) {
+		if (F->cels[i].layer == layer) return(F->cels + i);
+	}
+	return(0);
+}
+
 ASE_DECL int
 ASE_check_cel_visible (ASE_Sprite *sprite, ASE_Cel *cel)
 {
@@ -2348,6 +5849,186 @@ ASE_check_cel_visible (ASE_Sprite *sprite, ASE_Cel *cel)
 
 
 
+//////////////////////////////////////////////////////////////////////////////
+// primary API - animation
+//
+
+// last frame in [Lo, Lo + N) that starts at or before T. no branches in
+// the loop, so it runs the same number of steps for every instance
+static int ASE__frame_search(const uint32_t *Start, int Lo, int N, uint32_t T)
+{
+	const uint32_t *Base = Start + Lo;
+	while (N > 1) {
+		int Half = N / 2;
+		Base = (Base[Half] <= T) ? Base + Half : Base;
+		N -= Half;
+	}
+	return((int)(Base - Start));
+}
+
+// first step that ends after T (T < the cycle)
+static int ASE__step_search(const uint32_t *End, int N, uint32_t T)
+{
+	const uint32_t *Base = End;
+	while (N > 1) {
+		int Half = N / 2;
+		Base = (Base[Half - 1] <= T) ? Base + Half : Base;
+		N -= Half;
+	}
+	return((int)(Base - End));
+}
+
+typedef struct {
+	ASE_Tag *timeline; // the tag, if it has one
+	int      from;
+	int      to;
+	int      dir;
+	uint32_t forward;  // ms from 'from' through 'to'
+	uint32_t cycle;    // plus the way back, for ping-pong
+} ASE__loop;
+
+static ASE_BOOL ASE__get_loop(ASE_Sprite *S, int Tag, ASE__loop *L)
+{
+	if (!S->nframes || !S->frame_start) return(0);
+
+	L->timeline = 0;
+	L->from = 0;
+	L->to   = S->nframes - 1;
+	L->dir  = ASE_LOOP_FORWARD;
+	if (Tag >= 0 && Tag < S->ntags) {
+		ASE_Tag *T = S->tags + Tag;
+		if (T->steps) {
+			L->timeline = T;
+			L->cycle    = T->cycle;
+			return(1);
+		}
+		L->from = (T->from < 0) ? 0 : T->from;
+		L->to   = (T->to >= S->nframes) ? S->nframes - 1 : T->to;
+		L->dir  = T->dir;
+		if (L->to < L->from) L->to = L->from;
+	}
+
+	const uint32_t *St = S->frame_start;
+	L->forward = St[L->to + 1] - St[L->from];
+	L->cycle   = L->forward;
+	if (ASE_LOOP_PINGPONG == L->dir && L->to - L->from > 1)
+		L->cycle += St[L->to] - St[L->from + 1];
+	return(1);
+}
+
+// frame at time T (already wrapped into the cycle)
+static int ASE__loop_frame(const uint32_t *St, ASE__loop *L, uint32_t T)
+{
+	ASE_Tag *G = L->timeline;
+	if (G) return(G->steps[G->cycle ? ASE__step_search(G->step_end, G->nsteps, T) : 0]);
+
+	if (!L->cycle) return(L->from);
+	int N = L->to - L->from + 1;
+	switch (L->dir) {
+	case ASE_LOOP_REVERSE:
+		return(ASE__frame_search(St, L->from, N, St[L->to + 1] - 1 - T));
+
+	case ASE_LOOP_PINGPONG:
+		if (T >= L->forward) // on the way back, ends excluded
+			return(ASE__frame_search(St, L->from + 1, N - 2, St[L->to] - 1 - (T - L->forward)));
+		// FALLTHROUGH
+
+	default:
+		return(ASE__frame_search(St, L->from, N, St[L->from] + T));
+	}
+}
+
+ASE_DECL void
+ASE_anim_init (ASE_Anim *anim, ASE_Sprite *sprite, int tag)
+{
+	anim->tag   = tag;
+	anim->time  = 0;
+	anim->frame = ASE_frame_at(sprite, tag, 0);
+}
+
+ASE_DECL int
+ASE_anim_update (ASE_Anim *anim, ASE_Sprite *sprite, uint32_t elapsed_ms)
+{
+	ASE__loop L;
+	if (!ASE__get_loop(sprite, anim->tag, &L)) return(anim->frame = -1);
+
+	uint32_t T = anim->time + elapsed_ms;
+	if (T >= L.cycle) T = L.cycle ? T % L.cycle : 0;
+	anim->time  = T;
+	anim->frame = ASE__loop_frame(sprite->frame_start, &L, T);
+	return(anim->frame);
+}
+
+ASE_DECL int
+ASE_frame_at (ASE_Sprite *sprite, int tag, uint32_t ms)
+{
+	ASE__loop L;
+	if (!ASE__get_loop(sprite, tag, &L)) return(-1);
+	if (ms >= L.cycle) ms = L.cycle ? ms % L.cycle : 0;
+	return(ASE__loop_frame(sprite->frame_start, &L, ms));
+}
+
+ASE_DECL int
+ASE_tag_frame_at (ASE_Tag *tag, uint32_t ms)
+{
+	if (!tag->steps) return(-1);
+	if (!tag->cycle) return(tag->steps[0]);
+	if (ms >= tag->cycle) ms %= tag->cycle;
+	return(tag->steps[ASE__step_search(tag->step_end, tag->nsteps, ms)]);
+}
+
+ASE_DECL uint32_t
+ASE_tag_duration (ASE_Sprite *sprite, int tag)
+{
+	ASE__loop L;
+	if (!ASE__get_loop(sprite, tag, &L)) return(0);
+	return(L.cycle);
+}
+
+#define ASE_ANIM_LOOPS_CACHED 64
+
+ASE_DECL void
+ASE_anim_update_batch (ASE_Sprite *sprite, ASE_AnimBatch *batch, uint32_t elapsed_ms)
+{
+	int       N     = batch->count;
+	int16_t  *Tag   = batch->tag;
+	uint32_t *Time  = batch->time;
+	int32_t  *Frame = batch->frame;
+
+	// the loops are the same for every instance; work them out once
+	ASE__loop Loops[ASE_ANIM_LOOPS_CACHED + 1];
+	int NLoops = (sprite->ntags < ASE_ANIM_LOOPS_CACHED) ? sprite->ntags : ASE_ANIM_LOOPS_CACHED;
+	if (!ASE__get_loop(sprite, -1, Loops)) {
+		for (int i=0; i < N; ++i) Frame[i] = -1;
+		return;
+	}
+	for (int i=0; i < NLoops; ++i) ASE__get_loop(sprite, i, Loops + 1 + i);
+
+	// pass 1: the clocks. a straight add the compiler can vectorize
+	for (int i=0; i < N; ++i) Time[i] += elapsed_ms;
+
+	// pass 2: wrap and look up the frame, branch-free searches
+	const uint32_t *St = sprite->frame_start;
+	for (int i=0; i < N; ++i) {
+		ASE__loop  Uncached;
+		ASE__loop *L = Loops;
+		int        t = Tag[i];
+		if (t >= 0 && t < NLoops) {
+			L = Loops + 1 + t;
+		} else if (t >= 0 && t < sprite->ntags) {
+			ASE__get_loop(sprite, t, &Uncached);
+			L = &Uncached;
+		}
+
+		uint32_t T = Time[i];
+		if (T >= L->cycle) T = L->cycle ? T % L->cycle : 0;
+		Time[i]  = T;
+		Frame[i] = ASE__loop_frame(St, L, T);
+	}
+}
+
+
+
 #endif // ASE_IMPLEMENTATION
 
 #ifdef __cplusplus
@@ -0,0 +1,684 @@
+/*
+paq_mixer.h - v1.0 - public domain software mixer for paq_wav.h
+https://github.com/pennie-quinn/paq
+
+	*** no warranty implied; use at your own risk ***
+
+	Do this:
+		#define MIX_IMPLEMENTATION
+	before you include this file in _ONE_ C or C++ file to include
+	the implementation.
+
+	// i.e. something like this:
+	#include ...
+	#include ...
+	#define WAV_IMPLEMENTATION
+	#define MIX_IMPLEMENTATION
+	#include "paq_wav.h"
+	#include "paq_mixer.h"
+	#include ...
+
+	- paq_wav.h is included for you if you haven't already.
+
+	- You can #define MIX_ASSERT(x, msg) before the #include to avoid using
+	  my assert.
+	  - Or, you can #define MIX_NO_ASSERT if you're feeling lucky.
+
+	- You can also #define MIX_MALLOC and MIX_FREE to avoid using malloc
+	  and free.
+
+	- You can #define MIX_ERR(...) for error messages.
+
+	- You can #define MIX_NO_SIMD to disable the SSE2 code paths.
+
+
+NOTES:
+	- Mixes in-memory clips (8/16bit, float) and WAV_Streams into one
+	  interleaved float block, mono or stereo.
+	- Per-voice gain and pan. Mono voices pan with constant power, stereo
+	  voices with balance.
+	- Voice state is kept struct-of-arrays, packed, so a mix only walks
+	  live voices.
+	- No resampling: voices must already be at the mixer's rate
+	  (see: WAV_resample, WAV_Resampler).
+
+	Full docs under "DOCUMENTATION" below.
+
+
+CHANGELOG:
+	- 1.00  (2026-10-16) first release
+
+
+
+===============================   CONTRIBUTORS   ==============================
+Pennie Quinn
+	- core functionality
+
+
+
+LICENSE
+
+This software is dual-licensed to the public domain and under the following
+license: you are granted a perpetual, irrevocable license to copy, modify,
+publish, and distribute this file as you see fit.
+*/
+
+
+#ifndef WAV_BOOL
+#	include "paq_wav.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef PAQ_MIXER_H
+#define PAQ_MIXER_H
+
+
+/*
+=============================== DOCUMENTATION =================================
+
+Basic Usage
+	MIX_Mixer Mixer;
+	MIX_init(&Mixer, 2, 48000, 4096);
+
+	WAV_Data Boom;
+	WAV_load("boom.wav", &Boom);
+	MIX_Voice V = MIX_play(&Mixer, &Boom, 1.0f, -0.5f, 0);
+
+	...
+
+	// in the audio callback
+	MIX_mix(&Mixer, Out, Frames);
+
+	...
+
+	MIX_free(&Mixer);
+	WAV_free(&Boom);
+
+The mixer doesn't own clips or streams: keep them alive while their voices
+play. A voice stops by itself at the end of its source unless it loops.
+
+MIX_Voice handles stay safe to use after the voice is gone; calls on a dead
+voice do nothing.
+
+===============================================================================
+
+Voices
+
+	MIX_play        - a loaded WAV_Data. MIX_LOOP repeats the clip's first
+	                  forward 'smpl' loop, or the whole clip if it has none.
+	                  ADPCM clips must be decoded first (WAV_decode_adpcm).
+	MIX_play_stream - a WAV_Stream, read a block at a time. MIX_LOOP seeks
+	                  back to the start at the end; for loop points use
+	                  WAV_stream_set_loop.
+
+	Sources with more than 2 channels are refused.
+
+===============================================================================
+*/
+
+
+#include <stdint.h>
+
+
+//////////////////////////////////////////////////////////////////////////////
+// macros / config
+//
+#define MIX_BOOL int
+
+#ifdef inline
+#	define MIX_DECL inline
+#else
+#	define MIX_DECL extern inline
+#endif
+
+#ifndef MIX_ERR
+#	if WAV_DEBUG && !defined(WAV_NO_STDIO)
+#		define MIX_ERR(...) printf(__VA_ARGS__)
+#	else
+#		define MIX_ERR(...)
+#	endif
+#endif
+
+#if !defined(MIX_NO_ASSERT) && !defined(MIX_ASSERT)
+#	define MIX_ASSERT(expr, msg) \
+	do{                      \
+	if(!(expr)) {            \
+	fprintf(stderr,          \
+		"ASSERT(%s):\n"      \
+		"\t msg: %s\n"       \
+		"\tfile: %s\n"       \
+		"\tfunc: %s\n"       \
+		"\tline: %i\n",      \
+		#expr,               \
+		msg,                 \
+		__FILE__,            \
+		__FUNCTION__,        \
+		__LINE__);           \
+	abort();                 \
+	}}while(0)
+#endif
+
+#ifndef MIX_MALLOC
+#	include <malloc.h>
+#	define MIX_MALLOC malloc
+#	define MIX_FREE free
+#endif
+
+#ifdef MIX_NO_ASSERT
+#	define MIX_ASSERT(expr, msg)
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// flags
+//
+enum {
+	MIX_LOOP      = 1 << 0,
+
+	// internal
+	MIX__ENDED    = 1 << 7,
+
+	MIX_MAX_VOICES = 0xFFFF,
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - structs
+//
+typedef uint32_t MIX_Voice; // 0 is never a valid voice
+
+typedef struct {
+	int        channels;   // of the output, 1 or 2
+	uint32_t   rate;
+	int        capacity;
+	int        nvoices;    // live voices are [0, nvoices)
+
+	// per voice, struct-of-arrays, indexed by dense position
+	float    * gain;
+	float    * pan;
+	float    * gain_l;     // gain and pan folded together
+	float    * gain_r;
+	uint32_t * pos;        // next frame of a clip
+	uint32_t * loop_start;
+	uint32_t * loop_end;   // one past the last frame played
+	const WAV_Data **clip;
+	WAV_Stream    **stream;
+	uint8_t  * src_channels;
+	uint8_t  * flags;
+	uint16_t * slot;       // handle slot of each voice
+
+	// handle slots
+	uint16_t * generation;
+	uint16_t * dense;      // voice index of each slot
+	uint16_t * free_slots;
+	int        nfree;
+
+	float    * scratch;    // one block of converted source frames
+	void     * block;      // every array above lives here
+} MIX_Mixer;
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - mixer
+//
+MIX_DECL MIX_BOOL  MIX_init (MIX_Mixer *M, int channels, uint32_t rate, int max_voices);
+MIX_DECL void      MIX_free (MIX_Mixer *M);
+
+MIX_DECL void      MIX_mix (MIX_Mixer *M, float *out, int frames);
+// overwrites 'out' with 'frames' interleaved frames of every live voice.
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - voices
+//
+MIX_DECL MIX_Voice MIX_play (MIX_Mixer *M, const WAV_Data *clip,
+                             float gain, float pan, int flags);
+MIX_DECL MIX_Voice MIX_play_stream (MIX_Mixer *M, WAV_Stream *S,
+                                    float gain, float pan, int flags);
+// pan is -1 (left) to 1 (right). returns 0 if the source can't be mixed or
+// every voice is busy.
+
+MIX_DECL void      MIX_stop (MIX_Mixer *M, MIX_Voice V);
+MIX_DECL MIX_BOOL  MIX_playing (MIX_Mixer *M, MIX_Voice V);
+
+MIX_DECL void      MIX_set_gain (MIX_Mixer *M, MIX_Voice V, float gain);
+MIX_DECL void      MIX_set_pan  (MIX_Mixer *M, MIX_Voice V, float pan);
+
+MIX_DECL void      MIX_set_params (MIX_Mixer *M, const MIX_Voice *V,
+                                   const float *gain, const float *pan, int count);
+// updates 'count' voices at once. either array may be null to leave it alone.
+
+#endif // PAQ_MIXER_H
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//                              IMPLEMENTATION                              //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+#ifdef MIX_IMPLEMENTATION
+
+#include <math.h>
+#include <string.h>
+
+#if !defined(MIX_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	define MIX_SSE2
+#	include <emmintrin.h>
+#endif
+
+#define MIX_BLOCK 256 // frames mixed per voice visit; keeps 'out' in L1
+
+
+//////////////////////////////////////////////////////////////////////////////
+// handles
+//
+static MIX_Voice MIX__handle(MIX_Mixer *M, int slot)
+{
+	return(((MIX_Voice)M->generation[slot] << 16) | (MIX_Voice)(slot + 1));
+}
+
+// dense index of a live voice, or -1
+static int MIX__find(MIX_Mixer *M, MIX_Voice V)
+{
+	int Slot = (int)(V & 0xFFFF) - 1;
+	if (Slot < 0 || Slot >= M->capacity) return(-1);
+	if (M->generation[Slot] != (uint16_t)(V >> 16)) return(-1);
+	return(M->dense[Slot]);
+}
+
+// removes voice i, moving the last voice into its place
+static void MIX__remove(MIX_Mixer *M, int i)
+{
+	int Slot = M->slot[i];
+	++M->generation[Slot];
+	M->free_slots[M->nfree++] = (uint16_t)Slot;
+
+	int Last = --M->nvoices;
+	if (i != Last) {
+		M->gain[i]         = M->gain[Last];
+		M->pan[i]          = M->pan[Last];
+		M->gain_l[i]       = M->gain_l[Last];
+		M->gain_r[i]       = M->gain_r[Last];
+		M->pos[i]          = M->pos[Last];
+		M->loop_start[i]   = M->loop_start[Last];
+		M->loop_end[i]     = M->loop_end[Last];
+		M->clip[i]         = M->clip[Last];
+		M->stream[i]       = M->stream[Last];
+		M->src_channels[i] = M->src_channels[Last];
+		M->flags[i]        = M->flags[Last];
+		M->slot[i]         = M->slot[Last];
+		M->dense[M->slot[i]] = (uint16_t)i;
+	}
+}
+
+static void MIX__update_gains(MIX_Mixer *M, int i)
+{
+	float Gain = M->gain[i];
+	float Pan  = M->pan[i];
+	if (Pan < -1.0f) Pan = -1.0f;
+	if (Pan >  1.0f) Pan =  1.0f;
+
+	if (1 == M->channels) {
+		// mono out: pan means nothing, stereo sources are averaged
+		M->gain_l[i] = M->gain_r[i] = (2 == M->src_channels[i]) ? Gain * 0.5f : Gain;
+	} else if (1 == M->src_channels[i]) {
+		// constant power
+		float A = (Pan + 1.0f) * 0.78539816f;
+		M->gain_l[i] = Gain * cosf(A);
+		M->gain_r[i] = Gain * sinf(A);
+	} else {
+		// balance
+		M->gain_l[i] = Gain * ((Pan > 0.0f) ? 1.0f - Pan : 1.0f);
+		M->gain_r[i] = Gain * ((Pan < 0.0f) ? 1.0f + Pan : 1.0f);
+	}
+}
+
+static MIX_Voice MIX__start(MIX_Mixer *M, int channels, float gain, float pan, int flags)
+{
+	if (channels < 1 || channels > 2) {
+		MIX_ERR("can only mix mono or stereo sources\n");
+		return(0);
+	}
+	if (!M->nfree) return(0);
+
+	int Slot = M->free_slots[--M->nfree];
+	int i    = M->nvoices++;
+	M->dense[Slot] = (uint16_t)i;
+	M->slot[i]     = (uint16_t)Slot;
+
+	M->gain[i]         = gain;
+	M->pan[i]          = pan;
+	M->pos[i]          = 0;
+	M->loop_start[i]   = 0;
+	M->loop_end[i]     = 0;
+	M->clip[i]         = 0;
+	M->stream[i]       = 0;
+	M->src_channels[i] = (uint8_t)channels;
+	M->flags[i]        = (uint8_t)(flags & MIX_LOOP);
+	MIX__update_gains(M, i);
+	return(MIX__handle(M, Slot));
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// kernels -- out += src * gain, for each in/out channel layout
+//
+static void MIX__acc(float *out, int out_channels, const float *src, int src_channels,
+                     int frames, float gl, float gr)
+{
+	int f = 0;
+
+	if (2 == out_channels && 2 == src_channels) {
+#ifdef MIX_SSE2
+		__m128 G = _mm_setr_ps(gl, gr, gl, gr);
+		for (; f + 2 <= frames; f += 2) {
+			__m128 O = _mm_loadu_ps(out + f * 2);
+			O = _mm_add_ps(O, _mm_mul_ps(_mm_loadu_ps(src + f * 2), G));
+			_mm_storeu_ps(out + f * 2, O);
+		}
+#endif
+		for (; f < frames; ++f) {
+			out[f * 2 + 0] += src[f * 2 + 0] * gl;
+			out[f * 2 + 1] += src[f * 2 + 1] * gr;
+		}
+	} else if (2 == out_channels) {
+#ifdef MIX_SSE2
+		__m128 G = _mm_setr_ps(gl, gr, gl, gr);
+		for (; f + 4 <= frames; f += 4) {
+			__m128 S  = _mm_loadu_ps(src + f);
+			__m128 Lo = _mm_unpacklo_ps(S, S); // s0 s0 s1 s1
+			__m128 Hi = _mm_unpackhi_ps(S, S); // s2 s2 s3 s3
+			_mm_storeu_ps(out + f * 2,     _mm_add_ps(_mm_loadu_ps(out + f * 2),     _mm_mul_ps(Lo, G)));
+			_mm_storeu_ps(out + f * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + f * 2 + 4), _mm_mul_ps(Hi, G)));
+		}
+#endif
+		for (; f < frames; ++f) {
+			out[f * 2 + 0] += src[f] * gl;
+			out[f * 2 + 1] += src[f] * gr;
+		}
+	} else if (2 == src_channels) {
+#ifdef MIX_SSE2
+		__m128 G = _mm_setr_ps(gl, gr, gl, gr);
+		for (; f + 4 <= frames; f += 4) {
+			__m128 A = _mm_mul_ps(_mm_loadu_ps(src + f * 2),     G);
+			__m128 B = _mm_mul_ps(_mm_loadu_ps(src + f * 2 + 4), G);
+			__m128 L = _mm_shuffle_ps(A, B, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 R = _mm_shuffle_ps(A, B, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(out + f, _mm_add_ps(_mm_loadu_ps(out + f), _mm_add_ps(L, R)));
+		}
+#endif
+		for (; f < frames; ++f)
+			out[f] += src[f * 2] * gl + src[f * 2 + 1] * gr;
+	} else {
+#ifdef MIX_SSE2
+		__m128 G = _mm_set1_ps(gl);
+		for (; f + 4 <= frames; f += 4)
+			_mm_storeu_ps(out + f, _mm_add_ps(_mm_loadu_ps(out + f), _mm_mul_ps(_mm_loadu_ps(src + f), G)));
+#endif
+		for (; f < frames; ++f)
+			out[f] += src[f] * gl;
+	}
+}
+
+static void MIX__s16_to_float(float *out, const int16_t *src, int count)
+{
+	int i = 0;
+#ifdef MIX_SSE2
+	__m128 Scale = _mm_set1_ps(1.0f / 32767.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m128i V  = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i Lo = _mm_srai_epi32(_mm_unpacklo_epi16(V, V), 16);
+		__m128i Hi = _mm_srai_epi32(_mm_unpackhi_epi16(V, V), 16);
+		_mm_storeu_ps(out + i,     _mm_mul_ps(_mm_cvtepi32_ps(Lo), Scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(Hi), Scale));
+	}
+#endif
+	for (; i < count; ++i) out[i] = src[i] / 32767.0f;
+}
+
+// points *Src at up to 'frames' float frames of voice i and advances it.
+// returns 0 once the voice is done.
+static int MIX__fetch(MIX_Mixer *M, int i, int frames, const float **Src)
+{
+	int C = M->src_channels[i];
+
+	if (M->stream[i]) {
+		int Got = WAV_stream_read(M->stream[i], M->scratch, frames);
+		if (!Got && (M->flags[i] & MIX_LOOP) && WAV_stream_seek(M->stream[i], 0))
+			Got = WAV_stream_read(M->stream[i], M->scratch, frames);
+		*Src = M->scratch;
+		return(Got);
+	}
+
+	const WAV_Data *D = M->clip[i];
+	if (M->pos[i] >= M->loop_end[i]) {
+		if (!(M->flags[i] & MIX_LOOP)) return(0);
+		M->pos[i] = M->loop_start[i];
+	}
+
+	uint32_t Left = M->loop_end[i] - M->pos[i];
+	int      Run  = ((uint32_t)frames > Left) ? (int)Left : frames;
+	size_t   At   = (size_t)M->pos[i] * C;
+	M->pos[i] += Run;
+
+	switch (D->wBitsPerSample) {
+		case WAV_FLOAT:
+		{
+			*Src = (const float *)D->data + At;
+		} break;
+		case WAV_16BIT:
+		{
+			MIX__s16_to_float(M->scratch, (const int16_t *)D->data + At, Run * C);
+			*Src = M->scratch;
+		} break;
+		case WAV_8BIT:
+		{
+			const int8_t *P = D->data + At;
+			for (int n=0; n < Run * C; ++n) M->scratch[n] = P[n] / 127.0f;
+			*Src = M->scratch;
+		} break;
+		default: MIX_ASSERT(0, "INVALID DEFAULT CASE"); return(0);
+	}
+	return(Run);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - mixer
+//
+MIX_DECL MIX_BOOL
+MIX_init (MIX_Mixer *M, int channels, uint32_t rate, int max_voices)
+{
+	MIX_ASSERT(M && (1 == channels || 2 == channels), "invalid arg");
+	memset(M, 0, sizeof(MIX_Mixer));
+	if (max_voices < 1 || max_voices > MIX_MAX_VOICES) return(0);
+
+	size_t N = (size_t)max_voices;
+	size_t Size = N * (4 * sizeof(float) + 3 * sizeof(uint32_t))
+	            + N * (sizeof(WAV_Data *) + sizeof(WAV_Stream *))
+	            + N * (2 * sizeof(uint8_t) + 4 * sizeof(uint16_t))
+	            + MIX_BLOCK * 2 * sizeof(float) + 16;
+	uint8_t *P = (uint8_t *)MIX_MALLOC(Size);
+	if (!P) return(0);
+	M->block = P;
+
+	// widest first, so everything stays aligned
+	M->clip         = (const WAV_Data **)P; P += N * sizeof(WAV_Data *);
+	M->stream       = (WAV_Stream **)P;     P += N * sizeof(WAV_Stream *);
+	M->scratch      = (float *)P;           P += MIX_BLOCK * 2 * sizeof(float);
+	M->gain         = (float *)P;           P += N * sizeof(float);
+	M->pan          = (float *)P;           P += N * sizeof(float);
+	M->gain_l       = (float *)P;           P += N * sizeof(float);
+	M->gain_r       = (float *)P;           P += N * sizeof(float);
+	M->pos          = (uint32_t *)P;        P += N * sizeof(uint32_t);
+	M->loop_start   = (uint32_t *)P;        P += N * sizeof(uint32_t);
+	M->loop_end     = (uint32_t *)P;        P += N * sizeof(uint32_t);
+	M->slot         = (uint16_t *)P;        P += N * sizeof(uint16_t);
+	M->generation   = (uint16_t *)P;        P += N * sizeof(uint16_t);
+	M->dense        = (uint16_t *)P;        P += N * sizeof(uint16_t);
+	M->free_slots   = (uint16_t *)P;        P += N * sizeof(uint16_t);
+	M->src_channels = (uint8_t *)P;         P += N;
+	M->flags        = (uint8_t *)P;
+
+	M->channels = channels;
+	M->rate     = rate;
+	M->capacity = max_voices;
+	for (int i=0; i < max_voices; ++i) {
+		M->generation[i] = 1;
+		M->free_slots[i] = (uint16_t)(max_voices - 1 - i);
+	}
+	M->nfree = max_voices;
+	return(1);
+}
+
+MIX_DECL void
+MIX_free (MIX_Mixer *M)
+{
+	if (!M) return;
+	MIX_FREE(M->block);
+	memset(M, 0, sizeof(MIX_Mixer));
+}
+
+MIX_DECL void
+MIX_mix (MIX_Mixer *M, float *out, int frames)
+{
+	MIX_ASSERT(M && out, "invalid arg");
+	int C = M->channels;
+	memset(out, 0, (size_t)frames * C * sizeof(float));
+
+	for (int Off=0; Off < frames; Off += MIX_BLOCK) {
+		int N = frames - Off;
+		if (N > MIX_BLOCK) N = MIX_BLOCK;
+
+		for (int i=0; i < M->nvoices; ++i) {
+			if (M->flags[i] & MIX__ENDED) continue;
+
+			int Done = 0;
+			while (Done < N) {
+				const float *Src;
+				int Got = MIX__fetch(M, i, N - Done, &Src);
+				if (!Got) {
+					M->flags[i] |= MIX__ENDED;
+					break;
+				}
+				MIX__acc(out + (size_t)(Off + Done) * C, C, Src, M->src_channels[i],
+				         Got, M->gain_l[i], M->gain_r[i]);
+				Done += Got;
+			}
+		}
+	}
+
+	for (int i=M->nvoices - 1; i >= 0; --i)
+		if (M->flags[i] & MIX__ENDED) MIX__remove(M, i);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - voices
+//
+MIX_DECL MIX_Voice
+MIX_play (MIX_Mixer *M, const WAV_Data *clip, float gain, float pan, int flags)
+{
+	MIX_ASSERT(M && clip && clip->data, "invalid arg");
+	if (clip->dwSamplesPerSec != M->rate) {
+		MIX_ERR("clip is %i Hz, mixer is %i Hz\n", (int)clip->dwSamplesPerSec, (int)M->rate);
+		return(0);
+	}
+	if (WAV_4BIT == clip->wBitsPerSample) {
+		MIX_ERR("decode ADPCM clips before mixing them\n");
+		return(0);
+	}
+
+	MIX_Voice V = MIX__start(M, clip->wChannels, gain, pan, flags);
+	if (!V) return(0);
+
+	int i = M->dense[(V & 0xFFFF) - 1];
+	M->clip[i]     = clip;
+	M->loop_end[i] = clip->dwSamples;
+	if (flags & MIX_LOOP) {
+		for (uint32_t l=0; l < clip->nloops; ++l) {
+			const WAV_Loop *L = clip->loops + l;
+			if (WAV_LOOP_FORWARD == L->type && L->start <= L->end && L->end < clip->dwSamples) {
+				M->loop_start[i] = L->start;
+				M->loop_end[i]   = L->end + 1;
+				break;
+			}
+		}
+	}
+	return(V);
+}
+
+MIX_DECL MIX_Voice
+MIX_play_stream (MIX_Mixer *M, WAV_Stream *S, float gain, float pan, int flags)
+{
+	MIX_ASSERT(M && S, "invalid arg");
+	WAV_Data Info = WAV_stream_info(S);
+	if (Info.dwSamplesPerSec != M->rate) {
+		MIX_ERR("stream is %i Hz, mixer is %i Hz\n", (int)Info.dwSamplesPerSec, (int)M->rate);
+		return(0);
+	}
+
+	MIX_Voice V = MIX__start(M, Info.wChannels, gain, pan, flags);
+	if (!V) return(0);
+
+	M->stream[M->dense[(V & 0xFFFF) - 1]] = S;
+	return(V);
+}
+
+MIX_DECL void
+MIX_stop (MIX_Mixer *M, MIX_Voice V)
+{
+	int i = MIX__find(M, V);
+	if (i >= 0) MIX__remove(M, i);
+}
+
+MIX_DECL MIX_BOOL
+MIX_playing (MIX_Mixer *M, MIX_Voice V)
+{
+	return(MIX__find(M, V) >= 0);
+}
+
+MIX_DECL void
+MIX_set_gain (MIX_Mixer *M, MIX_Voice V, float gain)
+{
+	int i = MIX__find(M, V);
+	if (i < 0) return;
+	M->gain[i] = gain;
+	MIX__update_gains(M, i);
+}
+
+MIX_DECL void
+MIX_set_pan (MIX_Mixer *M, MIX_Voice V, float pan)
+{
+	int i = MIX__find(M, V);
+	if (i < 0) return;
+	M->pan[i] = pan;
+	MIX__update_gains(M, i);
+}
+
+MIX_DECL void
+MIX_set_params (MIX_Mixer *M, const MIX_Voice *V, const float *gain, const float *pan, int count)
+{
+	MIX_ASSERT(M && V, "invalid arg");
+	for (int n=0; n < count; ++n) {
+		int i = MIX__find(M, V[n]);
+		if (i < 0) continue;
+		if (gain) M->gain[i] = gain[n];
+		if (pan)  M->pan[i]  = pan[n];
+		MIX__update_gains(M, i);
+	}
+}
+
+
+#endif // MIX_IMPLEMENTATION
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,5 @@
 /*
-paq_wav.h - v1.0 - public domain barebones wav loader
+paq_wav.h - v1.02 - public domain barebones wav loader
 https://github.com/pennie-quinn/paq
 
 	*** no warranty implied; use at your own risk ***
@@ -29,16 +29,66 @@ https://github.com/pennie-quinn/paq
 
 	- You can #define WAV_NO_STDIO if you don't want to load from files.
 
+	- You can #define WAV_NO_SIMD to disable the SSE2/AVX2 code paths. AVX2
+	  is only used when the compiler targets it (i.e. -mavx2).
+
+	- You can #define WAV_NO_THREADS to make WAV_load_batch load on the
+	  calling thread only, and WAV_load_async load before it returns
+	  (WAV_async_init turns executors down, as nothing could wait on them).
+
+	- You can #define WAV_IO_URING on Linux 5.6+ to get WAV_load_batch_uring.
+	  WAV_URING_DEPTH, WAV_URING_CHUNK and WAV_URING_WINDOW tune it.
+
+	- You can #define WAV_WATCH on Linux to get hot reloading of the files
+	  WAV_load reads (see: WAV_watch_start).
+
+	- You can #define WAV_STATS to get per-load counters and timings (see:
+	  WAV_Stats). Without it none of the counting is compiled in. With it,
+	  WAV_MALLOC/WAV_REALLOC/WAV_FREE are wrapped for the rest of the
+	  implementation file so allocations can be counted.
+
+	- You can #define WAV_TRACE to get begin/end hooks around the decode
+	  work, and a writer for Chrome's trace format (see: WAV_trace_hooks).
+
+	- You can #define WAV_ALLOCATOR to send every allocation through a
+	  WAV_Allocator you pick at runtime, which gets a user pointer, the call
+	  site, and the size on free and realloc (see: WAV_set_allocator). It
+	  comes with a tracking one (see: WAV_Tracker). WAV_MALLOC and friends
+	  are still where the memory comes from by default.
+
 
 NOTES:
-	- Really basic, only reads format and data chunks.
+	- Really basic, only reads format, data, loop and cue chunks.
+	- PCM (8/16bit), IEEE float, IMA ADPCM and Microsoft ADPCM.
+	  ADPCM clips stay compressed in memory (see: WAV_decode_adpcm_block).
+	- RF64/BW64 files over 4GB, with 64-bit I/O (see: WAV_Callbacks64).
+	- 'smpl' loop points and 'cue ' markers (see: WAV_Loop, WAV_Cue).
 	- Load from a file path, FILE*, or memory block.
 	- Load from arbitrary I/O callbacks (see: WAV_Callbacks).
+	- Load many files at once on a worker pool (see: WAV_load_batch),
+	  optionally reading them with io_uring (see: WAV_load_batch_uring).
+	- Load in the background, with cancellation (see: WAV_load_async).
+	- Reload clips as their files change (see: WAV_watch_start).
+	- Sample-rate conversion, whole-buffer or streaming (see: WAV_resample).
+	- Stream frames from any source without loading the whole clip
+	  (see: WAV_Stream), with gapless looping (see: WAV_stream_set_loop).
+	- Min/max/RMS waveform overviews for drawing (see: WAV_Overview).
+	- Peak, true-peak, RMS and BS.1770 loudness (see: WAV_analyze).
+	- Optional counters and timings for every load (see: WAV_Stats).
+	- Optional trace events for chrome://tracing (see: WAV_trace_hooks).
+	- Optional allocator interface with a tracking allocator
+	  (see: WAV_Allocator, WAV_Tracker).
 
 	Full docs under "DOCUMENTATION" below.
 
 
 CHANGELOG:
+	- 1.02  (2026-10-16) sample-rate conversion, IMA/MS ADPCM, streaming,
+	                    skip unknown chunks instead of failing,
+	                    waveform overviews, loudness analysis, RF64,
+	                    smpl/cue loop points, batch and async loading,
+	                    io_uring batch reads, load statistics,
+	                    trace events, allocator interface, hot reload
 	- 1.01  (2018-10-21) bugfix: dwSamples was calculated incorrectly
 	- 1.00  (2018-01-19) first release
 
@@ -108,6 +158,9 @@ The functions you must provide for this are:
 
 See: WAV_Callbacks
 
+For files over 2GB (RF64), use WAV_Callbacks64 instead. It is the same, except
+skip, tell and seek take and return int64_t.
+
 ===============================================================================
 
 File Format Reference
@@ -185,13 +238,34 @@ File Format Reference
 // flags, magic numbers
 //
 enum {
+	WAV_4BIT        = 4,  // ADPCM
 	WAV_8BIT        = 8,
 	WAV_16BIT       = 16,
 	WAV_FLOAT       = 32,
-	WAV_MAGIC_RIFF  = ('R' << 24) | ('I' << 16) | ('I' << 8) | 'F',
+	WAV_MAGIC_RIFF  = ('R' << 24) | ('I' << 16) | ('F' << 8) | 'F',
 	WAV_MAGIC_WAVE  = ('W' << 24) | ('A' << 16) | ('V' << 8) | 'E',
 	WAV_MAGIC_FMT   = ('f' << 24) | ('m' << 16) | ('t' << 8) | ' ',
 	WAV_MAGIC_DATA  = ('d' << 24) | ('a' << 16) | ('t' << 8) | 'a',
+	WAV_MAGIC_FACT  = ('f' << 24) | ('a' << 16) | ('c' << 8) | 't',
+	WAV_MAGIC_RF64  = ('R' << 24) | ('F' << 16) | ('6' << 8) | '4',
+	WAV_MAGIC_BW64  = ('B' << 24) | ('W' << 16) | ('6' << 8) | '4',
+	WAV_MAGIC_DS64  = ('d' << 24) | ('s' << 16) | ('6' << 8) | '4',
+	WAV_MAGIC_SMPL  = ('s' << 24) | ('m' << 16) | ('p' << 8) | 'l',
+	WAV_MAGIC_CUE   = ('c' << 24) | ('u' << 16) | ('e' << 8) | ' ',
+
+	WAV_FORMAT_PCM       = 0x0001,
+	WAV_FORMAT_MS_ADPCM  = 0x0002,
+	WAV_FORMAT_FLOAT     = 0x0003,
+	WAV_FORMAT_IMA_ADPCM = 0x0011,
+
+	WAV_ADPCM_MAX_COEF   = 32,
+
+	// WAV_Loop type, as in 'smpl'
+	WAV_LOOP_FORWARD     = 0,
+	WAV_LOOP_PINGPONG    = 1,
+	WAV_LOOP_BACKWARD    = 2,
+
+	WAV_LOOP_FOREVER     = -1,
 };
 
 
@@ -199,13 +273,39 @@ enum {
 // primary API - structs
 //
 typedef struct {
+	uint32_t  id;      // cue point id
+	uint32_t  type;    // WAV_LOOP_FORWARD, _PINGPONG, _BACKWARD
+	uint32_t  start;   // first frame of the loop
+	uint32_t  end;     // last frame of the loop (inclusive)
+	uint32_t  count;   // times to play, 0 = forever
+} WAV_Loop;
+
+typedef struct {
+	uint32_t  id;
+	uint32_t  frame;
+} WAV_Cue;
+
+typedef struct {
+	uint16_t  wFormatTag;
 	uint16_t  wChannels;
 	uint32_t  dwSamplesPerSec;
 	uint32_t  dwAvgBytesPerSec;
 	uint16_t  wBlockAlign;
 	uint32_t  wBitsPerSample;
-	uint32_t  dwSamples;
+	uint32_t  dwSamples;   // frames (samples per channel)
+	uint64_t  qwDataSize;  // bytes in 'data'
 	int8_t  * data;
+
+	// ADPCM only
+	uint16_t  wSamplesPerBlock;
+	uint16_t  wNumCoef;    // MS ADPCM predictor pairs
+	int16_t   aCoef[WAV_ADPCM_MAX_COEF][2];
+
+	// from 'smpl' and 'cue ', wherever they are in the file
+	uint32_t  nloops;
+	WAV_Loop* loops;
+	uint32_t  ncues;
+	WAV_Cue * cues;
 } WAV_Data;
 
 
@@ -237,6 +337,25 @@ typedef struct {
 
 } WAV_Callbacks;
 
+typedef struct {
+	int (*read) (void *user, char *out, int size);
+		// fill 'out' with 'size' bytes
+		// returns the number of bytes read
+
+	void (*skip) (void *user, int64_t nbytes);
+		// skip 'nbytes' bytes
+
+	int (*eof)  (void *user);
+		// return nonzero if we have reached the end of the stream
+
+	int64_t (*tell) (void *user);
+		// same as ftello
+
+	void (*seek) (void *user, int64_t pos);
+		// same as fseeko
+
+} WAV_Callbacks64; // for files over 2GB
+
 #ifndef WAV_NO_STDIO
 WAV_DECL WAV_BOOL WAV_load (const char *filename, WAV_Data *out);
 
@@ -248,425 +367,5126 @@ WAV_DECL WAV_BOOL WAV_load_from_memory (const int8_t *buffer, int len, WAV_Data
 
 WAV_DECL WAV_BOOL WAV_load_from_callbacks (const WAV_Callbacks *io, void *user, WAV_Data *out);
 
+WAV_DECL WAV_BOOL WAV_load_from_callbacks64 (const WAV_Callbacks64 *io, void *user, WAV_Data *out);
+
 WAV_DECL void     WAV_free(WAV_Data *Doc);
 
 
 //////////////////////////////////////////////////////////////////////////////
-// primary API - conversion
+// primary API - batch loading
 //
-WAV_DECL void WAV_convert_to_8bit  (WAV_Data *Loaded);
-WAV_DECL void WAV_convert_to_16bit (WAV_Data *Loaded);
-WAV_DECL void WAV_convert_to_float (WAV_Data *Loaded);
+typedef void (*WAV_TaskFn) (void *task, int index, int worker);
 
-#define PAQ_WAVE_H
+typedef void (*WAV_Dispatch) (void *user, WAV_TaskFn fn, void *task, int count);
+// your job system: call fn(task, i, worker) for every i in [0, count) and
+// return once all of them have finished. 'worker' identifies the thread;
+// the wav loader keeps nothing per worker, so any value will do.
+
+#ifndef WAV_NO_STDIO
+WAV_DECL int WAV_load_batch (const char **filenames, WAV_Data *out,
+                             WAV_BOOL *ok, int count, int threads);
+// loads filenames[i] into out[i] on 'threads' threads (0 = one per core),
+// including the calling one. ok[i] says which loaded, if you want it.
+// returns the number loaded.
+
+WAV_DECL int WAV_load_batch_dispatch (const char **filenames, WAV_Data *out,
+                                      WAV_BOOL *ok, int count,
+                                      WAV_Dispatch dispatch, void *user);
+// same, but runs on your own threads.
 #endif
 
+#if defined(WAV_IO_URING) && defined(__linux__) && !defined(WAV_NO_STDIO)
+WAV_DECL int WAV_load_batch_uring (const char **filenames, WAV_Data *out,
+                                   WAV_BOOL *ok, int count, int threads);
+// same as WAV_load_batch, but the calling thread reads the files through
+// io_uring, many chunks in flight at once into registered buffers, while
+// the other threads parse them from memory. falls back to WAV_load_batch
+// if the kernel won't give us a ring.
+#endif
 
 
 //////////////////////////////////////////////////////////////////////////////
-//                                                                          //
-//                              IMPLEMENTATION                              //
-//                                                                          //
-//////////////////////////////////////////////////////////////////////////////
-#ifdef WAV_IMPLEMENTATION
+// primary API - async loading
+//
+typedef struct WAV_Request WAV_Request;
+
+enum {
+	WAV_REQUEST_PENDING   = 0,
+	WAV_REQUEST_RUNNING   = 1,
+	WAV_REQUEST_DONE      = 2,
+	WAV_REQUEST_FAILED    = 3,
+	WAV_REQUEST_CANCELLED = 4,
+};
+
+typedef void (*WAV_Done) (WAV_Request *request, WAV_Data *data, int status, void *user);
+// called on the loading thread when a request finishes, before
+// WAV_request_wait returns. 'data' is only filled in if status is
+// WAV_REQUEST_DONE; copy it out and zero it to keep it, or leave it for
+// WAV_request_take.
+
+typedef void (*WAV_Submit) (void *user, void (*job)(void *arg), void *arg);
+// your executor: run job(arg) once, on some other thread, some time soon.
+
+WAV_DECL WAV_BOOL     WAV_async_init (int threads, WAV_Submit submit, void *user);
+// starts the background executor: 'threads' loader threads (0 = one per
+// core), or your 'submit' if it isn't null. optional; the first async
+// load starts one with defaults. call it from one thread.
+
+WAV_DECL void         WAV_async_shutdown (void);
+// cancels whatever is still queued and stops the loader threads.
+
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_Request *WAV_load_async (const char *filename, WAV_Done done, void *user);
+#endif
+WAV_DECL WAV_Request *WAV_load_from_memory_async (const int8_t *buffer, int len, WAV_Done done, void *user);
+// returns right away. 'buffer' must stay alive until the request finishes.
+
+WAV_DECL int          WAV_request_status (WAV_Request *R);
+WAV_DECL int          WAV_request_wait (WAV_Request *R);
+// blocks until the request finishes, returns its status.
+
+WAV_DECL void         WAV_request_cancel (WAV_Request *R);
+// checked between blocks of sample data. the request then finishes as
+// CANCELLED.
+
+WAV_DECL WAV_BOOL     WAV_request_take (WAV_Request *R, WAV_Data *out);
+// moves the loaded data into 'out'. only once, only when DONE.
+
+WAV_DECL void         WAV_request_free (WAV_Request *R);
+// cancels the request if it's still going and forgets about it; it never
+// blocks. a data that wasn't taken is freed.
 
 
 //////////////////////////////////////////////////////////////////////////////
-// context struct and functions
+// primary API - hot reload
 //
+#if defined(WAV_WATCH) && defined(__linux__) && !defined(WAV_NO_STDIO) && !defined(WAV_NO_THREADS)
+#define WAV__WATCHING
 
-// we want to load from different sources without a lot of code duplication
+WAV_DECL WAV_BOOL WAV_watch_start (void);
+// from now on, every WAV_Data WAV_load fills is watched with inotify. when
+// its file is written, a thread of ours loads it again.
 
-typedef struct {
-	WAV_Callbacks io;
-	void *udata;
+WAV_DECL int      WAV_watch_poll (void);
+// swaps the reloaded clips in, each into the same WAV_Data WAV_load filled,
+// and frees what they held. call it where nothing is reading them (no mixer
+// voice playing them, say). returns how many changed.
 
-	int read_callbacks;
-	int buflen;
+WAV_DECL void     WAV_unwatch (WAV_Data *data);
+// stops watching data's file. WAV_free does it for you; a WAV_Data that's
+// watched must not move.
 
-	int8_t *buf;
-	int8_t *buf_end;
-	int8_t *buf_orig;
-	int8_t *buf_orig_end;
-} WAV__ctx;
+WAV_DECL void     WAV_watch_stop (void);
+// stops the thread and forgets every file, dropping unswapped reloads.
+#endif
 
-// init decode from callbacks
-static void WAV__start_callbacks(WAV__ctx *ctx, WAV_Callbacks *cb, void *user)
-{
-	ctx->io = *cb;
-	ctx->udata = user;
-	ctx->read_callbacks = 1;
-}
 
-// memory interface
-static int WAV__mem_read(void *user, char *data, int size)
-{
-	WAV__ctx *C = (WAV__ctx *)user;
-	int count = 0;
-	for(; count < size; ++count) {
-		if (C->buf >= C->buf_end) break;
-		*(data++) = *(C->buf++);
-	}
-	return(count);
-}
+//////////////////////////////////////////////////////////////////////////////
+// primary API - conversion
+//
+WAV_DECL void WAV_convert_to_8bit  (WAV_Data *Loaded);
+WAV_DECL void WAV_convert_to_16bit (WAV_Data *Loaded);
+WAV_DECL void WAV_convert_to_float (WAV_Data *Loaded);
+// ADPCM clips are decoded first (see: WAV_decode_adpcm)
 
-static void WAV__mem_skip(void *user, int bytes)
-{
-	WAV__ctx *C = (WAV__ctx *)user;
-	for(; bytes; --bytes, ++C->buf) {
-		if (C->buf >= C->buf_end) break;
-	}
-}
 
-static int WAV__mem_eof(void *user)
-{
-	WAV__ctx *C = (WAV__ctx *)user;
-	return(C->buf >= C->buf_end);
-}
+//////////////////////////////////////////////////////////////////////////////
+// primary API - ADPCM
+//
+WAV_DECL int  WAV_decode_adpcm_block (const WAV_Data *Format,
+                                      const uint8_t *block, int bytes, int16_t *out);
+// decodes one compressed block (at most Format->wBlockAlign bytes) into
+// interleaved 16bit frames. 'out' must hold wSamplesPerBlock * wChannels
+// samples. only the format fields of 'Format' are used, so a streaming
+// consumer can read its own blocks. returns the number of frames decoded.
 
-static int WAV__mem_tell(void *user)
-{
-	WAV__ctx *C = (WAV__ctx *)user;
-	return((int)(C->buf - C->buf_orig));
-}
+WAV_DECL WAV_BOOL WAV_decode_adpcm (WAV_Data *Loaded);
+// decodes a whole ADPCM clip to 16bit PCM in place.
 
-static void WAV__mem_seek(void *user, int pos)
-{
-	WAV__ctx *C = (WAV__ctx *)user;
-	C->buf = C->buf_orig + pos;
-}
 
-static WAV_Callbacks WAV__mem_callbacks = {
-	WAV__mem_read,
-	WAV__mem_skip,
-	WAV__mem_eof,
-	WAV__mem_tell,
-	WAV__mem_seek
-};
+//////////////////////////////////////////////////////////////////////////////
+// primary API - streaming
+//
+typedef struct WAV_Stream WAV_Stream;
 
-static void WAV__start_mem(WAV__ctx *ctx, int8_t *buf, int len)
-{
-	WAV__start_callbacks(ctx, &WAV__mem_callbacks, (void *)ctx);
-	ctx->buf = ctx->buf_orig = buf;
-	ctx->buf_end = ctx->buf_orig_end = buf + len;
-}
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_Stream *WAV_open (const char *filename);
 
+WAV_DECL WAV_Stream *WAV_open_file (FILE *f);
+// f must stay open until WAV_close.
+#endif
 
-// file interface
-#ifndef WAV_NO_STDIO
+WAV_DECL WAV_Stream *WAV_open_memory (const int8_t *buffer, int len);
 
-static int WAV__file_read(void *user, char *data, int size)
-{
-	return((int)fread(data, 1, size, (FILE *)user));
-}
+WAV_DECL WAV_Stream *WAV_open_callbacks (const WAV_Callbacks *io, void *user);
 
-static void WAV__file_skip(void *user, int bytes)
-{
-	fseek((FILE *)user, bytes, SEEK_CUR);
-}
+WAV_DECL WAV_Stream *WAV_open_callbacks64 (const WAV_Callbacks64 *io, void *user);
 
-static int WAV__file_eof(void *user)
-{
-	return(feof((FILE *)user));
-}
+WAV_DECL WAV_Data    WAV_stream_info (WAV_Stream *S);
+// format of the stream; 'data' is always null. 'loops' and 'cues' belong to
+// the stream.
 
-static int WAV__file_tell(void *user)
-{
-	return((int)ftell((FILE *)user));
-}
+WAV_DECL int         WAV_stream_read (WAV_Stream *S, float *out, int frames);
+// reads up to 'frames' interleaved float frames, decoding ADPCM one block at
+// a time. returns the number of frames read, 0 at the end of the stream.
 
-static void WAV__file_seek(void *user, int pos)
-{
-	fseek((FILE *)user, pos, SEEK_SET);
-}
+WAV_DECL WAV_BOOL    WAV_stream_seek (WAV_Stream *S, uint32_t frame);
+WAV_DECL uint32_t    WAV_stream_tell (WAV_Stream *S);
 
-static WAV_Callbacks WAV__file_callbacks = {
-	WAV__file_read,
-	WAV__file_skip,
-	WAV__file_eof,
-	WAV__file_tell,
-	WAV__file_seek
-};
+WAV_DECL WAV_BOOL    WAV_stream_set_loop (WAV_Stream *S, uint32_t start, uint32_t end, int repeats);
+// jumps back to 'start' after frame 'end' (inclusive) 'repeats' times, or
+// WAV_LOOP_FOREVER. the first WAV_STREAM_LOOKAHEAD frames of the loop are
+// decoded up front, so reads across the seam come back whole.
 
-// init decode from FILE
-static void WAV__start_file(WAV__ctx *ctx, FILE *f)
-{
-	WAV__start_callbacks(ctx, &WAV__file_callbacks, (void *)f);
-}
+WAV_DECL WAV_BOOL    WAV_stream_use_loop (WAV_Stream *S, int index);
+// loops[index] from the file. only forward loops can be streamed.
 
-#endif // !WAV_NO_STDIO
+WAV_DECL void        WAV_stream_clear_loop (WAV_Stream *S);
+// plays through to the end from wherever it is.
 
+WAV_DECL void        WAV_close (WAV_Stream *S);
 
 
 //////////////////////////////////////////////////////////////////////////////
-// generic reads
+// primary API - waveform overviews
 //
-WAV__read8(WAV__ctx *c)
-{
-	uint8_t v;
-	if (1 == c->io.read(c->udata, &v, 1)) return(v);
-	return(0);
-}
+#define WAV_OVERVIEW_MAX_LEVELS 8
 
-WAV__read16_le(WAV__ctx *c)
-{
-	uint8_t v[2];
-	if (2 == c->io.read(c->udata, v, 2))
-		return((v[1] << 8) | v[0]); // little-endian
-	else return(0);
-}
+typedef struct {
+	uint32_t  frames;    // frames summarized by each bucket
+	uint32_t  nbuckets;
+	float   * min;       // nbuckets * wChannels, interleaved like samples
+	float   * max;
+	float   * rms;
+} WAV_OverviewLevel;
 
-WAV__read32_le(WAV__ctx *c)
-{
-	uint8_t v[4];
-	if (4 == c->io.read(c->udata, v, 4))
-		return((v[3] << 24) | (v[2] << 16) | (v[1] << 8) | v[0]); // little-endian
-	else return(0);
-}
+typedef struct {
+	uint16_t          wChannels;
+	uint32_t          dwSamples;
+	int               nlevels;
+	WAV_OverviewLevel levels[WAV_OVERVIEW_MAX_LEVELS]; // finest first
+} WAV_Overview;
+
+WAV_DECL WAV_BOOL WAV_build_overview (const WAV_Data *Loaded,
+                                      const uint32_t *bucket_frames, int nlevels,
+                                      WAV_Overview *out);
+// bucket_frames must increase, each a multiple of the one before. pass a
+// null bucket_frames for { 256, 4096, 65536 }. the samples are read once;
+// coarser levels are built from finer ones.
+
+WAV_DECL void     WAV_free_overview (WAV_Overview *Ov);
+
+// serialization -- little-endian, meant to be stored next to the asset
+WAV_DECL int      WAV_overview_size (const WAV_Overview *Ov);
+WAV_DECL int      WAV_overview_save_to_memory (const WAV_Overview *Ov, uint8_t *buffer, int len);
+// returns the number of bytes written, 0 if 'len' is too small
+WAV_DECL WAV_BOOL WAV_overview_load_from_memory (const uint8_t *buffer, int len, WAV_Overview *out);
 
-WAV__read16_be(WAV__ctx *c)
-{
-	uint8_t v[2];
-	if (2 == c->io.read(c->udata, v, 2))
-		return((v[0] << 8) | v[1]); // big-endian
-	else return(0);
-}
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_BOOL WAV_overview_save (const char *filename, const WAV_Overview *Ov);
+WAV_DECL WAV_BOOL WAV_overview_load (const char *filename, WAV_Overview *out);
+#endif
 
-WAV__read32_be(WAV__ctx *c)
-{
-	uint8_t v[4];
-	if (4 == c->io.read(c->udata, v, 4))
-		return((v[0] << 24) | (v[1] << 16) | (v[2] << 8) | v[3]); // big-endian
-	else return(0);
-}
 
+//////////////////////////////////////////////////////////////////////////////
+// primary API - resampling
+//
+enum {
+	WAV_RESAMPLE_LINEAR = 0, // cheap, fine for previews
+	WAV_RESAMPLE_SINC   = 1, // windowed-sinc polyphase
+};
+
+WAV_DECL WAV_BOOL WAV_resample (WAV_Data *Loaded, uint32_t rate, int mode);
+// converts Loaded to 'rate' in place. the bit depth is preserved.
+
+//
+// streaming -- keeps filter state across blocks
+//
+typedef struct {
+	int       mode;
+	int       channels;
+	uint32_t  src_rate;
+	uint32_t  dst_rate;
+
+	uint32_t  up;      // dst_rate / gcd
+	uint32_t  down;    // src_rate / gcd
+	int       phases;
+	int       taps;
+	float   * coeffs;  // phases * taps
+
+	float   * hist;    // one plane of 'cap' frames per channel
+	int       cap;
+	int       nhist;
+	int       pos;     // integer part of the read position in hist
+	uint32_t  frac;    // fractional part, in 1/up steps
+
+	uint64_t  fed;     // input frames consumed
+	uint64_t  made;    // output frames produced
+	int       flushed; // zero frames appended by WAV_resampler_flush
+} WAV_Resampler;
+
+WAV_DECL WAV_BOOL WAV_resampler_init (WAV_Resampler *R, int channels,
+                                      uint32_t src_rate, uint32_t dst_rate, int mode);
+
+WAV_DECL int      WAV_resampler_process (WAV_Resampler *R,
+                                         const float *in, int frames, int *consumed,
+                                         float *out, int capacity);
+// 'in' and 'out' are interleaved float frames.
+// returns the number of frames written to 'out'. if 'out' fills up before
+// all of 'in' is used, *consumed tells you where to pick up next time.
+
+WAV_DECL int      WAV_resampler_flush (WAV_Resampler *R, float *out, int capacity);
+// call at end of stream (until it returns 0) to drain the filter tail.
+
+WAV_DECL void     WAV_resampler_free (WAV_Resampler *R);
 
 
 //////////////////////////////////////////////////////////////////////////////
-// decoder main
+// primary API - analysis
 //
-WAV_DECL WAV_BOOL
-WAV__decode_main(WAV__ctx *F, WAV_Data *Doc)
-{
-	// check header
-	if (WAV_MAGIC_RIFF == WAV__read32_le(F)) {
-		WAV_ERR("RIFF header missing!\n");
-		return(0);
-	}
+#define WAV_ANALYZE_MAX_CHANNELS 8
+#define WAV_ANALYZE_TP_TAPS      12 // per phase of the 4x true-peak filter
 
-	// load size
-	uint32_t FileSize = WAV__read32_le(F); // minus 8 for 'RIFF' and 'WAVE'
+typedef struct {
+	float  peak;      // largest |sample|
+	float  true_peak; // largest |sample| of the 4x oversampled signal
+	float  rms;       // over every sample of every channel
+	float  loudness;  // integrated, K-weighted and gated (ITU-R BS.1770),
+	                  // in LUFS. -HUGE_VALF if everything was gated away.
+} WAV_Analysis;
 
-	// load RIFF chunk type -- "WAVE"
-	if (WAV_MAGIC_WAVE == WAV__read32_le(F)) {
-		WAV_ERR("WAVE header missing!\n");
-		return(0);
-	}
+WAV_DECL WAV_BOOL WAV_analyze (const WAV_Data *Loaded, WAV_Analysis *out);
+WAV_DECL WAV_BOOL WAV_analyze_stream (WAV_Stream *S, WAV_Analysis *out);
+// reads the stream from its current position to the end
 
-	// format chunk
-	if (WAV_MAGIC_FMT == WAV__read32_le(F)) {
-		WAV_ERR("fmt header missing!\n");
-		return(0);
-	}
+//
+// accumulators -- for splitting one clip across threads, or feeding blocks
+// yourself.
+//
+//     chunk i covers frames [i * N, (i+1) * N), with N a multiple of
+//     WAV_analyzer_block_frames(). on its own thread:
+//
+//         WAV_analyzer_init(&A[i], channels, rate);
+//         WAV_analyze_range(clip, i * N, N, &A[i]);
+//
+//     then, in order:
+//
+//         for (i=1; i < nchunks; ++i) WAV_analyzer_merge(&A[0], &A[i]);
+//         WAV_analyzer_finish(&A[0], &result);
+//
+typedef struct {
+	int       channels;
+	uint32_t  rate;
 
-	uint32_t FmtChunkSize = WAV__read32_le(F);
+	// K-weighting: two biquads per channel, state padded for SIMD
+	float     b[2][3];
+	float     a[2][2];
+	float     z[2][2][WAV_ANALYZE_MAX_CHANNELS];
+	float     weight[WAV_ANALYZE_MAX_CHANNELS];
 
-	if (1 != WAV__read16_le(F)) { // indicates PCM format
-		WAV_ERR("chunkformat was not 1\n");
-		return(0);
-	}
+	// true peak: each input sample is stored twice so the last
+	// WAV_ANALYZE_TP_TAPS are always contiguous
+	float     tp_coeffs[3][WAV_ANALYZE_TP_TAPS];
+	float     tp_hist[WAV_ANALYZE_MAX_CHANNELS][WAV_ANALYZE_TP_TAPS * 2];
+	int       tp_pos;
 
-	Doc->wChannels = WAV__read16_le(F);
-	WAV_DBG("\twChannels:             %i\n", (int)Doc->wChannels);
+	float     peak;
+	float     true_peak;
+	double    sumsq;
+	uint64_t  samples;
 
-	Doc->dwSamplesPerSec = WAV__read32_le(F);
-	WAV_DBG("\tsamples per second:   %i\n", (int)Doc->dwSamplesPerSec);
+	// gating: mean square of each 100ms sub-block, channel-weighted
+	uint32_t  block_frames;
+	uint32_t  block_fill;
+	float     acc[WAV_ANALYZE_MAX_CHANNELS];
+	double  * blocks;
+	int       nblocks;
+	int       blocks_cap;
+} WAV_Analyzer;
 
-	Doc->dwAvgBytesPerSec = WAV__read32_le(F);
-	WAV_DBG("\tavg bytes per second: %i\n", (int)Doc->dwAvgBytesPerSec);
+WAV_DECL WAV_BOOL WAV_analyzer_init (WAV_Analyzer *A, int channels, uint32_t rate);
+WAV_DECL uint32_t WAV_analyzer_block_frames (const WAV_Analyzer *A);
 
-	Doc->wBlockAlign = WAV__read16_le(F);
-	WAV_DBG("\tblock align:          %i\n", (int)Doc->wBlockAlign);
+WAV_DECL void     WAV_analyzer_feed (WAV_Analyzer *A, const float *frames, int count);
+// interleaved float frames
 
-	Doc->wBitsPerSample = WAV__read16_le(F);
-	WAV_DBG("\tbits per sample:      %i\n", (int)Doc->wBitsPerSample);
+WAV_DECL void     WAV_analyzer_preroll (WAV_Analyzer *A, const float *frames, int count);
+// runs the filters without measuring, to warm them up on the frames just
+// before a chunk.
 
-	// data chunk
-	if (WAV_MAGIC_DATA == WAV__read32_le(F)) {
-		WAV_ERR("data header missing!\n");
-		return(0);
-	}
+WAV_DECL WAV_BOOL WAV_analyze_range (const WAV_Data *Loaded, uint32_t first, uint32_t count,
+                                     WAV_Analyzer *A);
+// prerolls on the frames before 'first', then feeds [first, first+count)
 
-	uint32_t DataChunkSize = WAV__read32_le(F);
-	WAV_DBG("\tdata chunk size:      %i\n", (int)DataChunkSize);
+WAV_DECL WAV_BOOL WAV_analyzer_merge (WAV_Analyzer *A, const WAV_Analyzer *Next);
+// appends the chunk that directly follows A's. A keeps Next's filter state.
 
-	// sample data
-	Doc->data = WAV_MALLOC(DataChunkSize);
-	int BytesRead = F->io.read(F->udata, Doc->data, DataChunkSize);
+WAV_DECL void     WAV_analyzer_finish (const WAV_Analyzer *A, WAV_Analysis *out);
+WAV_DECL void     WAV_analyzer_free (WAV_Analyzer *A);
 
-	if (BytesRead != DataChunkSize) {
-		WAV_ERR("only read %i of %i sample bytes\n", BytesRead, DataChunkSize);
-		WAV_FREE(Doc->data);
-		Doc->data = 0;
-		return(0);
-	}
 
-	Doc->dwSamples = DataChunkSize / (Doc->wBitsPerSample / 8) / Doc->wChannels;
+//////////////////////////////////////////////////////////////////////////////
+// primary API - statistics
+//
+#ifdef WAV_STATS
 
-	return(1);
-}
+#ifndef WAV_STATS_CHUNK_TYPES
+#	define WAV_STATS_CHUNK_TYPES 16
+#endif
+
+enum {
+	WAV_STATS_TOTAL,   // all of a load
+	WAV_STATS_HEADER,  // every chunk up to 'data'
+	WAV_STATS_DATA,    // reading the sample data
+	WAV_STATS_TRAILER, // chunks after 'data'
+	WAV_STATS_ADPCM,   // WAV_decode_adpcm, also when a conversion calls it
+	WAV_STATS_CONVERT, // WAV_convert_to_*, not counting the ADPCM decode
+	WAV_STATS_PHASES
+};
 
+typedef struct {
+	uint32_t id;       // fourcc, big-endian ('fmt ' is 0x666D7420), 0 = unused
+	uint32_t count;
+	uint64_t bytes;    // including chunk headers
+} WAV_StatsChunk;
+
+typedef struct {
+	uint32_t loads;
+	uint64_t bytes_read;
+	uint64_t io_calls;         // every callback: read, skip, eof, tell, seek
+	uint64_t reads;
+	uint64_t seeks;            // seek and skip
+	uint64_t allocs;           // WAV_MALLOC and WAV_REALLOC
+	uint64_t frees;
+	uint64_t bytes_allocated;  // sizes asked for, not what's live
+	uint64_t compressed_bytes; // ADPCM data decoded by WAV_decode_adpcm
+	uint64_t decoded_bytes;    // and the 16bit PCM it became
+	WAV_StatsChunk chunks[WAV_STATS_CHUNK_TYPES]; // first come; the rest
+	                                              // land in the last slot
+	uint64_t ns[WAV_STATS_PHASES];
+} WAV_Stats;
+
+WAV_DECL WAV_Stats *WAV_stats_attach (WAV_Stats *stats);
+// loads, ADPCM decodes and conversions on the calling thread add to 'stats'
+// from now on, until you attach something else or 0. returns what was
+// attached before. zero it yourself to start over. batch and async loads
+// run on other threads: attach from your WAV_Dispatch or WAV_Submit if you
+// want those counted.
+
+#endif // WAV_STATS
 
 
 //////////////////////////////////////////////////////////////////////////////
-// primary API - loading
+// primary API - tracing
 //
+#ifdef WAV_TRACE
+
+typedef void (*WAV_TraceBegin) (void *user, const char *name, int64_t arg);
+typedef void (*WAV_TraceEnd)   (void *user, const char *name);
+// 'name' is a string literal, the same one for both ends:
+//     "load"    a whole clip, arg 0
+//     "header"  every chunk up to 'data'
+//     "data"    reading the sample data, arg is its size
+//     "adpcm"   WAV_decode_adpcm, arg is the compressed size
+//     "convert" WAV_convert_to_*, arg is the new wBitsPerSample
+
+WAV_DECL void     WAV_trace_hooks (WAV_TraceBegin begin, WAV_TraceEnd end, void *user);
+// called around each piece of work, on whichever thread does it, so they
+// must be thread-safe. set them while nothing is loading; 0 to stop.
+
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_BOOL WAV_trace_json_open (const char *filename);
+// installs hooks that write every event to 'filename' as Chrome trace
+// JSON (chrome://tracing, ui.perfetto.dev), one track per thread.
+WAV_DECL void     WAV_trace_json_close (void);
+// removes them and finishes the file. stop loading first.
+#endif
+
+#endif // WAV_TRACE
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - allocators
+//
+#ifdef WAV_ALLOCATOR
+
+#define WAV_ALLOC_HEADER 32 // bytes in front of every block, see below
+
+typedef struct {
+	void *(*alloc)   (void *user, size_t size, const char *site);
+	void *(*realloc) (void *user, void *ptr, size_t old_size, size_t size, const char *site);
+	void  (*free)    (void *user, void *ptr, size_t size, const char *site);
+	void  *user;
+} WAV_Allocator;
+// 'site' is the "file:line" in this header that asked; free gets the site
+// that made (or last resized) the block. every block starts with
+// WAV_ALLOC_HEADER bytes where we keep its size, site and allocator, and the
+// sizes you see include them.
+
+WAV_DECL const WAV_Allocator *WAV_set_allocator (const WAV_Allocator *allocator);
+// allocations from now on, on every thread, go to 'allocator' (0 = back to
+// WAV_MALLOC and friends). returns the one before. blocks are freed by the
+// allocator that made them, so it has to outlive them. call it while
+// nothing is loading.
+
+// tracking -- counts everything on its way to another allocator
+#ifndef WAV_TRACKER_SITES
+#	define WAV_TRACKER_SITES 64
+#endif
+
+typedef struct {
+	const char *site;       // 0 = unused; the last slot takes the overflow
+	uint64_t    allocs;
+	uint64_t    frees;
+	uint64_t    reallocs;
+	uint64_t    live;       // blocks not freed yet
+	uint64_t    live_bytes;
+	uint64_t    peak_bytes;
+} WAV_TrackerSite;
+
+typedef struct {
+	WAV_Allocator        allocator; // pass &tracker.allocator to WAV_set_allocator
+	const WAV_Allocator *parent;    // where the memory comes from, 0 = WAV_MALLOC
+	void                *lock;
+
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t reallocs;
+	uint64_t realloc_moves;  // reallocs that came back somewhere else
+	uint64_t realloc_copied; // and the bytes they had to copy
+	uint64_t live;
+	uint64_t live_bytes;
+	uint64_t peak_live;
+	uint64_t peak_bytes;
+	WAV_TrackerSite sites[WAV_TRACKER_SITES];
+} WAV_Tracker;
+
+WAV_DECL WAV_BOOL WAV_tracker_init (WAV_Tracker *T, const WAV_Allocator *parent);
+WAV_DECL void     WAV_tracker_free (WAV_Tracker *T);
+// uninstall it first. blocks it still tracks go back to 'parent' as usual.
+
+#ifndef WAV_NO_STDIO
+WAV_DECL void     WAV_tracker_report (WAV_Tracker *T, FILE *f);
+// totals, then every site by peak bytes.
+#endif
+
+#endif // WAV_ALLOCATOR
+
+#define PAQ_WAVE_H
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//                              IMPLEMENTATION                              //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+#ifdef WAV_IMPLEMENTATION
+
+#include <math.h>
+
+#if !defined(WAV_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	define WAV_SSE2
+#	include <emmintrin.h>
+#	if defined(__AVX2__)
+#		define WAV_AVX2
+#		include <immintrin.h>
+#	endif
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// threads
+//
+#if !defined(WAV_NO_THREADS) && defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+	typedef HANDLE WAV__thread;
+	typedef LPTHREAD_START_ROUTINE WAV__thread_fn;
+#	define WAV__THREAD_PROC(name, arg) static DWORD WINAPI name(LPVOID arg)
+#elif !defined(WAV_NO_THREADS)
+#	include <pthread.h>
+#	include <sched.h>
+#	include <unistd.h>
+	typedef pthread_t WAV__thread;
+	typedef void *(*WAV__thread_fn)(void *);
+#	define WAV__THREAD_PROC(name, arg) static void *name(void *arg)
+#else
+	typedef int WAV__thread;
+	typedef void *(*WAV__thread_fn)(void *);
+#	define WAV__THREAD_PROC(name, arg) static void *name(void *arg)
+#endif
+
+static int WAV__cpu_count(void)
+{
+#if defined(WAV_NO_THREADS)
+	return(1);
+#elif defined(_WIN32)
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	return((int)Info.dwNumberOfProcessors);
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long N = sysconf(_SC_NPROCESSORS_ONLN);
+	return((N > 0) ? (int)N : 1);
+#else
+	return(1);
+#endif
+}
+
+static WAV_BOOL WAV__thread_start(WAV__thread *T, WAV__thread_fn Fn, void *Arg)
+{
+#if defined(WAV_NO_THREADS)
+	(void)T; (void)Fn; (void)Arg;
+	return(0);
+#elif defined(_WIN32)
+	*T = CreateThread(0, 0, Fn, Arg, 0, 0);
+	return(0 != *T);
+#else
+	return(0 == pthread_create(T, 0, Fn, Arg));
+#endif
+}
+
+static void WAV__thread_join(WAV__thread T)
+{
+#if defined(WAV_NO_THREADS)
+	(void)T;
+#elif defined(_WIN32)
+	WaitForSingleObject(T, INFINITE);
+	CloseHandle(T);
+#else
+	pthread_join(T, 0);
+#endif
+}
+
+// gives up the rest of the time slice
+static void WAV__thread_yield(void)
+{
+#if defined(WAV_NO_THREADS)
+#elif defined(_WIN32)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+// returns the value from before the add
+static long WAV__atomic_inc(volatile long *p)
+{
+#if defined(_MSC_VER)
+	return(_InterlockedIncrement(p) - 1);
+#else
+	return(__sync_fetch_and_add(p, 1));
+#endif
+}
+
+// reads a flag another thread may be setting
+static long WAV__atomic_get(volatile long *p)
+{
+#if defined(_MSC_VER)
+	return(_InterlockedOr(p, 0));
+#else
+	return(__sync_fetch_and_add(p, 0));
+#endif
+}
+
+// stores New if *p is Old; returns what *p was
+static long WAV__atomic_cas(volatile long *p, long Old, long New)
+{
+#if defined(_MSC_VER)
+	return(_InterlockedCompareExchange(p, New, Old));
+#else
+	return(__sync_val_compare_and_swap(p, Old, New));
+#endif
+}
+
+#if !defined(WAV_NO_THREADS) && defined(_WIN32)
+	typedef CRITICAL_SECTION   WAV__mutex;
+	typedef CONDITION_VARIABLE WAV__cond;
+#elif !defined(WAV_NO_THREADS)
+	typedef pthread_mutex_t    WAV__mutex;
+	typedef pthread_cond_t     WAV__cond;
+#else
+	typedef int                WAV__mutex;
+	typedef int                WAV__cond;
+#endif
+
+static void WAV__mutex_init(WAV__mutex *M)
+{
+#if defined(WAV_NO_THREADS)
+	(void)M;
+#elif defined(_WIN32)
+	InitializeCriticalSection(M);
+#else
+	pthread_mutex_init(M, 0);
+#endif
+}
+
+static void WAV__mutex_lock(WAV__mutex *M)
+{
+#if defined(WAV_NO_THREADS)
+	(void)M;
+#elif defined(_WIN32)
+	EnterCriticalSection(M);
+#else
+	pthread_mutex_lock(M);
+#endif
+}
+
+static void WAV__mutex_unlock(WAV__mutex *M)
+{
+#if defined(WAV_NO_THREADS)
+	(void)M;
+#elif defined(_WIN32)
+	LeaveCriticalSection(M);
+#else
+	pthread_mutex_unlock(M);
+#endif
+}
+
+static void WAV__cond_init(WAV__cond *C)
+{
+#if defined(WAV_NO_THREADS)
+	(void)C;
+#elif defined(_WIN32)
+	InitializeConditionVariable(C);
+#else
+	pthread_cond_init(C, 0);
+#endif
+}
+
+static void WAV__cond_wait(WAV__cond *C, WAV__mutex *M)
+{
+#if defined(WAV_NO_THREADS)
+	(void)C; (void)M;
+#elif defined(_WIN32)
+	SleepConditionVariableCS(C, M, INFINITE);
+#else
+	pthread_cond_wait(C, M);
+#endif
+}
+
+static void WAV__cond_broadcast(WAV__cond *C)
+{
+#if defined(WAV_NO_THREADS)
+	(void)C;
+#elif defined(_WIN32)
+	WakeAllConditionVariable(C);
+#else
+	pthread_cond_broadcast(C);
+#endif
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// statistics
+//
+#if defined(WAV_STATS) || defined(WAV_TRACE)
+
+#if defined(WAV_NO_THREADS)
+#	define WAV__THREAD_LOCAL
+#elif defined(_MSC_VER)
+#	define WAV__THREAD_LOCAL __declspec(thread)
+#else
+#	define WAV__THREAD_LOCAL __thread
+#endif
+
+// stats, and the json trace writer; the trace hook alone doesn't need it
+#if defined(WAV_STATS) || (defined(WAV_TRACE) && !defined(WAV_NO_STDIO))
+#if defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+static uint64_t WAV__now_ns(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER Freq, Now;
+	QueryPerformanceFrequency(&Freq);
+	QueryPerformanceCounter(&Now);
+	return((uint64_t)((double)Now.QuadPart * 1e9 / (double)Freq.QuadPart));
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec T;
+	clock_gettime(CLOCK_MONOTONIC, &T);
+	return((uint64_t)T.tv_sec * 1000000000ull + (uint64_t)T.tv_nsec);
+#else
+	return((uint64_t)clock() * (1000000000ull / CLOCKS_PER_SEC));
+#endif
+}
+#endif
+
+#endif // WAV_STATS || WAV_TRACE
+
+#ifdef WAV_STATS
+
+static WAV__THREAD_LOCAL WAV_Stats *WAV__stats;
+
+#	define WAV__STAT(expr)          do { WAV_Stats *S_ = WAV__stats; if (S_) S_->expr; } while(0)
+#	define WAV__STAT_BEGIN(t)       uint64_t t = WAV__stats ? WAV__now_ns() : 0
+#	define WAV__STAT_END(t, phase)  do { if (WAV__stats) WAV__stats->ns[phase] += WAV__now_ns() - t; } while(0)
+#	define WAV__STAT_CHUNK(id, n)   WAV__stats_chunk(id, n)
+
+static void WAV__stats_chunk(uint32_t Id, uint64_t Size)
+{
+	WAV_Stats *S = WAV__stats;
+	if (!S) return;
+	int i = 0;
+	while (i < WAV_STATS_CHUNK_TYPES - 1 && S->chunks[i].id && S->chunks[i].id != Id) ++i;
+	if (!S->chunks[i].id) S->chunks[i].id = Id;
+	S->chunks[i].count += 1;
+	S->chunks[i].bytes += Size + 8;
+}
+
+#ifndef WAV_ALLOCATOR
+// the allocator, counted. these are compiled before the macros below
+// point at them, so they call whatever WAV_MALLOC was. with WAV_ALLOCATOR
+// the allocator shim counts instead.
+static void *WAV__stats_malloc(size_t Size)
+{
+	WAV__STAT(allocs += 1);
+	WAV__STAT(bytes_allocated += Size);
+	return(WAV_MALLOC(Size));
+}
+
+static void *WAV__stats_realloc(void *P, size_t Size)
+{
+	WAV__STAT(allocs += 1);
+	WAV__STAT(bytes_allocated += Size);
+	return(WAV_REALLOC(P, Size));
+}
+
+static void WAV__stats_free(void *P)
+{
+	if (P) WAV__STAT(frees += 1);
+	WAV_FREE(P);
+}
+
+#undef  WAV_MALLOC
+#undef  WAV_REALLOC
+#undef  WAV_FREE
+#define WAV_MALLOC  WAV__stats_malloc
+#define WAV_REALLOC WAV__stats_realloc
+#define WAV_FREE    WAV__stats_free
+#endif // !WAV_ALLOCATOR
+
+WAV_DECL WAV_Stats *
+WAV_stats_attach (WAV_Stats *stats)
+{
+	WAV_Stats *Prev = WAV__stats;
+	WAV__stats = stats;
+	return(Prev);
+}
+
+#else
+#	define WAV__STAT(expr)          do {} while(0)
+#	define WAV__STAT_BEGIN(t)
+#	define WAV__STAT_END(t, phase)
+#	define WAV__STAT_CHUNK(id, n)
+#endif // WAV_STATS
+
+
+//////////////////////////////////////////////////////////////////////////////
+// allocators
+//
+#ifdef WAV_ALLOCATOR
+
+typedef struct {
+	size_t               size; // what was asked for, without the header
+	const WAV_Allocator *allocator;
+	const char          *site;
+} WAV__alloc_header;
+
+typedef char WAV__alloc_header_fits[(sizeof(WAV__alloc_header) <= WAV_ALLOC_HEADER) ? 1 : -1];
+
+#define WAV__STR2(x) #x
+#define WAV__STR(x)  WAV__STR2(x)
+#define WAV__SITE    __FILE__ ":" WAV__STR(__LINE__)
+
+// the default, WAV_MALLOC and friends as they were before this section
+static void *WAV__default_alloc(void *user, size_t size, const char *site)
+{
+	(void)user; (void)site;
+	return(WAV_MALLOC(size));
+}
+
+static void *WAV__default_realloc(void *user, void *ptr, size_t old_size, size_t size, const char *site)
+{
+	(void)user; (void)old_size; (void)site;
+	return(WAV_REALLOC(ptr, size));
+}
+
+static void WAV__default_free(void *user, void *ptr, size_t size, const char *site)
+{
+	(void)user; (void)size; (void)site;
+	WAV_FREE(ptr);
+}
+
+static const WAV_Allocator WAV__default_allocator = {
+	WAV__default_alloc,
+	WAV__default_realloc,
+	WAV__default_free,
+	0
+};
+
+static const WAV_Allocator *WAV__allocator = &WAV__default_allocator;
+
+WAV_DECL const WAV_Allocator *
+WAV_set_allocator (const WAV_Allocator *allocator)
+{
+	const WAV_Allocator *Prev = WAV__allocator;
+	WAV__allocator = allocator ? allocator : &WAV__default_allocator;
+	return((Prev == &WAV__default_allocator) ? 0 : Prev);
+}
+
+static void *WAV__alloc_malloc(size_t Size, const char *Site)
+{
+	const WAV_Allocator *A = WAV__allocator;
+	WAV__alloc_header *H = (WAV__alloc_header *)A->alloc(A->user, Size + WAV_ALLOC_HEADER, Site);
+	if (!H) return(0);
+	H->size      = Size;
+	H->allocator = A;
+	H->site      = Site;
+	WAV__STAT(allocs += 1);
+	WAV__STAT(bytes_allocated += Size);
+	return((char *)H + WAV_ALLOC_HEADER);
+}
+
+static void WAV__alloc_free(void *P)
+{
+	if (!P) return;
+	WAV__alloc_header *H = (WAV__alloc_header *)((char *)P - WAV_ALLOC_HEADER);
+	const WAV_Allocator *A = H->allocator;
+	WAV__STAT(frees += 1);
+	A->free(A->user, H, H->size + WAV_ALLOC_HEADER, H->site);
+}
+
+static void *WAV__alloc_realloc(void *P, size_t Size, const char *Site)
+{
+	if (!P) return(WAV__alloc_malloc(Size, Site));
+	if (!Size) {
+		WAV__alloc_free(P);
+		return(0);
+	}
+	WAV__alloc_header *H = (WAV__alloc_header *)((char *)P - WAV_ALLOC_HEADER);
+	const WAV_Allocator *A = H->allocator;
+	H = (WAV__alloc_header *)A->realloc(A->user, H,
+		H->size + WAV_ALLOC_HEADER, Size + WAV_ALLOC_HEADER, Site);
+	if (!H) return(0);
+	H->size = Size;
+	H->site = Site;
+	WAV__STAT(allocs += 1);
+	WAV__STAT(bytes_allocated += Size);
+	return((char *)H + WAV_ALLOC_HEADER);
+}
+
+
+// tracking
+static WAV_TrackerSite *WAV__tracker_site(WAV_Tracker *T, const char *Site)
+{
+	int i = 0;
+	while (i < WAV_TRACKER_SITES - 1 && T->sites[i].site && T->sites[i].site != Site) ++i;
+	if (!T->sites[i].site) T->sites[i].site = Site;
+	return(T->sites + i);
+}
+
+static void WAV__tracker_add(WAV_Tracker *T, const char *Site, size_t Size)
+{
+	WAV_TrackerSite *S = WAV__tracker_site(T, Site);
+	S->live       += 1;
+	S->live_bytes += Size;
+	if (S->live_bytes > S->peak_bytes) S->peak_bytes = S->live_bytes;
+
+	T->live       += 1;
+	T->live_bytes += Size;
+	if (T->live > T->peak_live) T->peak_live = T->live;
+	if (T->live_bytes > T->peak_bytes) T->peak_bytes = T->live_bytes;
+}
+
+static void WAV__tracker_remove(WAV_Tracker *T, const char *Site, size_t Size)
+{
+	WAV_TrackerSite *S = WAV__tracker_site(T, Site);
+	S->live       -= 1;
+	S->live_bytes -= Size;
+	T->live       -= 1;
+	T->live_bytes -= Size;
+}
+
+static const WAV_Allocator *WAV__tracker_parent(WAV_Tracker *T)
+{
+	return(T->parent ? T->parent : &WAV__default_allocator);
+}
+
+static void *WAV__tracker_alloc(void *user, size_t size, const char *site)
+{
+	WAV_Tracker *T = (WAV_Tracker *)user;
+	const WAV_Allocator *A = WAV__tracker_parent(T);
+	void *P = A->alloc(A->user, size, site);
+	if (!P) return(0);
+
+	WAV__mutex_lock((WAV__mutex *)T->lock);
+	T->allocs += 1;
+	WAV__tracker_site(T, site)->allocs += 1;
+	WAV__tracker_add(T, site, size);
+	WAV__mutex_unlock((WAV__mutex *)T->lock);
+	return(P);
+}
+
+static void *WAV__tracker_realloc(void *user, void *ptr, size_t old_size, size_t size, const char *site)
+{
+	WAV_Tracker *T = (WAV_Tracker *)user;
+	const WAV_Allocator *A = WAV__tracker_parent(T);
+	const char *OldSite = ((WAV__alloc_header *)ptr)->site;
+	void *P = A->realloc(A->user, ptr, old_size, size, site);
+	if (!P) return(0);
+
+	WAV__mutex_lock((WAV__mutex *)T->lock);
+	T->reallocs += 1;
+	if (P != ptr) {
+		T->realloc_moves  += 1;
+		T->realloc_copied += (old_size < size) ? old_size : size;
+	}
+	WAV__tracker_site(T, site)->reallocs += 1;
+	WAV__tracker_remove(T, OldSite, old_size);
+	WAV__tracker_add(T, site, size);
+	WAV__mutex_unlock((WAV__mutex *)T->lock);
+	return(P);
+}
+
+static void WAV__tracker_free(void *user, void *ptr, size_t size, const char *site)
+{
+	WAV_Tracker *T = (WAV_Tracker *)user;
+	const WAV_Allocator *A = WAV__tracker_parent(T);
+
+	WAV__mutex_lock((WAV__mutex *)T->lock);
+	T->frees += 1;
+	WAV__tracker_site(T, site)->frees += 1;
+	WAV__tracker_remove(T, site, size);
+	WAV__mutex_unlock((WAV__mutex *)T->lock);
+
+	A->free(A->user, ptr, size, site);
+}
+
+WAV_DECL WAV_BOOL
+WAV_tracker_init (WAV_Tracker *T, const WAV_Allocator *parent)
+{
+	memset(T, 0, sizeof(WAV_Tracker));
+	T->lock = WAV_MALLOC(sizeof(WAV__mutex));
+	if (!T->lock) return(0);
+	WAV__mutex_init((WAV__mutex *)T->lock);
+
+	T->parent            = parent;
+	T->allocator.alloc   = WAV__tracker_alloc;
+	T->allocator.realloc = WAV__tracker_realloc;
+	T->allocator.free    = WAV__tracker_free;
+	T->allocator.user    = T;
+	return(1);
+}
+
+WAV_DECL void
+WAV_tracker_free (WAV_Tracker *T)
+{
+	WAV_FREE(T->lock);
+	T->lock = 0;
+}
+
+#ifndef WAV_NO_STDIO
+WAV_DECL void
+WAV_tracker_report (WAV_Tracker *T, FILE *f)
+{
+	WAV__mutex_lock((WAV__mutex *)T->lock);
+	WAV_Tracker C = *T;
+	WAV__mutex_unlock((WAV__mutex *)T->lock);
+
+	fprintf(f, "wav allocations: %llu allocs, %llu frees, %llu reallocs "
+		"(%llu moved, %llu bytes copied)\n",
+		(unsigned long long)C.allocs, (unsigned long long)C.frees,
+		(unsigned long long)C.reallocs, (unsigned long long)C.realloc_moves,
+		(unsigned long long)C.realloc_copied);
+	fprintf(f, "  live: %llu blocks, %llu bytes; peak: %llu blocks, %llu bytes\n",
+		(unsigned long long)C.live, (unsigned long long)C.live_bytes,
+		(unsigned long long)C.peak_live, (unsigned long long)C.peak_bytes);
+
+	// biggest peak first
+	int Order[WAV_TRACKER_SITES];
+	int N = 0;
+	for (int i=0; i < WAV_TRACKER_SITES && C.sites[i].site; ++i) {
+		int j = N++;
+		for (; j > 0 && C.sites[Order[j-1]].peak_bytes < C.sites[i].peak_bytes; --j) Order[j] = Order[j-1];
+		Order[j] = i;
+	}
+
+	fprintf(f, "  %-28s %10s %10s %10s %8s %12s %12s\n",
+		"site", "allocs", "frees", "reallocs", "live", "live bytes", "peak bytes");
+	for (int i=0; i < N; ++i) {
+		WAV_TrackerSite *S = C.sites + Order[i];
+		const char *Name = S->site;
+		for (const char *c = S->site; *c; ++c) if ('/' == *c || '\\' == *c) Name = c + 1;
+		fprintf(f, "  %-28s %10llu %10llu %10llu %8llu %12llu %12llu\n", Name,
+			(unsigned long long)S->allocs, (unsigned long long)S->frees,
+			(unsigned long long)S->reallocs, (unsigned long long)S->live,
+			(unsigned long long)S->live_bytes, (unsigned long long)S->peak_bytes);
+	}
+}
+#endif // !WAV_NO_STDIO
+
+// everything below goes through the shim
+#undef  WAV_MALLOC
+#undef  WAV_REALLOC
+#undef  WAV_FREE
+#define WAV_MALLOC(size)     WAV__alloc_malloc(size, WAV__SITE)
+#define WAV_REALLOC(p, size) WAV__alloc_realloc(p, size, WAV__SITE)
+#define WAV_FREE(p)          WAV__alloc_free(p)
+
+#endif // WAV_ALLOCATOR
+
+
+//////////////////////////////////////////////////////////////////////////////
+// tracing
+//
+#ifdef WAV_TRACE
+
+static struct {
+	WAV_TraceBegin begin;
+	WAV_TraceEnd   end;
+	void *         user;
+} WAV__trace;
+
+#	define WAV__TRACE_BEGIN(name, arg) do { if (WAV__trace.begin) WAV__trace.begin(WAV__trace.user, name, arg); } while(0)
+#	define WAV__TRACE_END(name)        do { if (WAV__trace.end) WAV__trace.end(WAV__trace.user, name); } while(0)
+
+WAV_DECL void
+WAV_trace_hooks (WAV_TraceBegin begin, WAV_TraceEnd end, void *user)
+{
+	WAV__trace.begin = begin;
+	WAV__trace.end   = end;
+	WAV__trace.user  = user;
+}
+
+#ifndef WAV_NO_STDIO
+
+// Chrome's JSON array format, a B and an E event for every span. threads
+// are numbered in the order they first show up.
+static struct {
+	FILE *        file;
+	WAV__mutex    lock;
+	uint64_t      start;
+	long          events;
+	volatile long threads;
+} WAV__trace_json;
+
+static WAV__THREAD_LOCAL long WAV__trace_tid;
+
+static void WAV__trace_json_event(char Phase, const char *Name, int64_t Arg)
+{
+	uint64_t Now = WAV__now_ns();
+	if (!WAV__trace_tid) WAV__trace_tid = WAV__atomic_inc(&WAV__trace_json.threads) + 1;
+
+	WAV__mutex_lock(&WAV__trace_json.lock);
+	FILE *f = WAV__trace_json.file;
+	if (f) {
+		fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"wav\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%ld",
+			WAV__trace_json.events++ ? ",\n" : "", Name, Phase,
+			(double)(Now - WAV__trace_json.start) / 1000.0, WAV__trace_tid);
+		if ('B' == Phase) fprintf(f, ",\"args\":{\"arg\":%lld}", (long long)Arg);
+		fputs("}", f);
+	}
+	WAV__mutex_unlock(&WAV__trace_json.lock);
+}
+
+static void WAV__trace_json_begin(void *user, const char *name, int64_t arg)
+{
+	(void)user;
+	WAV__trace_json_event('B', name, arg);
+}
+
+static void WAV__trace_json_end(void *user, const char *name)
+{
+	(void)user;
+	WAV__trace_json_event('E', name, 0);
+}
+
+WAV_DECL WAV_BOOL
+WAV_trace_json_open (const char *filename)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		WAV_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	fputs("[\n", f);
+
+	WAV__mutex_init(&WAV__trace_json.lock);
+	WAV__trace_json.file   = f;
+	WAV__trace_json.start  = WAV__now_ns();
+	WAV__trace_json.events = 0;
+	WAV_trace_hooks(WAV__trace_json_begin, WAV__trace_json_end, 0);
+	return(1);
+}
+
+WAV_DECL void
+WAV_trace_json_close (void)
+{
+	if (!WAV__trace_json.file) return;
+	WAV_trace_hooks(0, 0, 0);
+
+	WAV__mutex_lock(&WAV__trace_json.lock);
+	fputs("\n]\n", WAV__trace_json.file);
+	fclose(WAV__trace_json.file);
+	WAV__trace_json.file = 0;
+	WAV__mutex_unlock(&WAV__trace_json.lock);
+}
+
+#endif // !WAV_NO_STDIO
+
+#else
+#	define WAV__TRACE_BEGIN(name, arg)
+#	define WAV__TRACE_END(name)
+#endif // WAV_TRACE
+
+
+//////////////////////////////////////////////////////////////////////////////
+// context struct and functions
+//
+
+// we want to load from different sources without a lot of code duplication
+
+typedef struct {
+	WAV_Callbacks64 io;
+	void *udata;
+
+	// 32-bit user callbacks, wrapped by io
+	WAV_Callbacks io32;
+	void *udata32;
+
+	int read_callbacks;
+	int buflen;
+
+	int8_t *buf;
+	int8_t *buf_end;
+	int8_t *buf_orig;
+	int8_t *buf_orig_end;
+
+	// set by WAV_request_cancel, checked between data blocks
+	volatile long *cancel;
+
+#ifdef WAV_STATS
+	// the real callbacks while counting ones stand in for them
+	WAV_Callbacks64 stats_io;
+	void *          stats_udata;
+#endif
+} WAV__ctx;
+
+// init decode from callbacks
+static void WAV__start_callbacks64(WAV__ctx *ctx, WAV_Callbacks64 *cb, void *user)
+{
+	ctx->io = *cb;
+	ctx->udata = user;
+	ctx->read_callbacks = 1;
+}
+
+// 32-bit callbacks
+static int WAV__cb32_read(void *user, char *data, int size)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	return(C->io32.read(C->udata32, data, size));
+}
+
+static void WAV__cb32_skip(void *user, int64_t bytes)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	for (; bytes > 0x7FFFFFFF; bytes -= 0x7FFFFFFF) C->io32.skip(C->udata32, 0x7FFFFFFF);
+	C->io32.skip(C->udata32, (int)bytes);
+}
+
+static int WAV__cb32_eof(void *user)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	return(C->io32.eof(C->udata32));
+}
+
+static int64_t WAV__cb32_tell(void *user)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	return(C->io32.tell(C->udata32));
+}
+
+static void WAV__cb32_seek(void *user, int64_t pos)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	C->io32.seek(C->udata32, (int)pos);
+}
+
+static WAV_Callbacks64 WAV__cb32_callbacks = {
+	WAV__cb32_read,
+	WAV__cb32_skip,
+	WAV__cb32_eof,
+	WAV__cb32_tell,
+	WAV__cb32_seek
+};
+
+static void WAV__start_callbacks(WAV__ctx *ctx, WAV_Callbacks *cb, void *user)
+{
+	WAV__start_callbacks64(ctx, &WAV__cb32_callbacks, (void *)ctx);
+	ctx->io32 = *cb;
+	ctx->udata32 = user;
+}
+
+// memory interface
+static int WAV__mem_read(void *user, char *data, int size)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	int64_t Left = (int64_t)(C->buf_end - C->buf);
+	int count = (Left < size) ? (int)Left : size;
+	if (count < 0) count = 0;
+	memcpy(data, C->buf, count);
+	C->buf += count;
+	return(count);
+}
+
+static void WAV__mem_skip(void *user, int64_t bytes)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	if (bytes > C->buf_end - C->buf) bytes = C->buf_end - C->buf;
+	C->buf += bytes;
+}
+
+static int WAV__mem_eof(void *user)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	return(C->buf >= C->buf_end);
+}
+
+static int64_t WAV__mem_tell(void *user)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	return((int64_t)(C->buf - C->buf_orig));
+}
+
+static void WAV__mem_seek(void *user, int64_t pos)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	C->buf = C->buf_orig + pos;
+}
+
+static WAV_Callbacks64 WAV__mem_callbacks = {
+	WAV__mem_read,
+	WAV__mem_skip,
+	WAV__mem_eof,
+	WAV__mem_tell,
+	WAV__mem_seek
+};
+
+static void WAV__start_mem(WAV__ctx *ctx, int8_t *buf, int len)
+{
+	WAV__start_callbacks64(ctx, &WAV__mem_callbacks, (void *)ctx);
+	ctx->buf = ctx->buf_orig = buf;
+	ctx->buf_end = ctx->buf_orig_end = buf + len;
+}
+
+
+// counting interface, in front of any of the others
+#ifdef WAV_STATS
+
+static int WAV__stats_read(void *user, char *data, int size)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	int Count = C->stats_io.read(C->stats_udata, data, size);
+	WAV__STAT(io_calls += 1);
+	WAV__STAT(reads += 1);
+	if (Count > 0) WAV__STAT(bytes_read += Count);
+	return(Count);
+}
+
+static void WAV__stats_skip(void *user, int64_t bytes)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	WAV__STAT(io_calls += 1);
+	WAV__STAT(seeks += 1);
+	C->stats_io.skip(C->stats_udata, bytes);
+}
+
+static int WAV__stats_eof(void *user)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	WAV__STAT(io_calls += 1);
+	return(C->stats_io.eof(C->stats_udata));
+}
+
+static int64_t WAV__stats_tell(void *user)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	WAV__STAT(io_calls += 1);
+	return(C->stats_io.tell(C->stats_udata));
+}
+
+static void WAV__stats_seek(void *user, int64_t pos)
+{
+	WAV__ctx *C = (WAV__ctx *)user;
+	WAV__STAT(io_calls += 1);
+	WAV__STAT(seeks += 1);
+	C->stats_io.seek(C->stats_udata, pos);
+}
+
+static WAV_Callbacks64 WAV__stats_callbacks = {
+	WAV__stats_read,
+	WAV__stats_skip,
+	WAV__stats_eof,
+	WAV__stats_tell,
+	WAV__stats_seek
+};
+
+#endif // WAV_STATS
+
+
+// file interface
+#ifndef WAV_NO_STDIO
+
+#if defined(_MSC_VER)
+#	define WAV__fseek64 _fseeki64
+#	define WAV__ftell64 _ftelli64
+#elif defined(__APPLE__) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L)
+#	define WAV__fseek64 fseeko
+#	define WAV__ftell64 ftello
+#else
+#	define WAV__fseek64 fseek // long is 64 bits on LP64 targets
+#	define WAV__ftell64 ftell
+#endif
+
+static int WAV__file_read(void *user, char *data, int size)
+{
+	return((int)fread(data, 1, size, (FILE *)user));
+}
+
+static void WAV__file_skip(void *user, int64_t bytes)
+{
+	WAV__fseek64((FILE *)user, bytes, SEEK_CUR);
+}
+
+static int WAV__file_eof(void *user)
+{
+	return(feof((FILE *)user));
+}
+
+static int64_t WAV__file_tell(void *user)
+{
+	return((int64_t)WAV__ftell64((FILE *)user));
+}
+
+static void WAV__file_seek(void *user, int64_t pos)
+{
+	WAV__fseek64((FILE *)user, pos, SEEK_SET);
+}
+
+static WAV_Callbacks64 WAV__file_callbacks = {
+	WAV__file_read,
+	WAV__file_skip,
+	WAV__file_eof,
+	WAV__file_tell,
+	WAV__file_seek
+};
+
+// init decode from FILE
+static void WAV__start_file(WAV__ctx *ctx, FILE *f)
+{
+	WAV__start_callbacks64(ctx, &WAV__file_callbacks, (void *)f);
+}
+
+#endif // !WAV_NO_STDIO
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// generic reads
+//
+WAV__read8(WAV__ctx *c)
+{
+	uint8_t v;
+	if (1 == c->io.read(c->udata, &v, 1)) return(v);
+	return(0);
+}
+
+WAV__read16_le(WAV__ctx *c)
+{
+	uint8_t v[2];
+	if (2 == c->io.read(c->udata, v, 2))
+		return((v[1] << 8) | v[0]); // little-endian
+	else return(0);
+}
+
+WAV__read32_le(WAV__ctx *c)
+{
+	uint8_t v[4];
+	if (4 == c->io.read(c->udata, v, 4))
+		return((v[3] << 24) | (v[2] << 16) | (v[1] << 8) | v[0]); // little-endian
+	else return(0);
+}
+
+WAV__read16_be(WAV__ctx *c)
+{
+	uint8_t v[2];
+	if (2 == c->io.read(c->udata, v, 2))
+		return((v[0] << 8) | v[1]); // big-endian
+	else return(0);
+}
+
+WAV__read32_be(WAV__ctx *c)
+{
+	uint8_t v[4];
+	if (4 == c->io.read(c->udata, v, 4))
+		return((v[0] << 24) | (v[1] << 16) | (v[2] << 8) | v[3]); // big-endian
+	else return(0);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// chunks
+//
+static void WAV__skip_chunk(WAV__ctx *F, uint64_t size)
+{
+	F->io.skip(F->udata, size + (size & 1)); // chunks are word aligned
+}
+
+static WAV_BOOL
+WAV__read_fmt(WAV__ctx *F, WAV_Data *Doc, uint32_t ChunkSize)
+{
+	if (ChunkSize < 16) {
+		WAV_ERR("fmt chunk too small: %i\n", (int)ChunkSize);
+		return(0);
+	}
+
+	Doc->wFormatTag = WAV__read16_le(F);
+	WAV_DBG("\tformat tag:           0x%04x\n", (int)Doc->wFormatTag);
+
+	Doc->wChannels = WAV__read16_le(F);
+	WAV_DBG("\twChannels:             %i\n", (int)Doc->wChannels);
+
+	Doc->dwSamplesPerSec = WAV__read32_le(F);
+	WAV_DBG("\tsamples per second:   %i\n", (int)Doc->dwSamplesPerSec);
+
+	Doc->dwAvgBytesPerSec = WAV__read32_le(F);
+	WAV_DBG("\tavg bytes per second: %i\n", (int)Doc->dwAvgBytesPerSec);
+
+	Doc->wBlockAlign = WAV__read16_le(F);
+	WAV_DBG("\tblock align:          %i\n", (int)Doc->wBlockAlign);
+
+	Doc->wBitsPerSample = WAV__read16_le(F);
+	WAV_DBG("\tbits per sample:      %i\n", (int)Doc->wBitsPerSample);
+
+	uint32_t Read = 16;
+
+	// WAVEFORMATEX extension
+	if (ChunkSize >= 18) {
+		uint16_t ExtraSize = WAV__read16_le(F);
+		Read += 2;
+
+		if (WAV_FORMAT_IMA_ADPCM == Doc->wFormatTag && ExtraSize >= 2) {
+			Doc->wSamplesPerBlock = WAV__read16_le(F);
+			Read += 2;
+		}
+		if (WAV_FORMAT_MS_ADPCM == Doc->wFormatTag && ExtraSize >= 4) {
+			Doc->wSamplesPerBlock = WAV__read16_le(F);
+			Doc->wNumCoef = WAV__read16_le(F);
+			Read += 4;
+			for (int i=0; i < Doc->wNumCoef && Read + 4 <= ChunkSize; ++i, Read += 4) {
+				int16_t C1 = (int16_t)WAV__read16_le(F);
+				int16_t C2 = (int16_t)WAV__read16_le(F);
+				if (i < WAV_ADPCM_MAX_COEF) {
+					Doc->aCoef[i][0] = C1;
+					Doc->aCoef[i][1] = C2;
+				}
+			}
+			if (Doc->wNumCoef > WAV_ADPCM_MAX_COEF) Doc->wNumCoef = WAV_ADPCM_MAX_COEF;
+		}
+	}
+	if (ChunkSize > Read) F->io.skip(F->udata, ChunkSize - Read);
+	if (ChunkSize & 1) F->io.skip(F->udata, 1);
+
+	int C = Doc->wChannels;
+	if (!C) {
+		WAV_ERR("no channels!\n");
+		return(0);
+	}
+
+	switch (Doc->wFormatTag) {
+	case WAV_FORMAT_PCM:
+	case WAV_FORMAT_FLOAT:
+		{
+			if (WAV_8BIT  != Doc->wBitsPerSample &&
+			    WAV_16BIT != Doc->wBitsPerSample &&
+			    WAV_FLOAT != Doc->wBitsPerSample)
+			{
+				WAV_ERR("unsupported bits per sample: %i\n", (int)Doc->wBitsPerSample);
+				return(0);
+			}
+		} break;
+
+	case WAV_FORMAT_IMA_ADPCM:
+		{
+			if (Doc->wBlockAlign <= 4 * C) {
+				WAV_ERR("bad IMA ADPCM block align: %i\n", (int)Doc->wBlockAlign);
+				return(0);
+			}
+			if (!Doc->wSamplesPerBlock)
+				Doc->wSamplesPerBlock = (Doc->wBlockAlign - 4 * C) * 2 / C + 1;
+			Doc->wBitsPerSample = WAV_4BIT;
+		} break;
+
+	case WAV_FORMAT_MS_ADPCM:
+		{
+			static const int16_t Standard[7][2] = {
+				{ 256,    0 }, { 512, -256 }, {   0,    0 }, { 192,   64 },
+				{ 240,    0 }, { 460, -208 }, { 392, -232 },
+			};
+			if (Doc->wBlockAlign <= 7 * C) {
+				WAV_ERR("bad MS ADPCM block align: %i\n", (int)Doc->wBlockAlign);
+				return(0);
+			}
+			if (!Doc->wSamplesPerBlock)
+				Doc->wSamplesPerBlock = (Doc->wBlockAlign - 7 * C) * 2 / C + 2;
+			if (Doc->wNumCoef < 7) {
+				memcpy(Doc->aCoef, Standard, sizeof(Standard));
+				Doc->wNumCoef = 7;
+			}
+			Doc->wBitsPerSample = WAV_4BIT;
+		} break;
+
+	default:
+		{
+			WAV_ERR("unsupported format tag: 0x%04x\n", (int)Doc->wFormatTag);
+			return(0);
+		}
+	}
+
+	return(1);
+}
+
+// frames held by a partial ADPCM block of 'bytes' bytes
+static uint32_t WAV__adpcm_frames(const WAV_Data *Doc, uint32_t bytes)
+{
+	uint32_t C = Doc->wChannels;
+	uint32_t Frames = 0;
+	if (WAV_FORMAT_IMA_ADPCM == Doc->wFormatTag && bytes > 4 * C)
+		Frames = 1 + ((bytes - 4 * C) / (4 * C)) * 8;
+	if (WAV_FORMAT_MS_ADPCM == Doc->wFormatTag && bytes >= 7 * C)
+		Frames = 2 + (bytes - 7 * C) * 2 / C;
+	return(Frames < Doc->wSamplesPerBlock ? Frames : Doc->wSamplesPerBlock);
+}
+
+static uint64_t WAV__read64_le(WAV__ctx *c)
+{
+	uint64_t Lo = (uint32_t)WAV__read32_le(c);
+	uint64_t Hi = (uint32_t)WAV__read32_le(c);
+	return(Lo | (Hi << 32));
+}
+
+// RF64 'ds64' chunk: 64-bit sizes for chunks whose 32-bit size is -1
+#define WAV_DS64_MAX_TABLE 8
+
+typedef struct {
+	uint64_t riff_size;
+	uint64_t data_size;
+	uint64_t sample_count;
+	int      ntable;
+	uint32_t table_id[WAV_DS64_MAX_TABLE];
+	uint64_t table_size[WAV_DS64_MAX_TABLE];
+} WAV__ds64;
+
+static void WAV__read_ds64(WAV__ctx *F, WAV__ds64 *O, uint32_t ChunkSize)
+{
+	uint32_t Read = 0;
+	memset(O, 0, sizeof(WAV__ds64));
+	if (ChunkSize >= 28) {
+		O->riff_size    = WAV__read64_le(F);
+		O->data_size    = WAV__read64_le(F);
+		O->sample_count = WAV__read64_le(F);
+		uint32_t Entries = WAV__read32_le(F);
+		Read = 28;
+		for (uint32_t i=0; i < Entries && Read + 12 <= ChunkSize; ++i, Read += 12) {
+			uint32_t Id   = WAV__read32_be(F);
+			uint64_t Size = WAV__read64_le(F);
+			if (O->ntable < WAV_DS64_MAX_TABLE) {
+				O->table_id[O->ntable]   = Id;
+				O->table_size[O->ntable] = Size;
+				++O->ntable;
+			}
+		}
+	}
+	WAV__skip_chunk(F, ChunkSize - Read);
+}
+
+// 'smpl': sampler header, then 24 bytes per loop
+static void WAV__read_smpl(WAV__ctx *F, WAV_Data *Doc, uint64_t ChunkSize)
+{
+	uint64_t Read = 0;
+	if (ChunkSize >= 36) {
+		for (int i=0; i < 7; ++i) WAV__read32_le(F); // manufacturer .. smpte offset
+		uint32_t Count = WAV__read32_le(F);
+		WAV__read32_le(F); // sampler data
+		Read = 36;
+
+		if (Count > (ChunkSize - Read) / 24) Count = (uint32_t)((ChunkSize - Read) / 24);
+		WAV_FREE(Doc->loops);
+		Doc->loops  = Count ? (WAV_Loop *)WAV_MALLOC(Count * sizeof(WAV_Loop)) : 0;
+		Doc->nloops = Doc->loops ? Count : 0;
+
+		for (uint32_t i=0; i < Doc->nloops; ++i, Read += 24) {
+			WAV_Loop *L = Doc->loops + i;
+			L->id    = WAV__read32_le(F);
+			L->type  = WAV__read32_le(F);
+			L->start = WAV__read32_le(F);
+			L->end   = WAV__read32_le(F);
+			WAV__read32_le(F); // fraction
+			L->count = WAV__read32_le(F);
+			WAV_DBG("\tloop %u: %u - %u x%u\n", L->id, L->start, L->end, L->count);
+		}
+	}
+	WAV__skip_chunk(F, ChunkSize - Read);
+}
+
+// 'cue ': 24 bytes per point
+static void WAV__read_cue(WAV__ctx *F, WAV_Data *Doc, uint64_t ChunkSize)
+{
+	uint64_t Read = 0;
+	if (ChunkSize >= 4) {
+		uint32_t Count = WAV__read32_le(F);
+		Read = 4;
+
+		if (Count > (ChunkSize - Read) / 24) Count = (uint32_t)((ChunkSize - Read) / 24);
+		WAV_FREE(Doc->cues);
+		Doc->cues  = Count ? (WAV_Cue *)WAV_MALLOC(Count * sizeof(WAV_Cue)) : 0;
+		Doc->ncues = Doc->cues ? Count : 0;
+
+		for (uint32_t i=0; i < Doc->ncues; ++i, Read += 24) {
+			WAV_Cue *C = Doc->cues + i;
+			C->id = WAV__read32_le(F);
+			WAV__read32_le(F); // play order position
+			WAV__read32_be(F); // 'data'
+			WAV__read32_le(F); // chunk start
+			WAV__read32_le(F); // block start
+			C->frame = WAV__read32_le(F);
+		}
+	}
+	WAV__skip_chunk(F, ChunkSize - Read);
+}
+
+// chunks we want that may come before or after 'data'
+static WAV_BOOL WAV__read_meta(WAV__ctx *F, WAV_Data *Doc, uint32_t ChunkId, uint64_t ChunkSize)
+{
+	switch (ChunkId) {
+		case WAV_MAGIC_SMPL: WAV__read_smpl(F, Doc, ChunkSize); return(1);
+		case WAV_MAGIC_CUE:  WAV__read_cue(F, Doc, ChunkSize);  return(1);
+		default: return(0);
+	}
+}
+
+// walks the chunks after 'data' (F is just past it) to the end of the RIFF
+// chunk, at offset RiffEnd
+static void WAV__read_trailer(WAV__ctx *F, WAV_Data *Doc, uint64_t DataSize, int64_t RiffEnd)
+{
+	if (DataSize & 1) F->io.skip(F->udata, 1);
+	while (F->io.tell(F->udata) + 8 <= RiffEnd) {
+		uint8_t H[8];
+		if (8 != F->io.read(F->udata, (char *)H, 8)) break;
+		uint32_t ChunkId   = (H[0] << 24) | (H[1] << 16) | (H[2] << 8) | H[3];
+		uint64_t ChunkSize = (uint32_t)((H[7] << 24) | (H[6] << 16) | (H[5] << 8) | H[4]);
+		WAV__STAT_CHUNK(ChunkId, ChunkSize);
+		if (!WAV__read_meta(F, Doc, ChunkId, ChunkSize)) WAV__skip_chunk(F, ChunkSize);
+	}
+}
+
+// reads the RIFF header and every chunk up to 'data', leaving F at the first
+// sample byte. RiffEnd is where the RIFF chunk ends, for WAV__read_trailer.
+static WAV_BOOL
+WAV__read_header(WAV__ctx *F, WAV_Data *Doc, uint64_t *DataSize, int64_t *RiffEnd)
+{
+	memset(Doc, 0, sizeof(WAV_Data));
+	int64_t Start = F->io.tell(F->udata);
+
+	// check header
+	uint32_t Magic = WAV__read32_be(F);
+	WAV_BOOL IsRF64 = (WAV_MAGIC_RF64 == Magic || WAV_MAGIC_BW64 == Magic);
+	if (WAV_MAGIC_RIFF != Magic && !IsRF64) {
+		WAV_ERR("RIFF header missing!\n");
+		return(0);
+	}
+
+	// load size
+	uint32_t FileSize = WAV__read32_le(F); // minus 8 for 'RIFF' and 'WAVE'
+
+	// load RIFF chunk type -- "WAVE"
+	if (WAV_MAGIC_WAVE != (uint32_t)WAV__read32_be(F)) {
+		WAV_ERR("WAVE header missing!\n");
+		return(0);
+	}
+
+	WAV_BOOL  HaveFmt     = 0;
+	WAV_BOOL  HaveFact    = 0;
+	uint64_t  FactSamples = 0;
+	WAV__ds64 Ds64        = {0};
+
+	for (;;) {
+		if (F->io.eof(F->udata)) {
+			WAV_ERR("data header missing!\n");
+			return(0);
+		}
+
+		uint32_t ChunkId   = WAV__read32_be(F);
+		uint64_t ChunkSize = (uint32_t)WAV__read32_le(F);
+
+		// RF64: the real size lives in ds64
+		if (IsRF64 && 0xFFFFFFFF == ChunkSize) {
+			if (WAV_MAGIC_DATA == ChunkId) ChunkSize = Ds64.data_size;
+			for (int i=0; i < Ds64.ntable; ++i)
+				if (Ds64.table_id[i] == ChunkId) ChunkSize = Ds64.table_size[i];
+		}
+		WAV__STAT_CHUNK(ChunkId, ChunkSize);
+
+		switch (ChunkId) {
+		case WAV_MAGIC_DS64:
+			{
+				WAV__read_ds64(F, &Ds64, (uint32_t)ChunkSize);
+				if (Ds64.sample_count) {
+					FactSamples = Ds64.sample_count;
+					HaveFact = 1;
+				}
+			} break;
+
+		case WAV_MAGIC_FMT:
+			{
+				if (!WAV__read_fmt(F, Doc, (uint32_t)ChunkSize)) return(0);
+				HaveFmt = 1;
+			} break;
+
+		case WAV_MAGIC_FACT:
+			{
+				if (ChunkSize >= 4) {
+					uint32_t Samples = WAV__read32_le(F);
+					if (!HaveFact || 0xFFFFFFFF != Samples) FactSamples = Samples;
+					HaveFact = 1;
+					WAV__skip_chunk(F, ChunkSize - 4);
+				} else {
+					WAV__skip_chunk(F, ChunkSize);
+				}
+			} break;
+
+		case WAV_MAGIC_DATA:
+			{
+				if (!HaveFmt) {
+					WAV_ERR("fmt header missing!\n");
+					return(0);
+				}
+
+				uint64_t Frames;
+				if (WAV_4BIT == Doc->wBitsPerSample) {
+					uint64_t Blocks = ChunkSize / Doc->wBlockAlign;
+					uint32_t Tail   = (uint32_t)(ChunkSize % Doc->wBlockAlign);
+					Frames = Blocks * Doc->wSamplesPerBlock + WAV__adpcm_frames(Doc, Tail);
+					if (HaveFact && FactSamples < Frames) Frames = FactSamples;
+				} else {
+					Frames = ChunkSize / (Doc->wBitsPerSample / 8) / Doc->wChannels;
+				}
+				if (Frames > 0xFFFFFFFF) {
+					WAV_ERR("too many frames per channel\n");
+					return(0);
+				}
+				Doc->dwSamples = (uint32_t)Frames;
+
+				// RF64 keeps the real RIFF size in ds64 too
+				uint64_t RiffSize = (IsRF64 && 0xFFFFFFFF == FileSize) ? Ds64.riff_size : FileSize;
+				*DataSize = ChunkSize;
+				*RiffEnd  = Start + 8 + (int64_t)RiffSize;
+				return(1);
+			}
+
+		default: // not interested
+			{
+				if (!WAV__read_meta(F, Doc, ChunkId, ChunkSize))
+					WAV__skip_chunk(F, ChunkSize);
+			} break;
+		}
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// decoder main
+//
+static WAV_BOOL
+WAV__decode_data(WAV__ctx *F, WAV_Data *Doc)
+{
+	uint64_t DataChunkSize = 0;
+	int64_t  RiffEnd       = 0;
+	WAV__STAT_BEGIN(HeaderStart);
+	WAV__TRACE_BEGIN("header", 0);
+	WAV_BOOL Ok = WAV__read_header(F, Doc, &DataChunkSize, &RiffEnd);
+	WAV__TRACE_END("header");
+	WAV__STAT_END(HeaderStart, WAV_STATS_HEADER);
+	if (!Ok) {
+		WAV_free(Doc);
+		return(0);
+	}
+
+	WAV_DBG("\tdata chunk size:      %llu\n", (unsigned long long)DataChunkSize);
+
+	if ((size_t)DataChunkSize != DataChunkSize) {
+		WAV_ERR("sample data doesn't fit in memory, use WAV_open\n");
+		WAV_free(Doc);
+		return(0);
+	}
+
+	// sample data, in pieces the int-sized read callback can take
+	Doc->data = WAV_MALLOC((size_t)DataChunkSize);
+	if (!Doc->data) {
+		WAV_free(Doc);
+		return(0);
+	}
+
+	// async loads read in smaller blocks so a cancel lands quickly
+	WAV__STAT_BEGIN(DataStart);
+	WAV__TRACE_BEGIN("data", (int64_t)DataChunkSize);
+	uint64_t Block = F->cancel ? (1u << 20) : (1u << 30);
+	uint64_t BytesRead = 0;
+	while (BytesRead < DataChunkSize) {
+		if (F->cancel && WAV__atomic_get(F->cancel)) break;
+		uint64_t Left = DataChunkSize - BytesRead;
+		int Want = (int)((Left > Block) ? Block : Left);
+		int Got  = F->io.read(F->udata, (char *)Doc->data + BytesRead, Want);
+		if (Got <= 0) break;
+		BytesRead += Got;
+	}
+	WAV__TRACE_END("data");
+	WAV__STAT_END(DataStart, WAV_STATS_DATA);
+
+	if (F->cancel && WAV__atomic_get(F->cancel)) {
+		WAV_free(Doc);
+		return(0);
+	}
+
+	if (BytesRead != DataChunkSize) {
+		WAV_ERR("only read %llu of %llu sample bytes\n",
+			(unsigned long long)BytesRead, (unsigned long long)DataChunkSize);
+		WAV_free(Doc);
+		return(0);
+	}
+
+	Doc->qwDataSize = DataChunkSize;
+	WAV__STAT_BEGIN(TrailerStart);
+	WAV__read_trailer(F, Doc, DataChunkSize, RiffEnd);
+	WAV__STAT_END(TrailerStart, WAV_STATS_TRAILER);
+	return(1);
+}
+
+WAV_DECL WAV_BOOL
+WAV__decode_main(WAV__ctx *F, WAV_Data *Doc)
+{
+	WAV__TRACE_BEGIN("load", 0);
+#ifdef WAV_STATS
+	WAV_Stats *Stats = WAV__stats;
+	uint64_t   Start = Stats ? WAV__now_ns() : 0;
+	if (Stats) {
+		// count every callback by standing in front of them
+		F->stats_io    = F->io;
+		F->stats_udata = F->udata;
+		F->io          = WAV__stats_callbacks;
+		F->udata       = F;
+	}
+#endif
+
+	WAV_BOOL R = WAV__decode_data(F, Doc);
+
+#ifdef WAV_STATS
+	if (Stats) {
+		F->io    = F->stats_io;
+		F->udata = F->stats_udata;
+		Stats->loads += 1;
+		Stats->ns[WAV_STATS_TOTAL] += WAV__now_ns() - Start;
+	}
+#endif
+	WAV__TRACE_END("load");
+	return(R);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - loading
+//
+#ifdef WAV__WATCHING
+// see: hot reload
+typedef struct WAV__watched WAV__watched;
+
+static struct {
+	int            started;
+	volatile long  quit;
+	int            fd;      // inotify
+	int            wake[2]; // a pipe to get the thread out of poll()
+	WAV__mutex     lock;
+	WAV__thread    thread;
+	WAV__watched * head;
+} WAV__watch;
+
+static WAV_BOOL WAV__watch_load(const char *filename, WAV_Data *out);
+static void     WAV__watch_drop(WAV_Data *data);
+#endif
+
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_BOOL
+WAV_load (const char *filename, WAV_Data *out)
+{
+#ifdef WAV__WATCHING
+	if (WAV__watch.started) return(WAV__watch_load(filename, out));
+#endif
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		WAV_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	WAV__ctx Context = {0};
+	WAV__start_file(&Context, F);
+	int R = WAV__decode_main(&Context, out);
+	fclose(F);
+	return(R);
+}
+
+WAV_DECL WAV_BOOL
+WAV_load_from_file (FILE *f, WAV_Data *out)
+{
+	WAV__ctx Context = {0};
+	WAV__start_file(&Context, f);
+	return (WAV__decode_main(&Context, out));
+}
+#endif
+
+WAV_DECL WAV_BOOL
+WAV_load_from_memory (const int8_t *buffer, int len, WAV_Data *out)
+{
+	WAV__ctx Context = {0};
+	WAV__start_mem(&Context, (int8_t *)buffer, len);
+	return(WAV__decode_main(&Context, out));
+}
+
+WAV_DECL WAV_BOOL
+WAV_load_from_callbacks (const WAV_Callbacks *io, void *user, WAV_Data *out)
+{
+	WAV__ctx Context = {0};
+	WAV__start_callbacks(&Context, (WAV_Callbacks *)io, user);
+	return(WAV__decode_main(&Context, out));
+}
+
+WAV_DECL WAV_BOOL
+WAV_load_from_callbacks64 (const WAV_Callbacks64 *io, void *user, WAV_Data *out)
+{
+	WAV__ctx Context = {0};
+	WAV__start_callbacks64(&Context, (WAV_Callbacks64 *)io, user);
+	return(WAV__decode_main(&Context, out));
+}
+
+WAV_DECL void
+WAV_free(WAV_Data *Doc)
+{
+#ifdef WAV__WATCHING
+	WAV__watch_drop(Doc);
+#endif
+	WAV_FREE(Doc->data);
+	WAV_FREE(Doc->loops);
+	WAV_FREE(Doc->cues);
+	memset(Doc, 0, sizeof(WAV_Data));
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - batch loading
+//
+#ifndef WAV_NO_STDIO
+
+#define WAV_BATCH_MAX_THREADS 64
+
+typedef struct {
+	const char  ** filenames;
+	WAV_Data     * out;
+	WAV_BOOL     * ok;
+	int            count;
+	volatile long  next;    // next file to hand out (our own threads only)
+	volatile long  loaded;
+} WAV__batch;
+
+// samples are read straight into their final buffer, so unlike the
+// aseprite loader there's no per-worker scratch to keep
+static void WAV__batch_task(void *task, int index, int worker)
+{
+	WAV__batch *B = (WAV__batch *)task;
+	(void)worker;
+
+	memset(B->out + index, 0, sizeof(WAV_Data));
+	WAV_BOOL R = WAV_load(B->filenames[index], B->out + index);
+
+	if (B->ok) B->ok[index] = R;
+	if (R) WAV__atomic_inc(&B->loaded);
+}
+
+static WAV_BOOL WAV__batch_begin(WAV__batch *B, const char **filenames, WAV_Data *out,
+                                 WAV_BOOL *ok, int count)
+{
+	memset(B, 0, sizeof(WAV__batch));
+	B->filenames = filenames;
+	B->out       = out;
+	B->ok        = ok;
+	B->count     = count;
+	return(1);
+}
+
+WAV__THREAD_PROC(WAV__batch_thread, Arg)
+{
+	WAV__batch *B = (WAV__batch *)Arg;
+	long i;
+	while ((i = WAV__atomic_inc(&B->next)) < B->count)
+		WAV__batch_task(B, (int)i, 0);
+	return(0);
+}
+
+WAV_DECL int
+WAV_load_batch (const char **filenames, WAV_Data *out, WAV_BOOL *ok, int count, int threads)
+{
+	WAV_ASSERT(filenames && out, "invalid arg");
+	if (count <= 0) return(0);
+	if (threads <= 0) threads = WAV__cpu_count();
+	if (threads > count) threads = count;
+	if (threads > WAV_BATCH_MAX_THREADS) threads = WAV_BATCH_MAX_THREADS;
+
+	WAV__batch B;
+	WAV__batch_begin(&B, filenames, out, ok, count);
+
+	WAV__thread T[WAV_BATCH_MAX_THREADS];
+	int Started = 1;
+	for (; Started < threads; ++Started) {
+		if (!WAV__thread_start(T + Started, WAV__batch_thread, &B)) break;
+	}
+
+	WAV__batch_thread(&B);
+	for (int i=1; i < Started; ++i) WAV__thread_join(T[i]);
+
+	return((int)B.loaded);
+}
+
+WAV_DECL int
+WAV_load_batch_dispatch (const char **filenames, WAV_Data *out, WAV_BOOL *ok, int count,
+                         WAV_Dispatch dispatch, void *user)
+{
+	WAV_ASSERT(filenames && out && dispatch, "invalid arg");
+	if (count <= 0) return(0);
+
+	WAV__batch B;
+	WAV__batch_begin(&B, filenames, out, ok, count);
+	dispatch(user, WAV__batch_task, &B, count);
+	return((int)B.loaded);
+}
+
+#endif // !WAV_NO_STDIO
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - batch loading with io_uring
+//
+#if defined(WAV_IO_URING) && defined(__linux__) && !defined(WAV_NO_STDIO)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// strict -std=c99 hides these
+#if defined(__GLIBC__) && !defined(__USE_MISC)
+extern long syscall(long number, ...);
+#endif
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+#ifndef WAV_URING_DEPTH
+#define WAV_URING_DEPTH     64                 // reads in flight
+#endif
+#ifndef WAV_URING_CHUNK
+#define WAV_URING_CHUNK     (256 * 1024)       // bytes per read
+#endif
+#ifndef WAV_URING_WINDOW
+#define WAV_URING_WINDOW    (32 * 1024 * 1024) // bytes read ahead of the decoders (x2)
+#endif
+#define WAV_URING_MAX_FILES 256                // open files per window
+
+// the raw ring, no liburing
+typedef struct {
+	int                   fd;
+	unsigned            * sq_head;
+	unsigned            * sq_tail;
+	unsigned            * sq_mask;
+	unsigned            * sq_array;
+	unsigned            * cq_head;
+	unsigned            * cq_tail;
+	unsigned            * cq_mask;
+	struct io_uring_sqe * sqes;
+	struct io_uring_cqe * cqes;
+	unsigned              queued; // not handed to the kernel yet
+
+	void                * sq_map;
+	void                * cq_map;
+	size_t                sq_map_size;
+	size_t                cq_map_size;
+	size_t                sqes_size;
+} WAV__uring;
+
+static void WAV__uring_free(WAV__uring *R)
+{
+	if (R->sqes   && (void *)R->sqes != MAP_FAILED) munmap(R->sqes, R->sqes_size);
+	if (R->cq_map && R->cq_map != MAP_FAILED)       munmap(R->cq_map, R->cq_map_size);
+	if (R->sq_map && R->sq_map != MAP_FAILED)       munmap(R->sq_map, R->sq_map_size);
+	if (R->fd >= 0) close(R->fd);
+	memset(R, 0, sizeof(WAV__uring));
+	R->fd = -1;
+}
+
+static WAV_BOOL WAV__uring_init(WAV__uring *R, unsigned Entries)
+{
+	struct io_uring_params Params;
+	memset(R, 0, sizeof(WAV__uring));
+	memset(&Params, 0, sizeof(Params));
+
+	R->fd = (int)syscall(__NR_io_uring_setup, Entries, &Params);
+	if (R->fd < 0) return(0);
+
+	R->sq_map_size = Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+	R->cq_map_size = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+	R->sqes_size   = Params.sq_entries * sizeof(struct io_uring_sqe);
+
+	R->sq_map = mmap(0, R->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                 R->fd, IORING_OFF_SQ_RING);
+	R->cq_map = mmap(0, R->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                 R->fd, IORING_OFF_CQ_RING);
+	R->sqes   = (struct io_uring_sqe *)mmap(0, R->sqes_size, PROT_READ | PROT_WRITE,
+	                 MAP_SHARED | MAP_POPULATE, R->fd, IORING_OFF_SQES);
+	if (R->sq_map == MAP_FAILED || R->cq_map == MAP_FAILED || (void *)R->sqes == MAP_FAILED) {
+		WAV__uring_free(R);
+		return(0);
+	}
+
+	uint8_t *Sq = (uint8_t *)R->sq_map;
+	uint8_t *Cq = (uint8_t *)R->cq_map;
+	R->sq_head  = (unsigned *)(Sq + Params.sq_off.head);
+	R->sq_tail  = (unsigned *)(Sq + Params.sq_off.tail);
+	R->sq_mask  = (unsigned *)(Sq + Params.sq_off.ring_mask);
+	R->sq_array = (unsigned *)(Sq + Params.sq_off.array);
+	R->cq_head  = (unsigned *)(Cq + Params.cq_off.head);
+	R->cq_tail  = (unsigned *)(Cq + Params.cq_off.tail);
+	R->cq_mask  = (unsigned *)(Cq + Params.cq_off.ring_mask);
+	R->cqes     = (struct io_uring_cqe *)(Cq + Params.cq_off.cqes);
+	return(1);
+}
+
+// next submission entry, zeroed; 0 if the ring is full. there's no SQPOLL
+// thread, so the kernel won't look at it before WAV__uring_enter
+static struct io_uring_sqe *WAV__uring_sqe(WAV__uring *R)
+{
+	unsigned Head = __atomic_load_n(R->sq_head, __ATOMIC_ACQUIRE);
+	unsigned Tail = *R->sq_tail;
+	if (Tail - Head > *R->sq_mask) return(0);
+
+	unsigned Index = Tail & *R->sq_mask;
+	struct io_uring_sqe *E = R->sqes + Index;
+	memset(E, 0, sizeof(struct io_uring_sqe));
+	R->sq_array[Index] = Index;
+	__atomic_store_n(R->sq_tail, Tail + 1, __ATOMIC_RELEASE);
+	++R->queued;
+	return(E);
+}
+
+// submits what's queued and waits for at least 'Wait' completions
+static WAV_BOOL WAV__uring_enter(WAV__uring *R, unsigned Wait)
+{
+	for (;;) {
+		long N = syscall(__NR_io_uring_enter, R->fd, R->queued, Wait,
+		                 Wait ? IORING_ENTER_GETEVENTS : 0, (void *)0, (size_t)0);
+		if (N >= 0) {
+			R->queued -= (unsigned)N;
+			return(1);
+		}
+		if (errno != EINTR) return(0);
+	}
+}
+
+static struct io_uring_cqe *WAV__uring_cqe(WAV__uring *R)
+{
+	unsigned Head = *R->cq_head;
+	if (Head == __atomic_load_n(R->cq_tail, __ATOMIC_ACQUIRE)) return(0);
+	return(R->cqes + (Head & *R->cq_mask));
+}
+
+static void WAV__uring_cqe_seen(WAV__uring *R)
+{
+	__atomic_store_n(R->cq_head, *R->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// a batch task for a file that's already in memory
+static void WAV__batch_mem_task(WAV__batch *B, int index, int worker, uint8_t *data, int len)
+{
+	WAV__ctx Context = {0};
+	(void)worker;
+
+	memset(B->out + index, 0, sizeof(WAV_Data));
+	WAV__start_mem(&Context, (int8_t *)data, len);
+	WAV_BOOL R = WAV__decode_main(&Context, B->out + index);
+
+	if (B->ok) B->ok[index] = R;
+	if (R) WAV__atomic_inc(&B->loaded);
+}
+
+typedef struct {
+	int             fd;
+	int             size;
+	int             issued; // bytes asked for
+	int             done;   // bytes that arrived
+	int             window;
+	WAV_BOOL        failed; // not read here; the decoder loads it the usual way
+	uint8_t       * data;   // in its window
+} WAV__uring_file;
+
+typedef struct {
+	int file;
+	int offset;
+	int len;
+} WAV__uring_read;
+
+typedef struct {
+	WAV__batch        batch;
+	WAV__uring        ring;
+	WAV__uring_file * files;
+	uint8_t         * window[2];
+	int               window_cap;
+	WAV_BOOL          fixed;   // the windows are registered buffers
+
+	WAV__uring_read   reads[WAV_URING_DEPTH];
+	int               free_reads[WAV_URING_DEPTH];
+	int               nfree;
+
+	// files are handed to the decoders in order, a window at a time
+	WAV__mutex        lock;
+	WAV__cond         cond;
+	int               ready;   // files below this can be decoded
+	int               next;    // next one to decode
+	int               busy[2]; // files left to decode, per window
+} WAV__uring_batch;
+
+typedef struct {
+	WAV__uring_batch * batch;
+	int                worker;
+} WAV__uring_worker;
+
+static void WAV__uring_queue(WAV__uring_batch *U, int Slot)
+{
+	WAV__uring_read *Rd = U->reads + Slot;
+	WAV__uring_file *F  = U->files + Rd->file;
+	struct io_uring_sqe *E = WAV__uring_sqe(&U->ring);
+	WAV_ASSERT(E, "io_uring submission queue overflow");
+
+	E->opcode    = U->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	E->fd        = F->fd;
+	E->off       = (uint64_t)Rd->offset;
+	E->addr      = (uint64_t)(uintptr_t)(F->data + Rd->offset);
+	E->len       = (unsigned)Rd->len;
+	E->buf_index = (uint16_t)F->window;
+	E->user_data = (uint64_t)Slot;
+}
+
+// opens the files that fit in window W, starting at First; returns the end
+static int WAV__uring_fill(WAV__uring_batch *U, int First, int W)
+{
+	int Used = 0;
+	int i = First;
+	for (; i < U->batch.count && i - First < WAV_URING_MAX_FILES; ++i) {
+		WAV__uring_file *F = U->files + i;
+		struct stat St;
+		F->window = W;
+		F->fd = open(U->batch.filenames[i], O_RDONLY | O_CLOEXEC);
+		if (F->fd < 0 || fstat(F->fd, &St) || St.st_size > U->window_cap) {
+			if (F->fd >= 0) close(F->fd);
+			F->fd = -1;
+			F->failed = 1;
+			continue;
+		}
+		if (Used + St.st_size > U->window_cap) {
+			close(F->fd);
+			F->fd = -1;
+			break;
+		}
+		F->size = (int)St.st_size;
+		F->data = U->window[W] + Used;
+		Used += F->size;
+	}
+	return(i);
+}
+
+// reads files [First, Last) in chunks, up to WAV_URING_DEPTH at a time
+static WAV_BOOL WAV__uring_read_window(WAV__uring_batch *U, int First, int Last)
+{
+	int File = First;
+	int Inflight = 0;
+	for (;;) {
+		while (U->nfree) {
+			while (File < Last && (U->files[File].failed || U->files[File].issued == U->files[File].size))
+				++File;
+			if (File == Last) break;
+
+			WAV__uring_file *F = U->files + File;
+			int Len  = F->size - F->issued;
+			if (Len > WAV_URING_CHUNK) Len = WAV_URING_CHUNK;
+			int Slot = U->free_reads[--U->nfree];
+			U->reads[Slot].file   = File;
+			U->reads[Slot].offset = F->issued;
+			U->reads[Slot].len    = Len;
+			F->issued += Len;
+			WAV__uring_queue(U, Slot);
+			++Inflight;
+		}
+		if (!Inflight) return(1);
+		if (!WAV__uring_enter(&U->ring, 1)) return(0);
+
+		struct io_uring_cqe *E;
+		while ((E = WAV__uring_cqe(&U->ring))) {
+			int Slot = (int)E->user_data;
+			int Res  = E->res;
+			WAV__uring_cqe_seen(&U->ring);
+
+			WAV__uring_read *Rd = U->reads + Slot;
+			WAV__uring_file *F  = U->files + Rd->file;
+			if (Res == -EAGAIN || Res == -EINTR) {
+				WAV__uring_queue(U, Slot);
+				continue;
+			}
+			if (Res > 0) {
+				F->done += Res;
+				if (Res < Rd->len) { // short read, ask for the rest
+					Rd->offset += Res;
+					Rd->len    -= Res;
+					WAV__uring_queue(U, Slot);
+					continue;
+				}
+			} else {
+				F->failed = 1; // error, or the file got shorter
+			}
+			U->free_reads[U->nfree++] = Slot;
+			--Inflight;
+		}
+	}
+}
+
+// decodes files as they're read. without 'Wait' it only takes what's ready
+static void WAV__uring_decode(WAV__uring_batch *U, int Worker, WAV_BOOL Wait)
+{
+	for (;;) {
+		WAV__mutex_lock(&U->lock);
+		while (Wait && U->next >= U->ready && U->ready < U->batch.count)
+			WAV__cond_wait(&U->cond, &U->lock);
+		if (U->next >= U->ready) {
+			WAV__mutex_unlock(&U->lock);
+			return;
+		}
+		int i = U->next++;
+		WAV__mutex_unlock(&U->lock);
+
+		WAV__uring_file *F = U->files + i;
+		if (F->failed || F->done != F->size)
+			WAV__batch_task(&U->batch, i, Worker);
+		else
+			WAV__batch_mem_task(&U->batch, i, Worker, F->data, F->size);
+
+		WAV__mutex_lock(&U->lock);
+		--U->busy[F->window];
+		WAV__cond_broadcast(&U->cond);
+		WAV__mutex_unlock(&U->lock);
+	}
+}
+
+WAV__THREAD_PROC(WAV__uring_thread, Arg)
+{
+	WAV__uring_worker *W = (WAV__uring_worker *)Arg;
+	WAV__uring_decode(W->batch, W->worker, 1);
+	return(0);
+}
+
+WAV_DECL int
+WAV_load_batch_uring (const char **filenames, WAV_Data *out, WAV_BOOL *ok, int count, int threads)
+{
+	WAV_ASSERT(filenames && out, "invalid arg");
+	if (count <= 0) return(0);
+	if (threads <= 0) threads = WAV__cpu_count();
+	if (threads > count) threads = count;
+	if (threads > WAV_BATCH_MAX_THREADS) threads = WAV_BATCH_MAX_THREADS;
+
+	WAV__uring_batch *U = (WAV__uring_batch *)WAV_MALLOC(sizeof(WAV__uring_batch));
+	if (!U) return(0);
+	memset(U, 0, sizeof(WAV__uring_batch));
+	if (!WAV__uring_init(&U->ring, WAV_URING_DEPTH)) {
+		WAV_FREE(U);
+		return(WAV_load_batch(filenames, out, ok, count, threads));
+	}
+
+	// size the windows to the batch, so small batches don't pin 64MB
+	int64_t Total = 0;
+	for (int i=0; i < count && Total < WAV_URING_WINDOW; ++i) {
+		struct stat St;
+		if (!stat(filenames[i], &St) && St.st_size <= WAV_URING_WINDOW) Total += St.st_size;
+	}
+	U->window_cap = (Total < WAV_URING_WINDOW) ? (int)Total : WAV_URING_WINDOW;
+	if (U->window_cap < 4096) U->window_cap = 4096;
+
+	U->files     = (WAV__uring_file *)WAV_MALLOC(count * sizeof(WAV__uring_file));
+	U->window[0] = (uint8_t *)WAV_MALLOC(U->window_cap);
+	U->window[1] = (uint8_t *)WAV_MALLOC(U->window_cap);
+	if (!U->files || !U->window[0] || !U->window[1] || !WAV__batch_begin(&U->batch, filenames, out, ok, count)) {
+		WAV__uring_free(&U->ring);
+		WAV_FREE(U->files);
+		WAV_FREE(U->window[0]);
+		WAV_FREE(U->window[1]);
+		WAV_FREE(U);
+		return(WAV_load_batch(filenames, out, ok, count, threads));
+	}
+	memset(U->files, 0, count * sizeof(WAV__uring_file));
+
+	// registering pins the windows so the kernel can skip mapping them on
+	// every read. it counts against RLIMIT_MEMLOCK; plain reads work too
+	struct iovec Io[2];
+	Io[0].iov_base = U->window[0];
+	Io[0].iov_len  = U->window_cap;
+	Io[1].iov_base = U->window[1];
+	Io[1].iov_len  = U->window_cap;
+	U->fixed = (0 == syscall(__NR_io_uring_register, U->ring.fd, IORING_REGISTER_BUFFERS, Io, 2));
+
+	U->nfree = WAV_URING_DEPTH;
+	for (int i=0; i < WAV_URING_DEPTH; ++i) U->free_reads[i] = i;
+	WAV__mutex_init(&U->lock);
+	WAV__cond_init(&U->cond);
+
+	WAV__uring_worker W[WAV_BATCH_MAX_THREADS];
+	WAV__thread       T[WAV_BATCH_MAX_THREADS];
+	int Started = 1;
+	for (int i=0; i < threads; ++i) {
+		W[i].batch  = U;
+		W[i].worker = i;
+	}
+	for (; Started < threads; ++Started) {
+		if (!WAV__thread_start(T + Started, WAV__uring_thread, W + Started)) break;
+	}
+
+	// this thread reads one window while the decoders work on the other
+	WAV_BOOL Broken = 0;
+	int Win = 0;
+	for (int First = 0; First < count; Win ^= 1) {
+		WAV__mutex_lock(&U->lock);
+		while (U->busy[Win]) WAV__cond_wait(&U->cond, &U->lock);
+		WAV__mutex_unlock(&U->lock);
+
+		int Last = WAV__uring_fill(U, First, Win);
+		if (!Broken) Broken = !WAV__uring_read_window(U, First, Last);
+		for (int i=First; i < Last; ++i) {
+			WAV__uring_file *F = U->files + i;
+			if (Broken && F->done != F->size) F->failed = 1;
+			if (F->fd >= 0) close(F->fd);
+			F->fd = -1;
+		}
+
+		WAV__mutex_lock(&U->lock);
+		U->busy[Win] = Last - First;
+		U->ready     = Last;
+		WAV__cond_broadcast(&U->cond);
+		WAV__mutex_unlock(&U->lock);
+
+		if (1 == Started) WAV__uring_decode(U, 0, 0);
+		First = Last;
+	}
+
+	WAV__uring_decode(U, 0, 1); // this thread is worker 0
+	for (int i=1; i < Started; ++i) WAV__thread_join(T[i]);
+
+	WAV__uring_free(&U->ring);
+	int Loaded = (int)U->batch.loaded;
+	WAV_FREE(U->files);
+	WAV_FREE(U->window[0]);
+	WAV_FREE(U->window[1]);
+	WAV_FREE(U);
+	return(Loaded);
+}
+
+#endif // WAV_IO_URING
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - async loading
+//
+#define WAV_ASYNC_MAX_THREADS 64
+
+struct WAV_Request {
+	volatile long   cancel;
+	int             status;
+	int             refs;     // the caller and the loader
+	int             taken;
+	WAV_Request   * next;     // queue
+
+	char          * filename; // or
+	const int8_t  * buffer;
+	int             len;
+
+	WAV_Done        done;
+	void          * user;
+	WAV_Data        result;
+};
+
+static struct {
+	volatile long   state;    // 0 stopped, 1 starting, 2 running
+	int             quit;
+	WAV__mutex      lock;
+	WAV__cond       wake;     // work for the loader threads
+	WAV__cond       finished; // a request finished
+	WAV_Request   * head;
+	WAV_Request   * tail;
+	int             nthreads;
+	WAV__thread     threads[WAV_ASYNC_MAX_THREADS];
+	WAV_Submit      submit;
+	void          * submit_user;
+} WAV__async;
+
+// drops a reference; call with the lock held
+static void WAV__request_release(WAV_Request *R)
+{
+	if (--R->refs) return;
+	WAV_free(&R->result);
+	WAV_FREE(R->filename);
+	WAV_FREE(R);
+}
+
+static void WAV__async_run(void *Job)
+{
+	WAV_Request *R = (WAV_Request *)Job;
+
+	WAV__mutex_lock(&WAV__async.lock);
+	int Status = WAV__atomic_get(&R->cancel) ? WAV_REQUEST_CANCELLED : WAV_REQUEST_RUNNING;
+	R->status = Status;
+	WAV__mutex_unlock(&WAV__async.lock);
+
+	if (WAV_REQUEST_RUNNING == Status) {
+		WAV__ctx Context = {0};
+		WAV_BOOL Ok = 0;
+#ifndef WAV_NO_STDIO
+		if (R->filename) {
+			FILE *F = fopen(R->filename, "rb");
+			if (F) {
+				WAV__start_file(&Context, F);
+				Context.cancel = &R->cancel;
+				Ok = WAV__decode_main(&Context, &R->result);
+				fclose(F);
+			}
+		} else
+#endif
+		{
+			WAV__start_mem(&Context, (int8_t *)R->buffer, R->len);
+			Context.cancel = &R->cancel;
+			Ok = WAV__decode_main(&Context, &R->result);
+		}
+		if (WAV__atomic_get(&R->cancel)) Status = WAV_REQUEST_CANCELLED;
+		else if (Ok)                   Status = WAV_REQUEST_DONE;
+		else                           Status = WAV_REQUEST_FAILED;
+		if (WAV_REQUEST_DONE != Status) WAV_free(&R->result);
+	}
+
+	if (R->done) R->done(R, &R->result, Status, R->user);
+
+	WAV__mutex_lock(&WAV__async.lock);
+	R->status = Status;
+	WAV__cond_broadcast(&WAV__async.finished);
+	WAV__request_release(R);
+	WAV__mutex_unlock(&WAV__async.lock);
+}
+
+WAV__THREAD_PROC(WAV__async_thread, Arg)
+{
+	(void)Arg;
+	for (;;) {
+		WAV__mutex_lock(&WAV__async.lock);
+		while (!WAV__async.head && !WAV__async.quit)
+			WAV__cond_wait(&WAV__async.wake, &WAV__async.lock);
+		WAV_Request *R = WAV__async.head;
+		if (R) {
+			WAV__async.head = R->next;
+			if (!WAV__async.head) WAV__async.tail = 0;
+		}
+		WAV__mutex_unlock(&WAV__async.lock);
+
+		if (!R) break; // quit, and the queue is empty
+		WAV__async_run(R);
+	}
+	return(0);
+}
+
+WAV_DECL WAV_BOOL
+WAV_async_init (int threads, WAV_Submit submit, void *user)
+{
+#ifdef WAV_NO_THREADS
+	// the lock and wake-ups are no-ops, so a request finishing on another
+	// thread couldn't tell a WAV_request_wait
+	if (submit) {
+		WAV_ERR("WAV_NO_THREADS can't take an executor\n");
+		return(0);
+	}
+#endif
+	// the first caller starts it, anyone racing it waits until it has
+	if (WAV__atomic_cas(&WAV__async.state, 0, 1)) {
+		while (2 != WAV__atomic_get(&WAV__async.state)) WAV__thread_yield();
+		return(1);
+	}
+	WAV__mutex_init(&WAV__async.lock);
+	WAV__cond_init(&WAV__async.wake);
+	WAV__cond_init(&WAV__async.finished);
+	WAV__async.quit        = 0;
+	WAV__async.head        = WAV__async.tail = 0;
+	WAV__async.submit      = submit;
+	WAV__async.submit_user = user;
+	WAV__async.nthreads    = 0;
+
+	if (!submit) {
+		if (threads <= 0) threads = WAV__cpu_count();
+		if (threads > WAV_ASYNC_MAX_THREADS) threads = WAV_ASYNC_MAX_THREADS;
+		for (int i=0; i < threads; ++i) {
+			if (!WAV__thread_start(WAV__async.threads + i, WAV__async_thread, 0)) break;
+			++WAV__async.nthreads;
+		}
+	}
+	WAV__atomic_inc(&WAV__async.state); // running
+	return(1);
+}
+
+WAV_DECL void
+WAV_async_shutdown (void)
+{
+	if (2 != WAV__atomic_get(&WAV__async.state)) return;
+
+	WAV__mutex_lock(&WAV__async.lock);
+	for (WAV_Request *R = WAV__async.head; R; R = R->next) WAV__atomic_inc(&R->cancel);
+	WAV__async.quit = 1;
+	WAV__cond_broadcast(&WAV__async.wake);
+	WAV__mutex_unlock(&WAV__async.lock);
+
+	for (int i=0; i < WAV__async.nthreads; ++i) WAV__thread_join(WAV__async.threads[i]);
+	WAV__async.nthreads = 0;
+	WAV__atomic_cas(&WAV__async.state, 2, 0);
+}
+
+static WAV_Request *WAV__request_submit(WAV_Request *R)
+{
+	if (2 != WAV__atomic_get(&WAV__async.state)) WAV_async_init(0, 0, 0);
+
+	R->refs   = 2;
+	R->status = WAV_REQUEST_PENDING;
+	if (WAV__async.submit) {
+		WAV__async.submit(WAV__async.submit_user, WAV__async_run, R);
+	} else if (!WAV__async.nthreads) {
+		WAV__async_run(R); // no threads to be had: load it now
+	} else {
+		WAV__mutex_lock(&WAV__async.lock);
+		if (WAV__async.tail) WAV__async.tail->next = R;
+		else               WAV__async.head = R;
+		WAV__async.tail = R;
+		WAV__cond_broadcast(&WAV__async.wake);
+		WAV__mutex_unlock(&WAV__async.lock);
+	}
+	return(R);
+}
+
+static WAV_Request *WAV__request_alloc(WAV_Done done, void *user)
+{
+	WAV_Request *R = (WAV_Request *)WAV_MALLOC(sizeof(WAV_Request));
+	if (!R) return(0);
+	memset(R, 0, sizeof(WAV_Request));
+	R->done = done;
+	R->user = user;
+	return(R);
+}
+
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_Request *
+WAV_load_async (const char *filename, WAV_Done done, void *user)
+{
+	WAV_ASSERT(filename, "invalid arg");
+	WAV_Request *R = WAV__request_alloc(done, user);
+	if (!R) return(0);
+
+	size_t Len = strlen(filename);
+	R->filename = (char *)WAV_MALLOC(Len + 1);
+	if (!R->filename) {
+		WAV_FREE(R);
+		return(0);
+	}
+	memcpy(R->filename, filename, Len + 1);
+	return(WAV__request_submit(R));
+}
+#endif
+
+WAV_DECL WAV_Request *
+WAV_load_from_memory_async (const int8_t *buffer, int len, WAV_Done done, void *user)
+{
+	WAV_ASSERT(buffer, "invalid arg");
+	WAV_Request *R = WAV__request_alloc(done, user);
+	if (!R) return(0);
+	R->buffer = buffer;
+	R->len    = len;
+	return(WAV__request_submit(R));
+}
+
+WAV_DECL int
+WAV_request_status (WAV_Request *R)
+{
+	WAV__mutex_lock(&WAV__async.lock);
+	int Status = R->status;
+	WAV__mutex_unlock(&WAV__async.lock);
+	return(Status);
+}
+
+WAV_DECL int
+WAV_request_wait (WAV_Request *R)
+{
+	WAV__mutex_lock(&WAV__async.lock);
+	while (R->status < WAV_REQUEST_DONE)
+		WAV__cond_wait(&WAV__async.finished, &WAV__async.lock);
+	int Status = R->status;
+	WAV__mutex_unlock(&WAV__async.lock);
+	return(Status);
+}
+
+WAV_DECL void
+WAV_request_cancel (WAV_Request *R)
+{
+	WAV__atomic_inc(&R->cancel);
+}
+
+WAV_DECL WAV_BOOL
+WAV_request_take (WAV_Request *R, WAV_Data *out)
+{
+	WAV_BOOL Ok = 0;
+	WAV__mutex_lock(&WAV__async.lock);
+	if (WAV_REQUEST_DONE == R->status && !R->taken) {
+		*out = R->result;
+		memset(&R->result, 0, sizeof(WAV_Data));
+		R->taken = 1;
+		Ok = 1;
+	}
+	WAV__mutex_unlock(&WAV__async.lock);
+	return(Ok);
+}
+
+WAV_DECL void
+WAV_request_free (WAV_Request *R)
+{
+	if (!R) return;
+	WAV__atomic_inc(&R->cancel);
+	WAV__mutex_lock(&WAV__async.lock);
+	WAV__request_release(R);
+	WAV__mutex_unlock(&WAV__async.lock);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - hot reload
+//
+#ifdef WAV__WATCHING
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+struct WAV__watched {
+	WAV__watched * next;
+	WAV_Data     * data;    // what WAV_load filled
+	char         * path;
+	const char   * name;    // the part of path after the directory
+	int            wd;      // the directory's inotify watch
+	int            dirty;   // written since the thread last looked
+	int            busy;    // being loaded on the thread
+	int            dropped; // unwatched while busy; the thread frees it
+	uint64_t       hash;    // of the file 'data' came from
+
+	// a finished reload, for WAV_watch_poll
+	int            ready;
+	WAV_Data       next_data;
+	uint64_t       next_hash;
+};
+
+// continues hash H over N more bytes; split a stream at multiples of 8
+static uint64_t WAV__hash_bytes(uint64_t H, const uint8_t *P, size_t N)
+{
+	for (; N >= 8; P += 8, N -= 8) {
+		uint64_t V;
+		memcpy(&V, P, 8);
+		H  = (H ^ V) * 0x100000001b3ull;
+		H ^= H >> 29;
+	}
+	for (; N; ++P, --N) H = (H ^ *P) * 0x100000001b3ull;
+	return(H);
+}
+
+#define WAV__HASH_BLOCK (64 * 1024)
+
+// hashes all of F a block at a time, and leaves it back at the start
+static WAV_BOOL WAV__hash_file(FILE *F, uint64_t *Hash)
+{
+	uint8_t *Block = (uint8_t *)WAV_MALLOC(WAV__HASH_BLOCK);
+	if (!Block) return(0);
+
+	uint64_t H     = 0xcbf29ce484222325ull;
+	uint64_t Total = 0;
+	size_t   Got;
+	while ((Got = fread(Block, 1, WAV__HASH_BLOCK, F)) > 0) {
+		H      = WAV__hash_bytes(H, Block, Got);
+		Total += Got;
+	}
+	WAV_BOOL Ok = !ferror(F) && 0 == fseek(F, 0, SEEK_SET);
+	WAV_FREE(Block);
+	*Hash = H ^ Total;
+	return(Ok);
+}
+
+static void WAV__watched_free(WAV__watched *W)
+{
+	WAV_free(&W->next_data);
+	WAV_FREE(W->path);
+	WAV_FREE(W);
+}
+
+// removes the directory's watch once no watched file uses it; call with the
+// lock held. inotify gives each directory one wd, so files in it share it
+static void WAV__watch_release(int wd)
+{
+	for (WAV__watched *W = WAV__watch.head; W; W = W->next)
+		if (W->wd == wd) return;
+	inotify_rm_watch(WAV__watch.fd, wd);
+}
+
+static void WAV__watch_drop(WAV_Data *D)
+{
+	if (!WAV__watch.started) return;
+
+	WAV__watched *Gone = 0;
+	WAV__mutex_lock(&WAV__watch.lock);
+	for (WAV__watched **P = &WAV__watch.head; *P; ) {
+		WAV__watched *W = *P;
+		if (W->data != D) {
+			P = &W->next;
+			continue;
+		}
+		*P = W->next;
+		WAV__watch_release(W->wd);
+		if (W->busy) {
+			W->dropped = 1;
+		} else {
+			W->next = Gone;
+			Gone    = W;
+		}
+	}
+	WAV__mutex_unlock(&WAV__watch.lock);
+
+	// freeing clips takes the lock again
+	while (Gone) {
+		WAV__watched *Next = Gone->next;
+		WAV__watched_free(Gone);
+		Gone = Next;
+	}
+}
+
+static void WAV__watch_add(const char *Path, WAV_Data *D, uint64_t Hash)
+{
+	WAV__watch_drop(D);
+
+	WAV__watched *W = (WAV__watched *)WAV_MALLOC(sizeof(WAV__watched));
+	if (!W) return;
+	memset(W, 0, sizeof(WAV__watched));
+
+	size_t N = strlen(Path);
+	W->path = (char *)WAV_MALLOC(N + 1);
+	if (!W->path) {
+		WAV__watched_free(W);
+		return;
+	}
+	memcpy(W->path, Path, N + 1);
+	W->data = D;
+	W->hash = Hash;
+
+	// editors save by renaming over the file, so watch the directory. the
+	// lock keeps a drop from removing a shared watch before W is listed
+	WAV__mutex_lock(&WAV__watch.lock);
+	char *Slash = strrchr(W->path, '/');
+	if (Slash) {
+		*Slash  = 0;
+		W->wd   = inotify_add_watch(WAV__watch.fd, (Slash == W->path) ? "/" : W->path, IN_CLOSE_WRITE | IN_MOVED_TO);
+		*Slash  = '/';
+		W->name = Slash + 1;
+	} else {
+		W->wd   = inotify_add_watch(WAV__watch.fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO);
+		W->name = W->path;
+	}
+	if (W->wd >= 0) {
+		W->next = WAV__watch.head;
+		WAV__watch.head = W;
+	}
+	WAV__mutex_unlock(&WAV__watch.lock);
+
+	if (W->wd < 0) {
+		WAV_ERR("wav: can't watch %s\n", Path);
+		WAV__watched_free(W);
+	}
+}
+
+// the clip and the hash come from the same open file, so a save that
+// renames over it can't slip past; one written in place sends another event
+static WAV_BOOL WAV__watch_load(const char *filename, WAV_Data *out)
+{
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		WAV_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	uint64_t Hash = 0;
+	WAV_BOOL R    = 0;
+	if (WAV__hash_file(F, &Hash)) {
+		R = WAV_load_from_file(F, out);
+	} else {
+		memset(out, 0, sizeof(WAV_Data));
+	}
+	fclose(F);
+	if (R) WAV__watch_add(filename, out, Hash);
+	return(R);
+}
+
+// reloads every file that's been written, one at a time
+static void WAV__watch_reload(void)
+{
+	while (!WAV__atomic_get(&WAV__watch.quit)) {
+		WAV__mutex_lock(&WAV__watch.lock);
+		WAV__watched *W = WAV__watch.head;
+		while (W && !W->dirty) W = W->next;
+		if (!W) {
+			WAV__mutex_unlock(&WAV__watch.lock);
+			return;
+		}
+		W->dirty = 0;
+		W->busy  = 1;
+		uint64_t Installed = W->hash;
+		WAV__mutex_unlock(&WAV__watch.lock);
+
+		FILE    *F    = fopen(W->path, "rb");
+		uint64_t Hash = 0;
+		WAV_Data D    = {0};
+		WAV_BOOL Ok   = 0;
+		WAV_BOOL Same = 0;
+
+		if (!F || !WAV__hash_file(F, &Hash)) {
+			WAV_ERR("wav: can't reload %s\n", W->path);
+		} else if (Hash == Installed) {
+			Same = 1; // touched, or changed back
+		} else {
+			Ok = WAV_load_from_file(F, &D);
+		}
+		if (F) fclose(F);
+
+		WAV_Data Stale = {0};
+
+		WAV__mutex_lock(&WAV__watch.lock);
+		W->busy = 0;
+		WAV__watched *Gone = W->dropped ? W : 0;
+		if (!Gone && (Ok || (Same && Installed == W->hash))) {
+			Stale    = W->next_data;
+			W->ready = 0;
+			memset(&W->next_data, 0, sizeof(WAV_Data));
+		}
+		if (!Gone && Ok) {
+			W->ready     = 1;
+			W->next_data = D;
+			W->next_hash = Hash;
+		}
+		WAV__mutex_unlock(&WAV__watch.lock);
+
+		if (Gone) WAV__watched_free(Gone);
+		if (Gone || !Ok) WAV_free(&D);
+		WAV_free(&Stale);
+	}
+}
+
+WAV__THREAD_PROC(WAV__watch_thread, Arg)
+{
+	(void)Arg;
+	union {
+		struct inotify_event event;
+		char                 bytes[4096];
+	} Events;
+
+	while (!WAV__atomic_get(&WAV__watch.quit)) {
+		struct pollfd P[2] = {
+			{ WAV__watch.fd,      POLLIN, 0 },
+			{ WAV__watch.wake[0], POLLIN, 0 },
+		};
+		if (poll(P, 2, -1) <= 0) continue;
+		if (P[1].revents) break;
+
+		ssize_t N = read(WAV__watch.fd, Events.bytes, sizeof(Events));
+		if (N <= 0) continue;
+
+		WAV__mutex_lock(&WAV__watch.lock);
+		for (char *E = Events.bytes; E < Events.bytes + N; ) {
+			struct inotify_event *Event = (struct inotify_event *)E;
+			for (WAV__watched *W = WAV__watch.head; Event->len && W; W = W->next) {
+				if (W->wd == Event->wd && !strcmp(W->name, Event->name)) W->dirty = 1;
+			}
+			E += sizeof(struct inotify_event) + Event->len;
+		}
+		WAV__mutex_unlock(&WAV__watch.lock);
+
+		WAV__watch_reload();
+	}
+	return(0);
+}
+
+WAV_DECL WAV_BOOL
+WAV_watch_start (void)
+{
+	if (WAV__watch.started) return(1);
+
+	WAV__watch.fd = inotify_init1(IN_CLOEXEC);
+	if (WAV__watch.fd < 0) {
+		WAV_ERR("wav: no inotify\n");
+		return(0);
+	}
+	if (pipe(WAV__watch.wake)) {
+		close(WAV__watch.fd);
+		return(0);
+	}
+	WAV__mutex_init(&WAV__watch.lock);
+	WAV__watch.quit = 0;
+	WAV__watch.head = 0;
+	if (!WAV__thread_start(&WAV__watch.thread, WAV__watch_thread, 0)) {
+		close(WAV__watch.wake[0]);
+		close(WAV__watch.wake[1]);
+		close(WAV__watch.fd);
+		return(0);
+	}
+	WAV__watch.started = 1;
+	return(1);
+}
+
+WAV_DECL int
+WAV_watch_poll (void)
+{
+	if (!WAV__watch.started) return(0);
+
+	int Swapped = 0;
+	for (;;) {
+		WAV__mutex_lock(&WAV__watch.lock);
+		WAV__watched *W = WAV__watch.head;
+		while (W && !W->ready) W = W->next;
+		if (!W) {
+			WAV__mutex_unlock(&WAV__watch.lock);
+			break;
+		}
+
+		WAV_Data Old = *W->data;
+		*W->data = W->next_data;
+		memset(&W->next_data, 0, sizeof(WAV_Data));
+		W->hash  = W->next_hash;
+		W->ready = 0;
+		WAV__mutex_unlock(&WAV__watch.lock);
+
+		WAV_free(&Old);
+		Swapped += 1;
+	}
+	return(Swapped);
+}
+
+WAV_DECL void
+WAV_unwatch (WAV_Data *data)
+{
+	WAV__watch_drop(data);
+}
+
+WAV_DECL void
+WAV_watch_stop (void)
+{
+	if (!WAV__watch.started) return;
+
+	WAV__atomic_inc(&WAV__watch.quit);
+	if (write(WAV__watch.wake[1], "q", 1) < 0) {
+		WAV_ERR("wav: can't wake the watcher\n");
+	}
+	WAV__thread_join(WAV__watch.thread);
+	close(WAV__watch.wake[0]);
+	close(WAV__watch.wake[1]);
+	close(WAV__watch.fd);
+
+	// nothing else takes the lock now
+	WAV__watched *W = WAV__watch.head;
+	WAV__watch.head    = 0;
+	WAV__watch.started = 0;
+	while (W) {
+		WAV__watched *Next = W->next;
+		WAV__watched_free(W);
+		W = Next;
+	}
+}
+
+#endif // WAV__WATCHING
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - conversion
+//
+WAV_DECL void
+WAV_convert_to_8bit  (WAV_Data *Loaded)
+{
+	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
+	if (WAV_4BIT == Loaded->wBitsPerSample && !WAV_decode_adpcm(Loaded)) return;
+	if (WAV_8BIT == Loaded->wBitsPerSample) return; // no conversion needed
+
+	WAV_DBG(" - WAV: converting to 8bit - \n");
+
+	WAV__STAT_BEGIN(ConvertStart);
+	WAV__TRACE_BEGIN("convert", WAV_8BIT);
+	size_t N = (size_t)Loaded->dwSamples * Loaded->wChannels;
+	int8_t *NewData = (int8_t *)WAV_MALLOC(N);
+	int8_t *D = NewData;
+
+	switch (Loaded->wBitsPerSample) {
+		case WAV_16BIT:
+		{
+			int16_t  *P = (int16_t *)Loaded->data;
+			for (size_t i=0; i < N; ++i)
+				*(D++) = (int8_t)(*(P++)/32767.0f * 127.0f);
+		} break;
+		case WAV_FLOAT:
+		{
+			float   *P = (float *)Loaded->data;
+			for (size_t i=0; i < N; ++i)
+				*(D++) = (int8_t)(*(P++) * 127.0f);
+		} break;
+		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	}
+	WAV_FREE(Loaded->data);
+	WAV__TRACE_END("convert");
+	WAV__STAT_END(ConvertStart, WAV_STATS_CONVERT);
+	Loaded->wFormatTag = WAV_FORMAT_PCM;
+	Loaded->wBitsPerSample = WAV_8BIT;
+	Loaded->qwDataSize = N;
+	Loaded->data = (int8_t *)NewData;
+}
+
+WAV_DECL void
+WAV_convert_to_16bit (WAV_Data *Loaded)
+{
+	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
+	if (WAV_4BIT == Loaded->wBitsPerSample && !WAV_decode_adpcm(Loaded)) return;
+	if (WAV_16BIT == Loaded->wBitsPerSample) return; // no conversion needed
+
+	WAV_DBG(" - WAV: converting to 8bit - \n");
+
+	WAV__STAT_BEGIN(ConvertStart);
+	WAV__TRACE_BEGIN("convert", WAV_16BIT);
+	size_t N = (size_t)Loaded->dwSamples * Loaded->wChannels;
+	int16_t *NewData = (int16_t *)WAV_MALLOC(N * 2);
+	int16_t *D = NewData;
+
+	switch (Loaded->wBitsPerSample) {
+		case WAV_8BIT:
+		{
+			int8_t  *P = (int8_t *)Loaded->data;
+			for (size_t i=0; i < N; ++i)
+				*(D++) = (int16_t)(*(P++)/127.0f * 32767.0f);
+		} break;
+		case WAV_FLOAT:
+		{
+			float   *P = (float *)Loaded->data;
+			for (size_t i=0; i < N; ++i)
+				*(D++) = (int16_t)(*(P++) * 32767.0f);
+		} break;
+		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	}
+	WAV_FREE(Loaded->data);
+	WAV__TRACE_END("convert");
+	WAV__STAT_END(ConvertStart, WAV_STATS_CONVERT);
+	Loaded->wFormatTag = WAV_FORMAT_PCM;
+	Loaded->wBitsPerSample = WAV_16BIT;
+	Loaded->qwDataSize = N * 2;
+	Loaded->data = (int8_t *)NewData;
+}
+
+WAV_DECL void
+WAV_convert_to_float (WAV_Data *Loaded)
+{
+	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
+	if (WAV_4BIT == Loaded->wBitsPerSample && !WAV_decode_adpcm(Loaded)) return;
+	if (WAV_FLOAT == Loaded->wBitsPerSample) return; // no conversion needed
+
+	WAV_DBG(" - WAV: converting to 8bit - \n");
+
+	WAV__STAT_BEGIN(ConvertStart);
+	WAV__TRACE_BEGIN("convert", WAV_FLOAT);
+	size_t N = (size_t)Loaded->dwSamples * Loaded->wChannels;
+	float *NewData = (float *)WAV_MALLOC(N * 4);
+	float *D = NewData;
+
+	switch (Loaded->wBitsPerSample) {
+		case WAV_8BIT:
+		{
+			int8_t  *P = (int8_t *)Loaded->data;
+			for (size_t i=0; i < N; ++i)
+				*(D++) = (*(P++)/127.0f);
+		} break;
+		case WAV_16BIT:
+		{
+			int16_t  *P = (int16_t *)Loaded->data;
+			for (size_t i=0; i < N; ++i)
+				*(D++) = (*(P++)/32767.0f);
+		} break;
+		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	}
+	WAV_FREE(Loaded->data);
+	WAV__TRACE_END("convert");
+	WAV__STAT_END(ConvertStart, WAV_STATS_CONVERT);
+	Loaded->wFormatTag = WAV_FORMAT_FLOAT;
+	Loaded->wBitsPerSample = WAV_FLOAT;
+	Loaded->qwDataSize = N * 4;
+	Loaded->data = (int8_t *)NewData;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - ADPCM
+//
+static const int16_t WAV__ima_steps[89] = {
+	    7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+	   19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+	   50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+	  130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+	  337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+	  876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+	 2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+	 5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t WAV__ima_index[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int16_t WAV__ms_adapt[16] = {
+	230, 230, 230, 230, 307, 409, 512, 614,
+	768, 614, 512, 409, 307, 230, 230, 230
+};
+
+// IMA step state x nibble -> signed difference and next step state, so the
+// inner loop is two loads and a clamp. worked out from WAV__ima_steps and
+// WAV__ima_index: diff = (step >> 3) + step (bit 2) + step >> 1 (bit 1)
+// + step >> 2 (bit 0), negated by bit 3; next = state + index, kept in 0..88
+static const int32_t WAV__ima_diff[89 * 16] = {
+	     0,     1,     3,     4,     7,     8,    10,    11,     0,    -1,    -3,    -4,    -7,    -8,   -10,   -11,
+	     1,     3,     5,     7,     9,    11,    13,    15,    -1,    -3,    -5,    -7,    -9,   -11,   -13,   -15,
+	     1,     3,     5,     7,    10,    12,    14,    16,    -1,    -3,    -5,    -7,   -10,   -12,   -14,   -16,
+	     1,     3,     6,     8,    11,    13,    16,    18,    -1,    -3,    -6,    -8,   -11,   -13,   -16,   -18,
+	     1,     3,     6,     8,    12,    14,    17,    19,    -1,    -3,    -6,    -8,   -12,   -14,   -17,   -19,
+	     1,     4,     7,    10,    13,    16,    19,    22,    -1,    -4,    -7,   -10,   -13,   -16,   -19,   -22,
+	     1,     4,     7,    10,    14,    17,    20,    23,    -1,    -4,    -7,   -10,   -14,   -17,   -20,   -23,
+	     1,     4,     8,    11,    15,    18,    22,    25,    -1,    -4,    -8,   -11,   -15,   -18,   -22,   -25,
+	     2,     6,    10,    14,    18,    22,    26,    30,    -2,    -6,   -10,   -14,   -18,   -22,   -26,   -30,
+	     2,     6,    10,    14,    19,    23,    27,    31,    -2,    -6,   -10,   -14,   -19,   -23,   -27,   -31,
+	     2,     6,    11,    15,    21,    25,    30,    34,    -2,    -6,   -11,   -15,   -21,   -25,   -30,   -34,
+	     2,     7,    12,    17,    23,    28,    33,    38,    -2,    -7,   -12,   -17,   -23,   -28,   -33,   -38,
+	     2,     7,    13,    18,    25,    30,    36,    41,    -2,    -7,   -13,   -18,   -25,   -30,   -36,   -41,
+	     3,     9,    15,    21,    28,    34,    40,    46,    -3,    -9,   -15,   -21,   -28,   -34,   -40,   -46,
+	     3,    10,    17,    24,    31,    38,    45,    52,    -3,   -10,   -17,   -24,   -31,   -38,   -45,   -52,
+	     3,    10,    18,    25,    34,    41,    49,    56,    -3,   -10,   -18,   -25,   -34,   -41,   -49,   -56,
+	     4,    12,    21,    29,    38,    46,    55,    63,    -4,   -12,   -21,   -29,   -38,   -46,   -55,   -63,
+	     4,    13,    22,    31,    41,    50,    59,    68,    -4,   -13,   -22,   -31,   -41,   -50,   -59,   -68,
+	     5,    15,    25,    35,    46,    56,    66,    76,    -5,   -15,   -25,   -35,   -46,   -56,   -66,   -76,
+	     5,    16,    27,    38,    50,    61,    72,    83,    -5,   -16,   -27,   -38,   -50,   -61,   -72,   -83,
+	     6,    18,    31,    43,    56,    68,    81,    93,    -6,   -18,   -31,   -43,   -56,   -68,   -81,   -93,
+	     6,    19,    33,    46,    61,    74,    88,   101,    -6,   -19,   -33,   -46,   -61,   -74,   -88,  -101,
+	     7,    22,    37,    52,    67,    82,    97,   112,    -7,   -22,   -37,   -52,   -67,   -82,   -97,  -112,
+	     8,    24,    41,    57,    74,    90,   107,   123,    -8,   -24,   -41,   -57,   -74,   -90,  -107,  -123,
+	     9,    27,    45,    63,    82,   100,   118,   136,    -9,   -27,   -45,   -63,   -82,  -100,  -118,  -136,
+	    10,    30,    50,    70,    90,   110,   130,   150,   -10,   -30,   -50,   -70,   -90,  -110,  -130,  -150,
+	    11,    33,    55,    77,    99,   121,   143,   165,   -11,   -33,   -55,   -77,   -99,  -121,  -143,  -165,
+	    12,    36,    60,    84,   109,   133,   157,   181,   -12,   -36,   -60,   -84,  -109,  -133,  -157,  -181,
+	    13,    39,    66,    92,   120,   146,   173,   199,   -13,   -39,   -66,   -92,  -120,  -146,  -173,  -199,
+	    14,    43,    73,   102,   132,   161,   191,   220,   -14,   -43,   -73,  -102,  -132,  -161,  -191,  -220,
+	    16,    48,    81,   113,   146,   178,   211,   243,   -16,   -48,   -81,  -113,  -146,  -178,  -211,  -243,
+	    17,    52,    88,   123,   160,   195,   231,   266,   -17,   -52,   -88,  -123,  -160,  -195,  -231,  -266,
+	    19,    58,    97,   136,   176,   215,   254,   293,   -19,   -58,   -97,  -136,  -176,  -215,  -254,  -293,
+	    21,    64,   107,   150,   194,   237,   280,   323,   -21,   -64,  -107,  -150,  -194,  -237,  -280,  -323,
+	    23,    70,   118,   165,   213,   260,   308,   355,   -23,   -70,  -118,  -165,  -213,  -260,  -308,  -355,
+	    26,    78,   130,   182,   235,   287,   339,   391,   -26,   -78,  -130,  -182,  -235,  -287,  -339,  -391,
+	    28,    85,   143,   200,   258,   315,   373,   430,   -28,   -85,  -143,  -200,  -258,  -315,  -373,  -430,
+	    31,    94,   157,   220,   284,   347,   410,   473,   -31,   -94,  -157,  -220,  -284,  -347,  -410,  -473,
+	    34,   103,   173,   242,   313,   382,   452,   521,   -34,  -103,  -173,  -242,  -313,  -382,  -452,  -521,
+	    38,   114,   191,   267,   345,   421,   498,   574,   -38,  -114,  -191,  -267,  -345,  -421,  -498,  -574,
+	    42,   126,   210,   294,   379,   463,   547,   631,   -42,  -126,  -210,  -294,  -379,  -463,  -547,  -631,
+	    46,   138,   231,   323,   417,   509,   602,   694,   -46,  -138,  -231,  -323,  -417,  -509,  -602,  -694,
+	    51,   153,   255,   357,   459,   561,   663,   765,   -51,  -153,  -255,  -357,  -459,  -561,  -663,  -765,
+	    56,   168,   280,   392,   505,   617,   729,   841,   -56,  -168,  -280,  -392,  -505,  -617,  -729,  -841,
+	    61,   184,   308,   431,   555,   678,   802,   925,   -61,  -184,  -308,  -431,  -555,  -678,  -802,  -925,
+	    68,   204,   340,   476,   612,   748,   884,  1020,   -68,  -204,  -340,  -476,  -612,  -748,  -884, -1020,
+	    74,   223,   373,   522,   672,   821,   971,  1120,   -74,  -223,  -373,  -522,  -672,  -821,  -971, -1120,
+	    82,   246,   411,   575,   740,   904,  1069,  1233,   -82,  -246,  -411,  -575,  -740,  -904, -1069, -1233,
+	    90,   271,   452,   633,   814,   995,  1176,  1357,   -90,  -271,  -452,  -633,  -814,  -995, -1176, -1357,
+	    99,   298,   497,   696,   895,  1094,  1293,  1492,   -99,  -298,  -497,  -696,  -895, -1094, -1293, -1492,
+	   109,   328,   547,   766,   985,  1204,  1423,  1642,  -109,  -328,  -547,  -766,  -985, -1204, -1423, -1642,
+	   120,   360,   601,   841,  1083,  1323,  1564,  1804,  -120,  -360,  -601,  -841, -1083, -1323, -1564, -1804,
+	   132,   397,   662,   927,  1192,  1457,  1722,  1987,  -132,  -397,  -662,  -927, -1192, -1457, -1722, -1987,
+	   145,   436,   728,  1019,  1311,  1602,  1894,  2185,  -145,  -436,  -728, -1019, -1311, -1602, -1894, -2185,
+	   160,   480,   801,  1121,  1442,  1762,  2083,  2403,  -160,  -480,  -801, -1121, -1442, -1762, -2083, -2403,
+	   176,   528,   881,  1233,  1587,  1939,  2292,  2644,  -176,  -528,  -881, -1233, -1587, -1939, -2292, -2644,
+	   194,   582,   970,  1358,  1746,  2134,  2522,  2910,  -194,  -582,  -970, -1358, -1746, -2134, -2522, -2910,
+	   213,   639,  1066,  1492,  1920,  2346,  2773,  3199,  -213,  -639, -1066, -1492, -1920, -2346, -2773, -3199,
+	   234,   703,  1173,  1642,  2112,  2581,  3051,  3520,  -234,  -703, -1173, -1642, -2112, -2581, -3051, -3520,
+	   258,   774,  1291,  1807,  2324,  2840,  3357,  3873,  -258,  -774, -1291, -1807, -2324, -2840, -3357, -3873,
+	   284,   852,  1420,  1988,  2556,  3124,  3692,  4260,  -284,  -852, -1420, -1988, -2556, -3124, -3692, -4260,
+	   312,   936,  1561,  2185,  2811,  3435,  4060,  4684,  -312,  -936, -1561, -2185, -2811, -3435, -4060, -4684,
+	   343,  1030,  1717,  2404,  3092,  3779,  4466,  5153,  -343, -1030, -1717, -2404, -3092, -3779, -4466, -5153,
+	   378,  1134,  1890,  2646,  3402,  4158,  4914,  5670,  -378, -1134, -1890, -2646, -3402, -4158, -4914, -5670,
+	   415,  1246,  2078,  2909,  3742,  4573,  5405,  6236,  -415, -1246, -2078, -2909, -3742, -4573, -5405, -6236,
+	   457,  1372,  2287,  3202,  4117,  5032,  5947,  6862,  -457, -1372, -2287, -3202, -4117, -5032, -5947, -6862,
+	   503,  1509,  2516,  3522,  4529,  5535,  6542,  7548,  -503, -1509, -2516, -3522, -4529, -5535, -6542, -7548,
+	   553,  1660,  2767,  3874,  4981,  6088,  7195,  8302,  -553, -1660, -2767, -3874, -4981, -6088, -7195, -8302,
+	   608,  1825,  3043,  4260,  5479,  6696,  7914,  9131,  -608, -1825, -3043, -4260, -5479, -6696, -7914, -9131,
+	   669,  2008,  3348,  4687,  6027,  7366,  8706, 10045,  -669, -2008, -3348, -4687, -6027, -7366, -8706,-10045,
+	   736,  2209,  3683,  5156,  6630,  8103,  9577, 11050,  -736, -2209, -3683, -5156, -6630, -8103, -9577,-11050,
+	   810,  2431,  4052,  5673,  7294,  8915, 10536, 12157,  -810, -2431, -4052, -5673, -7294, -8915,-10536,-12157,
+	   891,  2674,  4457,  6240,  8023,  9806, 11589, 13372,  -891, -2674, -4457, -6240, -8023, -9806,-11589,-13372,
+	   980,  2941,  4902,  6863,  8825, 10786, 12747, 14708,  -980, -2941, -4902, -6863, -8825,-10786,-12747,-14708,
+	  1078,  3235,  5393,  7550,  9708, 11865, 14023, 16180, -1078, -3235, -5393, -7550, -9708,-11865,-14023,-16180,
+	  1186,  3559,  5932,  8305, 10679, 13052, 15425, 17798, -1186, -3559, -5932, -8305,-10679,-13052,-15425,-17798,
+	  1305,  3915,  6526,  9136, 11747, 14357, 16968, 19578, -1305, -3915, -6526, -9136,-11747,-14357,-16968,-19578,
+	  1435,  4306,  7178, 10049, 12922, 15793, 18665, 21536, -1435, -4306, -7178,-10049,-12922,-15793,-18665,-21536,
+	  1579,  4737,  7896, 11054, 14214, 17372, 20531, 23689, -1579, -4737, -7896,-11054,-14214,-17372,-20531,-23689,
+	  1737,  5211,  8686, 12160, 15636, 19110, 22585, 26059, -1737, -5211, -8686,-12160,-15636,-19110,-22585,-26059,
+	  1911,  5733,  9555, 13377, 17200, 21022, 24844, 28666, -1911, -5733, -9555,-13377,-17200,-21022,-24844,-28666,
+	  2102,  6306, 10511, 14715, 18920, 23124, 27329, 31533, -2102, -6306,-10511,-14715,-18920,-23124,-27329,-31533,
+	  2312,  6937, 11562, 16187, 20812, 25437, 30062, 34687, -2312, -6937,-11562,-16187,-20812,-25437,-30062,-34687,
+	  2543,  7630, 12718, 17805, 22893, 27980, 33068, 38155, -2543, -7630,-12718,-17805,-22893,-27980,-33068,-38155,
+	  2798,  8394, 13990, 19586, 25183, 30779, 36375, 41971, -2798, -8394,-13990,-19586,-25183,-30779,-36375,-41971,
+	  3077,  9232, 15388, 21543, 27700, 33855, 40011, 46166, -3077, -9232,-15388,-21543,-27700,-33855,-40011,-46166,
+	  3385, 10156, 16928, 23699, 30471, 37242, 44014, 50785, -3385,-10156,-16928,-23699,-30471,-37242,-44014,-50785,
+	  3724, 11172, 18621, 26069, 33518, 40966, 48415, 55863, -3724,-11172,-18621,-26069,-33518,-40966,-48415,-55863,
+	  4095, 12286, 20478, 28669, 36862, 45053, 53245, 61436, -4095,-12286,-20478,-28669,-36862,-45053,-53245,-61436,
+};
+
+static const uint8_t WAV__ima_next[89 * 16] = {
+	 0,  0,  0,  0,  2,  4,  6,  8,  0,  0,  0,  0,  2,  4,  6,  8,
+	 0,  0,  0,  0,  3,  5,  7,  9,  0,  0,  0,  0,  3,  5,  7,  9,
+	 1,  1,  1,  1,  4,  6,  8, 10,  1,  1,  1,  1,  4,  6,  8, 10,
+	 2,  2,  2,  2,  5,  7,  9, 11,  2,  2,  2,  2,  5,  7,  9, 11,
+	 3,  3,  3,  3,  6,  8, 10, 12,  3,  3,  3,  3,  6,  8, 10, 12,
+	 4,  4,  4,  4,  7,  9, 11, 13,  4,  4,  4,  4,  7,  9, 11, 13,
+	 5,  5,  5,  5,  8, 10, 12, 14,  5,  5,  5,  5,  8, 10, 12, 14,
+	 6,  6,  6,  6,  9, 11, 13, 15,  6,  6,  6,  6,  9, 11, 13, 15,
+	 7,  7,  7,  7, 10, 12, 14, 16,  7,  7,  7,  7, 10, 12, 14, 16,
+	 8,  8,  8,  8, 11, 13, 15, 17,  8,  8,  8,  8, 11, 13, 15, 17,
+	 9,  9,  9,  9, 12, 14, 16, 18,  9,  9,  9,  9, 12, 14, 16, 18,
+	10, 10, 10, 10, 13, 15, 17, 19, 10, 10, 10, 10, 13, 15, 17, 19,
+	11, 11, 11, 11, 14, 16, 18, 20, 11, 11, 11, 11, 14, 16, 18, 20,
+	12, 12, 12, 12, 15, 17, 19, 21, 12, 12, 12, 12, 15, 17, 19, 21,
+	13, 13, 13, 13, 16, 18, 20, 22, 13, 13, 13, 13, 16, 18, 20, 22,
+	14, 14, 14, 14, 17, 19, 21, 23, 14, 14, 14, 14, 17, 19, 21, 23,
+	15, 15, 15, 15, 18, 20, 22, 24, 15, 15, 15, 15, 18, 20, 22, 24,
+	16, 16, 16, 16, 19, 21, 23, 25, 16, 16, 16, 16, 19, 21, 23, 25,
+	17, 17, 17, 17, 20, 22, 24, 26, 17, 17, 17, 17, 20, 22, 24, 26,
+	18, 18, 18, 18, 21, 23, 25, 27, 18, 18, 18, 18, 21, 23, 25, 27,
+	19, 19, 19, 19, 22, 24, 26, 28, 19, 19, 19, 19, 22, 24, 26, 28,
+	20, 20, 20, 20, 23, 25, 27, 29, 20, 20, 20, 20, 23, 25, 27, 29,
+	21, 21, 21, 21, 24, 26, 28, 30, 21, 21, 21, 21, 24, 26, 28, 30,
+	22, 22, 22, 22, 25, 27, 29, 31, 22, 22, 22, 22, 25, 27, 29, 31,
+	23, 23, 23, 23, 26, 28, 30, 32, 23, 23, 23, 23, 26, 28, 30, 32,
+	24, 24, 24, 24, 27, 29, 31, 33, 24, 24, 24, 24, 27, 29, 31, 33,
+	25, 25, 25, 25, 28, 30, 32, 34, 25, 25, 25, 25, 28, 30, 32, 34,
+	26, 26, 26, 26, 29, 31, 33, 35, 26, 26, 26, 26, 29, 31, 33, 35,
+	27, 27, 27, 27, 30, 32, 34, 36, 27, 27, 27, 27, 30, 32, 34, 36,
+	28, 28, 28, 28, 31, 33, 35, 37, 28, 28, 28, 28, 31, 33, 35, 37,
+	29, 29, 29, 29, 32, 34, 36, 38, 29, 29, 29, 29, 32, 34, 36, 38,
+	30, 30, 30, 30, 33, 35, 37, 39, 30, 30, 30, 30, 33, 35, 37, 39,
+	31, 31, 31, 31, 34, 36, 38, 40, 31, 31, 31, 31, 34, 36, 38, 40,
+	32, 32, 32, 32, 35, 37, 39, 41, 32, 32, 32, 32, 35, 37, 39, 41,
+	33, 33, 33, 33, 36, 38, 40, 42, 33, 33, 33, 33, 36, 38, 40, 42,
+	34, 34, 34, 34, 37, 39, 41, 43, 34, 34, 34, 34, 37, 39, 41, 43,
+	35, 35, 35, 35, 38, 40, 42, 44, 35, 35, 35, 35, 38, 40, 42, 44,
+	36, 36, 36, 36, 39, 41, 43, 45, 36, 36, 36, 36, 39, 41, 43, 45,
+	37, 37, 37, 37, 40, 42, 44, 46, 37, 37, 37, 37, 40, 42, 44, 46,
+	38, 38, 38, 38, 41, 43, 45, 47, 38, 38, 38, 38, 41, 43, 45, 47,
+	39, 39, 39, 39, 42, 44, 46, 48, 39, 39, 39, 39, 42, 44, 46, 48,
+	40, 40, 40, 40, 43, 45, 47, 49, 40, 40, 40, 40, 43, 45, 47, 49,
+	41, 41, 41, 41, 44, 46, 48, 50, 41, 41, 41, 41, 44, 46, 48, 50,
+	42, 42, 42, 42, 45, 47, 49, 51, 42, 42, 42, 42, 45, 47, 49, 51,
+	43, 43, 43, 43, 46, 48, 50, 52, 43, 43, 43, 43, 46, 48, 50, 52,
+	44, 44, 44, 44, 47, 49, 51, 53, 44, 44, 44, 44, 47, 49, 51, 53,
+	45, 45, 45, 45, 48, 50, 52, 54, 45, 45, 45, 45, 48, 50, 52, 54,
+	46, 46, 46, 46, 49, 51, 53, 55, 46, 46, 46, 46, 49, 51, 53, 55,
+	47, 47, 47, 47, 50, 52, 54, 56, 47, 47, 47, 47, 50, 52, 54, 56,
+	48, 48, 48, 48, 51, 53, 55, 57, 48, 48, 48, 48, 51, 53, 55, 57,
+	49, 49, 49, 49, 52, 54, 56, 58, 49, 49, 49, 49, 52, 54, 56, 58,
+	50, 50, 50, 50, 53, 55, 57, 59, 50, 50, 50, 50, 53, 55, 57, 59,
+	51, 51, 51, 51, 54, 56, 58, 60, 51, 51, 51, 51, 54, 56, 58, 60,
+	52, 52, 52, 52, 55, 57, 59, 61, 52, 52, 52, 52, 55, 57, 59, 61,
+	53, 53, 53, 53, 56, 58, 60, 62, 53, 53, 53, 53, 56, 58, 60, 62,
+	54, 54, 54, 54, 57, 59, 61, 63, 54, 54, 54, 54, 57, 59, 61, 63,
+	55, 55, 55, 55, 58, 60, 62, 64, 55, 55, 55, 55, 58, 60, 62, 64,
+	56, 56, 56, 56, 59, 61, 63, 65, 56, 56, 56, 56, 59, 61, 63, 65,
+	57, 57, 57, 57, 60, 62, 64, 66, 57, 57, 57, 57, 60, 62, 64, 66,
+	58, 58, 58, 58, 61, 63, 65, 67, 58, 58, 58, 58, 61, 63, 65, 67,
+	59, 59, 59, 59, 62, 64, 66, 68, 59, 59, 59, 59, 62, 64, 66, 68,
+	60, 60, 60, 60, 63, 65, 67, 69, 60, 60, 60, 60, 63, 65, 67, 69,
+	61, 61, 61, 61, 64, 66, 68, 70, 61, 61, 61, 61, 64, 66, 68, 70,
+	62, 62, 62, 62, 65, 67, 69, 71, 62, 62, 62, 62, 65, 67, 69, 71,
+	63, 63, 63, 63, 66, 68, 70, 72, 63, 63, 63, 63, 66, 68, 70, 72,
+	64, 64, 64, 64, 67, 69, 71, 73, 64, 64, 64, 64, 67, 69, 71, 73,
+	65, 65, 65, 65, 68, 70, 72, 74, 65, 65, 65, 65, 68, 70, 72, 74,
+	66, 66, 66, 66, 69, 71, 73, 75, 66, 66, 66, 66, 69, 71, 73, 75,
+	67, 67, 67, 67, 70, 72, 74, 76, 67, 67, 67, 67, 70, 72, 74, 76,
+	68, 68, 68, 68, 71, 73, 75, 77, 68, 68, 68, 68, 71, 73, 75, 77,
+	69, 69, 69, 69, 72, 74, 76, 78, 69, 69, 69, 69, 72, 74, 76, 78,
+	70, 70, 70, 70, 73, 75, 77, 79, 70, 70, 70, 70, 73, 75, 77, 79,
+	71, 71, 71, 71, 74, 76, 78, 80, 71, 71, 71, 71, 74, 76, 78, 80,
+	72, 72, 72, 72, 75, 77, 79, 81, 72, 72, 72, 72, 75, 77, 79, 81,
+	73, 73, 73, 73, 76, 78, 80, 82, 73, 73, 73, 73, 76, 78, 80, 82,
+	74, 74, 74, 74, 77, 79, 81, 83, 74, 74, 74, 74, 77, 79, 81, 83,
+	75, 75, 75, 75, 78, 80, 82, 84, 75, 75, 75, 75, 78, 80, 82, 84,
+	76, 76, 76, 76, 79, 81, 83, 85, 76, 76, 76, 76, 79, 81, 83, 85,
+	77, 77, 77, 77, 80, 82, 84, 86, 77, 77, 77, 77, 80, 82, 84, 86,
+	78, 78, 78, 78, 81, 83, 85, 87, 78, 78, 78, 78, 81, 83, 85, 87,
+	79, 79, 79, 79, 82, 84, 86, 88, 79, 79, 79, 79, 82, 84, 86, 88,
+	80, 80, 80, 80, 83, 85, 87, 88, 80, 80, 80, 80, 83, 85, 87, 88,
+	81, 81, 81, 81, 84, 86, 88, 88, 81, 81, 81, 81, 84, 86, 88, 88,
+	82, 82, 82, 82, 85, 87, 88, 88, 82, 82, 82, 82, 85, 87, 88, 88,
+	83, 83, 83, 83, 86, 88, 88, 88, 83, 83, 83, 83, 86, 88, 88, 88,
+	84, 84, 84, 84, 87, 88, 88, 88, 84, 84, 84, 84, 87, 88, 88, 88,
+	85, 85, 85, 85, 88, 88, 88, 88, 85, 85, 85, 85, 88, 88, 88, 88,
+	86, 86, 86, 86, 88, 88, 88, 88, 86, 86, 86, 86, 88, 88, 88, 88,
+	87, 87, 87, 87, 88, 88, 88, 88, 87, 87, 87, 87, 88, 88, 88, 88,
+};
+
+static int WAV__decode_ima_block(const WAV_Data *Fmt, const uint8_t *in, int bytes, int16_t *out)
+{
+	int C = Fmt->wChannels;
+	int Frames = (int)WAV__adpcm_frames(Fmt, bytes);
+	if (!Frames) return(0);
+
+	// per channel: 4 byte header, then runs of 4 bytes (8 nibbles, low first)
+	const uint8_t *Data = in + 4 * C;
+	for (int c=0; c < C; ++c) {
+		const uint8_t *H = in + 4 * c;
+		int Pred = (int16_t)(H[0] | (H[1] << 8));
+		int Idx  = (H[2] > 88) ? 88 : H[2];
+
+		int16_t *O = out + c;
+		*O = (int16_t)Pred;
+		O += C;
+
+		for (int i=1; i < Frames; ++i, O += C) {
+			int k = (i - 1) & 7;
+			const uint8_t *B = Data + ((i - 1) >> 3) * 4 * C + 4 * c;
+			int E = (Idx << 4) | ((B[k >> 1] >> ((k & 1) << 2)) & 15);
+
+			Pred += WAV__ima_diff[E];
+			if (Pred >  32767) Pred =  32767;
+			if (Pred < -32768) Pred = -32768;
+			Idx = WAV__ima_next[E];
+
+			*O = (int16_t)Pred;
+		}
+	}
+	return(Frames);
+}
+
+static int WAV__decode_ms_block(const WAV_Data *Fmt, const uint8_t *in, int bytes, int16_t *out)
+{
+	int C = Fmt->wChannels;
+	int Frames = (int)WAV__adpcm_frames(Fmt, bytes);
+	if (!Frames) return(0);
+
+	// header: C predictor indices, then C deltas, C sample1s, C sample2s
+	const uint8_t *Nibbles = in + 7 * C;
+	for (int c=0; c < C; ++c) {
+		int Pi = in[c];
+		if (Pi >= Fmt->wNumCoef) Pi = 0;
+		int C1 = Fmt->aCoef[Pi][0];
+		int C2 = Fmt->aCoef[Pi][1];
+
+		const uint8_t *H = in + C + 2 * c;
+		int Delta = (int16_t)(H[0]         | (H[1]         << 8));
+		int S1    = (int16_t)(H[2 * C]     | (H[2 * C + 1] << 8));
+		int S2    = (int16_t)(H[4 * C]     | (H[4 * C + 1] << 8));
+
+		out[c] = (int16_t)S2;
+		if (Frames > 1) out[C + c] = (int16_t)S1;
+
+		// nibbles are high first, interleaved by channel
+		int16_t *O = out + 2 * C + c;
+		for (int i=2; i < Frames; ++i, O += C) {
+			int n   = (i - 2) * C + c;
+			int Nib = (Nibbles[n >> 1] >> ((n & 1) ? 0 : 4)) & 15;
+
+			int Pred = ((S1 * C1) + (S2 * C2)) >> 8;
+			Pred += ((Nib ^ 8) - 8) * Delta; // sign-extend the nibble
+			if (Pred >  32767) Pred =  32767;
+			if (Pred < -32768) Pred = -32768;
+
+			S2 = S1;
+			S1 = Pred;
+			Delta = (WAV__ms_adapt[Nib] * Delta) >> 8;
+			if (Delta < 16) Delta = 16;
+
+			*O = (int16_t)Pred;
+		}
+	}
+	return(Frames);
+}
+
+WAV_DECL int
+WAV_decode_adpcm_block (const WAV_Data *Format,
+                        const uint8_t *block, int bytes, int16_t *out)
+{
+	WAV_ASSERT(Format && block && out, "invalid arg");
+	if (bytes > Format->wBlockAlign) bytes = Format->wBlockAlign;
+
+	switch (Format->wFormatTag) {
+		case WAV_FORMAT_IMA_ADPCM: return(WAV__decode_ima_block(Format, block, bytes, out));
+		case WAV_FORMAT_MS_ADPCM:  return(WAV__decode_ms_block(Format, block, bytes, out));
+		default: WAV_ASSERT(0, "not an ADPCM format"); break;
+	}
+	return(0);
+}
+
+WAV_DECL WAV_BOOL
+WAV_decode_adpcm (WAV_Data *Loaded)
+{
+	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
+	if (WAV_4BIT != Loaded->wBitsPerSample) return(1); // no decoding needed
+
+	WAV_DBG(" - WAV: decoding ADPCM - \n");
+
+	WAV__STAT_BEGIN(AdpcmStart);
+	WAV__TRACE_BEGIN("adpcm", (int64_t)Loaded->qwDataSize);
+	int C = Loaded->wChannels;
+	int16_t *NewData = (int16_t *)WAV_MALLOC((size_t)Loaded->dwSamples * C * 2);
+	int16_t *Block   = (int16_t *)WAV_MALLOC(Loaded->wSamplesPerBlock * C * 2);
+	if (!NewData || !Block) {
+		WAV_FREE(NewData);
+		WAV_FREE(Block);
+		WAV__TRACE_END("adpcm");
+		return(0);
+	}
+
+	uint32_t Done = 0;
+	for (uint64_t Off=0; Off < Loaded->qwDataSize && Done < Loaded->dwSamples; Off += Loaded->wBlockAlign) {
+		uint64_t Bytes = Loaded->qwDataSize - Off;
+		if (Bytes > Loaded->wBlockAlign) Bytes = Loaded->wBlockAlign;
+
+		uint32_t Left = Loaded->dwSamples - Done;
+		int16_t *Dest = (Left >= Loaded->wSamplesPerBlock) ? NewData + (size_t)Done * C : Block;
+
+		uint32_t Frames = WAV_decode_adpcm_block(Loaded,
+			(const uint8_t *)Loaded->data + Off, (int)Bytes, Dest);
+		if (!Frames) break;
+		if (Frames > Left) Frames = Left;
+		if (Dest == Block) memcpy(NewData + (size_t)Done * C, Block, Frames * C * 2);
+		Done += Frames;
+	}
+	WAV_FREE(Block);
+
+	// a truncated final block leaves silence rather than garbage
+	if (Done < Loaded->dwSamples)
+		memset(NewData + (size_t)Done * C, 0, (size_t)(Loaded->dwSamples - Done) * C * 2);
+
+	WAV__TRACE_END("adpcm");
+	WAV__STAT_END(AdpcmStart, WAV_STATS_ADPCM);
+	WAV__STAT(compressed_bytes += Loaded->qwDataSize);
+	WAV__STAT(decoded_bytes += (uint64_t)Loaded->dwSamples * C * 2);
+
+	WAV_FREE(Loaded->data);
+	Loaded->data             = (int8_t *)NewData;
+	Loaded->wFormatTag       = WAV_FORMAT_PCM;
+	Loaded->wBitsPerSample   = WAV_16BIT;
+	Loaded->wBlockAlign      = C * 2;
+	Loaded->dwAvgBytesPerSec = Loaded->dwSamplesPerSec * C * 2;
+	Loaded->qwDataSize       = (uint64_t)Loaded->dwSamples * C * 2;
+	Loaded->wSamplesPerBlock = 0;
+	return(1);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - streaming
+//
+#define WAV_STREAM_CHUNK     4096 // PCM frames read per io call
+#define WAV_STREAM_LOOKAHEAD 4096 // frames of a loop's start kept decoded
+
+struct WAV_Stream {
+	WAV__ctx  ctx;
+	WAV_Data  info;
+#ifndef WAV_NO_STDIO
+	FILE    * owned;      // opened by WAV_open
+#endif
+
+	int64_t   data_start; // offset of the first sample byte
+	uint32_t  frame;      // next frame handed out
+
+	uint8_t * raw;        // undecoded bytes: one ADPCM block or a run of PCM
+	int       raw_cap;
+
+	int16_t * pcm;        // the current decoded ADPCM block
+	int       pcm_frames;
+	int       pcm_pos;
+
+	// loop region, see WAV_stream_set_loop
+	int       looping;
+	uint32_t  loop_start;
+	uint32_t  loop_end;   // one past the last frame
+	int       loop_left;  // jumps back still to do, or WAV_LOOP_FOREVER
+	float   * head;       // the first head_frames frames from loop_start
+	int       head_frames;
+	int       head_pos;   // < head_frames while playing out of 'head'
+};
+
+static int WAV__frame_bytes(const WAV_Data *Doc)
+{
+	return(Doc->wChannels * (Doc->wBitsPerSample / 8));
+}
+
+static WAV_Stream *WAV__stream_begin(WAV_Stream *S)
+{
+	uint64_t DataSize = 0;
+	int64_t  RiffEnd  = 0;
+	if (!WAV__read_header(&S->ctx, &S->info, &DataSize, &RiffEnd)) {
+		WAV_close(S);
+		return(0);
+	}
+	S->info.qwDataSize = DataSize;
+	S->data_start = S->ctx.io.tell(S->ctx.udata);
+
+	// loops and cues can sit after the samples
+	S->ctx.io.seek(S->ctx.udata, S->data_start + (int64_t)DataSize);
+	WAV__read_trailer(&S->ctx, &S->info, DataSize, RiffEnd);
+	S->ctx.io.seek(S->ctx.udata, S->data_start);
+
+	int C = S->info.wChannels;
+	if (WAV_4BIT == S->info.wBitsPerSample) {
+		S->raw_cap = S->info.wBlockAlign;
+		S->pcm = (int16_t *)WAV_MALLOC(S->info.wSamplesPerBlock * C * 2);
+	} else {
+		S->raw_cap = WAV_STREAM_CHUNK * WAV__frame_bytes(&S->info);
+	}
+	S->raw = (uint8_t *)WAV_MALLOC(S->raw_cap);
+
+	if (!S->raw || (WAV_4BIT == S->info.wBitsPerSample && !S->pcm)) {
+		WAV_close(S);
+		return(0);
+	}
+	return(S);
+}
+
+static WAV_Stream *WAV__stream_alloc(void)
+{
+	WAV_Stream *S = (WAV_Stream *)WAV_MALLOC(sizeof(WAV_Stream));
+	if (S) memset(S, 0, sizeof(WAV_Stream));
+	return(S);
+}
+
+#ifndef WAV_NO_STDIO
+WAV_DECL WAV_Stream *
+WAV_open (const char *filename)
+{
+	FILE *F = fopen(filename, "rb");
+	if (!F) {
+		WAV_ERR("could not open file: %s\n", filename);
+		return(0);
+	}
+	WAV_Stream *S = WAV__stream_alloc();
+	if (!S) {
+		fclose(F);
+		return(0);
+	}
+	S->owned = F;
+	WAV__start_file(&S->ctx, F);
+	return(WAV__stream_begin(S));
+}
+
+WAV_DECL WAV_Stream *
+WAV_open_file (FILE *f)
+{
+	WAV_Stream *S = WAV__stream_alloc();
+	if (!S) return(0);
+	WAV__start_file(&S->ctx, f);
+	return(WAV__stream_begin(S));
+}
+#endif
+
+WAV_DECL WAV_Stream *
+WAV_open_memory (const int8_t *buffer, int len)
+{
+	WAV_Stream *S = WAV__stream_alloc();
+	if (!S) return(0);
+	WAV__start_mem(&S->ctx, (int8_t *)buffer, len);
+	return(WAV__stream_begin(S));
+}
+
+WAV_DECL WAV_Stream *
+WAV_open_callbacks (const WAV_Callbacks *io, void *user)
+{
+	WAV_Stream *S = WAV__stream_alloc();
+	if (!S) return(0);
+	WAV__start_callbacks(&S->ctx, (WAV_Callbacks *)io, user);
+	return(WAV__stream_begin(S));
+}
+
+WAV_DECL WAV_Stream *
+WAV_open_callbacks64 (const WAV_Callbacks64 *io, void *user)
+{
+	WAV_Stream *S = WAV__stream_alloc();
+	if (!S) return(0);
+	WAV__start_callbacks64(&S->ctx, (WAV_Callbacks64 *)io, user);
+	return(WAV__stream_begin(S));
+}
+
+WAV_DECL WAV_Data
+WAV_stream_info (WAV_Stream *S)
+{
+	return(S->info);
+}
+
+// reads and decodes ADPCM block 'Block', leaving the io positioned after it
+static WAV_BOOL WAV__stream_load_block(WAV_Stream *S, uint32_t Block)
+{
+	uint64_t Off = (uint64_t)Block * S->info.wBlockAlign;
+	if (Off >= S->info.qwDataSize) return(0);
+
+	uint64_t Bytes = S->info.qwDataSize - Off;
+	if (Bytes > S->info.wBlockAlign) Bytes = S->info.wBlockAlign;
+
+	int Got = S->ctx.io.read(S->ctx.udata, (char *)S->raw, (int)Bytes);
+	S->pcm_frames = (Got > 0) ? WAV_decode_adpcm_block(&S->info, S->raw, Got, S->pcm) : 0;
+	S->pcm_pos = 0;
+	return(S->pcm_frames > 0);
+}
+
+static int WAV__stream_read(WAV_Stream *S, float *out, int frames)
+{
+	int C    = S->info.wChannels;
+	int Done = 0;
+
+	uint32_t Left = S->info.dwSamples - S->frame;
+	if ((uint32_t)frames > Left) frames = (int)Left;
+
+	if (WAV_4BIT == S->info.wBitsPerSample) {
+		while (Done < frames) {
+			if (S->pcm_pos >= S->pcm_frames) {
+				uint32_t Block = S->frame / S->info.wSamplesPerBlock;
+				if (!WAV__stream_load_block(S, Block)) break;
+			}
+			int Run = S->pcm_frames - S->pcm_pos;
+			if (Run > frames - Done) Run = frames - Done;
+
+			const int16_t *P = S->pcm + S->pcm_pos * C;
+			for (int i=0; i < Run * C; ++i) *(out++) = *(P++) / 32767.0f;
+
+			S->pcm_pos += Run;
+			S->frame   += Run;
+			Done       += Run;
+		}
+		return(Done);
+	}
+
+	int FrameBytes = WAV__frame_bytes(&S->info);
+	while (Done < frames) {
+		int Run = frames - Done;
+		if (Run > WAV_STREAM_CHUNK) Run = WAV_STREAM_CHUNK;
+
+		int Got = S->ctx.io.read(S->ctx.udata, (char *)S->raw, Run * FrameBytes) / FrameBytes;
+		if (Got <= 0) break;
+
+		int N = Got * C;
+		switch (S->info.wBitsPerSample) {
+			case WAV_8BIT:
+			{
+				int8_t  *P = (int8_t *)S->raw;
+				for (int i=0; i < N; ++i) *(out++) = *(P++) / 127.0f;
+			} break;
+			case WAV_16BIT:
+			{
+				int16_t *P = (int16_t *)S->raw;
+				for (int i=0; i < N; ++i) *(out++) = *(P++) / 32767.0f;
+			} break;
+			case WAV_FLOAT:
+			{
+				memcpy(out, S->raw, N * sizeof(float));
+				out += N;
+			} break;
+			default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+		}
+
+		S->frame += Got;
+		Done     += Got;
+		if (Got < Run) break;
+	}
+	return(Done);
+}
+
+static WAV_BOOL WAV__stream_seek(WAV_Stream *S, uint32_t frame)
+{
+	if (frame > S->info.dwSamples) return(0);
+
+	if (WAV_4BIT == S->info.wBitsPerSample) {
+		uint32_t Block = frame / S->info.wSamplesPerBlock;
+		S->ctx.io.seek(S->ctx.udata, S->data_start + (int64_t)Block * S->info.wBlockAlign);
+		S->pcm_frames = S->pcm_pos = 0;
+		S->frame = frame;
+		if (frame < S->info.dwSamples) {
+			if (!WAV__stream_load_block(S, Block)) return(0);
+			S->pcm_pos = frame % S->info.wSamplesPerBlock;
+		}
+		return(1);
+	}
+
+	S->ctx.io.seek(S->ctx.udata, S->data_start + (int64_t)frame * WAV__frame_bytes(&S->info));
+	S->frame = frame;
+	return(1);
+}
+
+WAV_DECL int
+WAV_stream_read (WAV_Stream *S, float *out, int frames)
+{
+	WAV_ASSERT(S && out, "invalid arg");
+	if (!S->looping) return(WAV__stream_read(S, out, frames));
+
+	int C    = S->info.wChannels;
+	int Done = 0;
+	while (Done < frames) {
+		int Run = frames - Done;
+
+		if (S->head_pos < S->head_frames) {
+			// start of the loop, already decoded
+			if (Run > S->head_frames - S->head_pos) Run = S->head_frames - S->head_pos;
+			memcpy(out, S->head + S->head_pos * C, Run * C * sizeof(float));
+			S->head_pos += Run;
+			S->frame    += Run;
+		} else {
+			if (S->frame < S->loop_end && S->loop_left && Run > (int)(S->loop_end - S->frame))
+				Run = (int)(S->loop_end - S->frame);
+			Run = WAV__stream_read(S, out, Run);
+		}
+		out  += Run * C;
+		Done += Run;
+
+		if (S->frame == S->loop_end && S->loop_left) {
+			// jump back: play out of 'head' while the io catches up behind it.
+			// a loop that fits in 'head' leaves the io at its end instead
+			if (S->loop_left > 0) --S->loop_left;
+			if (S->loop_start + S->head_frames < S->loop_end &&
+			    !WAV__stream_seek(S, S->loop_start + S->head_frames)) break;
+			S->frame    = S->loop_start;
+			S->head_pos = 0;
+		} else if (!Run) {
+			break;
+		}
+	}
+	return(Done);
+}
+
+WAV_DECL WAV_BOOL
+WAV_stream_seek (WAV_Stream *S, uint32_t frame)
+{
+	WAV_ASSERT(S, "invalid arg");
+	S->head_pos = S->head_frames; // back to the io
+	return(WAV__stream_seek(S, frame));
+}
+
+WAV_DECL uint32_t
+WAV_stream_tell (WAV_Stream *S)
+{
+	return(S->frame);
+}
+
+WAV_DECL WAV_BOOL
+WAV_stream_set_loop (WAV_Stream *S, uint32_t start, uint32_t end, int repeats)
+{
+	WAV_ASSERT(S, "invalid arg");
+	if (start > end || end >= S->info.dwSamples) return(0);
+
+	int C = S->info.wChannels;
+	if (!S->head) {
+		S->head = (float *)WAV_MALLOC(WAV_STREAM_LOOKAHEAD * C * sizeof(float));
+		if (!S->head) return(0);
+	}
+
+	// decode the first frames of the loop, then go back to where we were
+	uint32_t Frame  = S->frame;
+	uint32_t Length = end - start + 1;
+	int      Head   = (Length < WAV_STREAM_LOOKAHEAD) ? (int)Length : WAV_STREAM_LOOKAHEAD;
+	S->looping = 0;
+
+	if (!WAV__stream_seek(S, start)) return(0);
+	S->head_frames = WAV__stream_read(S, S->head, Head);
+	S->head_pos    = S->head_frames;
+	if (!WAV__stream_seek(S, Frame)) return(0);
+	if (S->head_frames != Head) return(0);
+
+	S->looping    = 1;
+	S->loop_start = start;
+	S->loop_end   = end + 1;
+	S->loop_left  = repeats;
+	return(1);
+}
+
+WAV_DECL WAV_BOOL
+WAV_stream_use_loop (WAV_Stream *S, int index)
+{
+	WAV_ASSERT(S, "invalid arg");
+	if (index < 0 || (uint32_t)index >= S->info.nloops) return(0);
+
+	WAV_Loop *L = S->info.loops + index;
+	if (WAV_LOOP_FORWARD != L->type) return(0);
+	int Repeats = L->count ? (int)L->count - 1 : WAV_LOOP_FOREVER;
+	return(WAV_stream_set_loop(S, L->start, L->end, Repeats));
+}
+
+WAV_DECL void
+WAV_stream_clear_loop (WAV_Stream *S)
+{
+	WAV_ASSERT(S, "invalid arg");
+	if (S->looping && S->head_pos < S->head_frames) {
+		// finish the buffered frames from the io instead
+		uint32_t Frame = S->frame;
+		S->head_pos = S->head_frames;
+		WAV__stream_seek(S, Frame);
+	}
+	S->looping = 0;
+}
+
+WAV_DECL void
+WAV_close (WAV_Stream *S)
+{
+	if (!S) return;
+#ifndef WAV_NO_STDIO
+	if (S->owned) fclose(S->owned);
+#endif
+	WAV_FREE(S->raw);
+	WAV_FREE(S->pcm);
+	WAV_FREE(S->head);
+	WAV_FREE(S->info.loops);
+	WAV_FREE(S->info.cues);
+	WAV_FREE(S);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// sample cursor -- float frames out of any WAV_Data, ADPCM included
+//
+typedef struct {
+	const WAV_Data * doc;
+	uint32_t         frame;
+
+	int16_t        * pcm;     // decoded ADPCM block
+	int              pcm_frames;
+	int              pcm_pos;
+	uint32_t         block;
+} WAV__cursor;
+
+static WAV_BOOL WAV__cursor_begin(WAV__cursor *Cur, const WAV_Data *Doc)
+{
+	memset(Cur, 0, sizeof(WAV__cursor));
+	Cur->doc = Doc;
+	if (WAV_4BIT == Doc->wBitsPerSample) {
+		Cur->pcm = (int16_t *)WAV_MALLOC(Doc->wSamplesPerBlock * Doc->wChannels * 2);
+		if (!Cur->pcm) return(0);
+	}
+	return(1);
+}
+
+static void WAV__cursor_seek(WAV__cursor *Cur, uint32_t frame)
+{
+	const WAV_Data *D = Cur->doc;
+	if (frame > D->dwSamples) frame = D->dwSamples;
+	Cur->frame = frame;
+
+	if (WAV_4BIT == D->wBitsPerSample) {
+		uint64_t Off;
+		Cur->block = frame / D->wSamplesPerBlock;
+		Cur->pcm_frames = Cur->pcm_pos = 0;
+		Off = (uint64_t)Cur->block * D->wBlockAlign;
+		if (Off < D->qwDataSize) {
+			uint64_t Bytes = D->qwDataSize - Off;
+			if (Bytes > D->wBlockAlign) Bytes = D->wBlockAlign;
+			Cur->pcm_frames = WAV_decode_adpcm_block(D,
+				(const uint8_t *)D->data + Off, (int)Bytes, Cur->pcm);
+			Cur->pcm_pos = frame % D->wSamplesPerBlock;
+			++Cur->block;
+		}
+	}
+}
+
+static void WAV__cursor_end(WAV__cursor *Cur)
+{
+	WAV_FREE(Cur->pcm);
+	Cur->pcm = 0;
+}
+
+// reads up to 'frames' interleaved float frames
+static int WAV__cursor_read(WAV__cursor *Cur, float *out, int frames)
+{
+	const WAV_Data *D = Cur->doc;
+	int C = D->wChannels;
+
+	uint32_t Left = D->dwSamples - Cur->frame;
+	if ((uint32_t)frames > Left) frames = (int)Left;
+
+	if (WAV_4BIT == D->wBitsPerSample) {
+		int Done = 0;
+		while (Done < frames) {
+			if (Cur->pcm_pos >= Cur->pcm_frames) {
+				uint64_t Off = (uint64_t)Cur->block * D->wBlockAlign;
+				if (Off >= D->qwDataSize) break;
+				uint64_t Bytes = D->qwDataSize - Off;
+				if (Bytes > D->wBlockAlign) Bytes = D->wBlockAlign;
+				Cur->pcm_frames = WAV_decode_adpcm_block(D,
+					(const uint8_t *)D->data + Off, (int)Bytes, Cur->pcm);
+				Cur->pcm_pos = 0;
+				++Cur->block;
+				if (!Cur->pcm_frames) break;
+			}
+			int Run = Cur->pcm_frames - Cur->pcm_pos;
+			if (Run > frames - Done) Run = frames - Done;
+			const int16_t *P = Cur->pcm + Cur->pcm_pos * C;
+			for (int i=0; i < Run * C; ++i) *(out++) = *(P++) / 32767.0f;
+			Cur->pcm_pos += Run;
+			Done += Run;
+		}
+		Cur->frame += Done;
+		return(Done);
+	}
+
+	size_t First = (size_t)Cur->frame * C;
+	int    N     = frames * C;
+	switch (D->wBitsPerSample) {
+		case WAV_8BIT:
+		{
+			const int8_t  *P = (const int8_t *)D->data + First;
+			for (int i=0; i < N; ++i) *(out++) = *(P++) / 127.0f;
+		} break;
+		case WAV_16BIT:
+		{
+			const int16_t *P = (const int16_t *)D->data + First;
+			for (int i=0; i < N; ++i) *(out++) = *(P++) / 32767.0f;
+		} break;
+		case WAV_FLOAT:
+		{
+			memcpy(out, (const float *)D->data + First, N * sizeof(float));
+		} break;
+		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	}
+	Cur->frame += frames;
+	return(frames);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - waveform overviews
+//
+
+// min, max and sum of squares of n floats
+static void WAV__reduce(const float *p, int n, float *mn, float *mx, double *ss)
+{
+	float  Min = 3.4e38f, Max = -3.4e38f;
+	double Sum = 0.0;
+	int i = 0;
+#if defined(WAV_AVX2)
+	if (n >= 8) {
+		__m256 Vmin = _mm256_set1_ps(Min), Vmax = _mm256_set1_ps(Max);
+		__m256 Vss  = _mm256_setzero_ps();
+		for (; i + 8 <= n; i += 8) {
+			__m256 X = _mm256_loadu_ps(p + i);
+			Vmin = _mm256_min_ps(Vmin, X);
+			Vmax = _mm256_max_ps(Vmax, X);
+			Vss  = _mm256_add_ps(Vss, _mm256_mul_ps(X, X));
+		}
+		float T[8];
+		_mm256_storeu_ps(T, Vmin); for (int k=0; k < 8; ++k) if (T[k] < Min) Min = T[k];
+		_mm256_storeu_ps(T, Vmax); for (int k=0; k < 8; ++k) if (T[k] > Max) Max = T[k];
+		_mm256_storeu_ps(T, Vss);  for (int k=0; k < 8; ++k) Sum += T[k];
+	}
+#elif defined(WAV_SSE2)
+	if (n >= 4) {
+		__m128 Vmin = _mm_set1_ps(Min), Vmax = _mm_set1_ps(Max);
+		__m128 Vss  = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4) {
+			__m128 X = _mm_loadu_ps(p + i);
+			Vmin = _mm_min_ps(Vmin, X);
+			Vmax = _mm_max_ps(Vmax, X);
+			Vss  = _mm_add_ps(Vss, _mm_mul_ps(X, X));
+		}
+		float T[4];
+		_mm_storeu_ps(T, Vmin); for (int k=0; k < 4; ++k) if (T[k] < Min) Min = T[k];
+		_mm_storeu_ps(T, Vmax); for (int k=0; k < 4; ++k) if (T[k] > Max) Max = T[k];
+		_mm_storeu_ps(T, Vss);  for (int k=0; k < 4; ++k) Sum += T[k];
+	}
+#endif
+	for (; i < n; ++i) {
+		float X = p[i];
+		if (X < Min) Min = X;
+		if (X > Max) Max = X;
+		Sum += X * X;
+	}
+	*mn = Min;
+	*mx = Max;
+	*ss = Sum;
+}
+
+static WAV_BOOL WAV__overview_alloc_level(WAV_OverviewLevel *L, int channels)
+{
+	size_t N = (size_t)L->nbuckets * channels;
+	float *Block = (float *)WAV_MALLOC(N * 3 * sizeof(float) + 1);
+	if (!Block) return(0);
+	L->min = Block;
+	L->max = Block + N;
+	L->rms = Block + N * 2;
+	return(1);
+}
+
+WAV_DECL WAV_BOOL
+WAV_build_overview (const WAV_Data *Loaded,
+                    const uint32_t *bucket_frames, int nlevels,
+                    WAV_Overview *out)
+{
+	static const uint32_t Defaults[3] = { 256, 4096, 65536 };
+	WAV_ASSERT(Loaded && Loaded->data && out, "invalid arg");
+
+	if (!bucket_frames) {
+		bucket_frames = Defaults;
+		nlevels = 3;
+	}
+	if (nlevels < 1 || nlevels > WAV_OVERVIEW_MAX_LEVELS || !bucket_frames[0]) {
+		WAV_ERR("bad overview level count: %i\n", nlevels);
+		return(0);
+	}
+	for (int l=1; l < nlevels; ++l) {
+		if (bucket_frames[l] <= bucket_frames[l-1] || bucket_frames[l] % bucket_frames[l-1]) {
+			WAV_ERR("overview level %i is not a multiple of level %i\n", l, l-1);
+			return(0);
+		}
+	}
+
+	memset(out, 0, sizeof(WAV_Overview));
+	int C = Loaded->wChannels;
+	out->wChannels = Loaded->wChannels;
+	out->dwSamples = Loaded->dwSamples;
+	out->nlevels   = nlevels;
+
+	for (int l=0; l < nlevels; ++l) {
+		WAV_OverviewLevel *L = out->levels + l;
+		L->frames   = bucket_frames[l];
+		L->nbuckets = (uint32_t)(((uint64_t)Loaded->dwSamples + L->frames - 1) / L->frames);
+		if (!WAV__overview_alloc_level(L, C)) {
+			WAV_free_overview(out);
+			return(0);
+		}
+	}
+
+	// finest level straight from the samples, one bucket at a time
+	WAV_OverviewLevel *Fine = out->levels;
+	float *Frames = (float *)WAV_MALLOC((size_t)Fine->frames * C * sizeof(float));
+	float *Plane  = (float *)WAV_MALLOC((size_t)Fine->frames * sizeof(float));
+	WAV__cursor Cur;
+	if (!Frames || !Plane || !WAV__cursor_begin(&Cur, Loaded)) {
+		WAV_FREE(Frames);
+		WAV_FREE(Plane);
+		WAV_free_overview(out);
+		return(0);
+	}
+
+	for (uint32_t b=0; b < Fine->nbuckets; ++b) {
+		int N = WAV__cursor_read(&Cur, Frames, (int)Fine->frames);
+		for (int c=0; c < C; ++c) {
+			for (int i=0; i < N; ++i) Plane[i] = Frames[i * C + c];
+
+			double Sum = 0.0;
+			size_t At = (size_t)b * C + c;
+			if (N > 0) {
+				WAV__reduce(Plane, N, Fine->min + At, Fine->max + At, &Sum);
+				Fine->rms[At] = (float)sqrt(Sum / N);
+			} else {
+				Fine->min[At] = Fine->max[At] = Fine->rms[At] = 0.0f;
+			}
+		}
+	}
+	WAV__cursor_end(&Cur);
+	WAV_FREE(Frames);
+	WAV_FREE(Plane);
+
+	// coarser levels from the level below
+	for (int l=1; l < nlevels; ++l) {
+		WAV_OverviewLevel *L = out->levels + l;
+		WAV_OverviewLevel *P = out->levels + l - 1;
+		uint32_t K = L->frames / P->frames;
+
+		for (uint32_t b=0; b < L->nbuckets; ++b) {
+			uint32_t First = b * K;
+			uint32_t Last  = First + K;
+			if (Last > P->nbuckets) Last = P->nbuckets;
+
+			for (int c=0; c < C; ++c) {
+				float  Min = 3.4e38f, Max = -3.4e38f;
+				double Sum = 0.0, Count = 0.0;
+				for (uint32_t i=First; i < Last; ++i) {
+					size_t At = (size_t)i * C + c;
+					uint64_t End = (uint64_t)(i + 1) * P->frames;
+					double   N   = (double)((End > out->dwSamples ? out->dwSamples : End) - (uint64_t)i * P->frames);
+					if (P->min[At] < Min) Min = P->min[At];
+					if (P->max[At] > Max) Max = P->max[At];
+					Sum   += (double)P->rms[At] * P->rms[At] * N;
+					Count += N;
+				}
+				size_t At = (size_t)b * C + c;
+				L->min[At] = Min;
+				L->max[At] = Max;
+				L->rms[At] = (Count > 0.0) ? (float)sqrt(Sum / Count) : 0.0f;
+			}
+		}
+	}
+
+	return(1);
+}
+
+WAV_DECL void
+WAV_free_overview (WAV_Overview *Ov)
+{
+	if (!Ov) return;
+	for (int l=0; l < Ov->nlevels; ++l) WAV_FREE(Ov->levels[l].min);
+	memset(Ov, 0, sizeof(WAV_Overview));
+}
+
+#define WAV_OVERVIEW_MAGIC   (('W' << 24) | ('O' << 16) | ('V' << 8) | 'R')
+#define WAV_OVERVIEW_VERSION 1
+
+static void WAV__put32(uint8_t **P, uint32_t v)
+{
+	(*P)[0] = (uint8_t)v;
+	(*P)[1] = (uint8_t)(v >> 8);
+	(*P)[2] = (uint8_t)(v >> 16);
+	(*P)[3] = (uint8_t)(v >> 24);
+	*P += 4;
+}
+
+static uint32_t WAV__get32(const uint8_t **P)
+{
+	uint32_t v = (*P)[0] | ((*P)[1] << 8) | ((*P)[2] << 16) | ((uint32_t)(*P)[3] << 24);
+	*P += 4;
+	return(v);
+}
+
+WAV_DECL int
+WAV_overview_size (const WAV_Overview *Ov)
+{
+	size_t Size = 5 * 4; // magic, version, channels, samples, levels
+	for (int l=0; l < Ov->nlevels; ++l)
+		Size += 2 * 4 + (size_t)Ov->levels[l].nbuckets * Ov->wChannels * 3 * 4;
+	return((int)Size);
+}
+
+WAV_DECL int
+WAV_overview_save_to_memory (const WAV_Overview *Ov, uint8_t *buffer, int len)
+{
+	WAV_ASSERT(Ov && buffer, "invalid arg");
+	int Size = WAV_overview_size(Ov);
+	if (len < Size) return(0);
+
+	uint8_t *P = buffer;
+	WAV__put32(&P, WAV_OVERVIEW_MAGIC);
+	WAV__put32(&P, WAV_OVERVIEW_VERSION);
+	WAV__put32(&P, Ov->wChannels);
+	WAV__put32(&P, Ov->dwSamples);
+	WAV__put32(&P, Ov->nlevels);
+
+	for (int l=0; l < Ov->nlevels; ++l) {
+		WAV__put32(&P, Ov->levels[l].frames);
+		WAV__put32(&P, Ov->levels[l].nbuckets);
+	}
+	for (int l=0; l < Ov->nlevels; ++l) {
+		// min, max and rms are one contiguous block
+		size_t N = (size_t)Ov->levels[l].nbuckets * Ov->wChannels * 3;
+		const float *F = Ov->levels[l].min;
+		for (size_t i=0; i < N; ++i) {
+			uint32_t Bits;
+			memcpy(&Bits, F + i, 4);
+			WAV__put32(&P, Bits);
+		}
+	}
+
+	return((int)(P - buffer));
+}
+
+WAV_DECL WAV_BOOL
+WAV_overview_load_from_memory (const uint8_t *buffer, int len, WAV_Overview *out)
+{
+	WAV_ASSERT(buffer && out, "invalid arg");
+	memset(out, 0, sizeof(WAV_Overview));
+	if (len < 5 * 4) return(0);
+
+	const uint8_t *P   = buffer;
+	const uint8_t *End = buffer + len;
+	if (WAV_OVERVIEW_MAGIC != WAV__get32(&P) || WAV_OVERVIEW_VERSION != WAV__get32(&P)) {
+		WAV_ERR("not a waveform overview\n");
+		return(0);
+	}
+
+	uint32_t Channels = WAV__get32(&P);
+	uint32_t Samples  = WAV__get32(&P);
+	uint32_t Levels   = WAV__get32(&P);
+	if (!Channels || Channels > 0xFFFF || !Levels || Levels > WAV_OVERVIEW_MAX_LEVELS ||
+	    (size_t)(End - P) < Levels * 8)
+	{
+		WAV_ERR("corrupt waveform overview\n");
+		return(0);
+	}
+	out->wChannels = (uint16_t)Channels;
+	out->dwSamples = Samples;
+
+	// the same rules WAV_build_overview has: each level a multiple of the one
+	// before, with as many buckets as it takes to cover the samples
+	for (uint32_t l=0; l < Levels; ++l) {
+		WAV_OverviewLevel *L = out->levels + l;
+		WAV_OverviewLevel *Prev = l ? L - 1 : 0;
+		L->frames   = WAV__get32(&P);
+		L->nbuckets = WAV__get32(&P);
+		if (!L->frames || L->nbuckets != (uint32_t)(((uint64_t)Samples + L->frames - 1) / L->frames) ||
+		    (Prev && (L->frames <= Prev->frames || L->frames % Prev->frames)))
+		{
+			WAV_ERR("corrupt waveform overview\n");
+			WAV_free_overview(out);
+			return(0);
+		}
+	}
+	for (uint32_t l=0; l < Levels; ++l) {
+		WAV_OverviewLevel *L = out->levels + l;
+		uint64_t N = (uint64_t)L->nbuckets * Channels * 3;
+		if ((uint64_t)(End - P) / 4 < N || !WAV__overview_alloc_level(L, Channels)) {
+			WAV_free_overview(out);
+			return(0);
+		}
+		out->nlevels = l + 1;
+		for (uint64_t i=0; i < N; ++i) {
+			uint32_t Bits = WAV__get32(&P);
+			memcpy(L->min + i, &Bits, 4);
+		}
+	}
+
+	return(1);
+}
+
 #ifndef WAV_NO_STDIO
 WAV_DECL WAV_BOOL
-WAV_load (const char *filename, WAV_Data *out)
+WAV_overview_save (const char *filename, const WAV_Overview *Ov)
+{
+	int Size = WAV_overview_size(Ov);
+	uint8_t *Buffer = (uint8_t *)WAV_MALLOC(Size);
+	if (!Buffer) return(0);
+	WAV_overview_save_to_memory(Ov, Buffer, Size);
+
+	WAV_BOOL R = 0;
+	FILE *F = fopen(filename, "wb");
+	if (F) {
+		R = (1 == fwrite(Buffer, Size, 1, F));
+		fclose(F);
+	} else {
+		WAV_ERR("could not open file: %s\n", filename);
+	}
+	WAV_FREE(Buffer);
+	return(R);
+}
+
+WAV_DECL WAV_BOOL
+WAV_overview_load (const char *filename, WAV_Overview *out)
 {
 	FILE *F = fopen(filename, "rb");
 	if (!F) {
 		WAV_ERR("could not open file: %s\n", filename);
 		return(0);
 	}
-	WAV__ctx Context = {0};
-	WAV__start_file(&Context, F);
-	int R = WAV__decode_main(&Context, out);
+	fseek(F, 0, SEEK_END);
+	long Size = ftell(F);
+	fseek(F, 0, SEEK_SET);
+
+	WAV_BOOL R = 0;
+	uint8_t *Buffer = (Size > 0) ? (uint8_t *)WAV_MALLOC(Size) : 0;
+	if (Buffer && 1 == fread(Buffer, Size, 1, F))
+		R = WAV_overview_load_from_memory(Buffer, (int)Size, out);
+	WAV_FREE(Buffer);
 	fclose(F);
 	return(R);
 }
+#endif
 
-WAV_DECL WAV_BOOL
-WAV_load_from_file (FILE *f, WAV_Data *out)
+
+
+//////////////////////////////////////////////////////////////////////////////
+// primary API - resampling
+//
+#define WAV_RESAMPLE_TAPS       32   // sinc taps per phase when not decimating
+#define WAV_RESAMPLE_MAX_TAPS   256
+#define WAV_RESAMPLE_MAX_PHASES 512  // ratios with more phases get quantized
+#define WAV_RESAMPLE_BLOCK      1024 // frames buffered per channel
+
+static uint32_t WAV__gcd(uint32_t a, uint32_t b)
 {
-	WAV__ctx Context = {0};
-	WAV__start_file(&Context, f);
-	return (WAV__decode_main(&Context, out));
+	while (b) { uint32_t t = a % b; a = b; b = t; }
+	return(a);
+}
+
+static double WAV__bessel_i0(double x)
+{
+	double Sum = 1.0, Term = 1.0;
+	for (int k=1; k < 32; ++k) {
+		Term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		Sum += Term;
+	}
+	return(Sum);
+}
+
+// kaiser-windowed sinc, 'd' is the distance from the output position in input
+// samples, 'fc' the cutoff relative to the input nyquist.
+static double WAV__sinc_kernel(double d, double fc, double half)
+{
+	const double Pi = 3.14159265358979323846;
+	const double Beta = 8.0;
+
+	double x = d / half;
+	if (x <= -1.0 || x >= 1.0) return(0.0);
+
+	double Sinc = (d == 0.0) ? 1.0 : sin(Pi * fc * d) / (Pi * fc * d);
+	double Window = WAV__bessel_i0(Beta * sqrt(1.0 - x*x)) / WAV__bessel_i0(Beta);
+	return(fc * Sinc * Window);
 }
+
+static float WAV__dot(const float *a, const float *b, int n)
+{
+	float R = 0.0f;
+#if defined(WAV_AVX2)
+	__m256 S8 = _mm256_setzero_ps();
+	for (; n >= 8; n -= 8, a += 8, b += 8)
+		S8 = _mm256_add_ps(S8, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+	__m128 S = _mm_add_ps(_mm256_castps256_ps128(S8), _mm256_extractf128_ps(S8, 1));
+	S = _mm_add_ps(S, _mm_movehl_ps(S, S));
+	S = _mm_add_ss(S, _mm_shuffle_ps(S, S, 1));
+	R = _mm_cvtss_f32(S);
+#elif defined(WAV_SSE2)
+	__m128 S = _mm_setzero_ps();
+	for (; n >= 4; n -= 4, a += 4, b += 4)
+		S = _mm_add_ps(S, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+	S = _mm_add_ps(S, _mm_movehl_ps(S, S));
+	S = _mm_add_ss(S, _mm_shuffle_ps(S, S, 1));
+	R = _mm_cvtss_f32(S);
 #endif
+	for (; n; --n) R += *(a++) * *(b++);
+	return(R);
+}
 
 WAV_DECL WAV_BOOL
-WAV_load_from_memory (const int8_t *buffer, int len, WAV_Data *out)
+WAV_resampler_init (WAV_Resampler *R, int channels,
+                    uint32_t src_rate, uint32_t dst_rate, int mode)
 {
-	WAV__ctx Context = {0};
-	WAV__start_mem(&Context, (int8_t *)buffer, len);
-	return(WAV__decode_main(&Context, out));
+	WAV_ASSERT(R && channels > 0 && src_rate && dst_rate, "invalid arg");
+	memset(R, 0, sizeof(WAV_Resampler));
+
+	uint32_t G = WAV__gcd(src_rate, dst_rate);
+	R->mode     = mode;
+	R->channels = channels;
+	R->src_rate = src_rate;
+	R->dst_rate = dst_rate;
+	R->up       = dst_rate / G;
+	R->down     = src_rate / G;
+
+	if (WAV_RESAMPLE_LINEAR == mode) {
+		R->taps = 2;
+	} else {
+		// when decimating, lower the cutoff and widen the kernel to match
+		double Ratio = (R->up < R->down) ? (double)R->up / R->down : 1.0;
+		double Fc    = 0.95 * Ratio;
+		int    Taps  = (int)ceil(WAV_RESAMPLE_TAPS / Ratio);
+		Taps = (Taps + 7) & ~7;
+		if (Taps > WAV_RESAMPLE_MAX_TAPS) Taps = WAV_RESAMPLE_MAX_TAPS;
+
+		R->taps   = Taps;
+		R->phases = (R->up <= WAV_RESAMPLE_MAX_PHASES) ? (int)R->up : WAV_RESAMPLE_MAX_PHASES;
+		R->coeffs = (float *)WAV_MALLOC(R->phases * Taps * sizeof(float));
+		if (!R->coeffs) return(0);
+
+		double Half = Taps / 2;
+		for (int p=0; p < R->phases; ++p) {
+			float *H = R->coeffs + p * Taps;
+			double Sum = 0.0;
+			for (int k=0; k < Taps; ++k) {
+				double d = (double)p / R->phases + (Half - 1) - k;
+				double v = WAV__sinc_kernel(d, Fc, Half);
+				H[k] = (float)v;
+				Sum += v;
+			}
+			for (int k=0; k < Taps; ++k) H[k] = (float)(H[k] / Sum); // unity DC gain
+		}
+	}
+
+	R->cap  = R->taps + WAV_RESAMPLE_BLOCK;
+	R->hist = (float *)WAV_MALLOC(R->cap * channels * sizeof(float));
+	if (!R->hist) {
+		WAV_FREE(R->coeffs);
+		R->coeffs = 0;
+		return(0);
+	}
+
+	// prime with silence so the first output is centered on the first input
+	R->nhist = R->taps / 2 - 1;
+	R->pos   = R->nhist;
+	for (int c=0; c < channels; ++c)
+		memset(R->hist + c * R->cap, 0, R->nhist * sizeof(float));
+
+	WAV_DBG(" - WAV: resampler %i -> %i (%i/%i, %i taps, %i phases) - \n",
+		(int)src_rate, (int)dst_rate, (int)R->up, (int)R->down, R->taps, R->phases);
+	return(1);
 }
 
-WAV_DECL WAV_BOOL
-WAV_load_from_callbacks (const WAV_Callbacks *io, void *user, WAV_Data *out)
+// append up to 'frames' interleaved frames (silence if 'in' is null)
+static int WAV__resampler_feed(WAV_Resampler *R, const float *in, int frames)
 {
-	WAV__ctx Context = {0};
-	WAV__start_callbacks(&Context, (WAV_Callbacks *)io, user);
-	return(WAV__decode_main(&Context, out));
+	int Room = R->cap - R->nhist;
+	if (frames > Room) frames = Room;
+
+	for (int c=0; c < R->channels; ++c) {
+		float *D = R->hist + c * R->cap + R->nhist;
+		if (in) {
+			const float *P = in + c;
+			for (int i=0; i < frames; ++i, P += R->channels) D[i] = *P;
+		} else {
+			memset(D, 0, frames * sizeof(float));
+		}
+	}
+	R->nhist += frames;
+	return(frames);
+}
+
+// drop history the filter can no longer reach
+static void WAV__resampler_compact(WAV_Resampler *R)
+{
+	int Drop = R->pos - R->taps / 2 + 1;
+	if (Drop <= 0) return;
+	if (Drop > R->nhist) Drop = R->nhist;
+
+	for (int c=0; c < R->channels; ++c) {
+		float *P = R->hist + c * R->cap;
+		memmove(P, P + Drop, (R->nhist - Drop) * sizeof(float));
+	}
+	R->nhist -= Drop;
+	R->pos   -= Drop;
+}
+
+static int WAV__resampler_drain(WAV_Resampler *R, float *out, int capacity)
+{
+	int Half = R->taps / 2;
+	int Made = 0;
+
+	if (WAV_RESAMPLE_LINEAR == R->mode) {
+		float Scale = 1.0f / R->up;
+		for (; Made < capacity && R->pos + 1 < R->nhist; ++Made) {
+			float t = R->frac * Scale;
+			for (int c=0; c < R->channels; ++c) {
+				const float *X = R->hist + c * R->cap + R->pos;
+				*(out++) = X[0] + (X[1] - X[0]) * t;
+			}
+			R->frac += R->down;
+			R->pos  += R->frac / R->up;
+			R->frac %= R->up;
+		}
+	} else {
+		for (; Made < capacity && R->pos + Half < R->nhist; ++Made) {
+			uint32_t Phase = ((int)R->up == R->phases) ? R->frac
+				: (uint32_t)(((uint64_t)R->frac * R->phases) / R->up);
+			const float *H = R->coeffs + Phase * R->taps;
+			for (int c=0; c < R->channels; ++c) {
+				const float *X = R->hist + c * R->cap + R->pos - Half + 1;
+				*(out++) = WAV__dot(X, H, R->taps);
+			}
+			R->frac += R->down;
+			R->pos  += R->frac / R->up;
+			R->frac %= R->up;
+		}
+	}
+
+	R->made += Made;
+	return(Made);
+}
+
+WAV_DECL int
+WAV_resampler_process (WAV_Resampler *R,
+                       const float *in, int frames, int *consumed,
+                       float *out, int capacity)
+{
+	WAV_ASSERT(R && R->hist, "invalid arg");
+	int Made = 0, Used = 0;
+
+	for (;;) {
+		Made += WAV__resampler_drain(R, out + Made * R->channels, capacity - Made);
+		if (Made == capacity || Used == frames) break;
+		WAV__resampler_compact(R);
+		Used += WAV__resampler_feed(R, in + Used * R->channels, frames - Used);
+	}
+
+	R->fed += Used;
+	if (consumed) *consumed = Used;
+	return(Made);
+}
+
+WAV_DECL int
+WAV_resampler_flush (WAV_Resampler *R, float *out, int capacity)
+{
+	WAV_ASSERT(R && R->hist, "invalid arg");
+
+	// every input frame gets the outputs it is owed: ceil(fed * up / down)
+	uint64_t Owed = (R->fed * R->up + R->down - 1) / R->down;
+	int Made = 0;
+
+	while (Made < capacity && R->made < Owed) {
+		uint64_t Left = Owed - R->made;
+		int Want = capacity - Made;
+		if ((uint64_t)Want > Left) Want = (int)Left;
+
+		int Got = WAV__resampler_drain(R, out + Made * R->channels, Want);
+		Made += Got;
+		if (Got == Want) continue;
+
+		WAV__resampler_compact(R);
+		if (R->flushed >= R->taps / 2) break; // nothing left to push through
+		R->flushed += WAV__resampler_feed(R, 0, R->taps / 2 - R->flushed);
+	}
+
+	return(Made);
 }
 
 WAV_DECL void
-WAV_free(WAV_Data *Doc)
+WAV_resampler_free (WAV_Resampler *R)
 {
-	WAV_FREE(Doc->data);
-	memset(Doc, 0, sizeof(WAV_Data));
+	if (!R) return;
+	WAV_FREE(R->coeffs);
+	WAV_FREE(R->hist);
+	memset(R, 0, sizeof(WAV_Resampler));
+}
+
+WAV_DECL WAV_BOOL
+WAV_resample (WAV_Data *Loaded, uint32_t rate, int mode)
+{
+	WAV_ASSERT(Loaded && Loaded->data && rate, "invalid arg");
+	if (rate == Loaded->dwSamplesPerSec) return(1); // no conversion needed
+
+	WAV_DBG(" - WAV: resampling %i -> %i - \n", (int)Loaded->dwSamplesPerSec, (int)rate);
+
+	uint32_t Bits = Loaded->wBitsPerSample;
+	WAV_convert_to_float(Loaded);
+
+	WAV_Resampler R;
+	if (!WAV_resampler_init(&R, Loaded->wChannels, Loaded->dwSamplesPerSec, rate, mode))
+		return(0);
+
+	uint64_t Frames = ((uint64_t)Loaded->dwSamples * R.up + R.down - 1) / R.down;
+	float *NewData = (float *)WAV_MALLOC(Frames * Loaded->wChannels * sizeof(float));
+	if (!NewData) {
+		WAV_resampler_free(&R);
+		return(0);
+	}
+
+	const float *In = (const float *)Loaded->data;
+	uint32_t Left = Loaded->dwSamples;
+	uint64_t Made = 0;
+	while (Left) {
+		int Used = 0;
+		int Chunk = (Left > (1u << 20)) ? (1 << 20) : (int)Left;
+		Made += WAV_resampler_process(&R, In, Chunk, &Used,
+			NewData + Made * Loaded->wChannels, (int)(Frames - Made));
+		In   += Used * Loaded->wChannels;
+		Left -= Used;
+	}
+	Made += WAV_resampler_flush(&R, NewData + Made * Loaded->wChannels, (int)(Frames - Made));
+	WAV_ASSERT(Made == Frames, "resampler produced the wrong number of frames");
+	WAV_resampler_free(&R);
+
+	// loops and cues move with the samples
+	uint64_t From = Loaded->dwSamplesPerSec;
+	for (uint32_t i=0; i < Loaded->nloops; ++i) {
+		WAV_Loop *L = Loaded->loops + i;
+		L->start = (uint32_t)((uint64_t)L->start * rate / From);
+		L->end   = (uint32_t)(((uint64_t)L->end + 1) * rate / From) - 1;
+	}
+	for (uint32_t i=0; i < Loaded->ncues; ++i)
+		Loaded->cues[i].frame = (uint32_t)((uint64_t)Loaded->cues[i].frame * rate / From);
+
+	WAV_FREE(Loaded->data);
+	Loaded->data             = (int8_t *)NewData;
+	Loaded->dwSamples        = (uint32_t)Frames;
+	Loaded->dwSamplesPerSec  = rate;
+	Loaded->dwAvgBytesPerSec = rate * Loaded->wChannels * (WAV_FLOAT / 8);
+
+	if (WAV_8BIT  == Bits) WAV_convert_to_8bit(Loaded);
+	if (WAV_16BIT == Bits) WAV_convert_to_16bit(Loaded);
+	Loaded->wBlockAlign      = Loaded->wChannels * (Loaded->wBitsPerSample / 8);
+	Loaded->dwAvgBytesPerSec = rate * Loaded->wBlockAlign;
+	return(1);
 }
 
 
+
 //////////////////////////////////////////////////////////////////////////////
-// primary API - conversion
+// primary API - analysis
 //
-WAV_DECL void
-WAV_convert_to_8bit  (WAV_Data *Loaded)
+#define WAV_ANALYZE_PREROLL_MS 200
+#define WAV_ANALYZE_CHUNK      4096
+
+// 4x upsampler for true-peak: phases 1..3 (phase 0 is the input itself)
+static WAV_BOOL WAV__sinc_coeffs_4x(float out[3][WAV_ANALYZE_TP_TAPS])
 {
-	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
-	if (WAV_8BIT == Loaded->wBitsPerSample) return; // no conversion needed
+	double Half = WAV_ANALYZE_TP_TAPS / 2;
+	for (int p=1; p < 4; ++p) {
+		double Sum = 0.0;
+		for (int k=0; k < WAV_ANALYZE_TP_TAPS; ++k) {
+			double v = WAV__sinc_kernel(p / 4.0 + (Half - 1) - k, 1.0, Half);
+			out[p-1][k] = (float)v;
+			Sum += v;
+		}
+		for (int k=0; k < WAV_ANALYZE_TP_TAPS; ++k) out[p-1][k] = (float)(out[p-1][k] / Sum);
+	}
+	return(1);
+}
 
-	WAV_DBG(" - WAV: converting to 8bit - \n");
+WAV_DECL WAV_BOOL
+WAV_analyzer_init (WAV_Analyzer *A, int channels, uint32_t rate)
+{
+	const double Pi = 3.14159265358979323846;
+	WAV_ASSERT(A && rate, "invalid arg");
+	memset(A, 0, sizeof(WAV_Analyzer));
 
-	int8_t *NewData = (int8_t *)WAV_MALLOC(
-		Loaded->dwSamples * Loaded->wChannels);
-	int8_t *D = NewData;
+	if (channels < 1 || channels > WAV_ANALYZE_MAX_CHANNELS) {
+		WAV_ERR("can't analyze %i channels\n", channels);
+		return(0);
+	}
+	A->channels     = channels;
+	A->rate         = rate;
+	A->block_frames = rate / 10;
+	if (!A->block_frames) A->block_frames = 1;
+
+	// BS.1770 K-weighting, redesigned for 'rate' (same as libebur128)
+	{
+		double F0 = 1681.974450955533;
+		double G  = 3.999843853973347;
+		double Q  = 0.7071752369554196;
+		double K  = tan(Pi * F0 / rate);
+		double Vh = pow(10.0, G / 20.0);
+		double Vb = pow(Vh, 0.4996667741545416);
+		double A0 = 1.0 + K / Q + K * K;
+		A->b[0][0] = (float)((Vh + Vb * K / Q + K * K) / A0);
+		A->b[0][1] = (float)(2.0 * (K * K - Vh) / A0);
+		A->b[0][2] = (float)((Vh - Vb * K / Q + K * K) / A0);
+		A->a[0][0] = (float)(2.0 * (K * K - 1.0) / A0);
+		A->a[0][1] = (float)((1.0 - K / Q + K * K) / A0);
+	}
+	{
+		double F0 = 38.13547087602444;
+		double Q  = 0.5003270373238773;
+		double K  = tan(Pi * F0 / rate);
+		double A0 = 1.0 + K / Q + K * K;
+		A->b[1][0] = 1.0f;
+		A->b[1][1] = -2.0f;
+		A->b[1][2] = 1.0f;
+		A->a[1][0] = (float)(2.0 * (K * K - 1.0) / A0);
+		A->a[1][1] = (float)((1.0 - K / Q + K * K) / A0);
+	}
 
-	switch (Loaded->wBitsPerSample) {
-		case WAV_16BIT:
-		{
-			int16_t  *P = (int16_t *)Loaded->data;
-			for (int i=0; i < Loaded->dwSamples * Loaded->wChannels; ++i)
-				*(D++) = (int8_t)(*(P++)/32767.0f * 127.0f);
-		} break;
-		case WAV_FLOAT:
-		{
-			float   *P = (float *)Loaded->data;
-			for (int i=0; i < Loaded->dwSamples * Loaded->wChannels; ++i)
-				*(D++) = (int8_t)(*(P++) * 127.0f);
-		} break;
-		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	// channel weights: surrounds are +1.5dB, LFE is left out (5.1 and 7.1)
+	for (int c=0; c < channels; ++c) A->weight[c] = 1.0f;
+	if (channels == 6 || channels == 8) {
+		A->weight[3] = 0.0f;
+		for (int c=4; c < channels; ++c) A->weight[c] = 1.41f;
+	}
+
+	WAV__sinc_coeffs_4x(A->tp_coeffs);
+	return(1);
+}
+
+WAV_DECL uint32_t
+WAV_analyzer_block_frames (const WAV_Analyzer *A)
+{
+	return(A->block_frames);
+}
+
+static WAV_BOOL WAV__analyzer_push_block(WAV_Analyzer *A, double ms)
+{
+	if (A->nblocks == A->blocks_cap) {
+		int Cap = A->blocks_cap ? A->blocks_cap * 2 : 64;
+		double *B = (double *)WAV_REALLOC(A->blocks, Cap * sizeof(double));
+		if (!B) return(0);
+		A->blocks = B;
+		A->blocks_cap = Cap;
+	}
+	A->blocks[A->nblocks++] = ms;
+	return(1);
+}
+
+// both K-weighting stages over a frame, four channels at a time
+static void WAV__kweight(WAV_Analyzer *A, float *X)
+{
+#if defined(WAV_SSE2)
+	for (int g=0; g < A->channels; g += 4) {
+		__m128 V = _mm_loadu_ps(X + g);
+		for (int s=0; s < 2; ++s) {
+			__m128 Z1 = _mm_loadu_ps(A->z[s][0] + g);
+			__m128 Z2 = _mm_loadu_ps(A->z[s][1] + g);
+			__m128 Y  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A->b[s][0]), V), Z1);
+			Z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(A->b[s][1]), V),
+			                           _mm_mul_ps(_mm_set1_ps(A->a[s][0]), Y)), Z2);
+			Z2 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(A->b[s][2]), V),
+			                _mm_mul_ps(_mm_set1_ps(A->a[s][1]), Y));
+			_mm_storeu_ps(A->z[s][0] + g, Z1);
+			_mm_storeu_ps(A->z[s][1] + g, Z2);
+			V = Y;
+		}
+		_mm_storeu_ps(X + g, V);
+	}
+#else
+	for (int c=0; c < A->channels; ++c) {
+		float V = X[c];
+		for (int s=0; s < 2; ++s) {
+			float Y = A->b[s][0] * V + A->z[s][0][c];
+			A->z[s][0][c] = A->b[s][1] * V - A->a[s][0] * Y + A->z[s][1][c];
+			A->z[s][1][c] = A->b[s][2] * V - A->a[s][1] * Y;
+			V = Y;
+		}
+		X[c] = V;
+	}
+#endif
+}
+
+static void WAV__analyzer_run(WAV_Analyzer *A, const float *in, int count, WAV_BOOL measure)
+{
+	int C = A->channels;
+	for (int i=0; i < count; ++i, in += C) {
+		// padded to a multiple of four for WAV__kweight
+		float X[WAV_ANALYZE_MAX_CHANNELS] = {0};
+		memcpy(X, in, C * sizeof(float));
+
+		// true peak: the three in-between phases of a 4x upsample
+		int Tp = A->tp_pos;
+		A->tp_pos = (Tp + 1 == WAV_ANALYZE_TP_TAPS) ? 0 : Tp + 1;
+		for (int c=0; c < C; ++c) {
+			float *H = A->tp_hist[c];
+			H[Tp] = H[Tp + WAV_ANALYZE_TP_TAPS] = X[c];
+			if (!measure) continue;
+
+			const float *Window = H + Tp + 1;
+			float Peak = fabsf(X[c]);
+			if (Peak > A->peak) A->peak = Peak;
+			A->sumsq += (double)X[c] * X[c];
+			for (int p=0; p < 3; ++p) {
+				float V = fabsf(WAV__dot(Window, A->tp_coeffs[p], WAV_ANALYZE_TP_TAPS));
+				if (V > Peak) Peak = V;
+			}
+			if (Peak > A->true_peak) A->true_peak = Peak;
+		}
+
+		WAV__kweight(A, X);
+		if (!measure) continue;
+
+		A->samples += C;
+		for (int c=0; c < C; ++c) A->acc[c] += X[c] * X[c];
+		if (++A->block_fill == A->block_frames) {
+			double Sum = 0.0;
+			for (int c=0; c < C; ++c) Sum += A->weight[c] * A->acc[c];
+			WAV__analyzer_push_block(A, Sum / A->block_frames);
+			memset(A->acc, 0, sizeof(A->acc));
+			A->block_fill = 0;
+		}
 	}
-	WAV_FREE(Loaded->data);
-	Loaded->wBitsPerSample = WAV_8BIT;
-	Loaded->data = (int8_t *)NewData;
 }
 
 WAV_DECL void
-WAV_convert_to_16bit (WAV_Data *Loaded)
+WAV_analyzer_feed (WAV_Analyzer *A, const float *frames, int count)
 {
-	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
-	if (WAV_16BIT == Loaded->wBitsPerSample) return; // no conversion needed
+	WAV_ASSERT(A && frames, "invalid arg");
+	WAV__analyzer_run(A, frames, count, 1);
+}
 
-	WAV_DBG(" - WAV: converting to 8bit - \n");
+WAV_DECL void
+WAV_analyzer_preroll (WAV_Analyzer *A, const float *frames, int count)
+{
+	WAV_ASSERT(A && frames, "invalid arg");
+	WAV__analyzer_run(A, frames, count, 0);
+}
 
-	int16_t *NewData = (int16_t *)WAV_MALLOC(
-		Loaded->dwSamples * Loaded->wChannels * 2);
-	int16_t *D = NewData;
+WAV_DECL WAV_BOOL
+WAV_analyze_range (const WAV_Data *Loaded, uint32_t first, uint32_t count, WAV_Analyzer *A)
+{
+	WAV_ASSERT(Loaded && Loaded->data && A, "invalid arg");
+	if (first > Loaded->dwSamples) first = Loaded->dwSamples;
+	if (count > Loaded->dwSamples - first) count = Loaded->dwSamples - first;
+
+	WAV__cursor Cur;
+	float *Frames = (float *)WAV_MALLOC(WAV_ANALYZE_CHUNK * A->channels * sizeof(float));
+	if (!Frames || !WAV__cursor_begin(&Cur, Loaded)) {
+		WAV_FREE(Frames);
+		return(0);
+	}
 
-	switch (Loaded->wBitsPerSample) {
-		case WAV_8BIT:
-		{
-			int8_t  *P = (int8_t *)Loaded->data;
-			for (int i=0; i < Loaded->dwSamples * Loaded->wChannels; ++i)
-				*(D++) = (int16_t)(*(P++)/127.0f * 32767.0f);
-		} break;
-		case WAV_FLOAT:
-		{
-			float   *P = (float *)Loaded->data;
-			for (int i=0; i < Loaded->dwSamples * Loaded->wChannels; ++i)
-				*(D++) = (int16_t)(*(P++) * 32767.0f);
-		} break;
-		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	uint32_t Preroll = (uint32_t)((uint64_t)A->rate * WAV_ANALYZE_PREROLL_MS / 1000);
+	if (Preroll > first) Preroll = first;
+	WAV__cursor_seek(&Cur, first - Preroll);
+
+	for (uint32_t Left = Preroll; Left; ) {
+		int N = WAV__cursor_read(&Cur, Frames, Left < WAV_ANALYZE_CHUNK ? (int)Left : WAV_ANALYZE_CHUNK);
+		if (N <= 0) break;
+		WAV_analyzer_preroll(A, Frames, N);
+		Left -= N;
 	}
-	WAV_FREE(Loaded->data);
-	Loaded->wBitsPerSample = WAV_16BIT;
-	Loaded->data = (int8_t *)NewData;
+	for (uint32_t Left = count; Left; ) {
+		int N = WAV__cursor_read(&Cur, Frames, Left < WAV_ANALYZE_CHUNK ? (int)Left : WAV_ANALYZE_CHUNK);
+		if (N <= 0) break;
+		WAV_analyzer_feed(A, Frames, N);
+		Left -= N;
+	}
+
+	WAV__cursor_end(&Cur);
+	WAV_FREE(Frames);
+	return(1);
+}
+
+WAV_DECL WAV_BOOL
+WAV_analyzer_merge (WAV_Analyzer *A, const WAV_Analyzer *Next)
+{
+	WAV_ASSERT(A && Next, "invalid arg");
+	if (A->channels != Next->channels || A->rate != Next->rate) return(0);
+
+	// an unfinished sub-block in A can't be joined to Next's, which started
+	// a fresh one. chunks split on WAV_analyzer_block_frames never have one.
+	for (int i=0; i < Next->nblocks; ++i)
+		if (!WAV__analyzer_push_block(A, Next->blocks[i])) return(0);
+
+	if (Next->peak > A->peak) A->peak = Next->peak;
+	if (Next->true_peak > A->true_peak) A->true_peak = Next->true_peak;
+	A->sumsq   += Next->sumsq;
+	A->samples += Next->samples;
+
+	// carry on from where Next left off
+	memcpy(A->z, Next->z, sizeof(A->z));
+	memcpy(A->tp_hist, Next->tp_hist, sizeof(A->tp_hist));
+	memcpy(A->acc, Next->acc, sizeof(A->acc));
+	A->tp_pos     = Next->tp_pos;
+	A->block_fill = Next->block_fill;
+	return(1);
 }
 
 WAV_DECL void
-WAV_convert_to_float (WAV_Data *Loaded)
+WAV_analyzer_finish (const WAV_Analyzer *A, WAV_Analysis *out)
 {
-	WAV_ASSERT(Loaded && Loaded->data, "invalid arg");
-	if (WAV_FLOAT == Loaded->wBitsPerSample) return; // no conversion needed
+	WAV_ASSERT(A && out, "invalid arg");
+	out->peak      = A->peak;
+	out->true_peak = A->true_peak;
+	out->rms       = A->samples ? (float)sqrt(A->sumsq / A->samples) : 0.0f;
+	out->loudness  = -HUGE_VALF;
+
+	// 400ms gating blocks, overlapping by 75%
+	int NGates = A->nblocks - 3;
+	if (NGates <= 0) return;
+
+	// absolute gate at -70 LUFS, then relative gate 10 LU below the mean
+	const double Absolute = pow(10.0, (-70.0 + 0.691) / 10.0);
+	double Sum = 0.0;
+	int    N   = 0;
+	for (int i=0; i < NGates; ++i) {
+		double Z = (A->blocks[i] + A->blocks[i+1] + A->blocks[i+2] + A->blocks[i+3]) * 0.25;
+		if (Z > Absolute) { Sum += Z; ++N; }
+	}
+	if (!N) return;
+
+	double Relative = (Sum / N) * pow(10.0, -10.0 / 10.0);
+	Sum = 0.0;
+	N   = 0;
+	for (int i=0; i < NGates; ++i) {
+		double Z = (A->blocks[i] + A->blocks[i+1] + A->blocks[i+2] + A->blocks[i+3]) * 0.25;
+		if (Z > Absolute && Z > Relative) { Sum += Z; ++N; }
+	}
+	if (N) out->loudness = (float)(-0.691 + 10.0 * log10(Sum / N));
+}
 
-	WAV_DBG(" - WAV: converting to 8bit - \n");
+WAV_DECL void
+WAV_analyzer_free (WAV_Analyzer *A)
+{
+	if (!A) return;
+	WAV_FREE(A->blocks);
+	memset(A, 0, sizeof(WAV_Analyzer));
+}
 
-	float *NewData = (float *)WAV_MALLOC(
-		Loaded->dwSamples * Loaded->wChannels * 4);
-	float *D = NewData;
+WAV_DECL WAV_BOOL
+WAV_analyze (const WAV_Data *Loaded, WAV_Analysis *out)
+{
+	WAV_ASSERT(Loaded && out, "invalid arg");
+	WAV_Analyzer A;
+	if (!WAV_analyzer_init(&A, Loaded->wChannels, Loaded->dwSamplesPerSec)) return(0);
 
-	switch (Loaded->wBitsPerSample) {
-		case WAV_8BIT:
-		{
-			int8_t  *P = (int8_t *)Loaded->data;
-			for (int i=0; i < Loaded->dwSamples * Loaded->wChannels; ++i)
-				*(D++) = (*(P++)/127.0f);
-		} break;
-		case WAV_16BIT:
-		{
-			int16_t  *P = (int16_t *)Loaded->data;
-			for (int i=0; i < Loaded->dwSamples * Loaded->wChannels; ++i)
-				*(D++) = (*(P++)/32767.0f);
-		} break;
-		default: WAV_ASSERT(0, "INVALID DEFAULT CASE"); break;
+	WAV_BOOL R = WAV_analyze_range(Loaded, 0, Loaded->dwSamples, &A);
+	if (R) WAV_analyzer_finish(&A, out);
+	WAV_analyzer_free(&A);
+	return(R);
+}
+
+WAV_DECL WAV_BOOL
+WAV_analyze_stream (WAV_Stream *S, WAV_Analysis *out)
+{
+	WAV_ASSERT(S && out, "invalid arg");
+	WAV_Analyzer A;
+	if (!WAV_analyzer_init(&A, S->info.wChannels, S->info.dwSamplesPerSec)) return(0);
+
+	float *Frames = (float *)WAV_MALLOC(WAV_ANALYZE_CHUNK * A.channels * sizeof(float));
+	if (!Frames) {
+		WAV_analyzer_free(&A);
+		return(0);
 	}
-	WAV_FREE(Loaded->data);
-	Loaded->wBitsPerSample = WAV_FLOAT;
-	Loaded->data = (int8_t *)NewData;
+
+	int N;
+	while ((N = WAV_stream_read(S, Frames, WAV_ANALYZE_CHUNK)) > 0)
+		WAV_analyzer_feed(&A, Frames, N);
+
+	WAV_analyzer_finish(&A, out);
+	WAV_FREE(Frames);
+	WAV_analyzer_free(&A);
+	return(1);
 }
 
 